@@ -0,0 +1,550 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "precomp.h"
+#include "plugins/plugins_api.h"
+
+#include "async.h"
+#include "latency.h"
+#include "stats.h"
+#include "port.h"
+#include "comhub.h"
+#include "filter.h"
+#include "hubmsg.h"
+#include "bufutils.h"
+
+///////////////////////////////////////////////////////////////
+#define ASYNC_BATCH 16    // max jobs of one stage run at once
+///////////////////////////////////////////////////////////////
+struct AsyncJob
+{
+  AsyncJob *pNext;
+  AsyncStage *pStage;
+  BOOL out;               // OUT method (IN method otherwise)
+  BOOL echo;              // echo of the IN methods
+  BOOL method;            // call the method of the filter
+  BOOL offload;           // can be run by the offload thread
+  BOOL ok;
+  Port *pFromPort;
+  Port *pToPort;
+  HubMsg *pMsg;
+  HubMsg *pEchoMsg;
+  LONGLONG start;
+};
+///////////////////////////////////////////////////////////////
+static __declspec(thread) int iCurWorker = -1;
+///////////////////////////////////////////////////////////////
+BOOL AsyncPool::Start(unsigned numThreads)
+{
+  _ASSERTE(workers.empty());
+
+  if (!numThreads)
+    numThreads = 1;
+
+  hReady = ::CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+
+  if (!hReady) {
+    DWORD err = GetLastError();
+
+    cerr << "CreateSemaphore() - error=" << err << endl;
+    return FALSE;
+  }
+
+  for (unsigned i = 0 ; i < numThreads ; i++) {
+    Worker *pWorker = new Worker;
+
+    if (!pWorker) {
+      cerr << "No enough memory." << endl;
+      return FALSE;
+    }
+
+    pWorker->pPool = this;
+    pWorker->index = i;
+    ::InitializeCriticalSection(&pWorker->lock);
+
+    workers.push_back(pWorker);
+  }
+
+  for (vector<Worker *>::const_iterator i = workers.begin() ; i != workers.end() ; i++) {
+    DWORD id;
+    HANDLE hThread = ::CreateThread(NULL, 0, ThreadProc, *i, 0, &id);
+
+    if (!hThread) {
+      DWORD err = GetLastError();
+
+      cerr << "CreateThread() - error=" << err << endl;
+      return FALSE;
+    }
+
+    ::CloseHandle(hThread);
+  }
+
+  cout << "Started " << numThreads << " offload thread(s)" << endl;
+
+  return TRUE;
+}
+
+void AsyncPool::Schedule(AsyncStage *pStage)
+{
+  _ASSERTE(!workers.empty());
+
+  // the offload threads keep the rescheduled stages,
+  // the new ones are spread round-robin
+
+  unsigned iWorker;
+
+  if (iCurWorker >= 0)
+    iWorker = (unsigned)iCurWorker;
+  else
+    iWorker = (unsigned)::InterlockedIncrement(&iNext) % (unsigned)workers.size();
+
+  Worker *pWorker = workers[iWorker];
+
+  ::EnterCriticalSection(&pWorker->lock);
+  pWorker->stages.push_back(pStage);
+  ::LeaveCriticalSection(&pWorker->lock);
+
+  ::ReleaseSemaphore(hReady, 1, NULL);
+}
+
+AsyncStage *AsyncPool::Pop(unsigned iWorker)
+{
+  AsyncStage *pStage = NULL;
+
+  for (unsigned n = 0 ; n < workers.size() && !pStage ; n++) {
+    Worker *pWorker = workers[(iWorker + n) % workers.size()];
+
+    ::EnterCriticalSection(&pWorker->lock);
+
+    if (!pWorker->stages.empty()) {
+      if (n == 0) {
+        pStage = pWorker->stages.front();
+        pWorker->stages.pop_front();
+      } else {
+        pStage = pWorker->stages.back();
+        pWorker->stages.pop_back();
+      }
+    }
+
+    ::LeaveCriticalSection(&pWorker->lock);
+  }
+
+  return pStage;
+}
+
+DWORD CALLBACK AsyncPool::ThreadProc(LPVOID pParam)
+{
+  Worker *pWorker = (Worker *)pParam;
+  AsyncPool *pPool = pWorker->pPool;
+
+  iCurWorker = (int)pWorker->index;
+
+  for (;;) {
+    ::WaitForSingleObject(pPool->hReady, INFINITE);
+
+    AsyncStage *pStage = pPool->Pop(pWorker->index);
+
+    if (pStage)
+      pStage->Run();
+  }
+}
+///////////////////////////////////////////////////////////////
+static HubMsg *Detach(HubMsg *pMsg)
+{
+  HubMsgChain msgs;
+
+  for (HubMsg *pCurMsg = pMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+    HubMsg *pNewMsg = new HubMsg();
+
+    if (!pNewMsg) {
+      cerr << "No enough memory." << endl;
+      return NULL;
+    }
+
+    *(HUB_MSG *)pNewMsg = *(HUB_MSG *)pCurMsg;
+    ::memset((HUB_MSG *)pCurMsg, 0, sizeof(HUB_MSG));
+
+    msgs.Append(pNewMsg);
+
+    // the buffer can be modified by the offload thread,
+    // so it should not be shared with other messages
+
+    if ((pNewMsg->type & HUB_MSG_UNION_TYPES_MASK) == HUB_MSG_UNION_TYPE_BUF) {
+      if (!BufMakeWritable(&pNewMsg->u.buf.pBuf, pNewMsg->u.buf.size)) {
+        cerr << "No enough memory." << endl;
+        return NULL;
+      }
+    }
+  }
+
+  return msgs.Detach();
+}
+
+static void DeleteJob(AsyncJob *pJob)
+{
+  if (pJob->pMsg)
+    delete pJob->pMsg;
+
+  if (pJob->pEchoMsg)
+    delete pJob->pEchoMsg;
+
+  delete pJob;
+}
+///////////////////////////////////////////////////////////////
+AsyncStage::AsyncStage(const ComHub &_hub, FilterInstance &_instance, AsyncPool &_pool)
+  : hub(_hub),
+    instance(_instance),
+    pool(_pool),
+    pHead(NULL),
+    pTail(NULL),
+    state(STATE_IDLE),
+    pending(0),
+    hThread(NULL)
+{
+  ::InitializeCriticalSection(&lock);
+}
+
+AsyncStage::~AsyncStage()
+{
+  while (pHead) {
+    AsyncJob *pJob = pHead;
+
+    pHead = pJob->pNext;
+    DeleteJob(pJob);
+  }
+
+  if (hThread)
+    ::CloseHandle(hThread);
+
+  ::DeleteCriticalSection(&lock);
+}
+
+void AsyncStage::In(Port *pFromPort, HubMsg *pMsg)
+{
+  _ASSERTE(pFromPort == &instance.port);
+  _ASSERTE(pMsg->Next() == NULL);
+
+  instance.inStats.Add(pMsg);
+
+  Put(FALSE, FALSE, instance.pInMethod != NULL, pFromPort, pFromPort, pMsg);
+}
+
+void AsyncStage::Out(Port *pFromPort, Port *pToPort, HubMsg *pMsg, BOOL echo)
+{
+  _ASSERTE(pToPort == &instance.port);
+
+  // the echo of the next filters of the port is handled by all
+  // OUT methods, the routed messages only if the source matches
+
+  BOOL method = instance.pOutMethod &&
+                (echo || !instance.pSrcPorts ||
+                 instance.pSrcPorts->find(pFromPort) != instance.pSrcPorts->end());
+
+  if (method)
+    instance.outStats.Add(pMsg);
+
+  Put(TRUE, echo, method, pFromPort, pToPort, pMsg);
+}
+
+void AsyncStage::Put(BOOL out, BOOL echo, BOOL method, Port *pFromPort, Port *pToPort, HubMsg *pMsg)
+{
+  AsyncJob job;
+
+  job.pNext = NULL;
+  job.pStage = this;
+  job.out = out;
+  job.echo = echo;
+  job.method = method;
+  job.offload = TRUE;
+  job.ok = TRUE;
+  job.pFromPort = pFromPort;
+  job.pToPort = pToPort;
+  job.pMsg = pMsg;
+  job.pEchoMsg = NULL;
+  job.start = LatencyHist::Counter();
+
+  if (method) {
+    for (HubMsg *pCurMsg = pMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+      if (pCurMsg->type != HUB_MSG_TYPE_LINE_DATA) {
+        job.offload = FALSE;
+        break;
+      }
+    }
+  }
+
+  ::EnterCriticalSection(&lock);
+  BOOL idle = (state == STATE_IDLE && !pending);
+  ::LeaveCriticalSection(&lock);
+
+  // nothing is queued or waiting for the completion, so the
+  // message can be processed at once
+  // (the messages with pointers to the caller's data are sent only
+  // on starting the ports, so they are always processed here)
+
+  if (idle && (!job.offload || !job.method)) {
+    Complete(job);
+
+    if (job.pEchoMsg)
+      delete job.pEchoMsg;
+
+    return;
+  }
+
+  AsyncJob *pJob = new AsyncJob(job);
+
+  if (!pJob) {
+    cerr << "No enough memory." << endl;
+    return;
+  }
+
+  pJob->pMsg = Detach(pMsg);
+
+  if (!pJob->pMsg) {
+    delete pJob;
+    return;
+  }
+
+  Submit(pJob);
+}
+
+void AsyncStage::Submit(AsyncJob *pJob)
+{
+  if (!hThread && !SetThread()) {
+    Execute(*pJob);
+    Complete(*pJob);
+    DeleteJob(pJob);
+    return;
+  }
+
+  BOOL schedule = FALSE;
+
+  ::EnterCriticalSection(&lock);
+
+  if (pTail)
+    pTail->pNext = pJob;
+  else
+    pHead = pJob;
+
+  pTail = pJob;
+  pending++;
+
+  if (state == STATE_IDLE) {
+    state = STATE_SCHEDULED;
+    schedule = TRUE;
+  }
+
+  ::LeaveCriticalSection(&lock);
+
+  if (schedule)
+    pool.Schedule(this);
+}
+
+BOOL AsyncStage::SetThread()
+{
+  // the jobs are submitted by the thread of the port only
+
+  if (!::DuplicateHandle(::GetCurrentProcess(), ::GetCurrentThread(),
+                         ::GetCurrentProcess(), &hThread,
+                         0, FALSE, DUPLICATE_SAME_ACCESS))
+  {
+    DWORD err = GetLastError();
+
+    cerr << "WARNING: DuplicateHandle() - error=" << err << endl;
+
+    hThread = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void AsyncStage::Run()
+{
+  for (int n = 0 ; n < ASYNC_BATCH ; n++) {
+    ::EnterCriticalSection(&lock);
+
+    _ASSERTE(state == STATE_SCHEDULED);
+
+    AsyncJob *pJob = pHead;
+
+    if (!pJob) {
+      state = STATE_IDLE;
+      ::LeaveCriticalSection(&lock);
+      return;
+    }
+
+    pHead = pJob->pNext;
+
+    if (!pHead)
+      pTail = NULL;
+
+    pJob->pNext = NULL;
+
+    BOOL offload = pJob->offload;
+
+    if (!offload)
+      state = STATE_STOPPED;
+
+    ::LeaveCriticalSection(&lock);
+
+    if (offload)
+      Execute(*pJob);
+
+    if (!::QueueUserAPC(CompleteAPC, hThread, (ULONG_PTR)pJob)) {
+      DWORD err = GetLastError();
+
+      cerr << "WARNING: QueueUserAPC() - error=" << err << endl;
+
+      DeleteJob(pJob);
+
+      ::EnterCriticalSection(&lock);
+
+      _ASSERTE(pending > 0);
+      pending--;
+
+      if (!offload)
+        state = STATE_SCHEDULED;
+
+      ::LeaveCriticalSection(&lock);
+
+      continue;
+    }
+
+    // the stopped stage will be resumed by the thread of the port
+
+    if (!offload)
+      return;
+  }
+
+  // give a chance to other stages
+
+  pool.Schedule(this);
+}
+
+void AsyncStage::Execute(AsyncJob &job) const
+{
+  if (!job.method)
+    return;
+
+  HFILTER hFilter = instance.HFilter();
+  HFILTERINSTANCE hFilterInstance = instance.hFilterInstance;
+  HubMsg *pNextMsg = job.pMsg;
+
+  if (job.out) {
+    for (HubMsg *pCurMsg = pNextMsg ; pCurMsg ; pCurMsg = pNextMsg) {
+      pNextMsg = pNextMsg->Next();
+
+      if (!instance.pOutMethod(hFilter, hFilterInstance, (HMASTERPORT)job.pFromPort, pCurMsg)) {
+        job.ok = FALSE;
+        return;
+      }
+    }
+  } else {
+    HubMsgChain echoMsgs;
+
+    for (HubMsg *pCurMsg = pNextMsg ; pCurMsg ; pCurMsg = pNextMsg) {
+      pNextMsg = pNextMsg->Next();
+
+      HUB_MSG *pEchoMsgPart = NULL;
+
+      if (!instance.pInMethod(hFilter, hFilterInstance, pCurMsg, &pEchoMsgPart)) {
+        if (pEchoMsgPart)
+          delete (HubMsg *)pEchoMsgPart;
+
+        job.ok = FALSE;
+        return;
+      }
+
+      echoMsgs.Append((HubMsg *)pEchoMsgPart);
+    }
+
+    job.pEchoMsg = echoMsgs.Detach();
+  }
+}
+
+void AsyncStage::Complete(AsyncJob &job)
+{
+  if (!job.offload)
+    Execute(job);
+
+  if (job.out) {
+    if (job.method)
+      instance.outLatency.Add(job.start);
+
+    if (job.ok)
+      hub.Write(job.pFromPort, job.pToPort, job.pMsg, job.echo);
+  } else {
+    if (job.method)
+      instance.inLatency.Add(job.start);
+
+    // the echo of the async filter is not handled by its own OUT
+    // method, it's queued to keep the order with the routed data
+
+    if (job.pEchoMsg)
+      Put(TRUE, TRUE, FALSE, job.pFromPort, job.pFromPort, job.pEchoMsg);
+
+    hub.OnFilteredRead(job.pFromPort, job.pMsg);
+  }
+}
+
+void AsyncStage::Resume()
+{
+  BOOL schedule = FALSE;
+
+  ::EnterCriticalSection(&lock);
+
+  _ASSERTE(state == STATE_STOPPED);
+
+  if (pHead) {
+    state = STATE_SCHEDULED;
+    schedule = TRUE;
+  } else {
+    state = STATE_IDLE;
+  }
+
+  ::LeaveCriticalSection(&lock);
+
+  if (schedule)
+    pool.Schedule(this);
+}
+
+VOID CALLBACK AsyncStage::CompleteAPC(ULONG_PTR pParam)
+{
+  AsyncJob *pJob = (AsyncJob *)pParam;
+  AsyncStage *pStage = pJob->pStage;
+
+  pStage->Complete(*pJob);
+
+  ::EnterCriticalSection(&pStage->lock);
+  _ASSERTE(pStage->pending > 0);
+  pStage->pending--;
+  ::LeaveCriticalSection(&pStage->lock);
+
+  if (!pJob->offload)
+    pStage->Resume();
+
+  DeleteJob(pJob);
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,119 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#ifndef _ASYNC_H
+#define _ASYNC_H
+
+///////////////////////////////////////////////////////////////
+class ComHub;
+class Port;
+class HubMsg;
+class FilterInstance;
+class AsyncStage;
+struct AsyncJob;
+///////////////////////////////////////////////////////////////
+// Pool of offload threads for the async filters (--async-filter
+// option).
+//
+// Each thread has its own deque of ready stages. The thread takes
+// the stages from the front of its own deque and, if it's empty,
+// steals them from the back of the deques of other threads.
+///////////////////////////////////////////////////////////////
+class AsyncPool
+{
+  public:
+    AsyncPool() : hReady(NULL), iNext(0) {}
+
+    BOOL Start(unsigned numThreads);
+    void Schedule(AsyncStage *pStage);
+
+  private:
+    struct Worker {
+      AsyncPool *pPool;
+      unsigned index;
+      CRITICAL_SECTION lock;
+      deque<AsyncStage *> stages;
+    };
+
+    AsyncStage *Pop(unsigned iWorker);
+
+    static DWORD CALLBACK ThreadProc(LPVOID pParam);
+
+    vector<Worker *> workers;
+    HANDLE hReady;
+    LONG iNext;
+};
+///////////////////////////////////////////////////////////////
+// Async stage of the filter instance.
+//
+// The messages are processed by the filter methods one by one in
+// the order of arrival and the results are returned to the thread
+// of the port by APC in the same order, so the order of messages
+// of the port is kept. A message is processed at once only if no
+// any submitted job is waiting for the completion. Only LINE_DATA is processed by the offload
+// threads, other messages are processed by the thread of the port
+// while the stage is stopped.
+///////////////////////////////////////////////////////////////
+class AsyncStage
+{
+  public:
+    AsyncStage(const ComHub &_hub, FilterInstance &_instance, AsyncPool &_pool);
+    ~AsyncStage();
+
+    void In(Port *pFromPort, HubMsg *pMsg);
+    void Out(Port *pFromPort, Port *pToPort, HubMsg *pMsg, BOOL echo);
+    void Run();
+
+  private:
+    enum State {
+      STATE_IDLE,       // no any queued job
+      STATE_SCHEDULED,  // in the deque of the pool or running
+      STATE_STOPPED,    // waiting for the thread of the port
+    };
+
+    void Put(BOOL out, BOOL echo, BOOL method, Port *pFromPort, Port *pToPort, HubMsg *pMsg);
+    void Submit(AsyncJob *pJob);
+    void Execute(AsyncJob &job) const;
+    void Complete(AsyncJob &job);
+    void Resume();
+    BOOL SetThread();
+
+    static VOID CALLBACK CompleteAPC(ULONG_PTR pParam);
+
+    const ComHub &hub;
+    FilterInstance &instance;
+    AsyncPool &pool;
+
+    CRITICAL_SECTION lock;
+    AsyncJob *pHead;
+    AsyncJob *pTail;
+    State state;
+    DWORD pending;      // the submitted jobs not completed yet
+
+    HANDLE hThread;
+};
+///////////////////////////////////////////////////////////////
+
+#endif  // _ASYNC_H
@@ -0,0 +1,295 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+
+#include "bufutils.h"
+
+///////////////////////////////////////////////////////////////
+#define BUF_POOL_CLASSES (BUF_POOL_MAX_SHIFT - BUF_POOL_MIN_SHIFT + 1)
+///////////////////////////////////////////////////////////////
+struct FreeBlock {
+  FreeBlock *pNext;
+};
+///////////////////////////////////////////////////////////////
+struct RemoteBlock {
+  RemoteBlock *pNext;
+  DWORD size;
+};
+///////////////////////////////////////////////////////////////
+struct SizeClass {
+  FreeBlock *pFree;     // free list
+  DWORD countFree;      // blocks in free list
+  DWORD countUsed;      // blocks in use
+  DWORD countUsedMax;   // high-water mark of blocks in use
+};
+///////////////////////////////////////////////////////////////
+//
+// The pool is per thread, so the free lists do not need locking.
+// The buffers allocated by the offload threads of the async
+// filters are freed by the threads of the ports and vice versa,
+// so each block keeps its pool and the block freed by other thread
+// is pushed to the remote list of its pool. The remote list is
+// taken by the thread of the pool on the next allocation or
+// trimming.
+//
+// The pools are never deleted (the threads are not terminated
+// while the process runs).
+//
+struct ThreadPool {
+  SizeClass sizeClasses[BUF_POOL_CLASSES];
+
+  DWORD countAllocs;
+  DWORD countHits;
+  DWORD countAllocsReported;
+  DWORD countHitsReported;
+  DWORD countLarge;
+  DWORD sizeLarge;
+
+  RemoteBlock *volatile pRemote;
+};
+///////////////////////////////////////////////////////////////
+struct BlockHdr {
+  ThreadPool *pPool;
+};
+///////////////////////////////////////////////////////////////
+static __declspec(thread) ThreadPool *pThreadPool;
+///////////////////////////////////////////////////////////////
+static ThreadPool *GetPool()
+{
+  if (!pThreadPool) {
+    pThreadPool = new ThreadPool;
+
+    if (!pThreadPool) {
+      cerr << "No enough memory." << endl;
+      exit(2);
+    }
+
+    ::memset(pThreadPool, 0, sizeof(*pThreadPool));
+  }
+
+  return pThreadPool;
+}
+///////////////////////////////////////////////////////////////
+static int SizeClassIndex(DWORD size)
+{
+  int iClass = 0;
+
+  for (DWORD sizeClass = ((DWORD)1 << BUF_POOL_MIN_SHIFT) ; sizeClass < size ; sizeClass <<= 1)
+    iClass++;
+
+  return iClass;
+}
+
+static DWORD SizeClassSize(int iClass)
+{
+  return (DWORD)1 << (BUF_POOL_MIN_SHIFT + iClass);
+}
+///////////////////////////////////////////////////////////////
+static void FreeLocal(ThreadPool &pool, BYTE *pRaw, DWORD sizeRaw)
+{
+  if (sizeRaw > BUF_POOL_MAX_BLOCK) {
+    _ASSERTE(pool.countLarge > 0);
+    _ASSERTE(pool.sizeLarge >= sizeRaw);
+
+    pool.countLarge--;
+    pool.sizeLarge -= sizeRaw;
+
+    delete [] pRaw;
+    return;
+  }
+
+  int iClass = SizeClassIndex(sizeRaw);
+  SizeClass &sc = pool.sizeClasses[iClass];
+
+  _ASSERTE(SizeClassSize(iClass) == sizeRaw);
+  _ASSERTE(sc.countUsed > 0);
+
+  sc.countUsed--;
+
+  FreeBlock *pFreeBlock = (FreeBlock *)pRaw;
+
+  pFreeBlock->pNext = sc.pFree;
+  sc.pFree = pFreeBlock;
+  sc.countFree++;
+}
+
+static void FreeRemote(ThreadPool &pool)
+{
+  RemoteBlock *pNextBlock = (RemoteBlock *)::InterlockedExchangePointer((PVOID volatile *)&pool.pRemote, NULL);
+
+  while (pNextBlock) {
+    RemoteBlock *pBlock = pNextBlock;
+
+    pNextBlock = pBlock->pNext;
+
+    FreeLocal(pool, (BYTE *)pBlock - sizeof(BlockHdr), pBlock->size + sizeof(BlockHdr));
+  }
+}
+///////////////////////////////////////////////////////////////
+BYTE *BufPool::Alloc(DWORD *pSize)
+{
+  _ASSERTE(pSize != NULL);
+
+  ThreadPool &pool = *GetPool();
+
+  if (pool.pRemote)
+    FreeRemote(pool);
+
+  pool.countAllocs++;
+
+  DWORD sizeRaw = *pSize + sizeof(BlockHdr);
+  BYTE *pRaw;
+
+  if (sizeRaw > BUF_POOL_MAX_BLOCK) {
+    pRaw = new BYTE[sizeRaw];
+
+    if (!pRaw)
+      return NULL;
+
+    pool.countLarge++;
+    pool.sizeLarge += sizeRaw;
+  } else {
+    int iClass = SizeClassIndex(sizeRaw);
+    SizeClass &sc = pool.sizeClasses[iClass];
+
+    sizeRaw = SizeClassSize(iClass);
+
+    if (sc.pFree) {
+      pRaw = (BYTE *)sc.pFree;
+      sc.pFree = sc.pFree->pNext;
+
+      _ASSERTE(sc.countFree > 0);
+      sc.countFree--;
+
+      pool.countHits++;
+    } else {
+      pRaw = new BYTE[sizeRaw];
+
+      if (!pRaw)
+        return NULL;
+    }
+
+    if (++sc.countUsed > sc.countUsedMax)
+      sc.countUsedMax = sc.countUsed;
+  }
+
+  ((BlockHdr *)pRaw)->pPool = &pool;
+
+  *pSize = sizeRaw - sizeof(BlockHdr);
+
+  return pRaw + sizeof(BlockHdr);
+}
+///////////////////////////////////////////////////////////////
+void BufPool::Free(BYTE *pBlock, DWORD size)
+{
+  _ASSERTE(pBlock != NULL);
+
+  BYTE *pRaw = pBlock - sizeof(BlockHdr);
+  ThreadPool *pPool = ((BlockHdr *)pRaw)->pPool;
+
+  _ASSERTE(pPool != NULL);
+
+  if (pPool == pThreadPool) {
+    FreeLocal(*pPool, pRaw, size + sizeof(BlockHdr));
+    return;
+  }
+
+  // return the block to the pool of the thread allocated it
+
+  RemoteBlock *pRemoteBlock = (RemoteBlock *)pBlock;
+
+  pRemoteBlock->size = size;
+
+  for (;;) {
+    RemoteBlock *pHead = pPool->pRemote;
+
+    pRemoteBlock->pNext = pHead;
+
+    if (::InterlockedCompareExchangePointer((PVOID volatile *)&pPool->pRemote, pRemoteBlock, pHead) == pHead)
+      break;
+  }
+}
+///////////////////////////////////////////////////////////////
+void BufPool::Trim()
+{
+  ThreadPool &pool = *GetPool();
+
+  FreeRemote(pool);
+
+  for (int iClass = 0 ; iClass < BUF_POOL_CLASSES ; iClass++) {
+    SizeClass &sc = pool.sizeClasses[iClass];
+
+    _ASSERTE(sc.countUsedMax >= sc.countUsed);
+
+    // keep enough free blocks to reach the high-water mark again
+
+    DWORD countKeep = sc.countUsedMax - sc.countUsed;
+
+    while (sc.countFree > countKeep) {
+      FreeBlock *pFreeBlock = sc.pFree;
+
+      _ASSERTE(pFreeBlock != NULL);
+
+      sc.pFree = pFreeBlock->pNext;
+      sc.countFree--;
+
+      delete [] (BYTE *)pFreeBlock;
+    }
+
+    sc.countUsedMax = sc.countUsed;
+  }
+}
+///////////////////////////////////////////////////////////////
+void BufPool::Report()
+{
+  ThreadPool &pool = *GetPool();
+
+  if (pool.countAllocs == pool.countAllocsReported)
+    return;
+
+  DWORD countUsed = pool.countLarge;
+  DWORD sizeUsed = pool.sizeLarge;
+  DWORD countFree = 0;
+  DWORD sizeFree = 0;
+
+  for (int iClass = 0 ; iClass < BUF_POOL_CLASSES ; iClass++) {
+    const SizeClass &sc = pool.sizeClasses[iClass];
+
+    countUsed += sc.countUsed;
+    sizeUsed += sc.countUsed * SizeClassSize(iClass);
+    countFree += sc.countFree;
+    sizeFree += sc.countFree * SizeClassSize(iClass);
+  }
+
+  cout << "Buffers: allocations " << (pool.countAllocs - pool.countAllocsReported)
+       << ", hits " << (pool.countHits - pool.countHitsReported)
+       << ", used " << countUsed << " (" << sizeUsed << " bytes)"
+       << ", held " << countFree << " (" << sizeFree << " bytes)"
+       << endl;
+
+  pool.countAllocsReported = pool.countAllocs;
+  pool.countHitsReported = pool.countHits;
+}
+///////////////////////////////////////////////////////////////
@@ -31,29 +31,69 @@
 ///////////////////////////////////////////////////////////////
 #define BUF_SIGNATURE 'h4cB'
 ///////////////////////////////////////////////////////////////
+//
+// Buffer layout:
+//
+//   [signature] (_DEBUG only)
+//   refs        - number of owners sharing the buffer
+//   size        - capacity (the length of data is tracked by owner)
+//   data        <- pBuf
+//
+// A buffer with refs > 1 is immutable. Any owner that is going to
+// modify the data should call BufMakeWritable() before (copy-on-write).
+//
+#ifdef _DEBUG
+  #define BUF_HDR_SIZE (sizeof(DWORD) + sizeof(LONG) + sizeof(DWORD))
+#else   /* _DEBUG */
+  #define BUF_HDR_SIZE (sizeof(LONG) + sizeof(DWORD))
+#endif  /* _DEBUG */
+
+#define BUF_SIZE(pBuf) (*(DWORD *)((pBuf) - sizeof(DWORD)))
+#define BUF_REFS(pBuf) (*(LONG *)((pBuf) - sizeof(DWORD) - sizeof(LONG)))
+#define BUF_SIGN(pBuf) (*(DWORD *)((pBuf) - BUF_HDR_SIZE))
+///////////////////////////////////////////////////////////////
+//
+// Size-classed pool of memory blocks for buffers.
+//
+// The blocks up to BUF_POOL_MAX_BLOCK bytes are rounded up to the power
+// of 2 and recycled through per-class free lists. The free lists are
+// trimmed by Trim() to the high-water mark of blocks used since the
+// previous trimming. Each thread has its own pool and the block freed
+// by other thread is returned to the pool of the thread allocated it.
+//
+#define BUF_POOL_MIN_SHIFT  5
+#define BUF_POOL_MAX_SHIFT  16
+#define BUF_POOL_MAX_BLOCK  ((DWORD)1 << BUF_POOL_MAX_SHIFT)
+///////////////////////////////////////////////////////////////
+class BufPool
+{
+  public:
+    static BYTE *Alloc(DWORD *pSize);
+    static void Free(BYTE *pBlock, DWORD size);
+    static void Trim();
+    static void Report();
+};
+///////////////////////////////////////////////////////////////
 inline BYTE *BufAlloc(DWORD size)
 {
   if (!size)
     return NULL;
 
-  size += 16;
+  DWORD sizeBlock = BUF_HDR_SIZE + size + 16;
 
-  BYTE *pBuf = new BYTE[size
-#ifdef _DEBUG
-                        + sizeof(DWORD)
-#endif
-                        + sizeof(DWORD)];
+  BYTE *pBuf = BufPool::Alloc(&sizeBlock);
 
   if (!pBuf)
     return NULL;
 
+  pBuf += BUF_HDR_SIZE;
+
 #ifdef _DEBUG
-  *(DWORD *)pBuf = BUF_SIGNATURE;
-  pBuf += sizeof(DWORD);
+  BUF_SIGN(pBuf) = BUF_SIGNATURE;
 #endif
 
-  *(DWORD *)pBuf = size;
-  pBuf += sizeof(DWORD);
+  BUF_REFS(pBuf) = 1;
+  BUF_SIZE(pBuf) = sizeBlock - BUF_HDR_SIZE;
 
   return pBuf;
 }
@@ -61,31 +101,78 @@ inline BYTE *BufAlloc(DWORD size)
 inline VOID BufFree(BYTE *pBuf)
 {
   if (pBuf) {
-    _ASSERTE(*(DWORD *)(pBuf - sizeof(DWORD) - sizeof(DWORD)) == BUF_SIGNATURE);
+    _ASSERTE(BUF_SIGN(pBuf) == BUF_SIGNATURE);
+    _ASSERTE(BUF_REFS(pBuf) > 0);
 
-#ifdef _DEBUG
-    *(DWORD *)(pBuf - sizeof(DWORD) - sizeof(DWORD)) = 0;
-#endif
+    if (--BUF_REFS(pBuf) > 0)
+      return;
 
-    delete [] (pBuf
 #ifdef _DEBUG
-               - sizeof(DWORD)
+    BUF_SIGN(pBuf) = 0;
 #endif
-               - sizeof(DWORD));
+
+    BufPool::Free(pBuf - BUF_HDR_SIZE, BUF_HDR_SIZE + BUF_SIZE(pBuf));
   }
 }
 ///////////////////////////////////////////////////////////////
+inline BYTE *BufRef(BYTE *pBuf)
+{
+  if (pBuf) {
+    _ASSERTE(BUF_SIGN(pBuf) == BUF_SIGNATURE);
+    _ASSERTE(BUF_REFS(pBuf) > 0);
+
+    BUF_REFS(pBuf)++;
+  }
+
+  return pBuf;
+}
+///////////////////////////////////////////////////////////////
+inline BOOL BufIsShared(const BYTE *pBuf)
+{
+  _ASSERTE(!pBuf || (BUF_SIGN(pBuf) == BUF_SIGNATURE));
+
+  return pBuf && BUF_REFS(pBuf) > 1;
+}
+///////////////////////////////////////////////////////////////
+inline BOOL BufMakeWritable(BYTE **ppBuf, DWORD size)
+{
+  BYTE *pBuf = *ppBuf;
+
+  if (!BufIsShared(pBuf))
+    return TRUE;
+
+  BYTE *pNewBuf = BufAlloc(size);
+
+  if (!pNewBuf && size)
+    return FALSE;
+
+  if (size)
+    memcpy(pNewBuf, pBuf, size);
+
+  BufFree(pBuf);
+  *ppBuf = pNewBuf;
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
 inline void BufAppend(BYTE **ppBuf, DWORD offset, const BYTE *pSrc, DWORD sizeSrc)
 {
   BYTE *pBuf = *ppBuf;
 
-  _ASSERTE(!pBuf || (*(DWORD *)(pBuf - sizeof(DWORD) - sizeof(DWORD)) == BUF_SIGNATURE));
+  _ASSERTE(!pBuf || (BUF_SIGN(pBuf) == BUF_SIGNATURE));
 
-  DWORD sizeOld = pBuf ? *(DWORD *)(pBuf - sizeof(DWORD)) : 0;
+  DWORD sizeOld = pBuf ? BUF_SIZE(pBuf) : 0;
   DWORD sizeNew = offset + sizeSrc;
 
-  if (sizeOld < sizeNew) {
-    *ppBuf = BufAlloc(sizeNew);
+  if (sizeOld < sizeNew || BufIsShared(pBuf)) {
+    DWORD sizeAlloc = sizeNew;
+
+    // grow geometrically to get amortized O(1) appends to the tail
+
+    if (offset && sizeAlloc < offset*2)
+      sizeAlloc = offset*2;
+
+    *ppBuf = BufAlloc(sizeAlloc);
 
     if (sizeOld > offset)
       sizeOld = offset;
@@ -83,11 +83,61 @@
 #include "plugins/plugins_api.h"
 
 #include "comhub.h"
+#include "async.h"
+#include "latency.h"
+#include "stats.h"
 #include "port.h"
 #include "filters.h"
 #include "hubmsg.h"
+#include "bufutils.h"
 
 ///////////////////////////////////////////////////////////////
+struct HubThread
+{
+  HubThread(const ComHub &_hub, HubThreads::size_type _index)
+    : hub(_hub),
+      index(_index),
+      hThread(NULL),
+      hStarted(NULL),
+      started(FALSE)
+  {
+  }
+
+  const ComHub &hub;
+  const HubThreads::size_type index;
+  Ports ports;
+  HANDLE hThread;
+  HANDLE hStarted;
+  BOOL started;
+};
+///////////////////////////////////////////////////////////////
+ComHub::~ComHub()
+{
+  _ASSERTE(signature == HUB_SIGNATURE);
+
+  // the started hub threads can still use their ports so the ports
+  // are left to the process exit
+
+  BOOL running = FALSE;
+
+  for (HubThreads::const_iterator i = threads.begin() ; i != threads.end() ; i++) {
+    if ((*i)->hThread)
+      running = TRUE;
+  }
+
+  if (!running) {
+    for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++)
+      delete *i;
+
+    for (HubThreads::const_iterator i = threads.begin() ; i != threads.end() ; i++)
+      delete *i;
+  }
+
+#ifdef _DEBUG
+  signature = 0;
+#endif
+}
+
 void ComHub::Add()
 {
   Port *pPort = new Port(*this, NumPorts());
@@ -109,9 +159,74 @@ BOOL ComHub::InitPort(
   return ports[n]->Init(pPortRoutines, hConfig, pPath);
 }
 
-BOOL ComHub::StartAll() const
+BOOL ComHub::StartAll()
 {
-  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+  if (pFilters && (!pFilters->StartAsync() || !pFilters->CompileOutMethods()))
+    return FALSE;
+
+  if (numThreads > 1)
+    Partition();
+
+  if (threads.empty())
+    return StartPorts(ports);
+
+  ThreadsReport();
+
+  // the ports are started by their own threads so the completion
+  // routines and the timers of the ports will be called by them
+
+  for (HubThreads::const_iterator i = threads.begin() ; i != threads.end() ; i++) {
+    HubThread *pThread = *i;
+
+    pThread->hStarted = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    if (!pThread->hStarted) {
+      DWORD err = GetLastError();
+
+      cerr << "CreateEvent() - error=" << err << endl;
+      return FALSE;
+    }
+
+    DWORD id;
+
+    pThread->hThread = ::CreateThread(NULL, 0, ThreadProc, pThread, 0, &id);
+
+    if (!pThread->hThread) {
+      DWORD err = GetLastError();
+
+      cerr << "CreateThread() - error=" << err << endl;
+      return FALSE;
+    }
+
+    ::WaitForSingleObject(pThread->hStarted, INFINITE);
+    ::CloseHandle(pThread->hStarted);
+    pThread->hStarted = NULL;
+
+    if (!pThread->started)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+DWORD CALLBACK ComHub::ThreadProc(LPVOID pParam)
+{
+  HubThread *pThread = (HubThread *)pParam;
+
+  pThread->started = pThread->hub.StartPorts(pThread->ports);
+
+  ::SetEvent(pThread->hStarted);
+
+  if (!pThread->started)
+    return 1;
+
+  for (;;)
+    ::SleepEx(INFINITE, TRUE);
+}
+
+BOOL ComHub::StartPorts(const Ports &startPorts) const
+{
+  for (Ports::const_iterator i = startPorts.begin() ; i != startPorts.end() ; i++) {
     HubMsg msg;
 
     msg.type = HUB_MSG_TYPE_LOOP_TEST;
@@ -120,7 +235,7 @@ BOOL ComHub::StartAll() const
       return FALSE;
   }
 
-  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+  for (Ports::const_iterator i = startPorts.begin() ; i != startPorts.end() ; i++) {
     HubMsg msg;
 
     msg.type = HUB_MSG_TYPE_SET_OUT_OPTS;
@@ -129,7 +244,7 @@ BOOL ComHub::StartAll() const
       return FALSE;
   }
 
-  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+  for (Ports::const_iterator i = startPorts.begin() ; i != startPorts.end() ; i++) {
     DWORD fail_options[GO_O2I(GO_I2O(-1)) + 1];
 
     for (int iGo = 0 ; iGo < sizeof(fail_options)/sizeof(fail_options[0]) ; iGo++)
@@ -177,7 +292,7 @@ BOOL ComHub::StartAll() const
     }
   }
 
-  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+  for (Ports::const_iterator i = startPorts.begin() ; i != startPorts.end() ; i++) {
     if (!(*i)->Start())
       return FALSE;
   }
@@ -200,6 +315,35 @@ void ComHub::OnRead(Port *pFromPort, HubMsg *pMsg) const
   _ASSERTE(pFromPort != NULL);
   _ASSERTE(pMsg != NULL);
 
+  LONGLONG start = LatencyHist::Counter();
+
+  // the lost bytes report is not the data read by the port
+
+  if (pMsg->type != HUB_MSG_TYPE_LOST)
+    pFromPort->readStats.Add(pMsg);
+
+  // the driver discards the data written to the closed port so
+  // the data waiting for its credit is not kept too
+
+  if (pMsg->type == HUB_MSG_TYPE_CONNECT && !pMsg->u.val)
+    pFromPort->PurgeRoutes();
+
+  // the async filter calls OnFilteredRead() on the completion
+  // of its IN method
+
+  if (pFromPort->pAsync)
+    pFromPort->pAsync->In(pFromPort, pMsg);
+  else
+    OnFilteredRead(pFromPort, pMsg);
+
+  pFromPort->readLatency.Add(start);
+}
+
+void ComHub::OnFilteredRead(Port *pFromPort, HubMsg *pMsg) const
+{
+  _ASSERTE(pFromPort != NULL);
+  _ASSERTE(pMsg != NULL);
+
   if (pFilters) {
     HubMsg *pEchoMsg = NULL;
 
@@ -210,23 +354,47 @@ void ComHub::OnRead(Port *pFromPort, HubMsg *pMsg) const
       }
     }
 
-    for (HubMsg *pCurMsg = pEchoMsg ; pCurMsg ; pCurMsg = pCurMsg->Next())
-      pFromPort->Write(pCurMsg);
-
-    if (pEchoMsg)
+    if (pEchoMsg) {
+      Send(pFromPort, pFromPort, pEchoMsg, TRUE);
       delete pEchoMsg;
+    }
+  }
+
+  // the lost bytes are reported to the filters of the port only
+
+  BOOL routed = FALSE;
+
+  for (HubMsg *pCurMsg = pMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+    if (pCurMsg->type == HUB_MSG_TYPE_LOST)
+      pCurMsg->type = HUB_MSG_TYPE_EMPTY;
+    else
+      routed = TRUE;
   }
 
-  const PortMap &routeMap = (pMsg->type & HUB_MSG_ROUTE_FLOW_CONTROL) ? routeFlowControlMap : routeDataMap;
+  if (!routed)
+    return;
+
+  const RouteTable &routeTable = (pMsg->type & HUB_MSG_ROUTE_FLOW_CONTROL) ? routeFlowControlTable : routeDataTable;
+  Ports::size_type num = pFromPort->Num();
 
-  for (PortMap::const_iterator i = routeMap.find(pFromPort) ; i != routeMap.end() ; i++) {
-    if (i->first != pFromPort)
-      break;
+  if (num + 1 >= routeTable.index.size())
+    return;
+
+  if (pMsg->type == HUB_MSG_TYPE_CREDIT) {
+    // the credit window of the port is shared by the ports
+    // the flow control of the port is routed to
+
+    pFromPort->credit = (LONG)pMsg->u.val;
+    pFromPort->creditShares = DWORD(routeTable.index[num + 1] - routeTable.index[num]);
+    pFromPort->Dispatch();
+  }
 
+  for (Ports::size_type i = routeTable.index[num] ; i < routeTable.index[num + 1] ; i++) {
+    Port *pToPort = routeTable.ports[i];
     HubMsg *pOutMsg = pMsg->Clone();
 
     if (pFilters && pOutMsg) {
-      if (!pFilters->OutMethod(pFromPort, i->second, pOutMsg)) {
+      if (!pFilters->OutMethod(pFromPort, pToPort, pOutMsg)) {
         if (pOutMsg) {
           delete pOutMsg;
           pOutMsg = NULL;
@@ -235,28 +403,340 @@ void ComHub::OnRead(Port *pFromPort, HubMsg *pMsg) const
     }
 
     for (HubMsg *pCurMsg = pOutMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
-      i->second->Write(pCurMsg);
-
-      switch (HUB_MSG_T2N(pCurMsg->type)) {
-        case HUB_MSG_T2N(HUB_MSG_TYPE_SET_OUT_OPTS):
-          if (pCurMsg->u.val) {
-            cerr << i->second->Name() << " WARNING: Requested output option(s) SO_0x"
-                 << hex << pCurMsg->u.val << dec
-                 << " not supported" << endl;
-          }
-          break;
+      if (pCurMsg->type != HUB_MSG_TYPE_CREDIT)
+        continue;
+
+      LONG credit = Credit(pToPort);
+
+      if (credit == LONG_MAX) {
+        pCurMsg->type = HUB_MSG_TYPE_EMPTY;
+        continue;
       }
+
+      pCurMsg->u.val = credit > 0 ? (DWORD)credit : 0;
     }
 
-    if (pOutMsg)
+    if (pOutMsg) {
+      Send(pFromPort, pToPort, pOutMsg, FALSE);
       delete pOutMsg;
+    }
+  }
+}
+
+void ComHub::Send(Port *pFromPort, Port *pToPort, HubMsg *pMsg, BOOL echo) const
+{
+  if (pToPort->pAsync) {
+    // the messages are taken by the async filter and will be written
+    // by the thread of the port on the completion of its OUT method
+
+    pToPort->pAsync->Out(pFromPort, pToPort, pMsg, echo);
+    return;
+  }
+
+  Write(pFromPort, pToPort, pMsg, echo);
+}
+
+LONG ComHub::Credit(Port *pPort) const
+{
+  // the port can read while all the ports its data is routed to
+  // and its flow control is routed from have the credit, the
+  // credit not taken by the queued data is shared in proportion
+  // to the route weights
+
+  LONG credit = LONG_MAX;
+  Ports::size_type num = pPort->Num();
+
+  if (num + 1 >= routeDataTable.index.size())
+    return credit;
+
+  for (Ports::size_type i = routeDataTable.index[num] ; i < routeDataTable.index[num + 1] ; i++) {
+    Port *pToPort = routeDataTable.ports[i];
+
+    if (!pToPort->creditShares)
+      continue;
+
+    Ports::size_type numTo = pToPort->Num();
+
+    if (numTo + 1 >= routeFlowControlTable.index.size())
+      continue;
+
+    for (Ports::size_type j = routeFlowControlTable.index[numTo] ; j < routeFlowControlTable.index[numTo + 1] ; j++) {
+      if (routeFlowControlTable.ports[j] == pPort) {
+        LONGLONG weights = 0;
+
+        for (Ports::size_type k = routeFlowControlTable.index[numTo] ; k < routeFlowControlTable.index[numTo + 1] ; k++)
+          weights += pToPort->RouteWeight(routeFlowControlTable.ports[k]);
+
+        LONGLONG free = (LONGLONG)pToPort->credit - pToPort->RouteQueued();
+        LONG share = free > 0 ? (LONG)(free*pToPort->RouteWeight(pPort)/weights) : 0;
+
+        // the share rounded down to 0 would stop the source for ever
+        // since the drained port does not grant the same credit again
+
+        if (free > 0 && share == 0)
+          share = 1;
+
+        if (credit > share)
+          credit = share;
+
+        break;
+      }
+    }
+  }
+
+  return credit;
+}
+
+void ComHub::Write(Port *pFromPort, Port *pToPort, HubMsg *pMsg, BOOL echo) const
+{
+  for (HubMsg *pCurMsg = pMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+    if (echo) {
+      pToPort->Write(pCurMsg);
+      continue;
+    }
+
+    // the routed messages are scheduled by the port fairly
+    // between the ports they are routed from, the not supported
+    // output options are reported when the driver gets them
+
+    pToPort->Write(pFromPort, pCurMsg);
+  }
+}
+
+void ComHub::SetRouteWeight(Port *pFromPort, Port *pToPort, DWORD weight) const
+{
+  pToPort->SetRouteWeight(pFromPort, weight);
+}
+///////////////////////////////////////////////////////////////
+void BuildRouteTable(const Ports &ports, const PortMap &map, RouteTable &table)
+{
+  table.index.clear();
+  table.ports.clear();
+
+  table.index.reserve(ports.size() + 1);
+  table.ports.reserve(map.size());
+
+  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+    _ASSERTE((Ports::size_type)(*i)->Num() == table.index.size());
+
+    table.index.push_back(table.ports.size());
+
+    for (PortMap::const_iterator iPair = map.find(*i) ; iPair != map.end() ; iPair++) {
+      if (iPair->first != *i)
+        break;
+
+      table.ports.push_back(iPair->second);
+    }
+  }
+
+  table.index.push_back(table.ports.size());
+}
+
+void ComHub::SetDataRoute(const PortMap &map)
+{
+  routeDataMap = map;
+  BuildRouteTable(ports, routeDataMap, routeDataTable);
+}
+
+void ComHub::SetFlowControlRoute(const PortMap &map)
+{
+  routeFlowControlMap = map;
+  BuildRouteTable(ports, routeFlowControlMap, routeFlowControlTable);
+}
+
+void ComHub::BindPorts(Port *pPort1, Port *pPort2)
+{
+  _ASSERTE(pPort1 != NULL);
+  _ASSERTE(pPort2 != NULL);
+
+  bindMap.insert(pair<Port *, Port *>(pPort1, pPort2));
+}
+
+static Ports::size_type FindComponent(vector<Ports::size_type> &parents, Ports::size_type num)
+{
+  while (parents[num] != num) {
+    parents[num] = parents[parents[num]];
+    num = parents[num];
+  }
+
+  return num;
+}
+
+static void JoinComponents(vector<Ports::size_type> &parents, const PortMap &map)
+{
+  for (PortMap::const_iterator i = map.begin() ; i != map.end() ; i++) {
+    Ports::size_type c1 = FindComponent(parents, i->first->Num());
+    Ports::size_type c2 = FindComponent(parents, i->second->Num());
+
+    // the component is identified by its lowest port number
+
+    if (c1 < c2)
+      parents[c2] = c1;
+    else
+    if (c2 < c1)
+      parents[c1] = c2;
+  }
+}
+
+void ComHub::Partition()
+{
+  _ASSERTE(threads.empty());
+
+  // the ports connected by routes or sharing the filters or the
+  // driver's objects are joined to one component, the messages
+  // never cross the bounds of the components, so each component
+  // can be run by its own thread without any locking
+
+  vector<Ports::size_type> parents;
+
+  parents.reserve(ports.size());
+
+  for (Ports::size_type i = 0 ; i < ports.size() ; i++)
+    parents.push_back(i);
+
+  JoinComponents(parents, routeDataMap);
+  JoinComponents(parents, routeFlowControlMap);
+  JoinComponents(parents, bindMap);
+
+  if (pFilters) {
+    PortMap filtersMap;
+
+    pFilters->BindPorts(filtersMap);
+    JoinComponents(parents, filtersMap);
+  }
+
+  map<Ports::size_type, Ports> components;
+
+  for (Ports::size_type i = 0 ; i < ports.size() ; i++)
+    components[FindComponent(parents, i)].push_back(ports[i]);
+
+  HubThreads::size_type count = numThreads;
+
+  if (count > components.size())
+    count = components.size();
+
+  if (count <= 1)
+    return;
+
+  for (HubThreads::size_type n = 0 ; n < count ; n++) {
+    HubThread *pThread = new HubThread(*this, n);
+
+    if (!pThread) {
+      cerr << "No enough memory." << endl;
+      exit(2);
+    }
+
+    threads.push_back(pThread);
+  }
+
+  // put the largest components first to the least loaded threads
+
+  multimap<Ports::size_type, const Ports *, greater<Ports::size_type> > bySize;
+
+  for (map<Ports::size_type, Ports>::const_iterator i = components.begin() ; i != components.end() ; i++)
+    bySize.insert(pair<Ports::size_type, const Ports *>(i->second.size(), &i->second));
+
+  for (multimap<Ports::size_type, const Ports *, greater<Ports::size_type> >::const_iterator i = bySize.begin() ;
+       i != bySize.end() ;
+       i++)
+  {
+    HubThread *pThread = threads.front();
+
+    for (HubThreads::const_iterator iThread = threads.begin() ; iThread != threads.end() ; iThread++) {
+      if ((*iThread)->ports.size() < pThread->ports.size())
+        pThread = *iThread;
+    }
+
+    pThread->ports.insert(pThread->ports.end(), i->second->begin(), i->second->end());
+  }
+}
+
+void ComHub::ThreadsReport() const
+{
+  for (HubThreads::const_iterator i = threads.begin() ; i != threads.end() ; i++) {
+    cout << "Thread " << (*i)->index << ":";
+
+    for (Ports::const_iterator iPort = (*i)->ports.begin() ; iPort != (*i)->ports.end() ; iPort++)
+      cout << " " << (*iPort)->Name();
+
+    cout << endl;
   }
 }
 
 void ComHub::LostReport() const
 {
-  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++)
+  if (threads.empty()) {
+    Report(ports);
+
+    if (pStats)
+      pStats->Save();
+
+    return;
+  }
+
+  // the reports are passed from thread to thread, so each thread
+  // reports its own ports and the statistics are not locked
+
+  if (::InterlockedCompareExchange(&reporting, 1, 0) != 0)
+    return;
+
+  QueueReport(0);
+}
+
+void ComHub::QueueReport(HubThreads::size_type iThread) const
+{
+  _ASSERTE(iThread < threads.size());
+
+  HubThread *pThread = threads[iThread];
+
+  if (!::QueueUserAPC(ReportAPC, pThread->hThread, (ULONG_PTR)pThread)) {
+    DWORD err = GetLastError();
+
+    cerr << "WARNING: QueueUserAPC() - error=" << err << endl;
+
+    ::InterlockedExchange(&reporting, 0);
+  }
+}
+
+VOID CALLBACK ComHub::ReportAPC(ULONG_PTR pParam)
+{
+  const HubThread *pThread = (const HubThread *)pParam;
+  const ComHub &hub = pThread->hub;
+
+  hub.Report(pThread->ports);
+
+  if (pThread->index + 1 < hub.threads.size()) {
+    hub.QueueReport(pThread->index + 1);
+    return;
+  }
+
+  if (hub.pStats)
+    hub.pStats->Save();
+
+  ::InterlockedExchange(&hub.reporting, 0);
+}
+
+void ComHub::Report(const Ports &reportPorts) const
+{
+  for (Ports::const_iterator i = reportPorts.begin() ; i != reportPorts.end() ; i++)
     (*i)->LostReport();
+
+  BufPool::Trim();
+  BufPool::Report();
+
+  for (Ports::const_iterator i = reportPorts.begin() ; i != reportPorts.end() ; i++)
+    (*i)->LatencyReport();
+
+  if (pFilters)
+    pFilters->LatencyReport(reportPorts);
+
+  if (pStats) {
+    for (Ports::const_iterator i = reportPorts.begin() ; i != reportPorts.end() ; i++)
+      (*i)->StatsReport(*pStats);
+
+    if (pFilters)
+      pFilters->StatsReport(*pStats, reportPorts);
+  }
 }
 
 static void RouteReport(const PortMap &map, const char *pMapName)
@@ -61,27 +61,34 @@
 class Port;
 class Filters;
 class HubMsg;
+class Stats;
+struct HubThread;
 ///////////////////////////////////////////////////////////////
 typedef vector<Port*> Ports;
 typedef multimap<Port*, Port*> PortMap;
+typedef vector<HubThread*> HubThreads;
+///////////////////////////////////////////////////////////////
+struct RouteTable
+{
+  // routes from port num are ports[index[num]] ... ports[index[num + 1] - 1]
+  vector<Ports::size_type> index;
+  Ports ports;
+};
+
+void BuildRouteTable(const Ports &ports, const PortMap &map, RouteTable &table);
 ///////////////////////////////////////////////////////////////
 #define HUB_SIGNATURE 'h4cH'
 ///////////////////////////////////////////////////////////////
 class ComHub
 {
   public:
-    ComHub() : pFilters(NULL) {
+    ComHub() : pFilters(NULL), pStats(NULL), numThreads(1), routeLimit(0), reporting(0) {
 #ifdef _DEBUG
       signature = HUB_SIGNATURE;
 #endif
     }
 
-#ifdef _DEBUG
-    ~ComHub() {
-      _ASSERTE(signature == HUB_SIGNATURE);
-      signature = 0;
-    }
-#endif
+    ~ComHub();
 
     void Add();
     BOOL InitPort(
@@ -89,13 +96,20 @@ class ComHub
         const PORT_ROUTINES_A *pPortRoutines,
         HCONFIG hConfig,
         const char *pPath);
-    BOOL StartAll() const;
+    BOOL StartAll();
     BOOL OnFakeRead(Port *pFromPort, HubMsg *pMsg) const;
     void OnRead(Port *pFromPort, HubMsg *pMsg) const;
+    void OnFilteredRead(Port *pFromPort, HubMsg *pMsg) const;
+    void Write(Port *pFromPort, Port *pToPort, HubMsg *pMsg, BOOL echo) const;
     void LostReport() const;
-    void SetDataRoute(const PortMap &map) { routeDataMap = map; }
-    void SetFlowControlRoute(const PortMap &map) { routeFlowControlMap = map; }
+    void SetDataRoute(const PortMap &map);
+    void SetFlowControlRoute(const PortMap &map);
+    void BindPorts(Port *pPort1, Port *pPort2);
     void RouteReport() const;
+    void SetThreads(unsigned _numThreads) { numThreads = _numThreads; }
+    void SetRouteWeight(Port *pFromPort, Port *pToPort, DWORD weight) const;
+    void SetRouteLimit(DWORD _routeLimit) { routeLimit = _routeLimit; }
+    DWORD RouteLimit() const { return routeLimit; }
     unsigned NumPorts() const { return (unsigned)ports.size(); }
 
     Filters *SetFilters(Filters *_pFilters) {
@@ -104,6 +118,12 @@ class ComHub
       return pFiltersOld;
     }
 
+    Stats *SetStats(Stats *_pStats) {
+      Stats *pStatsOld = pStats;
+      pStats = _pStats;
+      return pStatsOld;
+    }
+
     Port *ComHub::GetPort(unsigned n) const {
       _ASSERTE(n < NumPorts());
       return ports.at(n);
@@ -112,11 +132,31 @@ class ComHub
     const char *FilterName(HFILTER hFilter) const;
 
   private:
+    BOOL StartPorts(const Ports &startPorts) const;
+    void Report(const Ports &reportPorts) const;
+    void Send(Port *pFromPort, Port *pToPort, HubMsg *pMsg, BOOL echo) const;
+    LONG Credit(Port *pPort) const;
+    void Partition();
+    void ThreadsReport() const;
+    void QueueReport(HubThreads::size_type iThread) const;
+
+    static DWORD CALLBACK ThreadProc(LPVOID pParam);
+    static VOID CALLBACK ReportAPC(ULONG_PTR pParam);
+
     Ports ports;
     PortMap routeDataMap;
     PortMap routeFlowControlMap;
+    PortMap bindMap;
+    RouteTable routeDataTable;
+    RouteTable routeFlowControlTable;
 
     Filters *pFilters;
+    Stats *pStats;
+
+    unsigned numThreads;
+    DWORD routeLimit;
+    HubThreads threads;
+    mutable LONG reporting;
 
 #ifdef _DEBUG
   private:
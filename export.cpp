@@ -70,6 +70,8 @@
 #include "plugins/plugins_api.h"
 
 #include "export.h"
+#include "latency.h"
+#include "stats.h"
 #include "port.h"
 #include "comhub.h"
 #include "bufutils.h"
@@ -94,6 +96,11 @@ static VOID CALLBACK buf_append(BYTE **ppBuf, DWORD offset, const BYTE *pSrc, DW
   BufAppend(ppBuf, offset, pSrc, sizeSrc);
 }
 ///////////////////////////////////////////////////////////////
+static BOOL CALLBACK buf_make_writable(BYTE **ppBuf, DWORD size)
+{
+  return BufMakeWritable(ppBuf, size);
+}
+///////////////////////////////////////////////////////////////
 static BOOL CALLBACK msg_replace_buf(HUB_MSG *pMsg, DWORD type, const BYTE *pSrc, DWORD sizeSrc)
 {
   _ASSERTE((type & HUB_MSG_UNION_TYPES_MASK) == HUB_MSG_UNION_TYPE_BUF);
@@ -311,6 +318,40 @@ static const ARG_INFO_A * CALLBACK get_arg_info(const char *pArg)
   return Arg::GetArgInfo(pArg);
 }
 ///////////////////////////////////////////////////////////////
+#ifdef USE_LATENCY_STATS
+static void CALLBACK write_latency(HMASTERPORT hMasterPort, LONGLONG queued)
+{
+  _ASSERTE(hMasterPort != NULL);
+  _ASSERTE(((Port *)hMasterPort)->IsValid());
+
+  ((Port *)hMasterPort)->writeLatency.Add(queued);
+}
+#endif  /* USE_LATENCY_STATS */
+///////////////////////////////////////////////////////////////
+static void CALLBACK stat_add(
+    HMASTERPORT hMasterPort,
+    const char *pName,
+    DWORD type,
+    const DWORD *pValue)
+{
+  _ASSERTE(hMasterPort != NULL);
+  _ASSERTE(((Port *)hMasterPort)->IsValid());
+
+  ((Port *)hMasterPort)->StatAdd(pName, type, pValue);
+}
+///////////////////////////////////////////////////////////////
+static void CALLBACK bind_ports(
+    HMASTERPORT hMasterPort1,
+    HMASTERPORT hMasterPort2)
+{
+  _ASSERTE(hMasterPort1 != NULL);
+  _ASSERTE(((Port *)hMasterPort1)->IsValid());
+  _ASSERTE(hMasterPort2 != NULL);
+  _ASSERTE(((Port *)hMasterPort2)->IsValid());
+
+  ((Port *)hMasterPort1)->hub.BindPorts((Port *)hMasterPort1, (Port *)hMasterPort2);
+}
+///////////////////////////////////////////////////////////////
 HUB_ROUTINES_A hubRoutines = {
   sizeof(HUB_ROUTINES_A),
   buf_alloc,
@@ -332,5 +373,13 @@ HUB_ROUTINES_A hubRoutines = {
   filter_port,
   get_filter,
   get_arg_info,
+  buf_make_writable,
+#ifdef USE_LATENCY_STATS
+  write_latency,
+#else   /* USE_LATENCY_STATS */
+  NULL,
+#endif  /* USE_LATENCY_STATS */
+  stat_add,
+  bind_ports,
 };
 ///////////////////////////////////////////////////////////////
@@ -33,6 +33,8 @@
 #ifndef _FILTER_H
 #define _FILTER_H
 
+///////////////////////////////////////////////////////////////
+class AsyncStage;
 ///////////////////////////////////////////////////////////////
 #define FILTER_SIGNATURE 'h4cF'
 ///////////////////////////////////////////////////////////////
@@ -50,7 +52,8 @@ class Filter
         pCreateInstance(_pCreateInstance),
         pInMethod(_pInMethod),
         pOutMethod(_pOutMethod),
-        hFilter(NULL)
+        hFilter(NULL),
+        flags(0)
     {
 #ifdef _DEBUG
       signature = FILTER_SIGNATURE;
@@ -80,6 +83,7 @@ class Filter
     FILTER_OUT_METHOD *const pOutMethod;
 
     HFILTER hFilter;
+    DWORD flags;
 
 #ifdef _DEBUG
   private:
@@ -105,7 +109,8 @@ class FilterInstance {
         pInMethod(addInMethod ? _filter.pInMethod : NULL),
         pOutMethod(addOutMethod ? _filter.pOutMethod : NULL),
         pSrcPorts(_pSrcPorts),
-        hFilterInstance(NULL)
+        hFilterInstance(NULL),
+        pAsync(NULL)
     {
 #ifdef _DEBUG
       signature = FILTER_INSTANCE_SIGNATURE;
@@ -130,14 +135,22 @@ class FilterInstance {
     Filter &filter;
     Port &port;
 
+    LatencyHist inLatency;
+    LatencyHist outLatency;
+
+    MsgStats inStats;
+    MsgStats outStats;
+
   protected:
     friend class Filters;
+    friend class AsyncStage;
 
     FILTER_IN_METHOD *const pInMethod;
     FILTER_OUT_METHOD *const pOutMethod;
     const set<Port *> *const pSrcPorts;
 
     HFILTERINSTANCE hFilterInstance;
+    AsyncStage *pAsync;
 
 #ifdef _DEBUG
   private:
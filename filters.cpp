@@ -54,6 +54,9 @@
 #include "precomp.h"
 #include "plugins/plugins_api.h"
 
+#include "async.h"
+#include "latency.h"
+#include "stats.h"
 #include "port.h"
 #include "comhub.h"
 #include "filters.h"
@@ -67,6 +70,12 @@ typedef pair<Port *, FilterInstanceArray*> PortFilters;
 ///////////////////////////////////////////////////////////////
 Filters::~Filters()
 {
+  // the started offload threads can still use the async stages and
+  // the filter instances so they are left to the process exit
+
+  if (pAsyncPool)
+    return;
+
   for (PortFiltersMap::const_iterator iPort = portFilters.begin() ; iPort != portFilters.end() ; iPort++) {
     if (iPort->second) {
       for (FilterInstanceArray::const_iterator i = iPort->second->begin() ; i != iPort->second->end() ; i++) {
@@ -121,6 +130,9 @@ BOOL Filters::CreateFilter(
     pFilter->hFilter = hFilter;
   }
 
+  if (ROUTINE_IS_VALID(pFltRoutines, pGetFlags))
+    pFilter->flags = pFltRoutines->pGetFlags(pFilter->hFilter);
+
   allFilters.push_back(pFilter);
 
   return TRUE;
@@ -214,6 +226,80 @@ BOOL Filters::AddFilter(
   return TRUE;
 }
 ///////////////////////////////////////////////////////////////
+BOOL Filters::StartAsync(unsigned numThreads)
+{
+  if (asyncFilters.empty())
+    return TRUE;
+
+  for (set<string>::const_iterator iName = asyncFilters.begin() ; iName != asyncFilters.end() ; iName++) {
+    BOOL found = FALSE;
+
+    for (FilterArray::const_iterator i = allFilters.begin() ; i != allFilters.end() ; i++) {
+      if (*i && (*i)->name == *iName) {
+        if (((*i)->flags & FILTER_FLAG_ASYNC_SAFE) == 0) {
+          cerr << "The filter " << *iName << " can't be async" << endl;
+          return FALSE;
+        }
+
+        found = TRUE;
+      }
+    }
+
+    if (!found) {
+      cerr << "Can't find filter " << *iName << endl;
+      return FALSE;
+    }
+  }
+
+  pAsyncPool = new AsyncPool();
+
+  if (!pAsyncPool) {
+    cerr << "No enough memory." << endl;
+    return FALSE;
+  }
+
+  for (PortFiltersMap::const_iterator iPort = portFilters.begin() ; iPort != portFilters.end() ; iPort++) {
+    if (!iPort->second)
+      continue;
+
+    for (FilterInstanceArray::const_iterator i = iPort->second->begin() ; i != iPort->second->end() ; i++) {
+      if (asyncFilters.find((*i)->filter.name) == asyncFilters.end())
+        continue;
+
+      // the messages of the port should be ordered before the
+      // other filters, so only the nearest to the port can be async
+
+      if (i != iPort->second->begin()) {
+        cerr << "The async filter " << (*i)->filter.name
+             << " should be the first filter of the port " << iPort->first->Name() << endl;
+        return FALSE;
+      }
+
+      AsyncStage *pAsync = new AsyncStage(hub, *(*i), *pAsyncPool);
+
+      if (!pAsync) {
+        cerr << "No enough memory." << endl;
+        return FALSE;
+      }
+
+      (*i)->pAsync = pAsync;
+      iPort->first->pAsync = pAsync;
+    }
+  }
+
+  // an offload thread per processor by default
+
+  if (!numThreads) {
+    SYSTEM_INFO sysInfo;
+
+    ::GetSystemInfo(&sysInfo);
+
+    numThreads = sysInfo.dwNumberOfProcessors;
+  }
+
+  return pAsyncPool->Start(numThreads);
+}
+///////////////////////////////////////////////////////////////
 void Filters::Report() const
 {
   if (!portFilters.size())
@@ -314,6 +400,63 @@ void Filters::Report() const
   }
 }
 ///////////////////////////////////////////////////////////////
+void Filters::LatencyReport(const Ports &ports) const
+{
+  for (Ports::const_iterator iPort = ports.begin() ; iPort != ports.end() ; iPort++) {
+    PortFiltersMap::const_iterator iPair = portFilters.find(*iPort);
+
+    if (iPair == portFilters.end() || !iPair->second)
+      continue;
+
+    for (FilterInstanceArray::const_iterator i = iPair->second->begin() ; i != iPair->second->end() ; i++) {
+      string name = (*i)->port.Name() + " " + (*i)->filter.Name();
+
+      (*i)->inLatency.Report(name, "IN method");
+      (*i)->outLatency.Report(name, "OUT method");
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+void Filters::StatsReport(Stats &stats, const Ports &ports) const
+{
+  for (Ports::const_iterator iPort = ports.begin() ; iPort != ports.end() ; iPort++) {
+    PortFiltersMap::const_iterator iPair = portFilters.find(*iPort);
+
+    if (iPair == portFilters.end() || !iPair->second)
+      continue;
+
+    for (FilterInstanceArray::const_iterator i = iPair->second->begin() ; i != iPair->second->end() ; i++) {
+      const string &port = (*i)->port.Name();
+      const char *pFilter = (*i)->filter.Name().c_str();
+
+      (*i)->inStats.Report(stats, "hub4com_filter_in", port, pFilter);
+      (*i)->outStats.Report(stats, "hub4com_filter_out", port, pFilter);
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+void Filters::BindPorts(PortMap &bindMap) const
+{
+  // the instances of the same filter share the filter's data
+
+  map<const Filter *, Port *> firstPorts;
+
+  for (PortFiltersMap::const_iterator iPort = portFilters.begin() ; iPort != portFilters.end() ; iPort++) {
+    if (!iPort->second)
+      continue;
+
+    for (FilterInstanceArray::const_iterator i = iPort->second->begin() ; i != iPort->second->end() ; i++) {
+      Port *&pFirstPort = firstPorts[&(*i)->filter];
+
+      if (!pFirstPort)
+        pFirstPort = iPort->first;
+      else
+      if (pFirstPort != iPort->first)
+        bindMap.insert(pair<Port *, Port *>(pFirstPort, iPort->first));
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
 BOOL Filters::InMethod(
     Port *pFromPort,
     const FilterInstanceArray::const_iterator &i,
@@ -323,37 +466,33 @@ BOOL Filters::InMethod(
 {
   _ASSERTE(*ppEchoMsg == NULL);
 
-  HubMsg *pEchoMsg = NULL;
+  HubMsgChain echoMsgs;
   HFILTER hFilter = (*i)->filter.hFilter;
   HFILTERINSTANCE hFilterInstance = (*i)->hFilterInstance;
 
   if ((*i)->pInMethod) {
     FILTER_IN_METHOD *pInMethod = (*i)->pInMethod;
     HubMsg *pNextMsg = pInMsg;
+    LONGLONG start = LatencyHist::Counter();
 
     for (HubMsg *pCurMsg = pNextMsg ; pCurMsg ; pCurMsg = pNextMsg) {
       pNextMsg = pNextMsg->Next();
 
       HUB_MSG *pEchoMsgPart = NULL;
 
+      (*i)->inStats.Add(pCurMsg);
+
       if (!pInMethod(hFilter, hFilterInstance, pCurMsg, &pEchoMsgPart)) {
         if (pEchoMsgPart)
           delete (HubMsg *)pEchoMsgPart;
 
-        if (pEchoMsg)
-          delete pEchoMsg;
-
         return FALSE;
       }
 
-      if (pEchoMsgPart) {
-        if (pEchoMsg) {
-          pEchoMsg->Merge((HubMsg *)pEchoMsgPart);
-        } else {
-          pEchoMsg = (HubMsg *)pEchoMsgPart;
-        }
-      }
+      echoMsgs.Append((HubMsg *)pEchoMsgPart);
     }
+
+    (*i)->inLatency.Add(start);
   }
 
   const FilterInstanceArray::const_iterator iNext = i + 1;
@@ -363,27 +502,26 @@ BOOL Filters::InMethod(
       return FALSE;
   }
 
-  if ((*i)->pOutMethod) {
+  if ((*i)->pOutMethod && *ppEchoMsg) {
     FILTER_OUT_METHOD *pOutMethod = (*i)->pOutMethod;
     HubMsg *pNextMsg = *ppEchoMsg;
+    LONGLONG start = LatencyHist::Counter();
 
     for (HubMsg *pCurMsg = pNextMsg ; pCurMsg ; pCurMsg = pNextMsg) {
       pNextMsg = pNextMsg->Next();
 
-      if (!pOutMethod(hFilter, hFilterInstance, (HMASTERPORT)pFromPort, pCurMsg)) {
-        if (pEchoMsg)
-          delete pEchoMsg;
+      (*i)->outStats.Add(pCurMsg);
 
+      if (!pOutMethod(hFilter, hFilterInstance, (HMASTERPORT)pFromPort, pCurMsg))
         return FALSE;
-      }
     }
-  }
 
-  if (pEchoMsg) {
-    if (*ppEchoMsg)
-      pEchoMsg->Merge(*ppEchoMsg);
+    (*i)->outLatency.Add(start);
+  }
 
-    *ppEchoMsg = pEchoMsg;
+  if (echoMsgs.Head()) {
+    echoMsgs.Append(*ppEchoMsg);
+    *ppEchoMsg = echoMsgs.Detach();
   }
 
   return TRUE;
@@ -406,7 +544,12 @@ BOOL Filters::InMethod(
   if (!pFilters)
     return TRUE;
 
-  const FilterInstanceArray::const_iterator i = pFilters->begin();
+  FilterInstanceArray::const_iterator i = pFilters->begin();
+
+  // the IN method of the async filter was already called
+
+  if (i != pFilters->end() && (*i)->pAsync)
+    i++;
 
   if (i != pFilters->end()) {
     if (!InMethod(pFromPort, i, pFilters->end(), pInMsg, ppEchoMsg))
@@ -416,38 +559,94 @@ BOOL Filters::InMethod(
   return TRUE;
 }
 ///////////////////////////////////////////////////////////////
+BOOL Filters::CompileOutMethods()
+{
+  numPorts = hub.NumPorts();
+
+  outMethods.clear();
+  outMethodsIndex.clear();
+  outMethodsIndex.reserve(numPorts*numPorts + 1);
+
+  for (unsigned iFrom = 0 ; iFrom < numPorts ; iFrom++) {
+    Port *pFromPort = hub.GetPort(iFrom);
+
+    _ASSERTE(pFromPort->Num() == (int)iFrom);
+
+    for (unsigned iTo = 0 ; iTo < numPorts ; iTo++) {
+      outMethodsIndex.push_back(outMethods.size());
+
+      PortFiltersMap::const_iterator iPair = portFilters.find(hub.GetPort(iTo));
+
+      if (iPair == portFilters.end())
+        continue;
+
+      FilterInstanceArray *pFilters = iPair->second;
+
+      if (!pFilters)
+        continue;
+
+      for (FilterInstanceArray::const_reverse_iterator i = pFilters->rbegin() ; i != pFilters->rend() ; i++) {
+        // the OUT method of the async filter is called by its stage
+
+        if ((*i)->pAsync)
+          continue;
+
+        if ((*i)->pOutMethod && (!(*i)->pSrcPorts ||
+            (*i)->pSrcPorts->find(pFromPort) != (*i)->pSrcPorts->end()))
+        {
+          FilterOutMethod method;
+
+          method.pOutMethod = (*i)->pOutMethod;
+          method.hFilter = (*i)->filter.hFilter;
+          method.hFilterInstance = (*i)->hFilterInstance;
+          method.pOutLatency = &(*i)->outLatency;
+          method.pOutStats = &(*i)->outStats;
+
+          outMethods.push_back(method);
+        }
+      }
+    }
+  }
+
+  outMethodsIndex.push_back(outMethods.size());
+
+  if (outMethodsIndex.size() != numPorts*numPorts + 1) {
+    cerr << "No enough memory." << endl;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
 BOOL Filters::OutMethod(
     Port *pFromPort,
     Port *pToPort,
     HubMsg *pOutMsg) const
 {
-  PortFiltersMap::const_iterator iPair = portFilters.find(pToPort);
-
-  if (iPair == portFilters.end())
-    return TRUE;
+  _ASSERTE(outMethodsIndex.size() == numPorts*numPorts + 1);
+  _ASSERTE((unsigned)pFromPort->Num() < numPorts);
+  _ASSERTE((unsigned)pToPort->Num() < numPorts);
 
-  FilterInstanceArray *pFilters = iPair->second;
+  unsigned iPair = pFromPort->Num()*numPorts + pToPort->Num();
+  LONGLONG start = LatencyHist::Counter();
 
-  if (!pFilters)
-    return TRUE;
+  for (FilterOutMethodArray::size_type i = outMethodsIndex[iPair] ; i < outMethodsIndex[iPair + 1] ; i++) {
+    const FilterOutMethod &method = outMethods[i];
 
-  for (FilterInstanceArray::const_reverse_iterator i = pFilters->rbegin() ; i != pFilters->rend() ; i++) {
-    if ((*i)->pOutMethod && (!(*i)->pSrcPorts ||
-        (*i)->pSrcPorts->find(pFromPort) != (*i)->pSrcPorts->end()))
-    {
-      FILTER_OUT_METHOD *pOutMethod = (*i)->pOutMethod;
-      HFILTER hFilter = (*i)->filter.hFilter;
-      HFILTERINSTANCE hFilterInstance = (*i)->hFilterInstance;
+    HubMsg *pNextMsg = pOutMsg;
 
-      HubMsg *pNextMsg = pOutMsg;
+    for (HubMsg *pCurMsg = pNextMsg ; pCurMsg ; pCurMsg = pNextMsg) {
+      pNextMsg = pNextMsg->Next();
 
-      for (HubMsg *pCurMsg = pNextMsg ; pCurMsg ; pCurMsg = pNextMsg) {
-        pNextMsg = pNextMsg->Next();
+      method.pOutStats->Add(pCurMsg);
 
-        if (!pOutMethod(hFilter, hFilterInstance, (HMASTERPORT)pFromPort, pCurMsg))
-          return FALSE;
-      }
+      if (!method.pOutMethod(method.hFilter, method.hFilterInstance, (HMASTERPORT)pFromPort, pCurMsg))
+        return FALSE;
     }
+
+    // the end of the previous method is the start of the next one
+
+    start = method.pOutLatency->Add(start);
   }
 
   return TRUE;
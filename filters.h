@@ -49,19 +49,35 @@
 #define _FILTERS_H
 
 ///////////////////////////////////////////////////////////////
+class AsyncPool;
 class ComHub;
 class Filter;
 class FilterInstance;
 class HubMsg;
+class LatencyHist;
+class MsgStats;
+class Stats;
 ///////////////////////////////////////////////////////////////
 typedef vector<Filter*> FilterArray;
 typedef vector<FilterInstance*> FilterInstanceArray;
 typedef map<Port *, FilterInstanceArray*> PortFiltersMap;
 ///////////////////////////////////////////////////////////////
+struct FilterOutMethod
+{
+  FILTER_OUT_METHOD *pOutMethod;
+  HFILTER hFilter;
+  HFILTERINSTANCE hFilterInstance;
+  LatencyHist *pOutLatency;
+  MsgStats *pOutStats;
+};
+
+typedef vector<FilterOutMethod> FilterOutMethodArray;
+typedef vector<FilterOutMethodArray::size_type> FilterOutMethodIndex;
+///////////////////////////////////////////////////////////////
 class Filters
 {
   public:
-    Filters(const ComHub &_hub) : hub(_hub) {}
+    Filters(const ComHub &_hub) : hub(_hub), pAsyncPool(NULL), numPorts(0) {}
     ~Filters();
     BOOL CreateFilter(
         const FILTER_ROUTINES_A *pFltRoutines,
@@ -75,7 +91,13 @@ class Filters
         BOOL addInMethod,
         BOOL addOutMethod,
         const set<Port *> *pOutMethodSrcPorts);
+    void SetAsync(const char *pName) { asyncFilters.insert(pName); }
+    BOOL StartAsync(unsigned numThreads = 0);
     void Report() const;
+    void LatencyReport(const Ports &ports) const;
+    void StatsReport(Stats &stats, const Ports &ports) const;
+    void BindPorts(PortMap &bindMap) const;
+    BOOL CompileOutMethods();
     BOOL InMethod(
         Port *pFromPort,
         HubMsg *pInMsg,
@@ -96,6 +118,16 @@ class Filters
     const ComHub &hub;
     FilterArray allFilters;
     PortFiltersMap portFilters;
+
+    set<string> asyncFilters;
+    AsyncPool *pAsyncPool;
+
+    // OUT methods of (from, to) pair are
+    //   outMethods[outMethodsIndex[from*numPorts + to]] ...
+    //   outMethods[outMethodsIndex[from*numPorts + to + 1] - 1]
+    unsigned numPorts;
+    FilterOutMethodArray outMethods;
+    FilterOutMethodIndex outMethodsIndex;
 };
 ///////////////////////////////////////////////////////////////
 
@@ -97,6 +97,7 @@
 
 #include "comhub.h"
 #include "filters.h"
+#include "stats.h"
 #include "utils.h"
 #include "plugins.h"
 #include "route.h"
@@ -145,6 +146,15 @@ static void Usage(const char *pProgPath, Plugins &plugins)
   << "                             (default flow control route enabled from P1 to P2" << endl
   << "                             if enabled data route from P1 to P2 and from P2 to" << endl
   << "                             P1)." << endl
+  << "  --route-weight=<LstR>:<LstL>:<w>" << endl
+  << "                           - set to <w> (1 by default) the weight of data sent" << endl
+  << "                             from any port listed in <LstR> to the ports listed" << endl
+  << "                             in <LstL>. If the data from several ports is" << endl
+  << "                             waiting for the credit of the port then the port" << endl
+  << "                             sends it in proportion to the weights." << endl
+  << "  --route-limit=<s>        - limit to <s> bytes the data of a route waiting for" << endl
+  << "                             the credit and discard the data over the limit (0" << endl
+  << "                             by default, means no limit and nothing discarded)." << endl
   << endl
   << "  If no any route option specified, then the options --route=0:All --route=1:0" << endl
   << "  used by default (route data from first port to all ports and from second" << endl
@@ -164,6 +174,11 @@ static void Usage(const char *pProgPath, Plugins &plugins)
   << "                             data by IN method just after receiving from ports" << endl
   << "                             listed in <Lst> or by OUT method just before" << endl
   << "                             sending to ports listed in <Lst>." << endl
+  << "  --async-filter=<FN>      - handle the data by the filter with name <FN> on" << endl
+  << "                             the offload threads (one per CPU) keeping the" << endl
+  << "                             order of data of each port. The filter should be" << endl
+  << "                             the first filter of its ports and its module" << endl
+  << "                             should declare it as async safe." << endl
   << endl
   << "  The syntax of <LstF> above is <F1>[,<F2>...], where the syntax of <Fn> is" << endl
   << "  <FGID>[.<Method>][(<Lst>)], where <FGID> is a filter group, <Method> is IN or" << endl
@@ -176,6 +191,20 @@ static void Usage(const char *pProgPath, Plugins &plugins)
   << "  --use-driver=<MID>       - use driver module with name <MID> to create the" << endl
   << "                             following ports (<MID> is serial by default)." << endl
   << endl
+  << "Thread options:" << endl
+  << "  --threads=<n>            - run the ports on up to <n> threads (1 by" << endl
+  << "                             default). The ports connected by routes or" << endl
+  << "                             sharing the filters run on the same thread." << endl
+  << endl
+  << "Statistics options:" << endl
+  << "  --stats-file=<file>      - every 10 seconds save the counters of ports and" << endl
+  << "                             filters (messages, bytes, write queue, XOFF time" << endl
+  << "                             etc.) to the file <file>. The file is replaced" << endl
+  << "                             atomically." << endl
+  << "  --stats-format=<fmt>     - use format <fmt> for the statistics file, where" << endl
+  << "                             <fmt> is prometheus (Prometheus text exposition" << endl
+  << "                             format) or json (prometheus by default)." << endl
+  << endl
   << "The syntax of <LstR>, <LstL> and <Lst> above is <P1>[,<P2>...], where <Pn> is a" << endl
   << "zero based position number of port or All." << endl
   ;
@@ -324,6 +353,43 @@ static void Route(
   free(pTmp);
 }
 ///////////////////////////////////////////////////////////////
+static BOOL RouteWeight(ComHub &hub, Port *pTo, HPRM0 pFrom, HPRM1 pWeight, HPRM2 /*p2*/)
+{
+  hub.SetRouteWeight((Port *)pFrom, pTo, (DWORD)*(int *)pWeight);
+  return TRUE;
+}
+
+static BOOL RouteWeightList(ComHub &hub, Port *pFrom, HPRM0 pListTo, HPRM1 pWeight, HPRM2 /*p2*/)
+{
+  return EnumPortList(hub, (const char *)pListTo, RouteWeight, (HPRM0)pFrom, pWeight);
+}
+
+static void RouteWeight(ComHub &hub, const char *pParam)
+{
+  char *pTmp = _strdup(pParam);
+
+  if (!pTmp) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  char *pSave;
+  const char *pListR = STRTOK_R(pTmp, ":", &pSave);
+  const char *pListL = STRTOK_R(NULL, ":", &pSave);
+  const char *pWeight = STRTOK_R(NULL, "", &pSave);
+  int weight;
+
+  if (!pListR || !pListL || !pWeight ||
+      !StrToInt(pWeight, &weight) || weight < 1 ||
+      !EnumPortList(hub, pListR, RouteWeightList, (HPRM0)pListL, (HPRM1)&weight))
+  {
+    cerr << "Invalid route weight " << pParam << endl;
+    exit(1);
+  }
+
+  free(pTmp);
+}
+///////////////////////////////////////////////////////////////
 static BOOL CreateFilter(
     const Plugins &plugins,
     Filters &filter,
@@ -517,6 +583,8 @@ static void Init(ComHub &hub, int argc, const char *const argv[])
   PortMap noDefaultRouteFlowControlMap;
 
   const char *pUseDriver = "serial";
+  const char *pStatsFile = NULL;
+  Stats::Format statsFormat = Stats::FORMAT_PROMETHEUS;
 
   for (vector<Arg>::const_iterator i = args.begin() ; i != args.end() ; i++) {
     BOOL ok = pPlugins->Config(i->c_str());
@@ -585,6 +653,20 @@ static void Init(ComHub &hub, int argc, const char *const argv[])
       defaultRouteData = FALSE;
       Route(hub, pParam, FALSE, FALSE, FALSE, noDefaultRouteFlowControlMap);
     } else
+    if ((pParam = GetParam(pArg, "route-weight=")) != NULL) {
+      RouteWeight(hub, pParam);
+    } else
+    if ((pParam = GetParam(pArg, "route-limit=")) != NULL) {
+      int limit;
+
+      if (!StrToInt(pParam, &limit) || limit < 0) {
+        cerr << "Invalid route limit in '" << i->c_str() << "'";
+        i->OutReference(cerr, " (", ")") << endl;
+        exit(1);
+      }
+
+      hub.SetRouteLimit((DWORD)limit);
+    } else
     if ((pParam = GetParam(pArg, "create-filter=")) != NULL) {
       if (!pFilters)
         pFilters = new Filters(hub);
@@ -609,8 +691,38 @@ static void Init(ComHub &hub, int argc, const char *const argv[])
 
       AddFilters(hub, *pFilters, pParam);
     } else
+    if ((pParam = GetParam(pArg, "async-filter=")) != NULL) {
+      if (!pFilters) {
+        cerr << "There is not any --create-filter option before '" << i->c_str() << "'";
+        i->OutReference(cerr, " (", ")") << endl;
+        exit(1);
+      }
+
+      pFilters->SetAsync(pParam);
+    } else
     if ((pParam = GetParam(pArg, "use-driver=")) != NULL) {
       pUseDriver = pParam;
+    } else
+    if ((pParam = GetParam(pArg, "threads=")) != NULL) {
+      int num;
+
+      if (!StrToInt(pParam, &num) || num < 1) {
+        cerr << "Invalid number of threads in '" << i->c_str() << "'";
+        i->OutReference(cerr, " (", ")") << endl;
+        exit(1);
+      }
+
+      hub.SetThreads((unsigned)num);
+    } else
+    if ((pParam = GetParam(pArg, "stats-file=")) != NULL) {
+      pStatsFile = pParam;
+    } else
+    if ((pParam = GetParam(pArg, "stats-format=")) != NULL) {
+      if (!Stats::GetFormat(pParam, &statsFormat)) {
+        cerr << "Unknown statistics format in '" << i->c_str() << "'";
+        i->OutReference(cerr, " (", ")") << endl;
+        exit(1);
+      }
     } else {
       if (!ok) {
         cerr << "Unknown option '" << i->c_str() << "'";
@@ -643,6 +755,18 @@ static void Init(ComHub &hub, int argc, const char *const argv[])
   hub.SetDataRoute(routeDataMap);
 
   hub.SetFilters(pFilters);
+
+  if (pStatsFile && *pStatsFile) {
+    Stats *pStats = new Stats(pStatsFile, statsFormat);
+
+    if (!pStats) {
+      cerr << "No enough memory." << endl;
+      exit(2);
+    }
+
+    hub.SetStats(pStats);
+  }
+
   hub.RouteReport();
 
   if (pFilters)
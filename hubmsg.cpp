@@ -36,6 +36,51 @@
 #include "hubmsg.h"
 #include "bufutils.h"
 
+///////////////////////////////////////////////////////////////
+//
+// Per thread pool of freed HubMsg objects (up to MSG_POOL_MAX)
+//
+#define MSG_POOL_MAX 1024
+
+struct FreeMsg {
+  FreeMsg *pNext;
+};
+
+static __declspec(thread) FreeMsg *pFreeMsgs = NULL;
+static __declspec(thread) DWORD countFreeMsgs = 0;
+///////////////////////////////////////////////////////////////
+void *HubMsg::operator new(size_t size)
+{
+  _ASSERTE(size == sizeof(HubMsg));
+
+  if (pFreeMsgs) {
+    FreeMsg *pFreeMsg = pFreeMsgs;
+
+    pFreeMsgs = pFreeMsg->pNext;
+    countFreeMsgs--;
+
+    return pFreeMsg;
+  }
+
+  return ::operator new(size);
+}
+///////////////////////////////////////////////////////////////
+void HubMsg::operator delete(void *pMem)
+{
+  if (!pMem)
+    return;
+
+  if (countFreeMsgs >= MSG_POOL_MAX) {
+    ::operator delete(pMem);
+    return;
+  }
+
+  FreeMsg *pFreeMsg = (FreeMsg *)pMem;
+
+  pFreeMsg->pNext = pFreeMsgs;
+  pFreeMsgs = pFreeMsg;
+  countFreeMsgs++;
+}
 ///////////////////////////////////////////////////////////////
 HubMsg::HubMsg()
   : pNext(NULL)
@@ -51,8 +96,18 @@ HubMsg::~HubMsg()
 {
   _ASSERTE(signature == MSG_SIGNATURE);
 
-  if (pNext)
-    delete pNext;
+  // delete the rest of chain iteratively to not overflow the stack
+
+  HubMsg *pNextMsg = pNext;
+
+  while (pNextMsg) {
+    HubMsg *pMsg = pNextMsg;
+
+    pNextMsg = pMsg->pNext;
+    pMsg->pNext = NULL;
+
+    delete pMsg;
+  }
 
   Clean();
 
@@ -65,35 +120,27 @@ HubMsg *HubMsg::Clone() const
 {
   _ASSERTE(signature == MSG_SIGNATURE);
 
-  HubMsg *pNewMsg = new HubMsg();
+  HubMsgChain chain;
 
-  if (!pNewMsg)
-    return NULL;
+  for (const HubMsg *pMsg = this ; pMsg ; pMsg = pMsg->pNext) {
+    _ASSERTE(pMsg->signature == MSG_SIGNATURE);
 
-  if (pNext) {
-    pNewMsg->pNext = pNext->Clone();
+    HubMsg *pNewMsg = new HubMsg();
 
-    if (!pNewMsg->pNext) {
-      delete pNewMsg;
+    if (!pNewMsg)
       return NULL;
-    }
-  }
 
-  if ((type & HUB_MSG_UNION_TYPES_MASK) == HUB_MSG_UNION_TYPE_BUF) {
-    BufAppend(&pNewMsg->u.buf.pBuf, 0, u.buf.pBuf, u.buf.size);
+    *(HUB_MSG *)pNewMsg = *(const HUB_MSG *)pMsg;
 
-    if (pNewMsg->u.buf.pBuf || !u.buf.size) {
-      pNewMsg->type = type;
-      pNewMsg->u.buf.size = u.buf.size;
-    } else {
-      delete pNewMsg;
-      return NULL;
+    if ((pMsg->type & HUB_MSG_UNION_TYPES_MASK) == HUB_MSG_UNION_TYPE_BUF) {
+      // share the data, it will be copied on write
+      BufRef(pNewMsg->u.buf.pBuf);
     }
-  } else {
-    *(HUB_MSG *)pNewMsg = *(const HUB_MSG *)this;
+
+    chain.Append(pNewMsg);
   }
 
-  return pNewMsg;
+  return chain.Detach();
 }
 ///////////////////////////////////////////////////////////////
 void HubMsg::Clean()
@@ -106,15 +153,41 @@ void HubMsg::Clean()
   ::memset((HUB_MSG *)this, 0, sizeof(HUB_MSG));
 }
 ///////////////////////////////////////////////////////////////
-void HubMsg::Merge(HubMsg *pMsg)
+void HubMsgChain::Clean()
 {
-  _ASSERTE(signature == MSG_SIGNATURE);
-  _ASSERTE(pMsg == NULL || pMsg->signature == MSG_SIGNATURE);
+  if (pHead) {
+    delete pHead;
+    pHead = pTail = NULL;
+  }
+}
+///////////////////////////////////////////////////////////////
+void HubMsgChain::Append(HubMsg *pMsg)
+{
+  if (!pMsg)
+    return;
+
+  _ASSERTE(pMsg->signature == MSG_SIGNATURE);
+
+  if (pTail) {
+    _ASSERTE(pTail->pNext == NULL);
+
+    pTail->pNext = pMsg;
+  } else {
+    pHead = pMsg;
+  }
+
+  // the appended message can be a chain itself
+
+  for (pTail = pMsg ; pTail->pNext ; pTail = pTail->pNext)
+    ;
+}
+///////////////////////////////////////////////////////////////
+HubMsg *HubMsgChain::Detach()
+{
+  HubMsg *pMsg = pHead;
 
-  HubMsg **ppNext = &pNext;
-  while (*ppNext)
-    ppNext = &(*ppNext)->pNext;
+  pHead = pTail = NULL;
 
-  *ppNext = pMsg;
+  return pMsg;
 }
 ///////////////////////////////////////////////////////////////
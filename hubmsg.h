@@ -39,8 +39,10 @@ class HubMsg : public HUB_MSG
     HubMsg();
     ~HubMsg();
 
+    static void *operator new(size_t size);
+    static void operator delete(void *pMem);
+
     void Clean();
-    void Merge(HubMsg *pMsg);
     HubMsg *Clone() const;
 
     void Insert(HubMsg *pPrevMsg) {
@@ -63,6 +65,25 @@ class HubMsg : public HUB_MSG
 #ifdef _DEBUG
     DWORD signature;
 #endif
+
+    friend class HubMsgChain;
+};
+///////////////////////////////////////////////////////////////
+class HubMsgChain
+{
+  public:
+    HubMsgChain() : pHead(NULL), pTail(NULL) {}
+    ~HubMsgChain() { Clean(); }
+
+    void Clean();
+    void Append(HubMsg *pMsg);
+    HubMsg *Detach();
+
+    HubMsg *Head() const { return pHead; }
+
+  private:
+    HubMsg *pHead;
+    HubMsg *pTail;
 };
 ///////////////////////////////////////////////////////////////
 
@@ -0,0 +1,145 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+
+#include "latency.h"
+
+#ifdef USE_LATENCY_STATS
+///////////////////////////////////////////////////////////////
+static LONGLONG Frequency()
+{
+  static LONGLONG frequency = 0;
+
+  if (!frequency) {
+    LARGE_INTEGER li;
+
+    if (!::QueryPerformanceFrequency(&li) || li.QuadPart <= 0)
+      li.QuadPart = 1000;
+
+    frequency = li.QuadPart;
+  }
+
+  return frequency;
+}
+///////////////////////////////////////////////////////////////
+int LatencyHist::BucketIndex(LONGLONG ticks)
+{
+  if (ticks < LATENCY_SUB_BUCKETS)
+    return ticks > 0 ? (int)ticks : 0;
+
+  int msb = LATENCY_SUB_BITS;
+
+  for (LONGLONG t = ticks >> (LATENCY_SUB_BITS + 1) ; t ; t >>= 1)
+    msb++;
+
+  return (msb - LATENCY_SUB_BITS + 1)*LATENCY_SUB_BUCKETS +
+         (int)((ticks >> (msb - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+LONGLONG LatencyHist::BucketValue(int iBucket)
+{
+  int k = iBucket/LATENCY_SUB_BUCKETS;
+
+  if (!k)
+    return iBucket;
+
+  // the highest value of the bucket
+
+  LONGLONG lower = (LONGLONG)(LATENCY_SUB_BUCKETS + iBucket%LATENCY_SUB_BUCKETS) << (k - 1);
+
+  return lower + ((LONGLONG)1 << (k - 1)) - 1;
+}
+///////////////////////////////////////////////////////////////
+static void PrintTicks(ostream &out, LONGLONG ticks)
+{
+  LONGLONG frequency = Frequency();
+  LONGLONG ns = ticks / frequency * 1000000000 +
+                ticks % frequency * 1000000000 / frequency;
+
+  if (ns < 1000)
+    out << ns << "ns";
+  else
+  if (ns < 1000000)
+    out << ns/1000 << "." << ns/100%10 << "us";
+  else
+    out << ns/1000000 << "." << ns/100000%10 << "ms";
+}
+///////////////////////////////////////////////////////////////
+void LatencyHist::Put(LONGLONG ticks)
+{
+  buckets[BucketIndex(ticks)]++;
+  count++;
+
+  if (max < ticks)
+    max = ticks;
+}
+
+void LatencyHist::Reset()
+{
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  max = 0;
+}
+///////////////////////////////////////////////////////////////
+void LatencyHist::Report(const string &name, const char *pWhat)
+{
+  if (!count)
+    return;
+
+  static const struct {
+    const char *pName;
+    DWORD perMille;
+  } percentiles[] = {
+    { "p50",   500 },
+    { "p90",   900 },
+    { "p99",   990 },
+    { "p99.9", 999 },
+  };
+
+  cout << "Latency " << name << " " << pWhat << ": count " << count;
+
+  int iBucket = 0;
+  DWORD counted = buckets[0];
+
+  for (int i = 0 ; i < int(sizeof(percentiles)/sizeof(percentiles[0])) ; i++) {
+    DWORD threshold = (DWORD)(((ULONGLONG)count * percentiles[i].perMille + 999) / 1000);
+
+    while (counted < threshold && iBucket < LATENCY_BUCKETS - 1)
+      counted += buckets[++iBucket];
+
+    LONGLONG value = BucketValue(iBucket);
+
+    cout << ", " << percentiles[i].pName << " ";
+    PrintTicks(cout, value < max ? value : max);
+  }
+
+  cout << ", max ";
+  PrintTicks(cout, max);
+  cout << endl;
+
+  Reset();
+}
+///////////////////////////////////////////////////////////////
+#endif  /* USE_LATENCY_STATS */
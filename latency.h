@@ -0,0 +1,95 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+///////////////////////////////////////////////////////////////
+// Latency histogram with logarithmic buckets, each power of two
+// range is split to LATENCY_SUB_BUCKETS linear sub-buckets, so
+// the relative error of the reported values is less than 1/8.
+//
+// The values are QueryPerformanceCounter() ticks. The histograms
+// are collected if the hub is built with USE_LATENCY_STATS,
+// otherwise all the methods are empty.
+///////////////////////////////////////////////////////////////
+#define LATENCY_SUB_BITS      3
+#define LATENCY_SUB_BUCKETS   (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS       ((63 - LATENCY_SUB_BITS + 1)*LATENCY_SUB_BUCKETS)
+///////////////////////////////////////////////////////////////
+#ifdef USE_LATENCY_STATS
+///////////////////////////////////////////////////////////////
+class LatencyHist
+{
+  public:
+    LatencyHist() { Reset(); }
+
+    static LONGLONG Counter() {
+      LARGE_INTEGER li;
+
+      ::QueryPerformanceCounter(&li);
+
+      return li.QuadPart;
+    }
+
+    // adds the time elapsed since start and returns the current counter
+
+    LONGLONG Add(LONGLONG start) {
+      LONGLONG now = Counter();
+
+      Put(now - start);
+
+      return now;
+    }
+
+    void Report(const string &name, const char *pWhat);
+
+    // the bucket of the ticks and the highest value of the bucket
+
+    static int BucketIndex(LONGLONG ticks);
+    static LONGLONG BucketValue(int iBucket);
+
+  private:
+    void Put(LONGLONG ticks);
+    void Reset();
+
+    DWORD buckets[LATENCY_BUCKETS];
+    DWORD count;
+    LONGLONG max;
+};
+///////////////////////////////////////////////////////////////
+#else   /* USE_LATENCY_STATS */
+///////////////////////////////////////////////////////////////
+class LatencyHist
+{
+  public:
+    static LONGLONG Counter() { return 0; }
+    LONGLONG Add(LONGLONG /*start*/) { return 0; }
+    void Report(const string &/*name*/, const char * /*pWhat*/) {}
+};
+///////////////////////////////////////////////////////////////
+#endif  /* USE_LATENCY_STATS */
+///////////////////////////////////////////////////////////////
+
+#endif  // _LATENCY_H
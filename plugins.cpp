@@ -42,6 +42,8 @@
 #include "precomp.h"
 #include "plugins/plugins_api.h"
 
+#include "latency.h"
+#include "stats.h"
 #include "port.h"
 #include "comhub.h"
 #include "plugins.h"
@@ -71,6 +71,7 @@ namespace FilterAwakSeq {
   #define DEBUG_PARAM(par) par
 #endif  /* _DEBUG */
 ///////////////////////////////////////////////////////////////
+static ROUTINE_BUF_MAKE_WRITABLE *pBufMakeWritable;
 static ROUTINE_MSG_REPLACE_VAL *pMsgReplaceVal;
 static ROUTINE_MSG_REPLACE_NONE *pMsgReplaceNone;
 static ROUTINE_MSG_INSERT_NONE *pMsgInsertNone;
@@ -315,7 +316,12 @@ static BOOL CALLBACK InMethod(
         // insert CONNECT(TRUE) before rest of data
 
         if (pBuf != pInMsg->u.buf.pBuf) {
-          memmove(pInMsg->u.buf.pBuf, pBuf, size);
+          DWORD offset = DWORD(pBuf - pInMsg->u.buf.pBuf);
+
+          if (!pBufMakeWritable(&pInMsg->u.buf.pBuf, offset + size))
+            return FALSE;
+
+          memmove(pInMsg->u.buf.pBuf, pInMsg->u.buf.pBuf + offset, size);
           pBuf = pInMsg->u.buf.pBuf;
         }
 
@@ -422,7 +428,8 @@ PLUGIN_INIT_A InitA;
 const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     const HUB_ROUTINES_A * pHubRoutines)
 {
-  if (!ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceVal) ||
+  if (!ROUTINE_IS_VALID(pHubRoutines, pBufMakeWritable) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceVal) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceNone) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgInsertNone) ||
       !ROUTINE_IS_VALID(pHubRoutines, pGetFilter))
@@ -430,6 +437,7 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     return NULL;
   }
 
+  pBufMakeWritable = pHubRoutines->pBufMakeWritable;
   pMsgReplaceVal = pHubRoutines->pMsgReplaceVal;
   pMsgReplaceNone = pHubRoutines->pMsgReplaceNone;
   pMsgInsertNone = pHubRoutines->pMsgInsertNone;
@@ -50,6 +50,30 @@ BOOL ComPort::Init(HMASTERPORT _hMasterPort)
   return TRUE;
 }
 
+void ComPort::ConnectDataPort(ComPort *pPort)
+{
+  connectedDataPorts.insert(pPort);
+  BindPort(pPort);
+}
+
+void ComPort::ConnectFlowControlPort(ComPort *pPort)
+{
+  connectedFlowControlPorts.insert(pPort);
+  BindPort(pPort);
+}
+
+void ComPort::BindPort(const ComPort *pPort) const
+{
+  // the connected ports call pOnRead() of each other, so they
+  // should run on the same thread
+
+  _ASSERTE(hMasterPort != NULL);
+  _ASSERTE(pPort->hMasterPort != NULL);
+
+  if (pBindPorts && pPort != this)
+    pBindPorts(hMasterPort, pPort->hMasterPort);
+}
+
 BOOL ComPort::FakeReadFilter(HUB_MSG *pInMsg)
 {
   _ASSERTE(pInMsg != NULL);
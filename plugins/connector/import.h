@@ -30,6 +30,7 @@
 ///////////////////////////////////////////////////////////////
 extern ROUTINE_BUF_ALLOC *pBufAlloc;
 extern ROUTINE_ON_READ *pOnRead;
+extern ROUTINE_BIND_PORTS *pBindPorts;
 ///////////////////////////////////////////////////////////////
 
 #endif  // _IMPORT_H
@@ -359,6 +359,7 @@ static const PLUGIN_ROUTINES_A *const plugins[] = {
 ///////////////////////////////////////////////////////////////
 ROUTINE_BUF_ALLOC *pBufAlloc;
 ROUTINE_ON_READ *pOnRead;
+ROUTINE_BIND_PORTS *pBindPorts;
 ///////////////////////////////////////////////////////////////
 PLUGIN_INIT_A InitA;
 const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
@@ -372,6 +373,7 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
 
   pBufAlloc = pHubRoutines->pBufAlloc;
   pOnRead = pHubRoutines->pOnRead;
+  pBindPorts = ROUTINE_GET(pHubRoutines, pBindPorts);
 
   return plugins;
 }
@@ -0,0 +1,375 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "cipherdefs.h"
+///////////////////////////////////////////////////////////////
+namespace FilterCrypt {
+///////////////////////////////////////////////////////////////
+#include "cipher.h"
+///////////////////////////////////////////////////////////////
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+///////////////////////////////////////////////////////////////
+static DWORD LoadLE32(const BYTE *p)
+{
+  return (DWORD)p[0] | ((DWORD)p[1] << 8) | ((DWORD)p[2] << 16) | ((DWORD)p[3] << 24);
+}
+
+static void StoreLE32(BYTE *p, DWORD v)
+{
+  p[0] = (BYTE)v;
+  p[1] = (BYTE)(v >> 8);
+  p[2] = (BYTE)(v >> 16);
+  p[3] = (BYTE)(v >> 24);
+}
+
+static DWORD LoadBE32(const BYTE *p)
+{
+  return ((DWORD)p[0] << 24) | ((DWORD)p[1] << 16) | ((DWORD)p[2] << 8) | (DWORD)p[3];
+}
+
+static void StoreBE32(BYTE *p, DWORD v)
+{
+  p[0] = (BYTE)(v >> 24);
+  p[1] = (BYTE)(v >> 16);
+  p[2] = (BYTE)(v >> 8);
+  p[3] = (BYTE)v;
+}
+///////////////////////////////////////////////////////////////
+// Merkle-Damgard padding shared by MD5 and SHA-256: feeds the
+// 64-byte blocks of the message followed by the padding and the
+// 64-bit message length in bits (big or little endian)
+///////////////////////////////////////////////////////////////
+typedef void HASH_BLOCK(DWORD *pHash, const BYTE *pBlock);
+
+static void HashBlocks(
+    HASH_BLOCK *pHashBlock,
+    BOOL bigEndian,
+    DWORD *pHash,
+    const BYTE *pData,
+    DWORD len)
+{
+  DWORD lenBitsLo = len << 3;
+  DWORD lenBitsHi = len >> 29;
+
+  for (; len >= 64 ; pData += 64, len -= 64)
+    pHashBlock(pHash, pData);
+
+  BYTE tail[128];
+
+  memcpy(tail, pData, len);
+  memset(tail + len, 0, sizeof(tail) - len);
+  tail[len] = 0x80;
+
+  DWORD lenTail = (len < 56) ? 64 : 128;
+
+  if (bigEndian) {
+    StoreBE32(tail + lenTail - 8, lenBitsHi);
+    StoreBE32(tail + lenTail - 4, lenBitsLo);
+  } else {
+    StoreLE32(tail + lenTail - 8, lenBitsLo);
+    StoreLE32(tail + lenTail - 4, lenBitsHi);
+  }
+
+  for (DWORD i = 0 ; i < lenTail ; i += 64)
+    pHashBlock(pHash, tail + i);
+}
+///////////////////////////////////////////////////////////////
+static void Md5Block(DWORD *pHash, const BYTE *pBlock)
+{
+  static const DWORD k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+  };
+
+  static const int r[16] = {
+    7, 12, 17, 22,
+    5,  9, 14, 20,
+    4, 11, 16, 23,
+    6, 10, 15, 21,
+  };
+
+  DWORD m[16];
+
+  for (int i = 0 ; i < 16 ; i++)
+    m[i] = LoadLE32(pBlock + i*4);
+
+  DWORD a = pHash[0];
+  DWORD b = pHash[1];
+  DWORD c = pHash[2];
+  DWORD d = pHash[3];
+
+  for (int i = 0 ; i < 64 ; i++) {
+    DWORD f;
+    int g;
+
+    switch (i >> 4) {
+      case 0:
+        f = (b & c) | (~b & d);
+        g = i;
+        break;
+      case 1:
+        f = (d & b) | (~d & c);
+        g = (5*i + 1) & 15;
+        break;
+      case 2:
+        f = b ^ c ^ d;
+        g = (3*i + 5) & 15;
+        break;
+      default:
+        f = c ^ (b | ~d);
+        g = (7*i) & 15;
+    }
+
+    DWORD t = d;
+    int s = r[((i >> 4) << 2) | (i & 3)];
+
+    d = c;
+    c = b;
+    f += a + k[i] + m[g];
+    b += ROTL32(f, s);
+    a = t;
+  }
+
+  pHash[0] += a;
+  pHash[1] += b;
+  pHash[2] += c;
+  pHash[3] += d;
+}
+
+void Md5(const BYTE *pData, DWORD len, BYTE digest[MD5_DIGEST_SIZE])
+{
+  DWORD hash[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+  HashBlocks(Md5Block, FALSE, hash, pData, len);
+
+  for (int i = 0 ; i < 4 ; i++)
+    StoreLE32(digest + i*4, hash[i]);
+}
+///////////////////////////////////////////////////////////////
+#define ROTR32(v, n) (((v) >> (n)) | ((v) << (32 - (n))))
+
+static void Sha256Block(DWORD *pHash, const BYTE *pBlock)
+{
+  static const DWORD k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+  };
+
+  DWORD w[64];
+
+  for (int i = 0 ; i < 16 ; i++)
+    w[i] = LoadBE32(pBlock + i*4);
+
+  for (int i = 16 ; i < 64 ; i++) {
+    DWORD s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    DWORD s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  DWORD h[8];
+
+  for (int i = 0 ; i < 8 ; i++)
+    h[i] = pHash[i];
+
+  for (int i = 0 ; i < 64 ; i++) {
+    DWORD s1 = ROTR32(h[4], 6) ^ ROTR32(h[4], 11) ^ ROTR32(h[4], 25);
+    DWORD ch = (h[4] & h[5]) ^ (~h[4] & h[6]);
+    DWORD t1 = h[7] + s1 + ch + k[i] + w[i];
+    DWORD s0 = ROTR32(h[0], 2) ^ ROTR32(h[0], 13) ^ ROTR32(h[0], 22);
+    DWORD maj = (h[0] & h[1]) ^ (h[0] & h[2]) ^ (h[1] & h[2]);
+    DWORD t2 = s0 + maj;
+
+    h[7] = h[6];
+    h[6] = h[5];
+    h[5] = h[4];
+    h[4] = h[3] + t1;
+    h[3] = h[2];
+    h[2] = h[1];
+    h[1] = h[0];
+    h[0] = t1 + t2;
+  }
+
+  for (int i = 0 ; i < 8 ; i++)
+    pHash[i] += h[i];
+}
+
+void Sha256(const BYTE *pData, DWORD len, BYTE digest[SHA256_DIGEST_SIZE])
+{
+  DWORD hash[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+
+  HashBlocks(Sha256Block, TRUE, hash, pData, len);
+
+  for (int i = 0 ; i < 8 ; i++)
+    StoreBE32(digest + i*4, hash[i]);
+}
+///////////////////////////////////////////////////////////////
+CipherRc4::CipherRc4(const BYTE *pKey, DWORD lenKey)
+  : i(0),
+    j(0)
+{
+  _ASSERTE(pKey != NULL);
+  _ASSERTE(lenKey > 0);
+
+  for (int k = 0 ; k < 256 ; k++)
+    s[k] = (BYTE)k;
+
+  BYTE t = 0;
+
+  for (int k = 0 ; k < 256 ; k++) {
+    t = (BYTE)(t + s[k] + pKey[k % lenKey]);
+
+    BYTE tmp = s[k];
+    s[k] = s[t];
+    s[t] = tmp;
+  }
+}
+
+void CipherRc4::Crypt(BYTE *pBuf, DWORD len)
+{
+  BYTE ii = i;
+  BYTE jj = j;
+
+  for (BYTE *pEnd = pBuf + len ; pBuf != pEnd ; pBuf++) {
+    ii++;
+
+    BYTE si = s[ii];
+
+    jj = (BYTE)(jj + si);
+
+    BYTE sj = s[jj];
+
+    s[ii] = sj;
+    s[jj] = si;
+
+    *pBuf ^= s[(BYTE)(si + sj)];
+  }
+
+  i = ii;
+  j = jj;
+}
+///////////////////////////////////////////////////////////////
+#define CHACHA20_QR(a, b, c, d) \
+  a += b; d ^= a; d = ROTL32(d, 16); \
+  c += d; b ^= c; b = ROTL32(b, 12); \
+  a += b; d ^= a; d = ROTL32(d, 8); \
+  c += d; b ^= c; b = ROTL32(b, 7);
+
+CipherChaCha20::CipherChaCha20(
+    const BYTE key[CHACHA20_KEY_SIZE],
+    const BYTE nonce[CHACHA20_NONCE_SIZE],
+    DWORD counter)
+  : streamUsed(sizeof(stream))
+{
+  // "expand 32-byte k"
+  state[0] = 0x61707865;
+  state[1] = 0x3320646e;
+  state[2] = 0x79622d32;
+  state[3] = 0x6b206574;
+
+  for (int i = 0 ; i < 8 ; i++)
+    state[4 + i] = LoadLE32(key + i*4);
+
+  // 64-bit block counter followed by 64-bit nonce
+  state[12] = counter;
+  state[13] = 0;
+  state[14] = LoadLE32(nonce);
+  state[15] = LoadLE32(nonce + 4);
+}
+
+void CipherChaCha20::NextStream()
+{
+  for (BYTE *pBlock = stream ; pBlock != stream + sizeof(stream) ; pBlock += CHACHA20_BLOCK_SIZE) {
+    DWORD x[16];
+
+    for (int i = 0 ; i < 16 ; i++)
+      x[i] = state[i];
+
+    for (int i = 0 ; i < 10 ; i++) {
+      CHACHA20_QR(x[0], x[4], x[ 8], x[12])
+      CHACHA20_QR(x[1], x[5], x[ 9], x[13])
+      CHACHA20_QR(x[2], x[6], x[10], x[14])
+      CHACHA20_QR(x[3], x[7], x[11], x[15])
+      CHACHA20_QR(x[0], x[5], x[10], x[15])
+      CHACHA20_QR(x[1], x[6], x[11], x[12])
+      CHACHA20_QR(x[2], x[7], x[ 8], x[13])
+      CHACHA20_QR(x[3], x[4], x[ 9], x[14])
+    }
+
+    for (int i = 0 ; i < 16 ; i++)
+      StoreLE32(pBlock + i*4, x[i] + state[i]);
+
+    if (++state[12] == 0)
+      state[13]++;
+  }
+
+  streamUsed = 0;
+}
+
+void CipherChaCha20::Crypt(BYTE *pBuf, DWORD len)
+{
+  while (len) {
+    if (streamUsed == sizeof(stream))
+      NextStream();
+
+    DWORD lenChunk = sizeof(stream) - streamUsed;
+
+    if (lenChunk > len)
+      lenChunk = len;
+
+    const BYTE *pStream = stream + streamUsed;
+    BYTE *pEnd = pBuf + lenChunk;
+
+    // XOR by machine words while both pointers allow it
+
+    if ((((ULONG_PTR)pBuf | (ULONG_PTR)pStream) & (sizeof(ULONG_PTR) - 1)) == 0) {
+      for (; pEnd - pBuf >= (int)sizeof(ULONG_PTR) ; pBuf += sizeof(ULONG_PTR), pStream += sizeof(ULONG_PTR))
+        *(ULONG_PTR *)pBuf ^= *(const ULONG_PTR *)pStream;
+    }
+
+    for (; pBuf != pEnd ; pBuf++, pStream++)
+      *pBuf ^= *pStream;
+
+    streamUsed += lenChunk;
+    len -= lenChunk;
+  }
+}
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
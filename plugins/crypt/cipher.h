@@ -0,0 +1,83 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#ifndef _CIPHER_H
+#define _CIPHER_H
+
+///////////////////////////////////////////////////////////////
+#define MD5_DIGEST_SIZE     16
+#define SHA256_DIGEST_SIZE  32
+///////////////////////////////////////////////////////////////
+void Md5(const BYTE *pData, DWORD len, BYTE digest[MD5_DIGEST_SIZE]);
+void Sha256(const BYTE *pData, DWORD len, BYTE digest[SHA256_DIGEST_SIZE]);
+///////////////////////////////////////////////////////////////
+class Cipher
+{
+  public:
+    virtual ~Cipher() {}
+
+    // encrypts or decrypts (the same for stream ciphers) in place
+    virtual void Crypt(BYTE *pBuf, DWORD len) = 0;
+};
+///////////////////////////////////////////////////////////////
+class CipherRc4 : public Cipher
+{
+  public:
+    CipherRc4(const BYTE *pKey, DWORD lenKey);
+
+    virtual void Crypt(BYTE *pBuf, DWORD len);
+
+  private:
+    BYTE s[256];
+    BYTE i;
+    BYTE j;
+};
+///////////////////////////////////////////////////////////////
+#define CHACHA20_KEY_SIZE       32
+#define CHACHA20_NONCE_SIZE     8
+#define CHACHA20_BLOCK_SIZE     64
+#define CHACHA20_STREAM_BLOCKS  4
+///////////////////////////////////////////////////////////////
+class CipherChaCha20 : public Cipher
+{
+  public:
+    CipherChaCha20(
+        const BYTE key[CHACHA20_KEY_SIZE],
+        const BYTE nonce[CHACHA20_NONCE_SIZE],
+        DWORD counter = 0);
+
+    virtual void Crypt(BYTE *pBuf, DWORD len);
+
+  private:
+    void NextStream();
+
+    DWORD state[16];
+
+    // keystream precomputed for CHACHA20_STREAM_BLOCKS blocks at once
+    BYTE stream[CHACHA20_BLOCK_SIZE*CHACHA20_STREAM_BLOCKS];
+    DWORD streamUsed;
+};
+///////////////////////////////////////////////////////////////
+
+#endif  // _CIPHER_H
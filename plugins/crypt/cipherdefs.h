@@ -0,0 +1,63 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#ifndef _CIPHERDEFS_H
+#define _CIPHERDEFS_H
+
+///////////////////////////////////////////////////////////////
+//
+// The cipher engine does not depend on Win32 so it can be built
+// and checked by tests/Makefile on other systems too.
+//
+///////////////////////////////////////////////////////////////
+#ifdef _WIN32
+
+#include <windows.h>
+#include <crtdbg.h>
+
+#else  /* _WIN32 */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef uint32_t DWORD;
+typedef uintptr_t ULONG_PTR;
+
+#ifndef TRUE
+  #define TRUE 1
+#endif
+#ifndef FALSE
+  #define FALSE 0
+#endif
+
+#define _ASSERTE(expr) assert(expr)
+
+#endif /* _WIN32 */
+///////////////////////////////////////////////////////////////
+
+#endif /* _CIPHERDEFS_H */
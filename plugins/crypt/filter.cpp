@@ -38,10 +38,14 @@
 
 #include "precomp.h"
 #include "../plugins_api.h"
+#include "cipherdefs.h"
 ///////////////////////////////////////////////////////////////
 namespace FilterCrypt {
 ///////////////////////////////////////////////////////////////
+#include "cipher.h"
+///////////////////////////////////////////////////////////////
 static ROUTINE_BUF_APPEND *pBufAppend;
+static ROUTINE_BUF_MAKE_WRITABLE *pBufMakeWritable;
 static ROUTINE_MSG_REPLACE_BUF *pmsgreplacebuf;
 ///////////////////////////////////////////////////////////////
 #ifndef _DEBUG
@@ -74,36 +78,58 @@ class Filter;
 
 class State : public Valid {
   public:
-    State() { Invalidate(); }
+    State()
+      : pFilter(NULL),
+        pCipherIn(NULL),
+        pCipherOut(NULL),
+        lenNonceIn(0),
+        nonceOutSent(TRUE)
+    {
+      Invalidate();
+    }
+
     ~State() { Close(); }
     void Open(const Filter &filter);
     void Close();
+    BOOL ReadNonce(HUB_MSG *pMsg);
+    BOOL WriteNonce(HUB_MSG *pMsg, DWORD len);
 
-    HCRYPTKEY hKeyIn;
-    HCRYPTKEY hKeyOut;
+    const Filter *pFilter;
+    Cipher *pCipherIn;
+    Cipher *pCipherOut;
+
+    // the nonces of ChaCha20 are sent in clear ahead of the data
+
+    BYTE nonceIn[CHACHA20_NONCE_SIZE];
+    DWORD lenNonceIn;
+    BYTE nonceOut[CHACHA20_NONCE_SIZE];
+    BOOL nonceOutSent;
 };
 ///////////////////////////////////////////////////////////////
 class Filter : public Valid {
   public:
     Filter(int argc, const char *const argv[]);
+    ~Filter();
 
-    ~Filter() {
-      if (IsValid())
-        CryptRelease();
-    }
+    BOOL UseNonce() const { return cipher == CIPHER_CHACHA20; }
+    BOOL NewNonce(BYTE nonce[CHACHA20_NONCE_SIZE]) const;
+    Cipher *NewCipher(const BYTE *pNonce = NULL) const;
 
   private:
-    void CryptRelease(BOOL all = TRUE);
-
-    friend class State;
+    enum {
+      CIPHER_RC4_MD5,
+      CIPHER_CHACHA20,
+    } cipher;
 
+    BYTE key[CHACHA20_KEY_SIZE];
     HCRYPTPROV hProv;
-    HCRYPTHASH hHash;
 };
 
 Filter::Filter(int argc, const char *const argv[])
+  : cipher(CIPHER_RC4_MD5),
+    hProv(NULL)
 {
-  BOOL noSecret = TRUE;
+  const char *pSecret = NULL;
 
   for (const char *const *pArgs = &argv[1] ; argc > 1 ; pArgs++, argc--) {
     const char *pArg = GetParam(*pArgs, "--");
@@ -117,7 +143,7 @@ Filter::Filter(int argc, const char *const argv[])
     const char *pParam;
 
     if ((pParam = GetParam(pArg, "secret=")) != NULL) {
-      if (!noSecret) {
+      if (pSecret) {
         cerr << "ERROR: The secret was set twice" << endl;
         Invalidate();
         continue;
@@ -126,30 +152,21 @@ Filter::Filter(int argc, const char *const argv[])
       if (!*pParam)
         cerr << "WARNING: The secret is empty" << endl;
 
-      if (!CryptAcquireContext(&hProv, NULL, MS_ENHANCED_PROV, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
-        DWORD err = GetLastError();
-        cerr << "CryptAcquireContext() - error=" << err << endl;
-        Invalidate();
-        continue;
+      pSecret = pParam;
+    }
+    else
+    if ((pParam = GetParam(pArg, "cipher=")) != NULL) {
+      if (_stricmp(pParam, "rc4-md5") == 0) {
+        cipher = CIPHER_RC4_MD5;
       }
-
-      if (!CryptCreateHash(hProv, CALG_MD5, 0, 0, &hHash)) {
-        DWORD err = GetLastError();
-        cerr << "CryptCreateHash() - error=" << err << endl;
-        CryptRelease(FALSE);
-        Invalidate();
-        continue;
+      else
+      if (_stricmp(pParam, "chacha20") == 0) {
+        cipher = CIPHER_CHACHA20;
       }
-
-      if (!CryptHashData(hHash, (const BYTE *)pParam, (DWORD)strlen(pParam), 0)) {
-        DWORD err = GetLastError();
-        cerr << "CryptHashData() - error=" << err << endl;
-        CryptRelease();
+      else {
+        cerr << "ERROR: Unknown cipher " << pParam << endl;
         Invalidate();
-        continue;
       }
-
-      noSecret = FALSE;
     }
     else {
       cerr << "ERROR: Unknown option " << pArg << endl;
@@ -157,54 +174,98 @@ Filter::Filter(int argc, const char *const argv[])
     }
   }
 
-  if (noSecret) {
+  if (!pSecret) {
     cerr << "ERROR: The secret was not set" << endl;
     Invalidate();
+    return;
   }
-  else
-  if (!IsValid()) {
-    CryptRelease();
+
+  switch (cipher) {
+    case CIPHER_RC4_MD5:
+      // the same 128-bit key as CryptDeriveKey(CALG_RC4) from a CALG_MD5 hash
+      Md5((const BYTE *)pSecret, (DWORD)strlen(pSecret), key);
+      break;
+    case CIPHER_CHACHA20:
+      Sha256((const BYTE *)pSecret, (DWORD)strlen(pSecret), key);
+
+      // the random nonces keep the keystreams of the directions and
+      // the connections unique
+
+      if (!CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
+        DWORD err = GetLastError();
+        cerr << "CryptAcquireContext() - error=" << err << endl;
+        hProv = NULL;
+        Invalidate();
+      }
+      break;
   }
 }
 
-void Filter::CryptRelease(BOOL all)
+Filter::~Filter()
 {
-  if (all) {
-    if (!CryptDestroyHash(hHash)) {
-      DWORD err = GetLastError();
-      cerr << "CryptDestroyHash() - error=" << err << endl;
-    }
+  if (hProv && !CryptReleaseContext(hProv, 0)) {
+    DWORD err = GetLastError();
+    cerr << "CryptReleaseContext() - error=" << err << endl;
   }
+}
 
-  if (CryptReleaseContext(hProv, 0)) {
+BOOL Filter::NewNonce(BYTE nonce[CHACHA20_NONCE_SIZE]) const
+{
+  _ASSERTE(hProv != NULL);
+
+  if (!CryptGenRandom(hProv, CHACHA20_NONCE_SIZE, nonce)) {
     DWORD err = GetLastError();
-    cerr << "CryptReleaseContext() - error=" << err << endl;
+    cerr << "CryptGenRandom() - error=" << err << endl;
+    return FALSE;
   }
+
+  return TRUE;
+}
+
+Cipher *Filter::NewCipher(const BYTE *pNonce) const
+{
+  Cipher *pCipher;
+
+  switch (cipher) {
+    case CIPHER_CHACHA20:
+      _ASSERTE(pNonce != NULL);
+      pCipher = new CipherChaCha20(key, pNonce);
+      break;
+    default:
+      pCipher = new CipherRc4(key, MD5_DIGEST_SIZE);
+  }
+
+  if (!pCipher) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  return pCipher;
 }
 ///////////////////////////////////////////////////////////////
 void State::Open(const Filter &filter)
 {
   _ASSERTE(!IsValid());
 
-  static const DWORD flags = (((DWORD)128) << 16);
+  pFilter = &filter;
 
-  if (!CryptDeriveKey(filter.hProv, CALG_RC4, filter.hHash, flags, &hKeyIn)) {
-    DWORD err = GetLastError();
-    cerr << "CryptDeriveKey() - error=" << err << endl;
+  if (!filter.UseNonce()) {
+    pCipherIn = filter.NewCipher();
+    pCipherOut = filter.NewCipher();
+
+    Validate();
     return;
   }
 
-  if (!CryptDeriveKey(filter.hProv, CALG_RC4, filter.hHash, flags, &hKeyOut)) {
-    DWORD err = GetLastError();
-    cerr << "CryptDeriveKey() - error=" << err << endl;
-
-    if (!CryptDestroyKey(hKeyIn)) {
-      DWORD err = GetLastError();
-      cerr << "CryptDestroyKey() - error=" << err << endl;
-    }
+  // the input cipher will be created on receiving the nonce of
+  // the peer, the own nonce will be sent ahead of the first data
 
+  if (!filter.NewNonce(nonceOut))
     return;
-  }
+
+  pCipherOut = filter.NewCipher(nonceOut);
+  nonceOutSent = FALSE;
+  lenNonceIn = 0;
 
   Validate();
 }
@@ -216,10 +277,75 @@ void State::Close()
 
   Invalidate();
 
-  if (!CryptDestroyKey(hKeyIn) || !CryptDestroyKey(hKeyOut)) {
-    DWORD err = GetLastError();
-    cerr << "CryptDestroyKey() - error=" << err << endl;
+  delete pCipherIn;
+  pCipherIn = NULL;
+
+  delete pCipherOut;
+  pCipherOut = NULL;
+
+  lenNonceIn = 0;
+  nonceOutSent = TRUE;
+}
+
+BOOL State::ReadNonce(HUB_MSG *pMsg)
+{
+  _ASSERTE(pCipherIn == NULL);
+
+  DWORD len = pMsg->u.buf.size;
+  DWORD lenPart = CHACHA20_NONCE_SIZE - lenNonceIn;
+
+  if (lenPart > len)
+    lenPart = len;
+
+  memcpy(nonceIn + lenNonceIn, pMsg->u.buf.pBuf, lenPart);
+  lenNonceIn += lenPart;
+
+  if (lenPart) {
+    if (!pBufMakeWritable(&pMsg->u.buf.pBuf, len))
+      return FALSE;
+
+    memmove(pMsg->u.buf.pBuf, pMsg->u.buf.pBuf + lenPart, len - lenPart);
+    pMsg->u.buf.size = len - lenPart;
   }
+
+  if (lenNonceIn < CHACHA20_NONCE_SIZE)
+    return TRUE;
+
+  // a reflected own nonce would decrypt the peer's data by the
+  // keystream of the sent data
+
+  if (memcmp(nonceIn, nonceOut, CHACHA20_NONCE_SIZE) == 0) {
+    cerr << "WARNING: The received nonce is equal to the sent one, discarding data" << endl;
+    Close();
+    pMsg->u.buf.size = 0;
+    return TRUE;
+  }
+
+  pCipherIn = pFilter->NewCipher(nonceIn);
+
+  return TRUE;
+}
+
+BOOL State::WriteNonce(HUB_MSG *pMsg, DWORD len)
+{
+  _ASSERTE(!nonceOutSent);
+
+  // make a private buffer for the nonce followed by the data
+
+  pBufAppend(&pMsg->u.buf.pBuf, len, NULL, CHACHA20_NONCE_SIZE);
+
+  if (!pMsg->u.buf.pBuf) {
+    pMsg->u.buf.size = 0;
+    return FALSE;
+  }
+
+  memmove(pMsg->u.buf.pBuf + CHACHA20_NONCE_SIZE, pMsg->u.buf.pBuf, len);
+  memcpy(pMsg->u.buf.pBuf, nonceOut, CHACHA20_NONCE_SIZE);
+  pMsg->u.buf.size = CHACHA20_NONCE_SIZE + len;
+
+  nonceOutSent = TRUE;
+
+  return TRUE;
 }
 ///////////////////////////////////////////////////////////////
 static PLUGIN_TYPE CALLBACK GetPluginType()
@@ -248,6 +374,14 @@ static void CALLBACK Help(const char *pProgPath)
   << endl
   << "Options:" << endl
   << "  --secret=<secret>       - set secret (mandatory)." << endl
+  << "  --cipher=<cipher>       - set cipher, where <cipher> is rc4-md5 or chacha20." << endl
+  << "                            The rc4-md5 cipher (default) uses RC4 with a 128-bit" << endl
+  << "                            key from the MD5 hash of the secret. The chacha20" << endl
+  << "                            cipher uses ChaCha20 with a 256-bit key from the" << endl
+  << "                            SHA-256 hash of the secret and a random nonce for" << endl
+  << "                            each direction of each connection. The nonce is" << endl
+  << "                            sent in clear ahead of the first data. Both sides" << endl
+  << "                            of the link should use the same cipher and secret." << endl
   << endl
   << "IN method input data stream description:" << endl
   << "  LINE_DATA - encrypted data." << endl
@@ -333,13 +467,28 @@ static BOOL CALLBACK InMethod(
       if (len == 0)
         break;
 
-      if (!CryptDecrypt(((State *)hFilterInstance)->hKeyIn, 0, FALSE, 0, pInMsg->u.buf.pBuf, &pInMsg->u.buf.size)) {
-        DWORD err = GetLastError();
-        cerr << "CryptDecrypt() - error=" << err << endl;
-        return FALSE;
+      State *pState = (State *)hFilterInstance;
+
+      if (!pState->IsValid()) {
+        // not connected, never pass the data through unencrypted
+        pInMsg->u.buf.size = 0;
+        break;
+      }
+
+      if (!pState->pCipherIn) {
+        if (!pState->ReadNonce(pInMsg))
+          return FALSE;
+
+        len = pInMsg->u.buf.size;
+
+        if (len == 0)
+          break;
       }
 
-      _ASSERTE(pInMsg->u.buf.size == len);
+      if (!pBufMakeWritable(&pInMsg->u.buf.pBuf, len))
+        return FALSE;
+
+      pState->pCipherIn->Crypt(pInMsg->u.buf.pBuf, len);
 
       break;
     }
@@ -376,13 +525,26 @@ static BOOL CALLBACK OutMethod(
       if (len == 0)
         break;
 
-      if (!CryptEncrypt(((State *)hFilterInstance)->hKeyOut, 0, FALSE, 0, pOutMsg->u.buf.pBuf, &pOutMsg->u.buf.size, len)) {
-        DWORD err = GetLastError();
-        cerr << "CryptEncrypt() - error=" << err << endl;
-        return FALSE;
+      State *pState = (State *)hFilterInstance;
+
+      if (!pState->IsValid()) {
+        // not connected, never pass the data through unencrypted
+        pOutMsg->u.buf.size = 0;
+        break;
       }
 
-      _ASSERTE(pOutMsg->u.buf.size == len);
+      if (!pState->nonceOutSent) {
+        if (!pState->WriteNonce(pOutMsg, len))
+          return FALSE;
+
+        pState->pCipherOut->Crypt(pOutMsg->u.buf.pBuf + CHACHA20_NONCE_SIZE, len);
+        break;
+      }
+
+      if (!pBufMakeWritable(&pOutMsg->u.buf.pBuf, len))
+        return FALSE;
+
+      pState->pCipherOut->Crypt(pOutMsg->u.buf.pBuf, len);
 
       break;
     }
@@ -391,6 +553,17 @@ static BOOL CALLBACK OutMethod(
   return pOutMsg != NULL;
 }
 ///////////////////////////////////////////////////////////////
+static DWORD CALLBACK GetFlags(
+    HFILTER DEBUG_PARAM(hFilter))
+{
+  _ASSERTE(hFilter != NULL);
+
+  // the ciphers of the instance are used only by its own methods,
+  // so the LINE_DATA can be handled by the offload threads
+
+  return FILTER_FLAG_ASYNC_SAFE;
+}
+///////////////////////////////////////////////////////////////
 static const FILTER_ROUTINES_A routines = {
   sizeof(FILTER_ROUTINES_A),
   GetPluginType,
@@ -405,6 +578,7 @@ static const FILTER_ROUTINES_A routines = {
   DeleteInstance,
   InMethod,
   OutMethod,
+  GetFlags,
 };
 
 static const PLUGIN_ROUTINES_A *const plugins[] = {
@@ -416,10 +590,14 @@ PLUGIN_INIT_A InitA;
 const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     const HUB_ROUTINES_A * pHubRoutines)
 {
-  if (!ROUTINE_IS_VALID(pHubRoutines, pBufAppend))
+  if (!ROUTINE_IS_VALID(pHubRoutines, pBufAppend) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pBufMakeWritable))
+  {
     return NULL;
+  }
 
   pBufAppend = pHubRoutines->pBufAppend;
+  pBufMakeWritable = pHubRoutines->pBufMakeWritable;
 
   return plugins;
 }
@@ -72,6 +72,9 @@ namespace FilterEscParse {
   #define DEBUG_PARAM(par) par
 #endif  /* _DEBUG */
 ///////////////////////////////////////////////////////////////
+#define MODEM_STATUS_DELTAS (MODEM_STATUS_DCTS|MODEM_STATUS_DDSR|MODEM_STATUS_TERI|MODEM_STATUS_DDCD)
+///////////////////////////////////////////////////////////////
+static ROUTINE_BUF_FREE *pBufFree;
 static ROUTINE_MSG_INSERT_VAL *pMsgInsertVal;
 static ROUTINE_MSG_INSERT_NONE *pMsgInsertNone;
 static ROUTINE_MSG_REPLACE_NONE *pMsgReplaceNone;
@@ -138,6 +141,7 @@ class State {
   private:
     void Reset() { state = subState = 0; }
     HUB_MSG *Flush(HUB_MSG *pMsg);
+    HUB_MSG *Parse(BYTE escapeChar, const BYTE *pBuf, const BYTE *pEnd, HUB_MSG *pMsg);
 
     BYTE maskMst;
     BYTE maskLsr;
@@ -171,15 +175,42 @@ HUB_MSG *State::Convert(BYTE escapeChar, HUB_MSG *pMsg)
   if (!escMode)
     return pMsg;
 
-  DWORD len = pMsg->u.buf.size;
-  basic_string<BYTE> org(pMsg->u.buf.pBuf, len);
-  const BYTE *pBuf = org.data();
+  BYTE *pOrg = pMsg->u.buf.pBuf;
+  const BYTE *pEnd = pOrg + pMsg->u.buf.size;
 
-  // discard original data from the stream
-  if (!pMsgReplaceBuf(pMsg, HUB_MSG_TYPE_LINE_DATA, NULL, 0))
-    return NULL;
+  // no escape sequences, so pass the original data as is
+  if (state == 0 && line_data.empty() && memchr(pOrg, escapeChar, pEnd - pOrg) == NULL)
+    return pMsg;
+
+  // detach original data from the stream
+  pMsg->u.buf.pBuf = NULL;
+  pMsg->u.buf.size = 0;
+
+  pMsg = Parse(escapeChar, pOrg, pEnd, pMsg);
+
+  pBufFree(pOrg);
+
+  return pMsg;
+}
+
+HUB_MSG *State::Parse(BYTE escapeChar, const BYTE *pBuf, const BYTE *pEnd, HUB_MSG *pMsg)
+{
+  HUB_MSG *pMstMsg = NULL;
+
+  while (pBuf < pEnd) {
+    if (state == 0) {
+      const BYTE *pEsc = (const BYTE *)memchr(pBuf, escapeChar, pEnd - pBuf);
+
+      if (!pEsc)
+        pEsc = pEnd;
+
+      line_data.append(pBuf, pEsc - pBuf);
+      pBuf = pEsc;
+
+      if (pBuf == pEnd)
+        break;
+    }
 
-  for (; len ; len--) {
     BYTE ch = *pBuf++;
 
     switch (state) {
@@ -243,12 +274,20 @@ HUB_MSG *State::Convert(BYTE escapeChar, HUB_MSG *pMsg)
               subState++;
             } else if (subState == 1) {
               if (maskMst) {
-                pMsg = Flush(pMsg);
-                if (!pMsg)
-                  return NULL;
-                pMsg = pMsgInsertVal(pMsg, HUB_MSG_TYPE_MODEM_STATUS, ch | VAL2MASK(maskMst));
-                if (!pMsg)
-                  return NULL;
+                if (pMstMsg && pMstMsg == pMsg && line_data.empty()) {
+                  // nothing between, so only the last modem status matters
+                  // but the changes reported by the previous one
+
+                  pMsg->u.val = (pMsg->u.val & MODEM_STATUS_DELTAS & maskMst) | ch | VAL2MASK(maskMst);
+                } else {
+                  pMsg = Flush(pMsg);
+                  if (!pMsg)
+                    return NULL;
+                  pMsg = pMsgInsertVal(pMsg, HUB_MSG_TYPE_MODEM_STATUS, ch | VAL2MASK(maskMst));
+                  if (!pMsg)
+                    return NULL;
+                  pMstMsg = pMsg;
+                }
               }
               Reset();
             } else {
@@ -665,7 +704,8 @@ PLUGIN_INIT_A InitA;
 const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     const HUB_ROUTINES_A * pHubRoutines)
 {
-  if (!ROUTINE_IS_VALID(pHubRoutines, pMsgInsertVal) ||
+  if (!ROUTINE_IS_VALID(pHubRoutines, pBufFree) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pMsgInsertVal) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgInsertNone) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceNone) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgInsertBuf) ||
@@ -677,6 +717,7 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     return NULL;
   }
 
+  pBufFree = pHubRoutines->pBufFree;
   pMsgInsertVal = pHubRoutines->pMsgInsertVal;
   pMsgInsertNone = pHubRoutines->pMsgInsertNone;
   pMsgReplaceNone = pHubRoutines->pMsgReplaceNone;
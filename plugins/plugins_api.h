@@ -180,6 +180,29 @@ extern "C" {
 #define HUB_MSG_TYPE_PURGE_TX_IN   (22  | HUB_MSG_UNION_TYPE_NONE)
 #define HUB_MSG_TYPE_PURGE_TX      (23  | HUB_MSG_UNION_TYPE_NONE)
 #define HUB_MSG_TYPE_TICK          (24  | HUB_MSG_UNION_TYPE_HVAL2)
+/*************/
+#define HUB_MSG_TYPE_LOST          (25  | HUB_MSG_UNION_TYPE_VAL | HUB_MSG_VAL_TYPE_UINT)
+/*
+ *      Input
+ *        HUB_MSG.u.val      - the number of bytes lost by the port since the
+ *                             previous report (sent by the port on LostReport)
+ *
+ *      It's passed to the IN methods of the filters of the port only and
+ *      is not routed to other ports.
+ */
+/*************/
+#define HUB_MSG_TYPE_CREDIT        (26  | HUB_MSG_ROUTE_FLOW_CONTROL | HUB_MSG_UNION_TYPE_VAL | HUB_MSG_VAL_TYPE_UINT)
+/*
+ *      Input
+ *        HUB_MSG.u.val      - the number of bytes of LINE_DATA that can be
+ *                             written to the port additionally to the queued
+ *                             ones (the credit window is shared by the ports
+ *                             the flow control of the port is routed to)
+ *      Output
+ *        HUB_MSG.u.val      - the number of bytes of LINE_DATA that can be
+ *                             read by the port (the least credit of the ports
+ *                             the data of the port is routed to)
+ */
 /*******************************************************************/
 typedef struct _HUB_MSG {
   DWORD type;
@@ -274,6 +297,51 @@ typedef HFILTER (CALLBACK ROUTINE_GET_FILTER)(
         HMASTERFILTERINSTANCE hMasterFilterInstance);
 typedef const ARG_INFO_A *(CALLBACK ROUTINE_GET_ARG_INFO_A)(
         const char *pArg);
+typedef BOOL (CALLBACK ROUTINE_BUF_MAKE_WRITABLE)(
+        BYTE **ppBuf,
+        DWORD size);
+/*
+ *      The LINE_DATA buffers can be shared between messages routed
+ *      to different ports. Before modifying the buffer in place call
+ *      pBufMakeWritable() to get a private copy of first size bytes
+ *      (the *ppBuf will be replaced if the buffer was shared).
+ */
+typedef void (CALLBACK ROUTINE_WRITE_LATENCY)(
+        HMASTERPORT hMasterPort,
+        LONGLONG queued);
+/*
+ *      The drivers call pWriteLatency() on write completion to account
+ *      the time the data was queued in the driver (queued is the
+ *      QueryPerformanceCounter() value at the time the data was queued).
+ *      The routine is optional, it's NULL if the hub is built without
+ *      latency statistics.
+ */
+#define HUB_STAT_TYPE_COUNTER      0
+#define HUB_STAT_TYPE_GAUGE        1
+typedef void (CALLBACK ROUTINE_STAT_ADD_A)(
+        HMASTERPORT hMasterPort,
+        const char *pName,
+        DWORD type,
+        const DWORD *pValue);
+/*
+ *      The drivers call pStatAdd() to register their own counters
+ *      (HUB_STAT_TYPE_COUNTER) or gauges (HUB_STAT_TYPE_GAUGE) with
+ *      name pName (lower case letters, digits and underscores). The
+ *      *pValue is read by the thread of the port on saving of the statistics,
+ *      so it should be valid till the hub exit. The routine is optional.
+ */
+typedef void (CALLBACK ROUTINE_BIND_PORTS)(
+        HMASTERPORT hMasterPort1,
+        HMASTERPORT hMasterPort2);
+/*
+ *      The hub can run the ports on several threads (see --threads
+ *      option). The ports connected by routes or sharing filters run
+ *      on the same thread. The drivers call pBindPorts() on port
+ *      initialization or on ConfigStop() to run on the same thread the
+ *      ports sharing the driver's own objects (e.g. a listening socket)
+ *      or calling pOnRead() of each other (e.g. connected fake ports).
+ *      The routine is optional.
+ */
 /*******************************************************************/
 typedef struct _HUB_ROUTINES_A {
   size_t size;
@@ -296,6 +364,10 @@ typedef struct _HUB_ROUTINES_A {
   ROUTINE_FILTERPORT *pFilterPort;
   ROUTINE_GET_FILTER *pGetFilter;
   ROUTINE_GET_ARG_INFO_A *pGetArgInfo;
+  ROUTINE_BUF_MAKE_WRITABLE *pBufMakeWritable;
+  ROUTINE_WRITE_LATENCY *pWriteLatency;
+  ROUTINE_STAT_ADD_A *pStatAdd;
+  ROUTINE_BIND_PORTS *pBindPorts;
 } HUB_ROUTINES_A;
 /*******************************************************************/
 typedef enum _PLUGIN_TYPE {
@@ -367,6 +439,16 @@ typedef BOOL (CALLBACK FILTER_OUT_METHOD)(
         HFILTERINSTANCE hFilterInstance,
         HMASTERPORT hFromPort,
         HUB_MSG *pOutMsg);
+#define FILTER_FLAG_ASYNC_SAFE     0x00000001
+typedef DWORD (CALLBACK FILTER_GET_FLAGS)(
+        HFILTER hFilter);
+/*
+ *      FILTER_FLAG_ASYNC_SAFE - the filter can be used with --async-filter
+ *      option. The IN and OUT methods of one instance are never called
+ *      concurrently but they can be called by different threads, so they
+ *      should not use the timers or pOnRead() and should not share not
+ *      constant data with other instances. The routine is optional.
+ */
 /*******************************************************************/
 typedef struct _FILTER_ROUTINES_A {
   COMMON_PLUGIN_ROUTINES_A
@@ -376,6 +458,7 @@ typedef struct _FILTER_ROUTINES_A {
   FILTER_DELETE_INSTANCE *pDeleteInstance;
   FILTER_IN_METHOD *pInMethod;
   FILTER_OUT_METHOD *pOutMethod;
+  FILTER_GET_FLAGS *pGetFlags;
 } FILTER_ROUTINES_A;
 /*******************************************************************/
 DECLARE_HANDLE(HPORT);
@@ -921,7 +921,7 @@ void WriteOverlapped::BufFree()
 #endif
 }
 
-BOOL WriteOverlapped::StartWrite(BYTE *_pBuf, DWORD _len)
+BOOL WriteOverlapped::StartWrite(BYTE *_pBuf, DWORD _len, LONGLONG _queued)
 {
   _ASSERTE(pBuf == NULL);
 
@@ -940,6 +940,7 @@ BOOL WriteOverlapped::StartWrite(BYTE *_pBuf, DWORD _len)
 
   pBuf = _pBuf;
   len = _len;
+  queued = _queued;
 
   return TRUE;
 }
@@ -979,18 +980,16 @@ VOID CALLBACK ReadOverlapped::OnRead(
   pOver->comIo.port.OnRead(pOver, pInBuf, done);
 }
 
-BOOL ReadOverlapped::StartRead()
+BOOL ReadOverlapped::StartRead(DWORD size)
 {
   ::memset((OVERLAPPED *)this, 0, sizeof(OVERLAPPED));
 
-  #define readBufSize 64
-
-  pBuf = pBufAlloc(readBufSize);
+  pBuf = pBufAlloc(size);
 
   if (!pBuf)
     return FALSE;
 
-  if (!::ReadFileEx(comIo.Handle(), pBuf, readBufSize, this, OnRead)) {
+  if (!::ReadFileEx(comIo.Handle(), pBuf, size, this, OnRead)) {
     TraceError(GetLastError(), "ReadOverlapped::StartRead(): ReadFileEx() %s", comIo.port.Name().c_str());
     return FALSE;
   }
@@ -1001,22 +1000,34 @@ BOOL ReadOverlapped::StartRead()
   return TRUE;
 }
 ///////////////////////////////////////////////////////////////
-static HANDLE hThread = INVALID_HANDLE_VALUE;
-#ifdef _DEBUG
-static DWORD idThread;
-#endif  /* _DEBUG */
-
-static BOOL SetThread()
+//
+// The hub can run the ports on several threads so the APCs from
+// the wait callbacks are queued to the thread that created the
+// waiting object. The duplicated handles of the threads are kept
+// in the TLS slot.
+//
+static DWORD tlsThread = TLS_OUT_OF_INDEXES;
+
+static HANDLE GetThread()
 {
-#ifdef _DEBUG
-  if (hThread == INVALID_HANDLE_VALUE) {
-    idThread = ::GetCurrentThreadId();
-  } else {
-    _ASSERTE(idThread == ::GetCurrentThreadId());
+  if (tlsThread == TLS_OUT_OF_INDEXES) {
+    DWORD tls = ::TlsAlloc();
+
+    if (tls == TLS_OUT_OF_INDEXES) {
+      TraceError(
+          GetLastError(),
+          "GetThread(): TlsAlloc()");
+
+      return NULL;
+    }
+
+    if (::InterlockedCompareExchange((LONG *)&tlsThread, (LONG)tls, (LONG)TLS_OUT_OF_INDEXES) != (LONG)TLS_OUT_OF_INDEXES)
+      ::TlsFree(tls);
   }
-#endif  /* _DEBUG */
 
-  if (hThread == INVALID_HANDLE_VALUE) {
+  HANDLE hThread = (HANDLE)::TlsGetValue(tlsThread);
+
+  if (!hThread) {
     if (!::DuplicateHandle(::GetCurrentProcess(),
                            ::GetCurrentThread(),
                            ::GetCurrentProcess(),
@@ -1025,25 +1036,35 @@ static BOOL SetThread()
                            FALSE,
                            DUPLICATE_SAME_ACCESS))
     {
-      hThread = INVALID_HANDLE_VALUE;
+      TraceError(
+          GetLastError(),
+          "GetThread(): DuplicateHandle()");
+
+      return NULL;
+    }
 
+    if (!::TlsSetValue(tlsThread, hThread)) {
       TraceError(
           GetLastError(),
-          "SetThread(): DuplicateHandle()");
+          "GetThread(): TlsSetValue()");
 
-      return FALSE;
+      ::CloseHandle(hThread);
+
+      return NULL;
     }
   }
 
-  return TRUE;
+  return hThread;
 }
 ///////////////////////////////////////////////////////////////
 WaitCommEventOverlapped::WaitCommEventOverlapped(ComIo &_comIo)
   : comIo(_comIo),
     hWait(INVALID_HANDLE_VALUE)
 {
-  if (!SetThread())
-      return;
+  hThread = GetThread();
+
+  if (!hThread)
+    return;
 
   ::memset((OVERLAPPED *)this, 0, sizeof(OVERLAPPED));
 
@@ -1098,7 +1119,7 @@ VOID CALLBACK WaitCommEventOverlapped::OnCommEvent(
     BOOLEAN /*timerOrWaitFired*/)
 {
   ((WaitCommEventOverlapped *)pOverlapped)->LockDelete();
-  if (!::QueueUserAPC(OnCommEvent, hThread, (ULONG_PTR)pOverlapped))
+  if (!::QueueUserAPC(OnCommEvent, ((WaitCommEventOverlapped *)pOverlapped)->hThread, (ULONG_PTR)pOverlapped))
     ((WaitCommEventOverlapped *)pOverlapped)->UnockDelete();
 }
 
@@ -264,7 +264,7 @@ class ReadOverlapped : private OVERLAPPED
   public:
     ReadOverlapped(ComIo &_comIo);
     ~ReadOverlapped();
-    BOOL StartRead();
+    BOOL StartRead(DWORD size);
 
   private:
     static VOID CALLBACK OnRead(
@@ -290,7 +290,8 @@ class WriteOverlapped : private OVERLAPPED
     }
 #endif
 
-    BOOL StartWrite(BYTE *_pBuf, DWORD _len);
+    BOOL StartWrite(BYTE *_pBuf, DWORD _len, LONGLONG _queued);
+    LONGLONG Queued() const { return queued; }
 
   private:
     static VOID CALLBACK OnWrite(
@@ -302,6 +303,7 @@ class WriteOverlapped : private OVERLAPPED
     ComIo &comIo;
     BYTE *pBuf;
     DWORD len;
+    LONGLONG queued;
 };
 ///////////////////////////////////////////////////////////////
 class SafeDelete
@@ -355,6 +357,7 @@ class WaitCommEventOverlapped : private OVERLAPPED, public SafeDelete
     static VOID CALLBACK OnCommEvent(ULONG_PTR pOverlapped);
 
     ComIo &comIo;
+    HANDLE hThread;
     HANDLE hWait;
     DWORD eMask;
 
@@ -79,6 +79,12 @@ ComParams::ComParams()
   , inDsr(0)
   , intervalTimeout(0)
   , writeQueueLimit(256)
+  , writeCredit(FALSE)
+  , creditWindow(cwDefault)
+  , readBufSizeMin(64)
+  , readBufSizeMax(64)
+  , batchWindow(0)
+  , batchBytes(0)
   , shareMode(0)
 {
 }
@@ -163,6 +169,124 @@ BOOL ComParams::SetWriteQueueLimit(const char *pWriteQueueLimit)
   return FALSE;
 }
 
+BOOL ComParams::SetWriteFc(const char *pWriteFc)
+{
+  switch (tolower((unsigned char)*pWriteFc)) {
+    case 'c':
+      writeCredit = TRUE;
+      return TRUE;
+    case 'x':
+      writeCredit = FALSE;
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+BOOL ComParams::SetCreditWindow(const char *pCreditWindow)
+{
+  if (tolower((unsigned char)*pCreditWindow) == 'd') {
+    creditWindow = cwDefault;
+    return TRUE;
+  }
+
+  if (!isdigit((unsigned char)*pCreditWindow))
+    return FALSE;
+
+  char *pEnd;
+  long val = strtol(pCreditWindow, &pEnd, 10);
+
+  if (*pEnd || val < cwMin)
+    return FALSE;
+
+  creditWindow = val;
+
+  return TRUE;
+}
+
+long ComParams::CreditWindow() const
+{
+  if (!writeCredit)
+    return 0;
+
+  // by default grant the space up to the XOFF threshold
+
+  long window = (creditWindow == cwDefault) ? (writeQueueLimit*2)/3 : creditWindow;
+
+  if (window < cwMin)
+    window = cwMin;
+
+  if (window > writeQueueLimit)
+    window = writeQueueLimit;
+
+  return window;
+}
+
+BOOL ComParams::SetReadBufSize(const char *pReadBufSize)
+{
+  if (!isdigit((unsigned char)*pReadBufSize))
+    return FALSE;
+
+  // the values over the range of long become negative
+
+  char *pEnd;
+  long sizeMin = (long)strtoul(pReadBufSize, &pEnd, 10);
+  long sizeMax = sizeMin;
+
+  if (*pEnd == ',') {
+    const char *pMax = pEnd + 1;
+
+    if (!isdigit((unsigned char)*pMax))
+      return FALSE;
+
+    sizeMax = (long)strtoul(pMax, &pEnd, 10);
+  }
+
+  if (*pEnd || sizeMin <= 0 || sizeMax < sizeMin)
+    return FALSE;
+
+  readBufSizeMin = sizeMin;
+  readBufSizeMax = sizeMax;
+
+  return TRUE;
+}
+
+BOOL ComParams::SetBatchWindow(const char *pBatchWindow)
+{
+  if (!isdigit((unsigned char)*pBatchWindow))
+    return FALSE;
+
+  // the values over the range of long become negative
+
+  char *pEnd;
+  long window = (long)strtoul(pBatchWindow, &pEnd, 10);
+
+  if (*pEnd || window < 0)
+    return FALSE;
+
+  batchWindow = window;
+
+  return TRUE;
+}
+
+BOOL ComParams::SetBatchBytes(const char *pBatchBytes)
+{
+  if (!isdigit((unsigned char)*pBatchBytes))
+    return FALSE;
+
+  // the values over the range of long become negative
+
+  char *pEnd;
+  long bytes = (long)strtoul(pBatchBytes, &pEnd, 10);
+
+  if (*pEnd || bytes < 0)
+    return FALSE;
+
+  batchBytes = bytes;
+
+  return TRUE;
+}
+
 BOOL ComParams::SetFlag(const char *pFlagStr, int *pFlag, BOOL withCurrent)
 {
   if (_stricmp(pFlagStr, "on") == 0) {
@@ -250,6 +374,62 @@ string ComParams::WriteQueueLimitStr(long writeQueueLimit)
   return "?";
 }
 
+string ComParams::WriteFcStr(BOOL writeCredit)
+{
+  return writeCredit ? "credit" : "xoff";
+}
+
+string ComParams::CreditWindowStr(long creditWindow)
+{
+  if (creditWindow == cwDefault)
+    return "2/3 of write limit";
+
+  if (creditWindow >= cwMin) {
+    stringstream buf;
+    buf << creditWindow;
+    return buf.str();
+  }
+
+  return "?";
+}
+
+string ComParams::ReadBufSizeStr(long readBufSizeMin, long readBufSizeMax)
+{
+  if (readBufSizeMin > 0 && readBufSizeMax >= readBufSizeMin) {
+    stringstream buf;
+    buf << readBufSizeMin;
+
+    if (readBufSizeMax != readBufSizeMin)
+      buf << "," << readBufSizeMax;
+
+    return buf.str();
+  }
+
+  return "?";
+}
+
+string ComParams::BatchWindowStr(long batchWindow)
+{
+  if (batchWindow >= 0) {
+    stringstream buf;
+    buf << batchWindow;
+    return buf.str();
+  }
+
+  return "?";
+}
+
+string ComParams::BatchBytesStr(long batchBytes)
+{
+  if (batchBytes >= 0) {
+    stringstream buf;
+    buf << batchBytes;
+    return buf.str();
+  }
+
+  return "?";
+}
+
 string ComParams::FlagStr(int flag, BOOL withCurrent)
 {
   switch (flag) {
@@ -290,6 +470,31 @@ const char *ComParams::WriteQueueLimitLst()
   return "a positive number or 0";
 }
 
+const char *ComParams::WriteFcLst()
+{
+  return "c[redit] or x[off]";
+}
+
+const char *ComParams::CreditWindowLst()
+{
+  return "a number not less than 64 or d[efault]";
+}
+
+const char *ComParams::ReadBufSizeLst()
+{
+  return "a positive number";
+}
+
+const char *ComParams::BatchWindowLst()
+{
+  return "a positive number or 0 microseconds";
+}
+
+const char *ComParams::BatchBytesLst()
+{
+  return "a positive number or 0";
+}
+
 const char *ComParams::FlagLst(BOOL withCurrent)
 {
   return withCurrent ? "on, off or c[urrent]" : "on or off";
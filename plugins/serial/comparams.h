@@ -66,6 +66,11 @@ class ComParams
     BOOL SetInDsr(const char *pInDsr) { return SetFlag(pInDsr, &inDsr); }
     BOOL SetIntervalTimeout(const char *pIntervalTimeout);
     BOOL SetWriteQueueLimit(const char *pWriteQueueLimit);
+    BOOL SetWriteFc(const char *pWriteFc);
+    BOOL SetCreditWindow(const char *pCreditWindow);
+    BOOL SetReadBufSize(const char *pReadBufSize);
+    BOOL SetBatchWindow(const char *pBatchWindow);
+    BOOL SetBatchBytes(const char *pBatchBytes);
     BOOL SetShareMode(const char *pShareMode) { return SetFlag(pShareMode, &shareMode, FALSE); }
 
     static string BaudRateStr(long baudRate);
@@ -79,6 +84,11 @@ class ComParams
     static string InDsrStr(int inDsr) { return FlagStr(inDsr); }
     static string IntervalTimeoutStr(long intervalTimeout);
     static string WriteQueueLimitStr(long writeQueueLimit);
+    static string WriteFcStr(BOOL writeCredit);
+    static string CreditWindowStr(long creditWindow);
+    static string ReadBufSizeStr(long readBufSizeMin, long readBufSizeMax);
+    static string BatchWindowStr(long batchWindow);
+    static string BatchBytesStr(long batchBytes);
     static string ShareModeStr(int shareMode) { return FlagStr(shareMode, FALSE); }
 
     string BaudRateStr() const { return BaudRateStr(baudRate); }
@@ -92,6 +102,11 @@ class ComParams
     string InDsrStr() const { return InDsrStr(inDsr); }
     string IntervalTimeoutStr() const { return IntervalTimeoutStr(intervalTimeout); }
     string WriteQueueLimitStr() const { return WriteQueueLimitStr(writeQueueLimit); }
+    string WriteFcStr() const { return WriteFcStr(writeCredit); }
+    string CreditWindowStr() const { return CreditWindowStr(creditWindow); }
+    string ReadBufSizeStr() const { return ReadBufSizeStr(readBufSizeMin, readBufSizeMax); }
+    string BatchWindowStr() const { return BatchWindowStr(batchWindow); }
+    string BatchBytesStr() const { return BatchBytesStr(batchBytes); }
     string ShareModeStr() const { return ShareModeStr(shareMode); }
 
     static const char *BaudRateLst();
@@ -105,6 +120,11 @@ class ComParams
     static const char *InDsrLst() { return FlagLst(); }
     static const char *IntervalTimeoutLst();
     static const char *WriteQueueLimitLst();
+    static const char *WriteFcLst();
+    static const char *CreditWindowLst();
+    static const char *ReadBufSizeLst();
+    static const char *BatchWindowLst();
+    static const char *BatchBytesLst();
     static const char *ShareModeLst() { return FlagLst(FALSE); }
 
     long BaudRate() const { return baudRate; }
@@ -118,8 +138,19 @@ class ComParams
     int InDsr() const { return inDsr; }
     long IntervalTimeout() const { return intervalTimeout; }
     long WriteQueueLimit() const { return writeQueueLimit; }
+    BOOL WriteCredit() const { return writeCredit; }
+    long CreditWindow() const;
+    long ReadBufSizeMin() const { return readBufSizeMin; }
+    long ReadBufSizeMax() const { return readBufSizeMax; }
+    long BatchWindow() const { return batchWindow; }
+    long BatchBytes() const { return batchBytes; }
     int ShareMode() const { return shareMode; }
 
+    enum {
+      cwDefault = -1,
+      cwMin = 64,
+    };
+
   private:
     BOOL SetFlag(const char *pFlagStr, int *pFlag, BOOL withCurrent = TRUE);
     static string FlagStr(int flag, BOOL withCurrent = TRUE);
@@ -136,6 +167,12 @@ class ComParams
     int inDsr;
     long intervalTimeout;
     long writeQueueLimit;
+    BOOL writeCredit;
+    long creditWindow;
+    long readBufSizeMin;
+    long readBufSizeMax;
+    long batchWindow;
+    long batchBytes;
     int shareMode;
 };
 ///////////////////////////////////////////////////////////////
@@ -141,6 +141,7 @@ namespace PortSerial {
 #include "comport.h"
 #include "comio.h"
 #include "comparams.h"
+#include "filterx.h"
 #include "import.h"
 ///////////////////////////////////////////////////////////////
 struct FIELD2NAME {
@@ -312,8 +313,20 @@ ComPort::ComPort(
     const char *pPath)
   : hMasterPort(NULL)
   , countReadOverlapped(0)
+  , readBufSize((DWORD)comParams.ReadBufSizeMin())
+  , readBufSizeMin((DWORD)comParams.ReadBufSizeMin())
+  , readBufSizeMax((DWORD)comParams.ReadBufSizeMax())
+  , readCount(0)
+  , readBytes(0)
+  , batchWindow((DWORD)comParams.BatchWindow())
+  , batchBytes((DWORD)comParams.BatchBytes())
+  , hBatchTimer(NULL)
+  , pBatchBuf(NULL)
+  , lenBatchBuf(0)
   , countWaitCommEventOverlapped(0)
   , countXoff(0)
+  , readCredited(FALSE)
+  , readCredit(0)
   , escapeOptions(0)
   , outOptions(0)
 #ifdef _DEBUG
@@ -326,12 +339,18 @@ ComPort::ComPort(
   , writeQueueLimitSendXoff((writeQueueLimit*2)/3)
   , writeQueueLimitSendXon(writeQueueLimit/3)
   , writeQueued(0)
+  , writeCredit(comParams.WriteCredit())
+  , creditWindow((DWORD)comParams.CreditWindow())
+  , creditGranted(0)
   , writeSuspended(FALSE)
+  , writeSuspendedStart(0)
+  , writeSuspendedTime(0)
   , writeLost(0)
   , writeLostTotal(0)
   , errors(0)
   , pWriteBuf(NULL)
   , lenWriteBuf(0)
+  , writeBufQueued(0)
 {
   pComIo = new ComIo(*this, pPath);
 
@@ -374,6 +393,13 @@ BOOL ComPort::Init(HMASTERPORT _hMasterPort)
 
   hMasterPort = _hMasterPort;
 
+  if (pStatAdd) {
+    pStatAdd(hMasterPort, "write_queued_bytes", HUB_STAT_TYPE_GAUGE, &writeQueued);
+    pStatAdd(hMasterPort, "write_lost_bytes_total", HUB_STAT_TYPE_COUNTER, &writeLostTotal);
+    pStatAdd(hMasterPort, "write_suspended_ms_total", HUB_STAT_TYPE_COUNTER, &writeSuspendedTime);
+    pStatAdd(hMasterPort, "errors_total", HUB_STAT_TYPE_COUNTER, &errors);
+  }
+
   return TRUE;
 }
 
@@ -396,13 +422,15 @@ void ComPort::Update()
 
       msg.type = HUB_MSG_TYPE_CONNECT;
       msg.u.val = FALSE;
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
     }
   }
 }
 
 BOOL ComPort::Start()
 {
+  CreditUpdate();
+
   return Start(true);
 }
 
@@ -464,7 +492,7 @@ BOOL ComPort::Start(BOOL first)
     msg.type = HUB_MSG_TYPE_GET_ESC_OPTS;
     msg.u.pv.pVal = &escapeOptions;
     msg.u.pv.val = 0;
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
 
     DWORD failEscapeOptions = pComIo->SetEscMode(escapeOptions, &pBuf, &done);
 
@@ -481,7 +509,7 @@ BOOL ComPort::Start(BOOL first)
       msg.type = HUB_MSG_TYPE_FAIL_ESC_OPTS;
       msg.u.pv.pVal = &options_GO1;
       msg.u.pv.val = failEscapeOptions;
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
 
       intercepted_options[1] |= (options_GO1 & ~GO_I2O(-1));
 
@@ -533,7 +561,7 @@ BOOL ComPort::Start(BOOL first)
 
       msg.type = HUB_MSG_TYPE_FAIL_IN_OPTS;
       msg.u.val = (fail_options & ~GO_I2O(-1)) | GO_I2O(iO == 0 ? 0 : 1);
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
     }
 
     if (inOptions[1] & GO1_RBR_STATUS)
@@ -588,7 +616,7 @@ BOOL ComPort::Start(BOOL first)
     return TRUE;
   }
 
-  if (countXoff <= 0) {
+  if (CanRead()) {
     if (!StartRead()) {
       pComIo->Close();
       pBufFree(pBuf);
@@ -601,38 +629,38 @@ BOOL ComPort::Start(BOOL first)
 
     msg.type = HUB_MSG_TYPE_CONNECT;
     msg.u.val = TRUE;
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
   }
 
   if (inOptions[0] & GO0_LBR_STATUS) {
     msg.type = HUB_MSG_TYPE_LBR_STATUS;
     msg.u.val = pComIo->BaudRate();
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
   }
 
   if (inOptions[0] & GO0_LLC_STATUS) {
     msg.type = HUB_MSG_TYPE_LLC_STATUS;
     msg.u.val = pComIo->LineControl();
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
   }
 
   if (inOptions[1] & GO1_RBR_STATUS) {
     msg.type = HUB_MSG_TYPE_RBR_STATUS;
     msg.u.val = pComIo->BaudRate();
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
   }
 
   if (inOptions[1] & GO1_RLC_STATUS) {
     msg.type = HUB_MSG_TYPE_RLC_STATUS;
     msg.u.val = pComIo->LineControl();
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
   }
 
   if (pBuf) {
     msg.type = HUB_MSG_TYPE_LINE_DATA;
     msg.u.buf.pBuf = pBuf;
     msg.u.buf.size = done;
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
   }
 
   CheckComEvents(DWORD(-1));
@@ -655,7 +683,7 @@ BOOL ComPort::StartRead()
   if (!pOverlapped)
     return FALSE;
 
-  if (!pOverlapped->StartRead()) {
+  if (!pOverlapped->StartRead(ReadSize())) {
     delete pOverlapped;
     return FALSE;
   }
@@ -672,6 +700,19 @@ BOOL ComPort::FakeReadFilter(HUB_MSG *pInMsg)
   _ASSERTE(pInMsg != NULL);
 
   switch (HUB_MSG_T2N(pInMsg->type)) {
+    case HUB_MSG_T2N(HUB_MSG_TYPE_TICK): {
+      if (pInMsg->u.hv2.hVal0 != this)
+        break;
+
+      if (pInMsg->u.hv2.hVal1 == hBatchTimer)
+        FlushBatch();
+
+      // discard owned tick
+      if (!pMsgReplaceNone(pInMsg, HUB_MSG_TYPE_EMPTY))
+        return FALSE;
+
+      break;
+    }
     case HUB_MSG_T2N(HUB_MSG_TYPE_GET_IN_OPTS): {
       int iGo = GO_O2I(pInMsg->u.pv.val);
 
@@ -713,26 +754,66 @@ void ComPort::FlowControlUpdate()
   if (writeSuspended) {
     if (writeQueued <= writeQueueLimitSendXon) {
       writeSuspended = FALSE;
+      writeSuspendedTime += GetTickCount() - writeSuspendedStart;
 
       HUB_MSG msg;
 
       msg.type = HUB_MSG_TYPE_ADD_XOFF_XON;
       msg.u.val = FALSE;
 
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
     }
   } else {
     if (writeQueued > writeQueueLimitSendXoff) {
       writeSuspended = TRUE;
+      writeSuspendedStart = GetTickCount();
 
       HUB_MSG msg;
 
       msg.type = HUB_MSG_TYPE_ADD_XOFF_XON;
       msg.u.val = TRUE;
 
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
     }
   }
+
+  CreditUpdate();
+}
+
+void ComPort::CreditUpdate()
+{
+  if (!creditWindow)
+    return;
+
+  DWORD credit = writeQueued < creditWindow ? creditWindow - writeQueued : 0;
+
+  // grant the freed space by quarters of the window (or all of it
+  // on draining) to not send a message per each write
+
+  if (credit <= creditGranted)
+    return;
+
+  if (credit - creditGranted < creditWindow/4 && credit < creditWindow)
+    return;
+
+  creditGranted = credit;
+
+  HUB_MSG msg;
+
+  msg.type = HUB_MSG_TYPE_CREDIT;
+  msg.u.val = credit;
+
+  OnReadMsg(&msg);
+}
+
+DWORD ComPort::ReadSize() const
+{
+  // do not read more than the credit allows
+
+  if (readCredited && readCredit > 0 && (DWORD)readCredit < readBufSize)
+    return (DWORD)readCredit;
+
+  return readBufSize;
 }
 
 void ComPort::PurgeWrite(BOOL withLost)
@@ -762,7 +843,19 @@ void ComPort::PurgeWrite(BOOL withLost)
   }
 }
 
-void ComPort::FilterX(BYTE *pBuf, DWORD &len)
+static LONGLONG WriteQueuedCounter()
+{
+  if (!pWriteLatency)
+    return 0;
+
+  LARGE_INTEGER li;
+
+  ::QueryPerformanceCounter(&li);
+
+  return li.QuadPart;
+}
+
+void ComPort::FilterX(BYTE **ppBuf, DWORD &len)
 {
   _ASSERTE(pComIo != NULL);
   _ASSERTE(pComIo->Handle() != INVALID_HANDLE_VALUE);
@@ -770,21 +863,27 @@ void ComPort::FilterX(BYTE *pBuf, DWORD &len)
   BYTE xOn;
   BYTE xOff;
 
-  if (pComIo->FilterX(xOn, xOff)) {
-    BYTE *pSrc = pBuf;
-    BYTE *pDst = pBuf;
+  if (!pComIo->FilterX(xOn, xOff))
+    return;
 
-    for (DWORD i = 0 ; i < len ; i++) {
-      if (*pSrc == xOn || *pSrc == xOff) {
-        pSrc++;
-        writeLost++;
-      } else {
-        *pDst++ = *pSrc++;
-      }
-    }
+  // usually there are no xOn and xOff chars in the data so
+  // don't touch (and don't copy if shared) the buffer in this case
+
+  DWORD off = FindX(*ppBuf, len, xOn, xOff);
 
-    len = DWORD(pDst - pBuf);
+  if (off == len)
+    return;
+
+  if (!pBufMakeWritable(ppBuf, len)) {
+    writeLost += len;
+    len = 0;
+    return;
   }
+
+  DWORD newLen = StripX(*ppBuf, off, len, xOn, xOff);
+
+  writeLost += len - newLen;
+  len = newLen;
 }
 
 void ComPort::UpdateOutOptions(DWORD options)
@@ -847,10 +946,15 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
     if (!len)
       return TRUE;
 
+    // the data consumes the granted credit
+
+    creditGranted = creditGranted > len ? creditGranted - len : 0;
+
     BYTE *pBuf = pMsg->u.buf.pBuf;
 
     if (!pBuf) {
       writeLost += len;
+      CreditUpdate();
       return FALSE;
     }
 
@@ -863,16 +967,20 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
       _ASSERTE(pWriteBuf == NULL);
       _ASSERTE(lenWriteBuf == 0);
 
-      FilterX(pBuf, len);
+      FilterX(&pMsg->u.buf.pBuf, len);
 
-      if (!len)
+      if (!len) {
+        CreditUpdate();
         return TRUE;
+      }
+
+      pBuf = pMsg->u.buf.pBuf;
 
       WriteOverlapped *pOverlapped = writeOverlappedBuf.front();
 
       _ASSERTE(pOverlapped != NULL);
 
-      if (!pOverlapped->StartWrite(pBuf, len)) {
+      if (!pOverlapped->StartWrite(pBuf, len, WriteQueuedCounter())) {
         writeLost += len;
         FlowControlUpdate();
         return FALSE;
@@ -884,6 +992,9 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
     } else {
       _ASSERTE((pWriteBuf == NULL && lenWriteBuf == 0) || (pWriteBuf != NULL && lenWriteBuf != 0));
 
+      if (!lenWriteBuf)
+        writeBufQueued = WriteQueuedCounter();
+
       pBufAppend(&pWriteBuf, lenWriteBuf, pBuf, len);
       lenWriteBuf += len;
     }
@@ -940,7 +1051,7 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
 
         msg.type = HUB_MSG_TYPE_LBR_STATUS;
         msg.u.val = curVal;
-        pOnRead(hMasterPort, &msg);
+        OnReadMsg(&msg);
       }
 
       if (inOptions[1] & GO1_RBR_STATUS) {
@@ -948,7 +1059,7 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
 
         msg.type = HUB_MSG_TYPE_RBR_STATUS;
         msg.u.val = curVal;                 // suppose remote equal local
-        pOnRead(hMasterPort, &msg);
+        OnReadMsg(&msg);
       }
     }
     break;
@@ -1001,7 +1112,7 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
 
         msg.type = HUB_MSG_TYPE_LLC_STATUS;
         msg.u.val = curVal;
-        pOnRead(hMasterPort, &msg);
+        OnReadMsg(&msg);
       }
 
       if (inOptions[1] & GO1_RLC_STATUS) {
@@ -1009,7 +1120,7 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
 
         msg.type = HUB_MSG_TYPE_RLC_STATUS;
         msg.u.val = curVal;                 // suppose remote equal local
-        pOnRead(hMasterPort, &msg);
+        OnReadMsg(&msg);
       }
     }
     break;
@@ -1043,7 +1154,7 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
     if (pMsg->u.val) {
       countXoff++;
     } else {
-      if (--countXoff == 0) {
+      if (--countXoff == 0 && CanRead()) {
         _ASSERTE(pComIo != NULL);
 
         if (pComIo->Handle() != INVALID_HANDLE_VALUE)
@@ -1051,6 +1162,15 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
       }
     }
     break;
+  case HUB_MSG_T2N(HUB_MSG_TYPE_CREDIT):
+    readCredited = TRUE;
+    readCredit = (LONG)pMsg->u.val;
+
+    _ASSERTE(pComIo != NULL);
+
+    if (CanRead() && pComIo->Handle() != INVALID_HANDLE_VALUE)
+      StartRead();
+    break;
   }
 
   return TRUE;
@@ -1093,6 +1213,9 @@ void ComPort::OnWrite(WriteOverlapped *pOverlapped, DWORD len, DWORD done)
   _ASSERTE(writeQueued >= len);
   writeQueued -= len;
 
+  if (pWriteLatency)
+    pWriteLatency(hMasterPort, pOverlapped->Queued());
+
   _ASSERTE(pComIo != NULL);
   _ASSERTE(pWriteBuf != NULL || lenWriteBuf == 0);
   _ASSERTE(pWriteBuf == NULL || lenWriteBuf != 0);
@@ -1101,9 +1224,9 @@ void ComPort::OnWrite(WriteOverlapped *pOverlapped, DWORD len, DWORD done)
     _ASSERTE(writeQueued >= lenWriteBuf);
     writeQueued -= lenWriteBuf;
 
-    FilterX(pWriteBuf, lenWriteBuf);
+    FilterX(&pWriteBuf, lenWriteBuf);
 
-    if (!lenWriteBuf || !pOverlapped->StartWrite(pWriteBuf, lenWriteBuf)) {
+    if (!lenWriteBuf || !pOverlapped->StartWrite(pWriteBuf, lenWriteBuf, writeBufQueued)) {
       writeOverlappedBuf.push(pOverlapped);
 
       writeLost += lenWriteBuf;
@@ -1125,25 +1248,118 @@ void ComPort::OnRead(ReadOverlapped *pOverlapped, BYTE *pBuf, DWORD done)
 {
   //cout << name << " OnRead " << ::GetCurrentThreadId() << endl;
 
-  HUB_MSG msg;
+  if (batchWindow) {
+    BatchRead(pBuf, done);
+  } else {
+    HUB_MSG msg;
 
-  msg.type = HUB_MSG_TYPE_LINE_DATA;
-  msg.u.buf.pBuf = pBuf;
-  msg.u.buf.size = done;
+    msg.type = HUB_MSG_TYPE_LINE_DATA;
+    msg.u.buf.pBuf = pBuf;
+    msg.u.buf.size = done;
 
-  pOnRead(hMasterPort, &msg);
+    pOnRead(hMasterPort, &msg);
+  }
+
+  UpdateReadBufSize(done);
 
-  if (pComIo->Handle() == INVALID_HANDLE_VALUE || countXoff > 0 || !pOverlapped->StartRead()) {
+  if (readCredited)
+    readCredit -= (LONG)done;
+
+  if (pComIo->Handle() == INVALID_HANDLE_VALUE || !CanRead() || !pOverlapped->StartRead(ReadSize())) {
     delete pOverlapped;
 
     countReadOverlapped--;
     _ASSERTE(countReadOverlapped >= 0);
 
-    if (countXoff <= 0)
+    if (CanRead())
       cout << name << " Stopped Read " << countReadOverlapped << endl;
   }
 }
 
+void ComPort::UpdateReadBufSize(DWORD done)
+{
+  readCount++;
+  readBytes += done;
+
+  if (done >= readBufSize) {
+    if (readBufSize < readBufSizeMax) {
+      readBufSize *= 2;
+
+      if (readBufSize > readBufSizeMax)
+        readBufSize = readBufSizeMax;
+    }
+  }
+  else
+  if (done < readBufSize/4) {
+    if (readBufSize > readBufSizeMin) {
+      readBufSize /= 2;
+
+      if (readBufSize < readBufSizeMin)
+        readBufSize = readBufSizeMin;
+    }
+  }
+}
+
+void ComPort::OnReadMsg(HUB_MSG *pMsg)
+{
+  // keep the order of batched data and other messages
+
+  FlushBatch();
+
+  pOnRead(hMasterPort, pMsg);
+}
+
+void ComPort::BatchRead(BYTE *pBuf, DWORD done)
+{
+  if (!pBatchBuf) {
+    pBatchBuf = pBuf;
+    lenBatchBuf = done;
+
+    if (!hBatchTimer)
+      hBatchTimer = pTimerCreate((HTIMEROWNER)this);
+
+    LARGE_INTEGER dueTime;
+
+    dueTime.QuadPart = -10LL * batchWindow;
+
+    if (!hBatchTimer || !pTimerSet(hBatchTimer, hMasterPort, &dueTime, 0, (HTIMERPARAM)hBatchTimer)) {
+      FlushBatch();
+      return;
+    }
+  } else {
+    pBufAppend(&pBatchBuf, lenBatchBuf, pBuf, done);
+    pBufFree(pBuf);
+
+    if (pBatchBuf) {
+      lenBatchBuf += done;
+    } else {
+      cerr << name << " Read batch lost " << (lenBatchBuf + done) << " bytes" << endl;
+      lenBatchBuf = 0;
+      return;
+    }
+  }
+
+  if (batchBytes && lenBatchBuf >= batchBytes)
+    FlushBatch();
+}
+
+void ComPort::FlushBatch()
+{
+  if (!pBatchBuf)
+    return;
+
+  HUB_MSG msg;
+
+  msg.type = HUB_MSG_TYPE_LINE_DATA;
+  msg.u.buf.pBuf = pBatchBuf;
+  msg.u.buf.size = lenBatchBuf;
+
+  pBatchBuf = NULL;
+  lenBatchBuf = 0;
+
+  pOnRead(hMasterPort, &msg);
+}
+
 void ComPort::OnCommEvent(WaitCommEventOverlapped *pOverlapped, DWORD eMask)
 {
   cout << name << " OnCommEvent " << ::GetCurrentThreadId() << " [";
@@ -1175,7 +1391,7 @@ void ComPort::CheckComEvents(DWORD eMask)
       msg.type = HUB_MSG_TYPE_MODEM_STATUS;
       msg.u.val = ((DWORD)(BYTE)stat | VAL2MASK(GO1_O2V_MODEM_STATUS(inOptions[1])));
 
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
     }
   }
 
@@ -1189,10 +1405,32 @@ void ComPort::CheckComEvents(DWORD eMask)
 
 void ComPort::LostReport()
 {
+  if (writeSuspended) {
+    DWORD now = GetTickCount();
+
+    writeSuspendedTime += now - writeSuspendedStart;
+    writeSuspendedStart = now;
+  }
+
   if (writeLost) {
     writeLostTotal += writeLost;
     cout << "Write lost " << name << ": " << writeLost << ", total " << writeLostTotal << endl;
+
+    HUB_MSG msg;
+
+    msg.type = HUB_MSG_TYPE_LOST;
+    msg.u.val = writeLost;
+
     writeLost = 0;
+
+    OnReadMsg(&msg);
+  }
+
+  if (readCount && readBufSizeMax != readBufSizeMin) {
+    cout << "Read " << name << ": " << readBytes << " bytes, " << readCount << " reads, "
+         << readBytes/readCount << " bytes per read, buffer " << readBufSize << endl;
+    readCount = 0;
+    readBytes = 0;
   }
 
   CheckComEvents(EV_BREAK|EV_ERR);
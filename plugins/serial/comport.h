@@ -140,8 +140,11 @@ class ComPort
 
   private:
     void FlowControlUpdate();
+    void CreditUpdate();
+    BOOL CanRead() const { return countXoff <= 0 && (!readCredited || readCredit > 0); }
+    DWORD ReadSize() const;
     void PurgeWrite(BOOL withLost);
-    void FilterX(BYTE *pBuf, DWORD &len);
+    void FilterX(BYTE **ppBuf, DWORD &len);
     void UpdateOutOptions(DWORD options);
     void StartDisconnect();
     void Update();
@@ -149,14 +152,33 @@ class ComPort
     BOOL StartRead();
     BOOL StartWaitCommEvent();
     void CheckComEvents(DWORD eMask);
+    void UpdateReadBufSize(DWORD done);
+    void OnReadMsg(HUB_MSG *pMsg);
+    void BatchRead(BYTE *pBuf, DWORD done);
+    void FlushBatch();
 
     ComIo *pComIo;
     string name;
     HMASTERPORT hMasterPort;
 
     int countReadOverlapped;
+
+    DWORD readBufSize;
+    DWORD readBufSizeMin;
+    DWORD readBufSizeMax;
+    DWORD readCount;
+    DWORD readBytes;
+
+    DWORD batchWindow;
+    DWORD batchBytes;
+    HMASTERTIMER hBatchTimer;
+    BYTE *pBatchBuf;
+    DWORD lenBatchBuf;
+
     int countWaitCommEventOverlapped;
     int countXoff;
+    BOOL readCredited;
+    LONG readCredit;
 
     DWORD intercepted_options[2];
     DWORD inOptions[2];
@@ -174,7 +196,12 @@ class ComPort
     DWORD writeQueueLimitSendXoff;
     DWORD writeQueueLimitSendXon;
     DWORD writeQueued;
+    BOOL writeCredit;
+    DWORD creditWindow;
+    DWORD creditGranted;
     BOOL writeSuspended;
+    DWORD writeSuspendedStart;
+    DWORD writeSuspendedTime;
     DWORD writeLost;
     DWORD writeLostTotal;
     DWORD errors;
@@ -182,6 +209,7 @@ class ComPort
     queue<WriteOverlapped *> writeOverlappedBuf;
     BYTE *pWriteBuf;
     DWORD lenWriteBuf;
+    LONGLONG writeBufQueued;
 
 #ifdef _DEBUG
   private:
@@ -0,0 +1,85 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+
+namespace PortSerial {
+
+#include "filterx.h"
+
+///////////////////////////////////////////////////////////////
+static DWORD FindChar(const BYTE *pBuf, DWORD off, DWORD len, BYTE ch)
+{
+  _ASSERTE(off <= len);
+
+  const BYTE *pCh = (const BYTE *)memchr(pBuf + off, ch, len - off);
+
+  return pCh ? DWORD(pCh - pBuf) : len;
+}
+///////////////////////////////////////////////////////////////
+DWORD FindX(const BYTE *pBuf, DWORD len, BYTE xOn, BYTE xOff)
+{
+  DWORD offOn = FindChar(pBuf, 0, len, xOn);
+
+  // the xOff char can be only before the xOn char here
+  DWORD offOff = FindChar(pBuf, 0, offOn, xOff);
+
+  return offOn < offOff ? offOn : offOff;
+}
+///////////////////////////////////////////////////////////////
+DWORD StripX(BYTE *pBuf, DWORD off, DWORD len, BYTE xOn, BYTE xOff)
+{
+  _ASSERTE(off <= len);
+
+  DWORD offOn = FindChar(pBuf, off, len, xOn);
+  DWORD offOff = FindChar(pBuf, off, len, xOff);
+  DWORD dst = offOn < offOff ? offOn : offOff;
+  DWORD src = dst;
+
+  // move the data between xOn and xOff chars by blocks
+
+  for (;;) {
+    DWORD offX = offOn < offOff ? offOn : offOff;
+
+    if (offX > src) {
+      memmove(pBuf + dst, pBuf + src, offX - src);
+      dst += offX - src;
+    }
+
+    if (offX >= len)
+      break;
+
+    src = offX + 1;
+
+    if (offOn < src)
+      offOn = FindChar(pBuf, src, len, xOn);
+
+    if (offOff < src)
+      offOff = FindChar(pBuf, src, len, xOff);
+  }
+
+  return dst;
+}
+///////////////////////////////////////////////////////////////
+} // end namespace
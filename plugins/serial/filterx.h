@@ -0,0 +1,37 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#ifndef _FILTERX_H
+#define _FILTERX_H
+
+///////////////////////////////////////////////////////////////
+// returns offset of the first xOn or xOff char or len if none
+DWORD FindX(const BYTE *pBuf, DWORD len, BYTE xOn, BYTE xOff);
+
+// removes xOn and xOff chars located at or after off (the
+// offset returned by FindX()) and returns the new length
+DWORD StripX(BYTE *pBuf, DWORD off, DWORD len, BYTE xOn, BYTE xOff);
+///////////////////////////////////////////////////////////////
+
+#endif  // _FILTERX_H
@@ -46,8 +46,14 @@
 extern ROUTINE_BUF_ALLOC *pBufAlloc;
 extern ROUTINE_BUF_FREE *pBufFree;
 extern ROUTINE_BUF_APPEND *pBufAppend;
+extern ROUTINE_BUF_MAKE_WRITABLE *pBufMakeWritable;
+extern ROUTINE_MSG_REPLACE_NONE *pMsgReplaceNone;
 extern ROUTINE_MSG_INSERT_NONE *pMsgInsertNone;
 extern ROUTINE_ON_READ *pOnRead;
+extern ROUTINE_WRITE_LATENCY *pWriteLatency;
+extern ROUTINE_STAT_ADD_A *pStatAdd;
+extern ROUTINE_TIMER_CREATE *pTimerCreate;
+extern ROUTINE_TIMER_SET *pTimerSet;
 ///////////////////////////////////////////////////////////////
 
 #endif  // _IMPORT_H
@@ -177,6 +177,37 @@ static void CALLBACK Help(const char *pProgPath)
   << "                             where <s> is " << ComParams::WriteQueueLimitLst() << ". The queue" << endl
   << "                             will be purged with data lost on overruning." << endl
   << "                             The value 0 will disable writing to the port." << endl
+  << "  --write-fc=<m>           - set flow control of the write queue to <m> (" << ComParams().WriteFcStr() << endl
+  << "                             by default), where <m> is " << ComParams::WriteFcLst() << "." << endl
+  << "                             With xoff the ports routing data to the port are" << endl
+  << "                             stopped by XOFF sent on filling 2/3 of the write" << endl
+  << "                             queue and started by XON sent on draining to 1/3" << endl
+  << "                             of it. With credit the port also grants the free" << endl
+  << "                             space of the credit window to the ports routing" << endl
+  << "                             data to it and they read not more than granted." << endl
+  << "  --write-credit=<s>       - set credit window to <s> (" << ComParams().CreditWindowStr() << " by" << endl
+  << "                             default), where <s> is " << ComParams::CreditWindowLst() << "." << endl
+  << "                             The window is not greater than the write queue" << endl
+  << "                             limit. Used with --write-fc=credit only." << endl
+  << "  --read-buf=<min>[,<max>] - set read buffer size to <min> bytes (" << ComParams().ReadBufSizeStr() << " by" << endl
+  << "                             default), where <min> and <max> are " << ComParams::ReadBufSizeLst() << "." << endl
+  << "                             If <max> is greater than <min> then the size will" << endl
+  << "                             be doubled on each full read up to <max> and" << endl
+  << "                             halved on each read filled less than a quarter" << endl
+  << "                             down to <min>. Use it with --ito option to get" << endl
+  << "                             fewer reads on high baud rates." << endl
+  << "  --batch-window=<t>       - set read batching window to <t> (" << ComParams().BatchWindowStr() << " by default)," << endl
+  << "                             where <t> is " << ComParams::BatchWindowLst() << "." << endl
+  << "                             If <t> is not 0 then the data of consecutive reads" << endl
+  << "                             will be coalesced and passed to the filters and" << endl
+  << "                             routed as one message not later than <t>" << endl
+  << "                             microseconds after the first read. It gives fewer" << endl
+  << "                             filter calls for many small packets at the cost" << endl
+  << "                             of bounded latency." << endl
+  << "  --batch-bytes=<s>        - pass the coalesced data not waiting for the end of" << endl
+  << "                             batching window if at least <s> bytes collected" << endl
+  << "                             (" << ComParams().BatchBytesStr() << " by default), where <s> is " << ComParams::BatchBytesLst() << "." << endl
+  << "                             The value 0 means no limit." << endl
   << "  --share-mode=<c>         - set share mode to <c> (" << ComParams().ShareModeStr() << " by default), where <c>" << endl
   << "                             is " << ComParams::ShareModeLst() << "." << endl
   << endl
@@ -299,6 +330,36 @@ static BOOL CALLBACK Config(
       exit(1);
     }
   } else
+  if ((pParam = GetParam(pArg, "--write-fc=")) != NULL) {
+    if (!comParams.SetWriteFc(pParam)) {
+      Diag("Invalid write flow control value in ", pArg);
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--write-credit=")) != NULL) {
+    if (!comParams.SetCreditWindow(pParam)) {
+      Diag("Invalid credit window value in ", pArg);
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--read-buf=")) != NULL) {
+    if (!comParams.SetReadBufSize(pParam)) {
+      Diag("Invalid read buffer size value in ", pArg);
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--batch-window=")) != NULL) {
+    if (!comParams.SetBatchWindow(pParam)) {
+      Diag("Invalid batching window value in ", pArg);
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--batch-bytes=")) != NULL) {
+    if (!comParams.SetBatchBytes(pParam)) {
+      Diag("Invalid batching bytes value in ", pArg);
+      exit(1);
+    }
+  } else
   if ((pParam = GetParam(pArg, "--share-mode=")) != NULL) {
     if (!comParams.SetShareMode(pParam)) {
       Diag("Invalid share mode value in ", pArg);
@@ -422,8 +483,14 @@ static const PLUGIN_ROUTINES_A *const plugins[] = {
 ROUTINE_BUF_ALLOC *pBufAlloc;
 ROUTINE_BUF_FREE *pBufFree;
 ROUTINE_BUF_APPEND *pBufAppend;
+ROUTINE_BUF_MAKE_WRITABLE *pBufMakeWritable;
+ROUTINE_MSG_REPLACE_NONE *pMsgReplaceNone;
 ROUTINE_MSG_INSERT_NONE *pMsgInsertNone;
 ROUTINE_ON_READ *pOnRead;
+ROUTINE_WRITE_LATENCY *pWriteLatency;
+ROUTINE_STAT_ADD_A *pStatAdd;
+ROUTINE_TIMER_CREATE *pTimerCreate;
+ROUTINE_TIMER_SET *pTimerSet;
 ///////////////////////////////////////////////////////////////
 PLUGIN_INIT_A InitA;
 const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
@@ -432,8 +499,12 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
   if (!ROUTINE_IS_VALID(pHubRoutines, pBufAlloc) ||
       !ROUTINE_IS_VALID(pHubRoutines, pBufFree) ||
       !ROUTINE_IS_VALID(pHubRoutines, pBufAppend) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pBufMakeWritable) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceNone) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgInsertNone) ||
       !ROUTINE_IS_VALID(pHubRoutines, pOnRead) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pTimerCreate) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pTimerSet) ||
       !ROUTINE_IS_VALID(pHubRoutines, pGetArgInfo))
   {
     return NULL;
@@ -442,8 +513,14 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
   pBufAlloc = pHubRoutines->pBufAlloc;
   pBufFree = pHubRoutines->pBufFree;
   pBufAppend = pHubRoutines->pBufAppend;
+  pBufMakeWritable = pHubRoutines->pBufMakeWritable;
+  pMsgReplaceNone = pHubRoutines->pMsgReplaceNone;
   pMsgInsertNone = pHubRoutines->pMsgInsertNone;
   pOnRead = pHubRoutines->pOnRead;
+  pWriteLatency = ROUTINE_GET(pHubRoutines, pWriteLatency);
+  pStatAdd = ROUTINE_GET(pHubRoutines, pStatAdd);
+  pTimerCreate = pHubRoutines->pTimerCreate;
+  pTimerSet = pHubRoutines->pTimerSet;
   pGetArgInfo = pHubRoutines->pGetArgInfo;
 
   return plugins;
@@ -43,7 +43,9 @@
 ///////////////////////////////////////////////////////////////
 namespace FilterTag {
 ///////////////////////////////////////////////////////////////
-static ROUTINE_MSG_REPLACE_BUF *pMsgReplaceBuf;
+static ROUTINE_BUF_ALLOC *pBufAlloc;
+static ROUTINE_BUF_FREE *pBufFree;
+static ROUTINE_BUF_MAKE_WRITABLE *pBufMakeWritable;
 ///////////////////////////////////////////////////////////////
 #ifndef _DEBUG
   #define DEBUG_PARAM(par)
@@ -480,15 +482,22 @@ static BOOL CALLBACK InMethod(
         break;
 
       BYTE tag = (BYTE)((Filter *)hFilter)->tagIn;
-      basic_string<BYTE> line_data;
+      BYTE *pNewBuf = pBufAlloc(len*2);
 
-      for (const BYTE *pBuf = pInMsg->u.buf.pBuf ; len ; len--) {
-        line_data.append(&tag, 1);
-        line_data.append(pBuf++, 1);
+      if (!pNewBuf)
+        return FALSE;
+
+      const BYTE *pBuf = pInMsg->u.buf.pBuf;
+      BYTE *pNext = pNewBuf;
+
+      for (const BYTE *pEnd = pBuf + len ; pBuf != pEnd ; pBuf++) {
+        *pNext++ = tag;
+        *pNext++ = *pBuf;
       }
 
-      if (!pMsgReplaceBuf(pInMsg, HUB_MSG_TYPE_LINE_DATA, line_data.data(), (DWORD)line_data.size()))
-        return FALSE;
+      pBufFree(pInMsg->u.buf.pBuf);
+      pInMsg->u.buf.pBuf = pNewBuf;
+      pInMsg->u.buf.size = len*2;
 
       break;
     }
@@ -520,27 +529,38 @@ static BOOL CALLBACK OutMethod(
       BYTE tag = (BYTE)((Filter *)hFilter)->tagOut;
       BOOL isValOut = ((State *)hFilterInstance)->isValOut;
       BOOL isMyValOut = ((State *)hFilterInstance)->isMyValOut;
-      basic_string<BYTE> line_data;
 
-      for (const BYTE *pBuf = pOutMsg->u.buf.pBuf ; len ; len--) {
-        BYTE ch = *pBuf++;
+      // the output is not longer than the input so filter it in place
 
-        if (isValOut) {
-          if (isMyValOut)
-            line_data.append(&ch, 1);
+      if (!pBufMakeWritable(&pOutMsg->u.buf.pBuf, len))
+        return FALSE;
 
-          isValOut = FALSE;
-        } else {
-          isMyValOut = (ch == tag);
-          isValOut = TRUE;
-        }
+      const BYTE *pBuf = pOutMsg->u.buf.pBuf;
+      const BYTE *pEnd = pBuf + len;
+      BYTE *pNext = pOutMsg->u.buf.pBuf;
+
+      if (isValOut && pBuf != pEnd) {
+        if (isMyValOut)
+          *pNext++ = *pBuf;
+
+        pBuf++;
+        isValOut = FALSE;
+      }
+
+      for (; pEnd - pBuf >= 2 ; pBuf += 2) {
+        if (pBuf[0] == tag)
+          *pNext++ = pBuf[1];
+      }
+
+      if (pBuf != pEnd) {
+        isMyValOut = (*pBuf == tag);
+        isValOut = TRUE;
       }
 
       ((State *)hFilterInstance)->isValOut = isValOut;
       ((State *)hFilterInstance)->isMyValOut = isMyValOut;
 
-      if (!pMsgReplaceBuf(pOutMsg, HUB_MSG_TYPE_LINE_DATA, line_data.data(), (DWORD)line_data.size()))
-        return FALSE;
+      pOutMsg->u.buf.size = (DWORD)(pNext - pOutMsg->u.buf.pBuf);
 
       break;
     }
@@ -574,17 +594,24 @@ static BOOL CALLBACK InMethodSync(
 
       BYTE sync = (BYTE)((FilterSync *)hFilter)->syncIn;
       BOOL isValIn = ((StateSync *)hFilterInstance)->isValIn;
-      basic_string<BYTE> line_data;
 
-      for (const BYTE *pBuf = pInMsg->u.buf.pBuf ; len ; len--) {
-        BYTE ch = *pBuf++;
+      // the output is not longer than the input so filter it in place
+
+      if (!pBufMakeWritable(&pInMsg->u.buf.pBuf, len))
+        return FALSE;
+
+      const BYTE *pBuf = pInMsg->u.buf.pBuf;
+      BYTE *pNext = pInMsg->u.buf.pBuf;
+
+      for (const BYTE *pEnd = pBuf + len ; pBuf != pEnd ; pBuf++) {
+        BYTE ch = *pBuf;
 
         if (isValIn) {
-          line_data.append(&ch, 1);
+          *pNext++ = ch;
           isValIn = FALSE;
         } else {
           if (ch != sync) {
-            line_data.append(&ch, 1);
+            *pNext++ = ch;
             isValIn = TRUE;
           }
         }
@@ -592,8 +619,7 @@ static BOOL CALLBACK InMethodSync(
 
       ((StateSync *)hFilterInstance)->isValIn = isValIn;
 
-      if (!pMsgReplaceBuf(pInMsg, HUB_MSG_TYPE_LINE_DATA, line_data.data(), (DWORD)line_data.size()))
-        return FALSE;
+      pInMsg->u.buf.size = (DWORD)(pNext - pInMsg->u.buf.pBuf);
 
       break;
     }
@@ -627,23 +653,41 @@ static BOOL CALLBACK OutMethodSync(
       BYTE sync = (BYTE)((FilterSync *)hFilter)->syncOut;
       BOOL isValOut = ((StateSync *)hFilterInstance)->isValOut;
       int periodOut = ((StateSync *)hFilterInstance)->periodOut;
-      basic_string<BYTE> line_data;
 
-      for (const BYTE *pBuf = pOutMsg->u.buf.pBuf ; len ; len--) {
-        BYTE ch = *pBuf++;
+      if (periodOut <= 0) {
+        // no syncs, the data are passed as is
+        if (len & 1)
+          isValOut = !isValOut;
+
+        ((StateSync *)hFilterInstance)->isValOut = isValOut;
+
+        break;
+      }
+
+      // at most one sync per tag-value pair
+      BYTE *pNewBuf = pBufAlloc(len + (len + 1)/2);
+
+      if (!pNewBuf)
+        return FALSE;
+
+      const BYTE *pBuf = pOutMsg->u.buf.pBuf;
+      BYTE *pNext = pNewBuf;
+
+      for (const BYTE *pEnd = pBuf + len ; pBuf != pEnd ; pBuf++) {
+        BYTE ch = *pBuf;
 
         if (isValOut) {
-          line_data.append(&ch, 1);
+          *pNext++ = ch;
           isValOut = FALSE;
         } else {
           if (periodOut > 0) {
             if (periodOut-- == 1) {
-              line_data.append(&sync, 1);
+              *pNext++ = sync;
               periodOut = ((FilterSync *)hFilter)->periodOut;
             }
           }
 
-          line_data.append(&ch, 1);
+          *pNext++ = ch;
           isValOut = TRUE;
         }
       }
@@ -651,8 +695,9 @@ static BOOL CALLBACK OutMethodSync(
       ((StateSync *)hFilterInstance)->isValOut = isValOut;
       ((StateSync *)hFilterInstance)->periodOut = periodOut;
 
-      if (!pMsgReplaceBuf(pOutMsg, HUB_MSG_TYPE_LINE_DATA, line_data.data(), (DWORD)line_data.size()))
-        return FALSE;
+      pBufFree(pOutMsg->u.buf.pBuf);
+      pOutMsg->u.buf.pBuf = pNewBuf;
+      pOutMsg->u.buf.size = (DWORD)(pNext - pNewBuf);
 
       break;
     }
@@ -703,10 +748,16 @@ PLUGIN_INIT_A InitA;
 const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     const HUB_ROUTINES_A * pHubRoutines)
 {
-  if (!ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceBuf))
+  if (!ROUTINE_IS_VALID(pHubRoutines, pBufAlloc) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pBufFree) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pBufMakeWritable))
+  {
     return NULL;
+  }
 
-  pMsgReplaceBuf = pHubRoutines->pMsgReplaceBuf;
+  pBufAlloc = pHubRoutines->pBufAlloc;
+  pBufFree = pHubRoutines->pBufFree;
+  pBufMakeWritable = pHubRoutines->pBufMakeWritable;
 
   return plugins;
 }
@@ -302,7 +302,8 @@ void Close(const char *pName, SOCKET hSock)
 VOID CALLBACK WriteOverlapped::OnWrite(
     DWORD err,
     DWORD done,
-    LPOVERLAPPED pOverlapped)
+    LPWSAOVERLAPPED pOverlapped,
+    DWORD /*flags*/)
 {
   WriteOverlapped *pOver = (WriteOverlapped *)pOverlapped;
 
@@ -316,38 +317,53 @@ VOID CALLBACK WriteOverlapped::OnWrite(
 
 void WriteOverlapped::BufFree()
 {
-  _ASSERTE(pBuf != NULL);
+  _ASSERTE(!bufs.empty());
 
-  pBufFree(pBuf);
+  for (vector<WSABUF>::const_iterator i = bufs.begin() ; i != bufs.end() ; i++)
+    pBufFree((BYTE *)i->buf);
 
-#ifdef _DEBUG
-  pBuf = NULL;
-#endif
+  bufs.clear();
 }
 
-BOOL WriteOverlapped::StartWrite(BYTE *_pBuf, DWORD _len)
+BOOL WriteOverlapped::StartWrite(vector<WSABUF> &_bufs, LONGLONG _queued)
 {
-  _ASSERTE(pBuf == NULL);
+  _ASSERTE(bufs.empty());
+  _ASSERTE(!_bufs.empty());
 
   ::memset((OVERLAPPED *)this, 0, sizeof(OVERLAPPED));
 
-  _ASSERTE(_pBuf != NULL);
-  _ASSERTE(_len != 0);
+  len = 0;
+  queued = _queued;
 
-  if (!::WriteFileEx(port.Handle(), _pBuf, _len, this, OnWrite)) {
-    TraceError(GetLastError(), "WriteOverlapped::StartWrite(): WriteFileEx(%x) %s", port.Handle(), port.Name().c_str());
-    return FALSE;
+  for (vector<WSABUF>::const_iterator i = _bufs.begin() ; i != _bufs.end() ; i++) {
+    _ASSERTE(i->buf != NULL);
+    _ASSERTE(i->len != 0);
+
+    len += i->len;
   }
 
-  pBuf = _pBuf;
-  len = _len;
+  bufs.swap(_bufs);
+
+  DWORD sent;
+
+  if (::WSASend((SOCKET)port.Handle(), &bufs[0], (DWORD)bufs.size(), &sent, 0, this, OnWrite) != 0) {
+    DWORD err = ::WSAGetLastError();
+
+    if (err != WSA_IO_PENDING) {
+      TraceError(err, "WriteOverlapped::StartWrite(): WSASend(%x) %s", port.Handle(), port.Name().c_str());
+      _bufs.swap(bufs);
+      return FALSE;
+    }
+  }
 
   return TRUE;
 }
 ///////////////////////////////////////////////////////////////
 ReadOverlapped::ReadOverlapped(ComPort &_port)
   : port(_port),
-    pBuf(NULL)
+    pBuf(NULL),
+    seq(0),
+    size(0)
 {
 }
 
@@ -374,18 +390,19 @@ VOID CALLBACK ReadOverlapped::OnRead(
   pOver->port.OnRead(pOver, pInBuf, done);
 }
 
-BOOL ReadOverlapped::StartRead()
+BOOL ReadOverlapped::StartRead(DWORD _seq, DWORD _size)
 {
   ::memset((OVERLAPPED *)this, 0, sizeof(OVERLAPPED));
 
-  #define readBufSize 64
+  seq = _seq;
+  size = _size;
 
-  pBuf = pBufAlloc(readBufSize);
+  pBuf = pBufAlloc(size);
 
   if (!pBuf)
     return FALSE;
 
-  if (!::ReadFileEx(port.Handle(), pBuf, readBufSize, this, OnRead)) {
+  if (!::ReadFileEx(port.Handle(), pBuf, size, this, OnRead)) {
     TraceError(GetLastError(), "ReadOverlapped::StartRead(): ReadFileEx(%x) %s", port.Handle(), port.Name().c_str());
     return FALSE;
   }
@@ -393,22 +410,34 @@ BOOL ReadOverlapped::StartRead()
   return TRUE;
 }
 ///////////////////////////////////////////////////////////////
-static HANDLE hThread = INVALID_HANDLE_VALUE;
-#ifdef _DEBUG
-static DWORD idThread;
-#endif  /* _DEBUG */
-
-static BOOL SetThread()
+//
+// The hub can run the ports on several threads so the APCs from
+// the wait callbacks are queued to the thread that created the
+// waiting object. The duplicated handles of the threads are kept
+// in the TLS slot.
+//
+static DWORD tlsThread = TLS_OUT_OF_INDEXES;
+
+static HANDLE GetThread()
 {
-#ifdef _DEBUG
-  if (hThread == INVALID_HANDLE_VALUE) {
-    idThread = ::GetCurrentThreadId();
-  } else {
-    _ASSERTE(idThread == ::GetCurrentThreadId());
+  if (tlsThread == TLS_OUT_OF_INDEXES) {
+    DWORD tls = ::TlsAlloc();
+
+    if (tls == TLS_OUT_OF_INDEXES) {
+      TraceError(
+          GetLastError(),
+          "GetThread(): TlsAlloc()");
+
+      return NULL;
+    }
+
+    if (::InterlockedCompareExchange((LONG *)&tlsThread, (LONG)tls, (LONG)TLS_OUT_OF_INDEXES) != (LONG)TLS_OUT_OF_INDEXES)
+      ::TlsFree(tls);
   }
-#endif  /* _DEBUG */
 
-  if (hThread == INVALID_HANDLE_VALUE) {
+  HANDLE hThread = (HANDLE)::TlsGetValue(tlsThread);
+
+  if (!hThread) {
     if (!::DuplicateHandle(::GetCurrentProcess(),
                            ::GetCurrentThread(),
                            ::GetCurrentProcess(),
@@ -417,17 +446,25 @@ static BOOL SetThread()
                            FALSE,
                            DUPLICATE_SAME_ACCESS))
     {
-      hThread = INVALID_HANDLE_VALUE;
+      TraceError(
+          GetLastError(),
+          "GetThread(): DuplicateHandle()");
 
+      return NULL;
+    }
+
+    if (!::TlsSetValue(tlsThread, hThread)) {
       TraceError(
           GetLastError(),
-          "SetThread(): DuplicateHandle()");
+          "GetThread(): TlsSetValue()");
 
-      return FALSE;
+      ::CloseHandle(hThread);
+
+      return NULL;
     }
   }
 
-  return TRUE;
+  return hThread;
 }
 ///////////////////////////////////////////////////////////////
 WaitEventOverlapped::WaitEventOverlapped(ComPort &_port, SOCKET hSockWait)
@@ -435,8 +472,10 @@ WaitEventOverlapped::WaitEventOverlapped(ComPort &_port, SOCKET hSockWait)
     hSock(hSockWait),
     hWait(INVALID_HANDLE_VALUE)
 {
-  if (!SetThread())
-      return;
+  hThread = GetThread();
+
+  if (!hThread)
+    return;
 
   hEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
 
@@ -493,7 +532,7 @@ VOID CALLBACK WaitEventOverlapped::OnEvent(
     BOOLEAN /*timerOrWaitFired*/)
 {
   ((WaitEventOverlapped *)pOverlapped)->LockDelete();
-  if (!::QueueUserAPC(OnEvent, hThread, (ULONG_PTR)pOverlapped))
+  if (!::QueueUserAPC(OnEvent, ((WaitEventOverlapped *)pOverlapped)->hThread, (ULONG_PTR)pOverlapped))
     ((WaitEventOverlapped *)pOverlapped)->UnockDelete();
 }
 
@@ -556,8 +595,10 @@ ListenOverlapped::ListenOverlapped(Listener &_listener, SOCKET hSockWait)
     hSock(hSockWait),
     hWait(INVALID_HANDLE_VALUE)
 {
-  if (!SetThread())
-      return;
+  hThread = GetThread();
+
+  if (!hThread)
+    return;
 
   hEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
 
@@ -621,7 +662,7 @@ VOID CALLBACK ListenOverlapped::OnEvent(
     BOOLEAN /*timerOrWaitFired*/)
 {
   ((ListenOverlapped *)pOverlapped)->LockDelete();
-  if (!::QueueUserAPC(OnEvent, hThread, (ULONG_PTR)pOverlapped))
+  if (!::QueueUserAPC(OnEvent, ((ListenOverlapped *)pOverlapped)->hThread, (ULONG_PTR)pOverlapped))
     ((ListenOverlapped *)pOverlapped)->UnockDelete();
 }
 
@@ -59,7 +59,9 @@ class ReadOverlapped : private OVERLAPPED
   public:
     ReadOverlapped(ComPort &_port);
     ~ReadOverlapped();
-    BOOL StartRead();
+    BOOL StartRead(DWORD _seq, DWORD _size);
+    DWORD Seq() const { return seq; }
+    DWORD Size() const { return size; }
 
   private:
     static VOID CALLBACK OnRead(
@@ -69,34 +71,36 @@ class ReadOverlapped : private OVERLAPPED
 
     ComPort &port;
     BYTE *pBuf;
+    DWORD seq;
+    DWORD size;
 };
 ///////////////////////////////////////////////////////////////
 class WriteOverlapped : private OVERLAPPED
 {
   public:
-    WriteOverlapped(ComPort &_port) : port(_port) {
-#ifdef _DEBUG
-      pBuf = NULL;
-#endif
-    }
+    WriteOverlapped(ComPort &_port) : port(_port) {}
 #ifdef _DEBUG
     ~WriteOverlapped() {
-      _ASSERTE(pBuf == NULL);
+      _ASSERTE(bufs.empty());
     }
 #endif
 
-    BOOL StartWrite(BYTE *_pBuf, DWORD _len);
+    // On success takes the buffers and leaves _bufs empty
+    BOOL StartWrite(vector<WSABUF> &_bufs, LONGLONG _queued);
+    LONGLONG Queued() const { return queued; }
 
   private:
     static VOID CALLBACK OnWrite(
       DWORD err,
       DWORD done,
-      LPOVERLAPPED pOverlapped);
+      LPWSAOVERLAPPED pOverlapped,
+      DWORD flags);
     void BufFree();
 
     ComPort &port;
-    BYTE *pBuf;
+    vector<WSABUF> bufs;
     DWORD len;
+    LONGLONG queued;
 };
 ///////////////////////////////////////////////////////////////
 class SafeDelete
@@ -153,6 +157,7 @@ class WaitEventOverlapped : public SafeDelete
 
     ComPort &port;
     SOCKET hSock;
+    HANDLE hThread;
     HANDLE hWait;
     HANDLE hEvent;
 
@@ -179,6 +184,7 @@ class ListenOverlapped : public SafeDelete
 
     Listener &listener;
     SOCKET hSock;
+    HANDLE hThread;
     HANDLE hWait;
     HANDLE hEvent;
 
@@ -52,15 +52,64 @@ class ComParams
     static const char *WriteQueueLimitLst();
     long WriteQueueLimit() const { return writeQueueLimit; }
 
+    BOOL SetWriteFc(const char *pWriteFc);
+    static string WriteFcStr(BOOL writeCredit);
+    string WriteFcStr() const { return WriteFcStr(writeCredit); }
+    static const char *WriteFcLst();
+    BOOL WriteCredit() const { return writeCredit; }
+
+    BOOL SetCreditWindow(const char *pCreditWindow);
+    static string CreditWindowStr(long creditWindow);
+    string CreditWindowStr() const { return CreditWindowStr(creditWindow); }
+    static const char *CreditWindowLst();
+    long CreditWindow() const;
+
+    BOOL SetReadBufSize(const char *pReadBufSize);
+    static string ReadBufSizeStr(long readBufSizeMin, long readBufSizeMax);
+    string ReadBufSizeStr() const { return ReadBufSizeStr(readBufSizeMin, readBufSizeMax); }
+    static const char *ReadBufSizeLst();
+    long ReadBufSizeMin() const { return readBufSizeMin; }
+    long ReadBufSizeMax() const { return readBufSizeMax; }
+
+    BOOL SetReadCount(const char *pReadCount);
+    static string ReadCountStr(long readCount);
+    string ReadCountStr() const { return ReadCountStr(readCount); }
+    static const char *ReadCountLst();
+    long ReadCount() const { return readCount; }
+
+    BOOL SetBatchWindow(const char *pBatchWindow);
+    static string BatchWindowStr(long batchWindow);
+    string BatchWindowStr() const { return BatchWindowStr(batchWindow); }
+    static const char *BatchWindowLst();
+    long BatchWindow() const { return batchWindow; }
+
+    BOOL SetBatchBytes(const char *pBatchBytes);
+    static string BatchBytesStr(long batchBytes);
+    string BatchBytesStr() const { return BatchBytesStr(batchBytes); }
+    static const char *BatchBytesLst();
+    long BatchBytes() const { return batchBytes; }
+
     enum {
       rtDefault = -1,
       rtDisable = -2,
     };
 
+    enum {
+      cwDefault = -1,
+      cwMin = 64,
+    };
+
   private:
     char *pIF;
     int reconnectTime;
     long writeQueueLimit;
+    BOOL writeCredit;
+    long creditWindow;
+    long readBufSizeMin;
+    long readBufSizeMax;
+    long readCount;
+    long batchWindow;
+    long batchBytes;
 };
 ///////////////////////////////////////////////////////////////
 
@@ -100,9 +100,12 @@ namespace PortTcp {
 #include "comparams.h"
 #include "import.h"
 ///////////////////////////////////////////////////////////////
+#define MAX_WRITE_BUFS 64   // max number of pending buffers for one gather write
+///////////////////////////////////////////////////////////////
 Listener::Listener(const struct sockaddr_in &_snLocal)
   : snLocal(_snLocal),
-    hSockListen(INVALID_SOCKET)
+    hSockListen(INVALID_SOCKET),
+    hMasterPortBound(NULL)
 {
 }
 
@@ -113,6 +116,19 @@ void Listener::Push(ComPort *pPort)
   ports.push(pPort);
 }
 
+void Listener::Bind(HMASTERPORT hMasterPort)
+{
+  _ASSERTE(hMasterPort != NULL);
+
+  // the ports accepted by the same listener should run on the same thread
+
+  if (!hMasterPortBound)
+    hMasterPortBound = hMasterPort;
+  else
+  if (pBindPorts)
+    pBindPorts(hMasterPortBound, hMasterPort);
+}
+
 BOOL Listener::Start()
 {
   if (hSockListen != INVALID_SOCKET)
@@ -196,6 +212,7 @@ ComPort::ComPort(
     hSock(INVALID_SOCKET),
     isValid(TRUE),
     isConnected(FALSE),
+    countConnected(0),
     isDisconnected(FALSE),
     pendingListenerOnDisconnect(FALSE),
     connectionCounter(0),
@@ -205,17 +222,38 @@ ComPort::ComPort(
     name("TCP"),
     hMasterPort(NULL),
     countReadOverlapped(0),
+    readCount((int)comParams.ReadCount()),
+    readBufSize((DWORD)comParams.ReadBufSizeMin()),
+    readBufSizeMin((DWORD)comParams.ReadBufSizeMin()),
+    readBufSizeMax((DWORD)comParams.ReadBufSizeMax()),
+    readSeqStart(0),
+    readSeqDone(0),
+    batchWindow((DWORD)comParams.BatchWindow()),
+    batchBytes((DWORD)comParams.BatchBytes()),
+    hBatchTimer(NULL),
+    pBatchBuf(NULL),
+    lenBatchBuf(0),
     countXoff(0),
+    readCredited(FALSE),
+    readCredit(0),
+    readReserved(0),
     writeQueueLimit(comParams.WriteQueueLimit()),
     writeQueued(0),
+    writeCredit(comParams.WriteCredit()),
+    creditGranted(0),
     writeSuspended(FALSE),
+    writeSuspendedStart(0),
+    writeSuspendedTime(0),
     writeLost(0),
     writeLostTotal(0),
-    pWriteBuf(NULL),
-    lenWriteBuf(0)
+    writeCopySaved(0),
+    writeCopySavedTotal(0),
+    lenWriteBuf(0),
+    writeBufQueued(0)
 {
   writeQueueLimitSendXoff = (writeQueueLimit*2)/3;
   writeQueueLimitSendXon = writeQueueLimit/3;
+  creditWindow = (DWORD)comParams.CreditWindow();
 
   string path(pPath);
 
@@ -321,6 +359,16 @@ BOOL ComPort::Init(HMASTERPORT _hMasterPort)
 {
   hMasterPort = _hMasterPort;
 
+  if (pStatAdd) {
+    pStatAdd(hMasterPort, "write_queued_bytes", HUB_STAT_TYPE_GAUGE, &writeQueued);
+    pStatAdd(hMasterPort, "write_lost_bytes_total", HUB_STAT_TYPE_COUNTER, &writeLostTotal);
+    pStatAdd(hMasterPort, "write_suspended_ms_total", HUB_STAT_TYPE_COUNTER, &writeSuspendedTime);
+    pStatAdd(hMasterPort, "connects_total", HUB_STAT_TYPE_COUNTER, &countConnected);
+  }
+
+  if (pListener)
+    pListener->Bind(hMasterPort);
+
   return isValid;
 }
 
@@ -328,6 +376,8 @@ BOOL ComPort::Start()
 {
   _ASSERTE(hMasterPort != NULL);
 
+  CreditUpdate();
+
   if (pListener) {
     return pListener->Start();
   } else {
@@ -340,27 +390,43 @@ BOOL ComPort::Start()
 
 BOOL ComPort::StartRead()
 {
-  if (countReadOverlapped)
-    return TRUE;
+  while (countReadOverlapped < readCount && CanRead()) {
+    if (hSock == INVALID_SOCKET)
+      return FALSE;
 
-  if (hSock == INVALID_SOCKET)
-    return FALSE;
+    ReadOverlapped *pOverlapped;
 
-  ReadOverlapped *pOverlapped;
+    pOverlapped = new ReadOverlapped(*this);
 
-  pOverlapped = new ReadOverlapped(*this);
+    if (!pOverlapped)
+      return FALSE;
 
-  if (!pOverlapped)
-    return FALSE;
+    if (!StartRead(pOverlapped)) {
+      delete pOverlapped;
+      return FALSE;
+    }
 
-  if (!pOverlapped->StartRead()) {
-    delete pOverlapped;
-    return FALSE;
+    countReadOverlapped++;
+
+    //cout << "Started Read " << name << " " << countReadOverlapped << endl;
   }
 
-  countReadOverlapped++;
+  return TRUE;
+}
+
+BOOL ComPort::StartRead(ReadOverlapped *pOverlapped)
+{
+  DWORD size = ReadSize();
+
+  if (!size || !pOverlapped->StartRead(readSeqStart, size))
+    return FALSE;
+
+  // the credit is reserved till the read is completed so the
+  // outstanding reads can't get more than the credit allows
+
+  readReserved += (LONG)size;
 
-  //cout << "Started Read " << name << " " << countReadOverlapped << endl;
+  readSeqStart++;
 
   return TRUE;
 }
@@ -378,6 +444,10 @@ BOOL ComPort::FakeReadFilter(HUB_MSG *pInMsg)
         if (CanConnect())
           StartConnect();
       }
+      else
+      if (pInMsg->u.hv2.hVal1 == hBatchTimer) {
+        FlushBatch();
+      }
 
       // discard owned tick
       if (!pMsgReplaceNone(pInMsg, HUB_MSG_TYPE_EMPTY))
@@ -436,26 +506,85 @@ void ComPort::FlowControlUpdate()
   if (writeSuspended) {
     if (writeQueued <= writeQueueLimitSendXon) {
       writeSuspended = FALSE;
+      writeSuspendedTime += GetTickCount() - writeSuspendedStart;
 
       HUB_MSG msg;
 
       msg.type = HUB_MSG_TYPE_ADD_XOFF_XON;
       msg.u.val = FALSE;
 
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
     }
   } else {
     if (writeQueued > writeQueueLimitSendXoff) {
       writeSuspended = TRUE;
+      writeSuspendedStart = GetTickCount();
 
       HUB_MSG msg;
 
       msg.type = HUB_MSG_TYPE_ADD_XOFF_XON;
       msg.u.val = TRUE;
 
-      pOnRead(hMasterPort, &msg);
+      OnReadMsg(&msg);
     }
   }
+
+  CreditUpdate();
+}
+
+void ComPort::CreditUpdate()
+{
+  if (!creditWindow)
+    return;
+
+  DWORD credit = writeQueued < creditWindow ? creditWindow - writeQueued : 0;
+
+  // grant the freed space by quarters of the window (or all of it
+  // on draining) to not send a message per each write
+
+  if (credit <= creditGranted)
+    return;
+
+  if (credit - creditGranted < creditWindow/4 && credit < creditWindow)
+    return;
+
+  creditGranted = credit;
+
+  HUB_MSG msg;
+
+  msg.type = HUB_MSG_TYPE_CREDIT;
+  msg.u.val = credit;
+
+  OnReadMsg(&msg);
+}
+
+DWORD ComPort::ReadSize() const
+{
+  // do not read more than the credit not reserved by other reads allows
+
+  if (readCredited) {
+    LONG free = readCredit - readReserved;
+
+    if (free <= 0)
+      return 0;
+
+    if ((DWORD)free < readBufSize)
+      return (DWORD)free;
+  }
+
+  return readBufSize;
+}
+
+static LONGLONG WriteQueuedCounter()
+{
+  if (!pWriteLatency)
+    return 0;
+
+  LARGE_INTEGER li;
+
+  ::QueryPerformanceCounter(&li);
+
+  return li.QuadPart;
 }
 
 BOOL ComPort::Write(HUB_MSG *pMsg)
@@ -472,54 +601,67 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
     if (!len)
       return TRUE;
 
+    // the data consumes the granted credit
+
+    creditGranted = creditGranted > len ? creditGranted - len : 0;
+
     BYTE *pBuf = pMsg->u.buf.pBuf;
 
     if (!pBuf) {
       writeLost += len;
+      CreditUpdate();
       return FALSE;
     }
 
     if (hSock == INVALID_SOCKET || isDisconnected) {
       writeLost += len;
+      CreditUpdate();
       return FALSE;
     }
 
-    if (writeQueued > writeQueueLimit) {
-      if (lenWriteBuf) {
-        _ASSERTE(pWriteBuf != NULL);
+    if (writeQueued > writeQueueLimit)
+      PurgeWrite();
 
-        writeLost += lenWriteBuf;
-        writeQueued -= lenWriteBuf;
-        lenWriteBuf = 0;
-        pBufFree(pWriteBuf);
-        pWriteBuf = NULL;
-      }
-    }
+    if (!lenWriteBuf)
+      writeBufQueued = WriteQueuedCounter();
 
-    if (isConnected && writeOverlappedBuf.size()) {
-      _ASSERTE(pWriteBuf == NULL);
-      _ASSERTE(lenWriteBuf == 0);
+    if (writeBufs.size() < MAX_WRITE_BUFS) {
+      WSABUF wsaBuf;
 
-      WriteOverlapped *pOverlapped = writeOverlappedBuf.front();
+      wsaBuf.buf = (CHAR *)pBuf;
+      wsaBuf.len = len;
 
-      _ASSERTE(pOverlapped != NULL);
+      writeBufs.push_back(wsaBuf);
+      pMsg->type = HUB_MSG_TYPE_EMPTY;  // detach pBuf
+
+      if (!isConnected || writeOverlappedBuf.empty())
+        writeCopySaved += len;  // it would be appended to the pending data
+    } else {
+      WSABUF &wsaBuf = writeBufs.back();
+      DWORD lenLast = wsaBuf.len;
 
-      if (!pOverlapped->StartWrite(pBuf, len)) {
-        writeLost += len;
+      pBufAppend((BYTE **)&wsaBuf.buf, lenLast, pBuf, len);
+
+      if (!wsaBuf.buf) {
+        writeBufs.pop_back();
+        writeQueued -= lenLast;
+        lenWriteBuf -= lenLast;
+        writeLost += lenLast + len;
         FlowControlUpdate();
         return FALSE;
       }
 
-      writeOverlappedBuf.pop();
-      pMsg->type = HUB_MSG_TYPE_EMPTY;  // detach pBuf
-    } else {
-      _ASSERTE((pWriteBuf == NULL && lenWriteBuf == 0) || (pWriteBuf != NULL && lenWriteBuf != 0));
-
-      pBufAppend(&pWriteBuf, lenWriteBuf, pBuf, len);
-      lenWriteBuf += len;
+      wsaBuf.len += len;
     }
 
+    lenWriteBuf += len;
     writeQueued += len;
+
+    if (isConnected && !StartWrite()) {
+      FlowControlUpdate();
+      return FALSE;
+    }
+
     FlowControlUpdate();
 
     //cout << "Started Write " << name << " " << len << " " << writeQueued << endl;
@@ -565,10 +707,17 @@ BOOL ComPort::Write(HUB_MSG *pMsg)
     if (pMsg->u.val) {
       countXoff++;
     } else {
-      if (--countXoff == 0 && isConnected)
+      if (--countXoff == 0 && isConnected && CanRead())
         StartRead();
     }
     break;
+  case HUB_MSG_T2N(HUB_MSG_TYPE_CREDIT):
+    readCredited = TRUE;
+    readCredit = (LONG)pMsg->u.val;
+
+    if (isConnected && CanRead())
+      StartRead();
+    break;
   }
 
   return TRUE;
@@ -605,47 +754,115 @@ void ComPort::OnWrite(WriteOverlapped *pOverlapped, DWORD len, DWORD done)
 
   writeQueued -= len;
 
-  _ASSERTE(pWriteBuf != NULL || lenWriteBuf == 0);
-  _ASSERTE(pWriteBuf == NULL || lenWriteBuf != 0);
+  if (pWriteLatency)
+    pWriteLatency(hMasterPort, pOverlapped->Queued());
 
-  if (lenWriteBuf &&
-      isConnected &&
-      !isDisconnected &&
-      hSock != INVALID_SOCKET)
-  {
-    if (!pOverlapped->StartWrite(pWriteBuf, lenWriteBuf)) {
-      writeOverlappedBuf.push(pOverlapped);
+  writeOverlappedBuf.push(pOverlapped);
 
-      writeLost += lenWriteBuf;
-      writeQueued -= lenWriteBuf;
-      pBufFree(pWriteBuf);
-    }
+  if (isConnected && !isDisconnected && hSock != INVALID_SOCKET)
+    StartWrite();
 
-    lenWriteBuf = 0;
-    pWriteBuf = NULL;
-  } else {
-    writeOverlappedBuf.push(pOverlapped);
+  FlowControlUpdate();
+}
+
+BOOL ComPort::StartWrite()
+{
+  _ASSERTE((writeBufs.empty() && lenWriteBuf == 0) || (!writeBufs.empty() && lenWriteBuf != 0));
+
+  if (writeBufs.empty() || writeOverlappedBuf.empty())
+    return TRUE;
+
+  WriteOverlapped *pOverlapped = writeOverlappedBuf.front();
+
+  _ASSERTE(pOverlapped != NULL);
+
+  if (!pOverlapped->StartWrite(writeBufs, writeBufQueued)) {
+    PurgeWrite();
+    return FALSE;
   }
 
-  FlowControlUpdate();
+  writeOverlappedBuf.pop();
+  lenWriteBuf = 0;
+
+  return TRUE;
+}
+
+void ComPort::PurgeWrite()
+{
+  if (!lenWriteBuf)
+    return;
+
+  for (vector<WSABUF>::const_iterator i = writeBufs.begin() ; i != writeBufs.end() ; i++)
+    pBufFree((BYTE *)i->buf);
+
+  writeBufs.clear();
+
+  writeLost += lenWriteBuf;
+  writeQueued -= lenWriteBuf;
+  lenWriteBuf = 0;
 }
 
 void ComPort::OnRead(ReadOverlapped *pOverlapped, BYTE *pBuf, DWORD done)
 {
-  HUB_MSG msg;
+  if (pOverlapped->Seq() != readSeqDone) {
+    // completed before some previously started reads, so hold it
 
-  msg.type = HUB_MSG_TYPE_LINE_DATA;
-  msg.u.buf.pBuf = pBuf;
-  msg.u.buf.size = done;
+    ReadDone &readDone = readDoneHeld[pOverlapped->Seq()];
 
-  pOnRead(hMasterPort, &msg);
+    readDone.pOverlapped = pOverlapped;
+    readDone.pBuf = pBuf;
+    readDone.done = done;
+
+    return;
+  }
+
+  for (;;) {
+    readSeqDone++;
+
+    OnReadDone(pOverlapped, pBuf, done);
+
+    ReadDoneMap::iterator i = readDoneHeld.find(readSeqDone);
+
+    if (i == readDoneHeld.end())
+      break;
+
+    pOverlapped = i->second.pOverlapped;
+    pBuf = i->second.pBuf;
+    done = i->second.done;
+
+    readDoneHeld.erase(i);
+  }
+}
+
+void ComPort::OnReadDone(ReadOverlapped *pOverlapped, BYTE *pBuf, DWORD done)
+{
+  UpdateReadBufSize(done, pOverlapped->Size());
+
+  if (batchWindow) {
+    BatchRead(pBuf, done);
+  } else {
+    HUB_MSG msg;
+
+    msg.type = HUB_MSG_TYPE_LINE_DATA;
+    msg.u.buf.pBuf = pBuf;
+    msg.u.buf.size = done;
+
+    pOnRead(hMasterPort, &msg);
+  }
 
   if (done == 0 && isDisconnected) {
     isDisconnected = FALSE;
     OnDisconnect();
   }
 
-  if (countXoff > 0 || !isConnected || !pOverlapped->StartRead()) {
+  readReserved -= (LONG)pOverlapped->Size();
+
+  _ASSERTE(readReserved >= 0);
+
+  if (readCredited)
+    readCredit -= (LONG)done;
+
+  if (!CanRead() || !isConnected || !StartRead(pOverlapped)) {
     _ASSERTE(countReadOverlapped > 0);
 
     delete pOverlapped;
@@ -653,20 +870,102 @@ void ComPort::OnRead(ReadOverlapped *pOverlapped, BYTE *pBuf, DWORD done)
   }
 }
 
+void ComPort::UpdateReadBufSize(DWORD done, DWORD size)
+{
+  if (readBufSizeMax <= readBufSizeMin)
+    return;
+
+  if (done >= size) {
+    // get all the data available in the socket by the next read
+
+    u_long available = 0;
+
+    if (hSock != INVALID_SOCKET && ::ioctlsocket(hSock, FIONREAD, &available) == 0 && available > readBufSize*2)
+      readBufSize = available;
+    else
+      readBufSize *= 2;
+
+    if (readBufSize > readBufSizeMax)
+      readBufSize = readBufSizeMax;
+  }
+  else
+  if (done < readBufSize/4) {
+    if (readBufSize > readBufSizeMin) {
+      readBufSize /= 2;
+
+      if (readBufSize < readBufSizeMin)
+        readBufSize = readBufSizeMin;
+    }
+  }
+}
+
+void ComPort::OnReadMsg(HUB_MSG *pMsg)
+{
+  // keep the order of batched data and other messages
+
+  FlushBatch();
+
+  pOnRead(hMasterPort, pMsg);
+}
+
+void ComPort::BatchRead(BYTE *pBuf, DWORD done)
+{
+  if (!pBatchBuf) {
+    pBatchBuf = pBuf;
+    lenBatchBuf = done;
+
+    if (!hBatchTimer)
+      hBatchTimer = pTimerCreate((HTIMEROWNER)this);
+
+    LARGE_INTEGER dueTime;
+
+    dueTime.QuadPart = -10LL * batchWindow;
+
+    if (!hBatchTimer || !pTimerSet(hBatchTimer, hMasterPort, &dueTime, 0, (HTIMERPARAM)hBatchTimer)) {
+      FlushBatch();
+      return;
+    }
+  } else {
+    pBufAppend(&pBatchBuf, lenBatchBuf, pBuf, done);
+    pBufFree(pBuf);
+
+    if (pBatchBuf) {
+      lenBatchBuf += done;
+    } else {
+      cerr << name << " Read batch lost " << (lenBatchBuf + done) << " bytes" << endl;
+      lenBatchBuf = 0;
+      return;
+    }
+  }
+
+  if (batchBytes && lenBatchBuf >= batchBytes)
+    FlushBatch();
+}
+
+void ComPort::FlushBatch()
+{
+  if (!pBatchBuf)
+    return;
+
+  HUB_MSG msg;
+
+  msg.type = HUB_MSG_TYPE_LINE_DATA;
+  msg.u.buf.pBuf = pBatchBuf;
+  msg.u.buf.size = lenBatchBuf;
+
+  pBatchBuf = NULL;
+  lenBatchBuf = 0;
+
+  pOnRead(hMasterPort, &msg);
+}
+
 void ComPort::OnDisconnect()
 {
   Close(name.c_str(), hSock);
   hSock = INVALID_SOCKET;
 
   if (lenWriteBuf) {
-    _ASSERTE(pWriteBuf != NULL);
-
-    writeLost += lenWriteBuf;
-    writeQueued -= lenWriteBuf;
-    lenWriteBuf = 0;
-    pBufFree(pWriteBuf);
-    pWriteBuf = NULL;
-
+    PurgeWrite();
     FlowControlUpdate();
   }
 
@@ -680,7 +979,7 @@ void ComPort::OnDisconnect()
     msg.type = HUB_MSG_TYPE_CONNECT;
     msg.u.val = FALSE;
 
-    pOnRead(hMasterPort, &msg);
+    OnReadMsg(&msg);
   }
 
   if (pListener) {
@@ -746,27 +1045,14 @@ void ComPort::OnConnect()
   cout << name << ": Connected" << endl;
 
   isConnected = TRUE;
+  countConnected++;
 
-  if (countXoff <= 0)
+  if (CanRead())
     StartRead();
 
-  if (lenWriteBuf && writeOverlappedBuf.size()) {
-    WriteOverlapped *pOverlapped = writeOverlappedBuf.front();
-
-    _ASSERTE(pOverlapped != NULL);
-
-    if (pOverlapped->StartWrite(pWriteBuf, lenWriteBuf)) {
-      writeOverlappedBuf.pop();
-    } else {
-      writeLost += lenWriteBuf;
-      writeQueued -= lenWriteBuf;
-      pBufFree(pWriteBuf);
-
-      FlowControlUpdate();
-    }
-
-    lenWriteBuf = 0;
-    pWriteBuf = NULL;
+  if (lenWriteBuf) {
+    StartWrite();
+    FlowControlUpdate();
   }
 
   HUB_MSG msg;
@@ -774,15 +1060,36 @@ void ComPort::OnConnect()
   msg.type = HUB_MSG_TYPE_CONNECT;
   msg.u.val = TRUE;
 
-  pOnRead(hMasterPort, &msg);
+  OnReadMsg(&msg);
 }
 
 void ComPort::LostReport()
 {
+  if (writeSuspended) {
+    DWORD now = GetTickCount();
+
+    writeSuspendedTime += now - writeSuspendedStart;
+    writeSuspendedStart = now;
+  }
+
   if (writeLost) {
     writeLostTotal += writeLost;
     cout << "Write lost " << name << ": " << writeLost << ", total " << writeLostTotal << endl;
+
+    HUB_MSG msg;
+
+    msg.type = HUB_MSG_TYPE_LOST;
+    msg.u.val = writeLost;
+
     writeLost = 0;
+
+    OnReadMsg(&msg);
+  }
+
+  if (writeCopySaved) {
+    writeCopySavedTotal += writeCopySaved;
+    cout << "Write copy saved " << name << ": " << writeCopySaved << ", total " << writeCopySavedTotal << endl;
+    writeCopySaved = 0;
   }
 }
 ///////////////////////////////////////////////////////////////
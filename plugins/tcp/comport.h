@@ -86,6 +86,7 @@ class Listener
     }
 
     void Push(ComPort *pPort);
+    void Bind(HMASTERPORT hMasterPort);
     BOOL Start();
     BOOL OnEvent(ListenOverlapped *pOverlapped, long e, int err);
     void OnDisconnect(ComPort *pPort);
@@ -94,6 +95,7 @@ class Listener
   private:
     struct sockaddr_in snLocal;
     SOCKET hSockListen;
+    HMASTERPORT hMasterPortBound;
     priority_queue<ComPortPtr> ports;
 };
 ///////////////////////////////////////////////////////////////
@@ -123,12 +125,23 @@ class ComPort
 
   private:
     void FlowControlUpdate();
+    void CreditUpdate();
+    BOOL CanRead() const { return countXoff <= 0 && (!readCredited || readCredit > readReserved); }
+    DWORD ReadSize() const;
+    BOOL StartWrite();
+    void PurgeWrite();
     BOOL CanConnect() const { return (permanent || connectionCounter > 0); }
     void StartConnect();
     BOOL StartRead();
+    BOOL StartRead(ReadOverlapped *pOverlapped);
+    void OnReadDone(ReadOverlapped *pOverlapped, BYTE *pBuf, DWORD done);
+    void UpdateReadBufSize(DWORD done, DWORD size);
     BOOL StartWaitEvent(SOCKET hSockWait);
     void OnConnect();
     void OnDisconnect();
+    void OnReadMsg(HUB_MSG *pMsg);
+    void BatchRead(BYTE *pBuf, DWORD done);
+    void FlushBatch();
 
     struct sockaddr_in snLocal;
     struct sockaddr_in snRemote;
@@ -141,6 +154,7 @@ class ComPort
 
     SOCKET hSock;
     BOOL isConnected;
+    DWORD countConnected;
     BOOL isDisconnected;
     BOOL pendingListenerOnDisconnect;
     int connectionCounter;
@@ -153,19 +167,55 @@ class ComPort
     HMASTERPORT hMasterPort;
 
     int countReadOverlapped;
+    int readCount;
+
+    DWORD readBufSize;
+    DWORD readBufSizeMin;
+    DWORD readBufSizeMax;
+
+    struct ReadDone {
+      ReadOverlapped *pOverlapped;
+      BYTE *pBuf;
+      DWORD done;
+    };
+
+    typedef map<DWORD, ReadDone> ReadDoneMap;
+
+    // the reads are numbered on starting and passed in this order
+
+    DWORD readSeqStart;
+    DWORD readSeqDone;
+    ReadDoneMap readDoneHeld;
+
+    DWORD batchWindow;
+    DWORD batchBytes;
+    HMASTERTIMER hBatchTimer;
+    BYTE *pBatchBuf;
+    DWORD lenBatchBuf;
     int countXoff;
+    BOOL readCredited;
+    LONG readCredit;
+    LONG readReserved;            // the credit of the started reads
 
     DWORD writeQueueLimit;
     DWORD writeQueueLimitSendXoff;
     DWORD writeQueueLimitSendXon;
     DWORD writeQueued;
+    BOOL writeCredit;
+    DWORD creditWindow;
+    DWORD creditGranted;
     BOOL writeSuspended;
+    DWORD writeSuspendedStart;
+    DWORD writeSuspendedTime;
     DWORD writeLost;
     DWORD writeLostTotal;
+    DWORD writeCopySaved;
+    DWORD writeCopySavedTotal;
 
     queue<WriteOverlapped *> writeOverlappedBuf;
-    BYTE *pWriteBuf;
+    vector<WSABUF> writeBufs;
     DWORD lenWriteBuf;
+    LONGLONG writeBufQueued;
 };
 ///////////////////////////////////////////////////////////////
 inline bool ComPortPtr::operator<(const ComPortPtr &p) const
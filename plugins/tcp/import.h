@@ -51,6 +51,9 @@ extern ROUTINE_BUF_ALLOC *pBufAlloc;
 extern ROUTINE_BUF_FREE *pBufFree;
 extern ROUTINE_BUF_APPEND *pBufAppend;
 extern ROUTINE_ON_READ *pOnRead;
+extern ROUTINE_WRITE_LATENCY *pWriteLatency;
+extern ROUTINE_STAT_ADD_A *pStatAdd;
+extern ROUTINE_BIND_PORTS *pBindPorts;
 extern ROUTINE_TIMER_CREATE *pTimerCreate;
 extern ROUTINE_TIMER_SET *pTimerSet;
 ///////////////////////////////////////////////////////////////
@@ -137,6 +137,41 @@ static void CALLBACK Help(const char *pProgPath)
   << "                             where <s> is " << ComParams::WriteQueueLimitLst() << ". The queue" << endl
   << "                             will be purged with data lost on overruning." << endl
   << "                             The value 0 will disable writing to the port." << endl
+  << "  --write-fc=<m>           - set flow control of the write queue to <m> (" << ComParams().WriteFcStr() << endl
+  << "                             by default), where <m> is " << ComParams::WriteFcLst() << "." << endl
+  << "                             With xoff the ports routing data to the port are" << endl
+  << "                             stopped by XOFF sent on filling 2/3 of the write" << endl
+  << "                             queue and started by XON sent on draining to 1/3" << endl
+  << "                             of it. With credit the port also grants the free" << endl
+  << "                             space of the credit window to the ports routing" << endl
+  << "                             data to it and they read not more than granted." << endl
+  << "  --write-credit=<s>       - set credit window to <s> (" << ComParams().CreditWindowStr() << " by" << endl
+  << "                             default), where <s> is " << ComParams::CreditWindowLst() << "." << endl
+  << "                             The window is not greater than the write queue" << endl
+  << "                             limit. Used with --write-fc=credit only." << endl
+  << "  --read-buf=<min>[,<max>] - set read buffer size to <min> bytes (" << ComParams().ReadBufSizeStr() << " by" << endl
+  << "                             default), where <min> and <max> are " << ComParams::ReadBufSizeLst() << "." << endl
+  << "                             If <max> is greater than <min> then the size will" << endl
+  << "                             be doubled on each full read (or increased up to" << endl
+  << "                             the size of data available in the socket) up to" << endl
+  << "                             <max> and halved on each read filled less than a" << endl
+  << "                             quarter down to <min>." << endl
+  << "  --read-count=<n>         - set number of outstanding reads to <n> (" << ComParams().ReadCountStr() << " by" << endl
+  << "                             default), where <n> is " << ComParams::ReadCountLst() << ". The data of" << endl
+  << "                             completed reads is passed in the order of the" << endl
+  << "                             reads starting." << endl
+  << "  --batch-window=<t>       - set read batching window to <t> (" << ComParams().BatchWindowStr() << " by default)," << endl
+  << "                             where <t> is " << ComParams::BatchWindowLst() << "." << endl
+  << "                             If <t> is not 0 then the data of consecutive reads" << endl
+  << "                             will be coalesced and passed to the filters and" << endl
+  << "                             routed as one message not later than <t>" << endl
+  << "                             microseconds after the first read. It gives fewer" << endl
+  << "                             filter calls for many small packets at the cost" << endl
+  << "                             of bounded latency." << endl
+  << "  --batch-bytes=<s>        - pass the coalesced data not waiting for the end of" << endl
+  << "                             batching window if at least <s> bytes collected" << endl
+  << "                             (" << ComParams().BatchBytesStr() << " by default), where <s> is " << ComParams::BatchBytesLst() << "." << endl
+  << "                             The value 0 means no limit." << endl
   << endl
   << "Output data stream description:" << endl
   << "  LINE_DATA(<data>) - send <data> to remote host." << endl
@@ -249,6 +284,42 @@ static BOOL CALLBACK Config(
       cerr << "Invalid write limit value in " << pArg << endl;
       exit(1);
     }
+  } else
+  if ((pParam = GetParam(pArg, "--write-fc=")) != NULL) {
+    if (!comParams.SetWriteFc(pParam)) {
+      cerr << "Invalid write flow control value in " << pArg << endl;
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--write-credit=")) != NULL) {
+    if (!comParams.SetCreditWindow(pParam)) {
+      cerr << "Invalid credit window value in " << pArg << endl;
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--read-buf=")) != NULL) {
+    if (!comParams.SetReadBufSize(pParam)) {
+      cerr << "Invalid read buffer size value in " << pArg << endl;
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--read-count=")) != NULL) {
+    if (!comParams.SetReadCount(pParam)) {
+      cerr << "Invalid read count value in " << pArg << endl;
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--batch-window=")) != NULL) {
+    if (!comParams.SetBatchWindow(pParam)) {
+      cerr << "Invalid batching window value in " << pArg << endl;
+      exit(1);
+    }
+  } else
+  if ((pParam = GetParam(pArg, "--batch-bytes=")) != NULL) {
+    if (!comParams.SetBatchBytes(pParam)) {
+      cerr << "Invalid batching bytes value in " << pArg << endl;
+      exit(1);
+    }
   } else {
     return FALSE;
   }
@@ -377,6 +448,9 @@ ROUTINE_BUF_ALLOC *pBufAlloc;
 ROUTINE_BUF_FREE *pBufFree;
 ROUTINE_BUF_APPEND *pBufAppend;
 ROUTINE_ON_READ *pOnRead;
+ROUTINE_WRITE_LATENCY *pWriteLatency;
+ROUTINE_STAT_ADD_A *pStatAdd;
+ROUTINE_BIND_PORTS *pBindPorts;
 ROUTINE_TIMER_CREATE *pTimerCreate;
 ROUTINE_TIMER_SET *pTimerSet;
 ///////////////////////////////////////////////////////////////
@@ -400,6 +474,9 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
   pBufFree = pHubRoutines->pBufFree;
   pBufAppend = pHubRoutines->pBufAppend;
   pOnRead = pHubRoutines->pOnRead;
+  pWriteLatency = ROUTINE_GET(pHubRoutines, pWriteLatency);
+  pStatAdd = ROUTINE_GET(pHubRoutines, pStatAdd);
+  pBindPorts = ROUTINE_GET(pHubRoutines, pBindPorts);
   pTimerCreate = pHubRoutines->pTimerCreate;
   pTimerSet = pHubRoutines->pTimerSet;
 
@@ -36,7 +36,9 @@
 #include <windows.h>
 #include <crtdbg.h>
 
+#include <vector>
 #include <queue>
+#include <map>
 #include <iostream>
 #include <sstream>
 
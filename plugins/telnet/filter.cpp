@@ -970,6 +970,7 @@ static const PLUGIN_ROUTINES_A *const plugins[] = {
   NULL
 };
 ///////////////////////////////////////////////////////////////
+ROUTINE_BUF_FREE *pBufFree;
 ROUTINE_MSG_INSERT_VAL *pMsgInsertVal;
 ROUTINE_MSG_REPLACE_BUF *pMsgReplaceBuf;
 ROUTINE_MSG_INSERT_BUF *pMsgInsertBuf;
@@ -980,7 +981,8 @@ PLUGIN_INIT_A InitA;
 const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     const HUB_ROUTINES_A * pHubRoutines)
 {
-  if (!ROUTINE_IS_VALID(pHubRoutines, pMsgInsertVal) ||
+  if (!ROUTINE_IS_VALID(pHubRoutines, pBufFree) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pMsgInsertVal) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceBuf) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgInsertBuf) ||
       !ROUTINE_IS_VALID(pHubRoutines, pMsgReplaceNone) ||
@@ -996,6 +998,7 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
     return NULL;
   }
 
+  pBufFree = pHubRoutines->pBufFree;
   pMsgInsertVal = pHubRoutines->pMsgInsertVal;
   pMsgReplaceBuf = pHubRoutines->pMsgReplaceBuf;
   pMsgInsertBuf = pHubRoutines->pMsgInsertBuf;
@@ -37,6 +37,7 @@
 #define _IMPORT_H
 
 ///////////////////////////////////////////////////////////////
+extern ROUTINE_BUF_FREE *pBufFree;
 extern ROUTINE_MSG_INSERT_VAL *pMsgInsertVal;
 extern ROUTINE_MSG_REPLACE_BUF *pMsgReplaceBuf;
 extern ROUTINE_MSG_INSERT_BUF *pMsgInsertBuf;
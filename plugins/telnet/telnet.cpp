@@ -95,6 +95,10 @@ TelnetProtocol::TelnetProtocol(const char *pName)
 
   for(int i = 0 ; i < BYTE(-1) ; i++)
     options[i] = NULL;
+
+#ifdef _DEBUG
+  started = FALSE;
+#endif  /* _DEBUG */
 }
 
 TelnetProtocol::~TelnetProtocol()
@@ -142,33 +146,60 @@ HUB_MSG *TelnetProtocol::Flush(HUB_MSG *pMsg, BYTE_string &stream)
   return pMsg;
 }
 
+static const BYTE *FindByte(const BYTE *pBuf, const BYTE *pEnd, BYTE ch)
+{
+  const BYTE *pFound = (const BYTE *)memchr(pBuf, ch, pEnd - pBuf);
+
+  return pFound ? pFound : pEnd;
+}
+
 HUB_MSG *TelnetProtocol::Encode(HUB_MSG *pMsg)
 {
   _ASSERTE(started == TRUE);
   _ASSERTE(pMsg->type == HUB_MSG_TYPE_LINE_DATA);
 
-  DWORD len = pMsg->u.buf.size;
-  BYTE_string org(pMsg->u.buf.pBuf, len);
-  const BYTE *pBuf = org.data();
+  BOOL crPadding = (ascii_cr_padding.size() &&
+                    (options[0 /*TRANSMIT-BINARY*/] == NULL ||
+                     options[0 /*TRANSMIT-BINARY*/]->stateLocal != TelnetOption::osYes));
 
-  // discard original data from the stream
-  if (!pMsgReplaceBuf(pMsg, HUB_MSG_TYPE_LINE_DATA, NULL, 0))
-    return NULL;
+  BYTE *pOrg = pMsg->u.buf.pBuf;
+  const BYTE *pBuf = pOrg;
+  const BYTE *pEnd = pBuf + pMsg->u.buf.size;
+  const BYTE *pIac = FindByte(pBuf, pEnd, cdIAC);
+  const BYTE *pCr = crPadding ? FindByte(pBuf, pEnd, 13 /*CR*/) : pEnd;
 
-  for (; len ; len--) {
-    BYTE ch = *pBuf++;
+  // nothing to escape, so pass the original data as is
+  if (pIac == pEnd && pCr == pEnd && streamEncoded.empty())
+    return pMsg;
 
-    if (ch == cdIAC)
-      streamEncoded += ch;
+  // detach original data from the stream
+  pMsg->u.buf.pBuf = NULL;
+  pMsg->u.buf.size = 0;
+
+  for (;;) {
+    const BYTE *pSpecial = (pIac < pCr) ? pIac : pCr;
+
+    streamEncoded.append(pBuf, pSpecial - pBuf);
+
+    if (pSpecial == pEnd)
+      break;
+
+    BYTE ch = *pSpecial;
 
+    pBuf = pSpecial + 1;
     streamEncoded += ch;
 
-    if (ch == 13 /*CR*/ && ascii_cr_padding.size()) {
-      if (options[0 /*TRANSMIT-BINARY*/] == NULL || options[0 /*TRANSMIT-BINARY*/]->stateLocal != TelnetOption::osYes)
-        streamEncoded += ascii_cr_padding;
+    if (ch == cdIAC) {
+      streamEncoded += ch;
+      pIac = FindByte(pBuf, pEnd, cdIAC);
+    } else {
+      streamEncoded += ascii_cr_padding;
+      pCr = FindByte(pBuf, pEnd, 13 /*CR*/);
     }
   }
 
+  pBufFree(pOrg);
+
   return FlushEncodedStream(pMsg);
 }
 
@@ -185,15 +216,29 @@ HUB_MSG *TelnetProtocol::Decode(HUB_MSG *pMsg)
   _ASSERTE(started == TRUE);
   _ASSERTE(pMsg->type == HUB_MSG_TYPE_LINE_DATA);
 
-  DWORD len = pMsg->u.buf.size;
-  BYTE_string org(pMsg->u.buf.pBuf, len);
-  const BYTE *pBuf = org.data();
+  BYTE *pOrg = pMsg->u.buf.pBuf;
+  const BYTE *pBuf = pOrg;
+  const BYTE *pEnd = pBuf + pMsg->u.buf.size;
+
+  // no commands, so pass the original data as is
+  if (state == stData && streamDecoded.empty() && FindByte(pBuf, pEnd, cdIAC) == pEnd)
+    return pMsg;
+
+  // detach original data from the stream
+  pMsg->u.buf.pBuf = NULL;
+  pMsg->u.buf.size = 0;
 
-  // discard original data from the stream
-  if (!pMsgReplaceBuf(pMsg, HUB_MSG_TYPE_LINE_DATA, NULL, 0))
-    return NULL;
+  while (pBuf < pEnd) {
+    if (state == stData) {
+      const BYTE *pIac = FindByte(pBuf, pEnd, cdIAC);
+
+      streamDecoded.append(pBuf, pIac - pBuf);
+      pBuf = pIac;
+
+      if (pBuf == pEnd)
+        break;
+    }
 
-  for (; len ; len--) {
     BYTE ch = *pBuf++;
 
     switch (state) {
@@ -295,8 +340,10 @@ HUB_MSG *TelnetProtocol::Decode(HUB_MSG *pMsg)
             if (!options[option] || !options[option]->OnSubNegotiation(params, &pMsg))
               cout << "  ignored" << endl;
 
-            if (!pMsg)
+            if (!pMsg) {
+              pBufFree(pOrg);
               return NULL;
+            }
 
             state = stData;
             break;
@@ -308,6 +355,8 @@ HUB_MSG *TelnetProtocol::Decode(HUB_MSG *pMsg)
     }
   }
 
+  pBufFree(pOrg);
+
   return FlushDecodedStream(pMsg);
 }
 
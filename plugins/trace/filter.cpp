@@ -84,6 +84,10 @@
 ///////////////////////////////////////////////////////////////
 namespace FilterTrace {
 ///////////////////////////////////////////////////////////////
+#include "print.h"
+#include "recorder.h"
+#include "tracebin.h"
+///////////////////////////////////////////////////////////////
 #ifndef _DEBUG
   #define DEBUG_PARAM(par)
 #else   /* _DEBUG */
@@ -93,8 +97,8 @@ namespace FilterTrace {
 static ROUTINE_PORT_NAME_A *pPortName = NULL;
 static ROUTINE_FILTER_NAME_A *pFilterName = NULL;
 static ROUTINE_FILTERPORT *pFilterPort;
-///////////////////////////////////////////////////////////////
-static void PrintTime(ostream &tout);
+static ROUTINE_GET_FILTER *pGetFilter;
+static ROUTINE_BIND_PORTS *pBindPorts = NULL;
 ///////////////////////////////////////////////////////////////
 const char *GetParam(const char *pArg, const char *pPattern)
 {
@@ -108,25 +112,66 @@ const char *GetParam(const char *pArg, const char *pPattern)
 ///////////////////////////////////////////////////////////////
 class TraceConfig {
   public:
-    TraceConfig() : pTraceStream(NULL) {}
+    TraceConfig() : binary(FALSE), recorderSize(0), pTraceStream(NULL), pTraceSink(NULL) {}
 
     void SetTracePath(const char *pPath);
+    BOOL SetTraceFormat(const char *pFormat);
+    BOOL SetRecorderSize(const char *pSize);
+    BOOL IsBinary() const { return binary; }
+    DWORD RecorderSize() const { return recorderSize; }
     ostream *GetTraceStream();
+    TraceSink *GetTraceSink();
     void PrintToAllTraceStreams(const char *pStr);
     stringstream buf;
 
   private:
     string path;
+    BOOL binary;
+    DWORD recorderSize;
     ostream *pTraceStream;
+    TraceSink *pTraceSink;
 
     typedef set<ostream*> Streams;
+    typedef set<TraceSink*> Sinks;
 
     Streams traceStreams;
+    Sinks traceSinks;
 };
 
 void TraceConfig::SetTracePath(const char *pPath) {
   path = pPath;
   pTraceStream = NULL;
+  pTraceSink = NULL;
+}
+
+BOOL TraceConfig::SetTraceFormat(const char *pFormat) {
+  if (_stricmp(pFormat, "text") == 0) {
+    binary = FALSE;
+  }
+  else
+  if (_stricmp(pFormat, "binary") == 0) {
+    binary = TRUE;
+  }
+  else {
+    return FALSE;
+  }
+
+  pTraceStream = NULL;
+  pTraceSink = NULL;
+
+  return TRUE;
+}
+
+BOOL TraceConfig::SetRecorderSize(const char *pSize) {
+  char *pEnd;
+  unsigned long size = strtoul(pSize, &pEnd, 0);
+
+  if (*pEnd || (size && size < RECORDER_SIZE_MIN) || size > 0x3FFFFF)
+    return FALSE;
+
+  recorderSize = (DWORD)size*1024;
+
+  return TRUE;
 }
 
 ostream *TraceConfig::GetTraceStream() {
@@ -156,10 +201,29 @@ ostream *TraceConfig::GetTraceStream() {
   return pTraceStream;
 }
 
+TraceSink *TraceConfig::GetTraceSink() {
+  if (pTraceSink)
+    return pTraceSink;
+
+  if (path.empty()) {
+    cerr << "The binary trace format requires --trace-file=<path>" << endl;
+    exit(1);
+  }
+
+  pTraceSink = TraceSink::Open(path.c_str());
+
+  traceSinks.insert(pTraceSink);
+
+  return pTraceSink;
+}
+
 void TraceConfig::PrintToAllTraceStreams(const char *pStr)
 {
   for (Streams::const_iterator iS = traceStreams.begin() ; iS != traceStreams.end() ; iS++)
     (**iS) << pStr;
+
+  for (Sinks::const_iterator iS = traceSinks.begin() ; iS != traceSinks.end() ; iS++)
+    (*iS)->Text(pStr);
 }
 ///////////////////////////////////////////////////////////////
 class Valid {
@@ -178,6 +242,8 @@ class Filter : public Valid {
     const char *FilterName() const { return pName; }
 
     ostream *pTraceStream;
+    TraceSink *pTraceSink;
+    DWORD recorderSize;
 
   private:
     const char *pName;
@@ -185,7 +251,9 @@ class Filter : public Valid {
 
 Filter::Filter(const char *_pName, TraceConfig &config, int argc, const char *const argv[])
   : pName(_pName),
-    pTraceStream(NULL)
+    pTraceStream(NULL),
+    pTraceSink(NULL),
+    recorderSize(config.RecorderSize())
 {
   for (const char *const *pArgs = &argv[1] ; argc > 1 ; pArgs++, argc--) {
     const char *pArg = GetParam(*pArgs, "--");
@@ -202,7 +270,11 @@ Filter::Filter(const char *_pName, TraceConfig &config, int argc, const char *co
     }
   }
 
-  if (!pTraceStream)
+  // the flight recorder dumps in text format
+
+  if (config.IsBinary() && !recorderSize)
+    pTraceSink = config.GetTraceSink();
+  else
     pTraceStream = config.GetTraceStream();
 }
 ///////////////////////////////////////////////////////////////
@@ -233,6 +305,17 @@ static void CALLBACK Help(const char *pProgPath)
   << "Global options:" << endl
   << "  --trace-file=<path>   - redirect trace to <path>. Cancel redirection if" << endl
   << "                          <path> is empty." << endl
+  << "  --trace-format=<fmt>  - set trace format for the next created filters, where" << endl
+  << "                          <fmt> is text (default) or binary. The binary trace" << endl
+  << "                          is buffered and written by a background thread," << endl
+  << "                          it requires --trace-file=<path> and can be rendered" << endl
+  << "                          to text by tracefmt.exe <path>." << endl
+  << "  --trace-recorder=<KB> - set flight recorder mode for the next created filters" << endl
+  << "                          if <KB> is not 0 (default is 0). In this mode each" << endl
+  << "                          port keeps its last messages in a ring of <KB>" << endl
+  << "                          kilobytes (min " << RECORDER_SIZE_MIN << ") instead of tracing them and" << endl
+  << "                          the ring is dumped to the trace file in text format" << endl
+  << "                          when the port reports lost bytes or on Ctrl+Break." << endl
   << endl
   << "Options:" << endl
   << endl
@@ -300,6 +383,20 @@ static BOOL CALLBACK Config(
 
   if ((pParam = GetParam(pArg, "--trace-file=")) != NULL) {
     ((TraceConfig *)hConfig)->SetTracePath(pParam);
+  }
+  else
+  if ((pParam = GetParam(pArg, "--trace-format=")) != NULL) {
+    if (!((TraceConfig *)hConfig)->SetTraceFormat(pParam)) {
+      cerr << "Unknown trace format " << pParam << endl;
+      exit(1);
+    }
+  }
+  else
+  if ((pParam = GetParam(pArg, "--trace-recorder=")) != NULL) {
+    if (!((TraceConfig *)hConfig)->SetRecorderSize(pParam)) {
+      cerr << "Invalid flight recorder size " << pParam << endl;
+      exit(1);
+    }
   } else {
     return FALSE;
   }
@@ -350,428 +447,90 @@ static void CALLBACK Delete(
   delete (Filter *)hFilter;
 }
 ///////////////////////////////////////////////////////////////
-static HFILTERINSTANCE CALLBACK CreateInstance(
-    HMASTERFILTERINSTANCE hMasterFilterInstance)
-{
-  _ASSERTE(hMasterFilterInstance != NULL);
-
-  HMASTERPORT hMasterPort = pFilterPort(hMasterFilterInstance);
-
-  _ASSERTE(hMasterPort != NULL);
-
-  return (HFILTERINSTANCE)pPortName(hMasterPort);
-}
-///////////////////////////////////////////////////////////////
-static void CALLBACK DeleteInstance(
-    HFILTERINSTANCE DEBUG_PARAM(hFilterInstance))
-{
-  _ASSERTE(hFilterInstance != NULL);
-}
-///////////////////////////////////////////////////////////////
-static void PrintTime(ostream &tout)
-{
-  char f = tout.fill('0');
-
-  SYSTEMTIME time;
-
-  ::GetLocalTime(&time);
-
-  tout << setw(4) << time.wYear << "/"
-       << setw(2) << time.wMonth << "/"
-       << setw(2) << time.wDay << " "
-       << setw(2) << time.wHour << ":"
-       << setw(2) << time.wMinute << ":"
-       << setw(2) << time.wSecond << "."
-       << setw(3) << time.wMilliseconds << " ";
-
-  tout.fill(f);
-}
-///////////////////////////////////////////////////////////////
-struct CODE2NAME {
-  DWORD code;
-  const char *name;
-};
-#define TOCODE2NAME(p, s) { (ULONG)p##s, #s }
-
-static void PrintCode(ostream &tout, const CODE2NAME *pTable, DWORD code)
-{
-  if (pTable) {
-    while (pTable->name) {
-      if (pTable->code == code) {
-        tout << pTable->name;
-        return;
-      }
-      pTable++;
+class State {
+  public:
+    State(const char *_pPortName, Recorder *_pRecorder)
+      : pPortName(_pPortName),
+        pRecorder(_pRecorder)
+    {}
+
+    ~State() {
+      if (pRecorder)
+        delete pRecorder;
     }
-  }
 
-  tout << "0x" << hex << code << dec;
-}
-///////////////////////////////////////////////////////////////
-struct FIELD2NAME {
-  DWORD field;
-  DWORD mask;
-  const char *name;
+    const char *pPortName;
+    Recorder *pRecorder;
 };
-#define TOFIELD2NAME2(p, s) { (ULONG)p##s, (ULONG)p##s, #s }
-
-static BOOL PrintFields(
-    ostream &tout,
-    const FIELD2NAME *pTable,
-    DWORD fields,
-    BOOL delimitNext = FALSE,
-    const char *pUnknownPrefix = "",
-    const char *pDelimiter = "|")
-{
-  if (pTable) {
-    while (pTable->name) {
-      DWORD field = (fields & pTable->mask);
-
-      if (field == pTable->field) {
-        fields &= ~pTable->mask;
-        if (delimitNext)
-          tout << pDelimiter;
-        else
-          delimitNext = TRUE;
-
-        tout << pTable->name;
-      }
-      pTable++;
-    }
-  }
-
-  if (fields) {
-    if (delimitNext)
-      tout << pDelimiter;
-    else
-      delimitNext = TRUE;
-
-    tout << pUnknownPrefix << "0x" << hex << fields << dec;
-  }
-
-  return delimitNext;
-}
 ///////////////////////////////////////////////////////////////
-static const CODE2NAME codeNameTableHubMsg[] = {
-  TOCODE2NAME(HUB_MSG_TYPE_, EMPTY),
-  TOCODE2NAME(HUB_MSG_TYPE_, LINE_DATA),
-  TOCODE2NAME(HUB_MSG_TYPE_, CONNECT),
-  TOCODE2NAME(HUB_MSG_TYPE_, MODEM_STATUS),
-  TOCODE2NAME(HUB_MSG_TYPE_, LINE_STATUS),
-  TOCODE2NAME(HUB_MSG_TYPE_, SET_PIN_STATE),
-  TOCODE2NAME(HUB_MSG_TYPE_, GET_IN_OPTS),
-  TOCODE2NAME(HUB_MSG_TYPE_, SET_OUT_OPTS),
-  TOCODE2NAME(HUB_MSG_TYPE_, FAIL_IN_OPTS),
-  TOCODE2NAME(HUB_MSG_TYPE_, RBR_STATUS),
-  TOCODE2NAME(HUB_MSG_TYPE_, RLC_STATUS),
-  TOCODE2NAME(HUB_MSG_TYPE_, COUNT_REPEATS),
-  TOCODE2NAME(HUB_MSG_TYPE_, GET_ESC_OPTS),
-  TOCODE2NAME(HUB_MSG_TYPE_, FAIL_ESC_OPTS),
-  TOCODE2NAME(HUB_MSG_TYPE_, BREAK_STATUS),
-  TOCODE2NAME(HUB_MSG_TYPE_, SET_BR),
-  TOCODE2NAME(HUB_MSG_TYPE_, SET_LC),
-  TOCODE2NAME(HUB_MSG_TYPE_, SET_LSR),
-  TOCODE2NAME(HUB_MSG_TYPE_, LBR_STATUS),
-  TOCODE2NAME(HUB_MSG_TYPE_, LLC_STATUS),
-  TOCODE2NAME(HUB_MSG_TYPE_, LOOP_TEST),
-  TOCODE2NAME(HUB_MSG_TYPE_, ADD_XOFF_XON),
-  TOCODE2NAME(HUB_MSG_TYPE_, PURGE_TX_IN),
-  TOCODE2NAME(HUB_MSG_TYPE_, PURGE_TX),
-  TOCODE2NAME(HUB_MSG_TYPE_, TICK),
-  {0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const CODE2NAME codeNameTableParity[] = {
-  NOPARITY,    "N",
-  ODDPARITY,   "O",
-  EVENPARITY,  "E",
-  MARKPARITY,  "M",
-  SPACEPARITY, "S",
-  {0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const CODE2NAME codeNameTableStopBits
-[] = {
-  ONESTOPBIT,   "1",
-  ONE5STOPBITS, "1.5",
-  TWOSTOPBITS,  "2",
-  {0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const FIELD2NAME fieldNameTableModemStatus[] = {
-  TOFIELD2NAME2(MODEM_STATUS_, DCTS),
-  TOFIELD2NAME2(MODEM_STATUS_, DDSR),
-  TOFIELD2NAME2(MODEM_STATUS_, TERI),
-  TOFIELD2NAME2(MODEM_STATUS_, DDCD),
-  TOFIELD2NAME2(MODEM_STATUS_, CTS),
-  TOFIELD2NAME2(MODEM_STATUS_, DSR),
-  TOFIELD2NAME2(MODEM_STATUS_, RI),
-  TOFIELD2NAME2(MODEM_STATUS_, DCD),
-  {0, 0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const FIELD2NAME fieldNameTableLineStatus[] = {
-  TOFIELD2NAME2(LINE_STATUS_, DR),
-  TOFIELD2NAME2(LINE_STATUS_, OE),
-  TOFIELD2NAME2(LINE_STATUS_, PE),
-  TOFIELD2NAME2(LINE_STATUS_, FE),
-  TOFIELD2NAME2(LINE_STATUS_, BI),
-  TOFIELD2NAME2(LINE_STATUS_, THRE),
-  TOFIELD2NAME2(LINE_STATUS_, TEMT),
-  TOFIELD2NAME2(LINE_STATUS_, FIFOERR),
-  {0, 0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const FIELD2NAME fieldNameTableGo0Options[] = {
-  TOFIELD2NAME2(GO0_, LBR_STATUS),
-  TOFIELD2NAME2(GO0_, LLC_STATUS),
-  TOFIELD2NAME2(GO0_, ESCAPE_MODE),
-  {0, 0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const FIELD2NAME fieldNameTableGo1Options[] = {
-  TOFIELD2NAME2(GO1_, RBR_STATUS),
-  TOFIELD2NAME2(GO1_, RLC_STATUS),
-  TOFIELD2NAME2(GO1_, BREAK_STATUS),
-  {0, 0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const FIELD2NAME codeNameTableSetPinState[] = {
-  TOFIELD2NAME2(PIN_STATE_, RTS),
-  TOFIELD2NAME2(PIN_STATE_, DTR),
-  TOFIELD2NAME2(PIN_STATE_, OUT1),
-  TOFIELD2NAME2(PIN_STATE_, OUT2),
-  TOFIELD2NAME2(PIN_STATE_, CTS),
-  TOFIELD2NAME2(PIN_STATE_, DSR),
-  TOFIELD2NAME2(PIN_STATE_, RI),
-  TOFIELD2NAME2(PIN_STATE_, DCD),
-  TOFIELD2NAME2(PIN_STATE_, BREAK),
-  {0, 0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static const FIELD2NAME fieldNameTableSoOptions[] = {
-  TOFIELD2NAME2(SO_, SET_BR),
-  TOFIELD2NAME2(SO_, SET_LC),
-  {0, 0, NULL}
-};
-///////////////////////////////////////////////////////////////
-static BOOL PrintGoOptions(
-    ostream &tout,
-    DWORD fields,
-    BOOL delimitNext = FALSE)
+static void BindPort(const void *pOutput, HMASTERPORT hMasterPort)
 {
-  int iGo = GO_O2I(fields);
-
-  fields &= ~GO_I2O(-1);
-
-  const FIELD2NAME *pTable;
-
-  switch (iGo) {
-    case 0:
-      pTable = fieldNameTableGo0Options;
-      break;
-    case 1:
-      delimitNext = PrintFields(tout, fieldNameTableModemStatus, GO1_O2V_MODEM_STATUS(fields), delimitNext, "MST_");
-      delimitNext = PrintFields(tout, fieldNameTableLineStatus, GO1_O2V_LINE_STATUS(fields), delimitNext, "LSR_");
-      fields &= ~(GO1_V2O_MODEM_STATUS(-1) | GO1_V2O_LINE_STATUS(-1));
-      pTable = fieldNameTableGo1Options;
-      break;
-    default:
-      pTable = NULL;
-  }
+  // the ports tracing to the same stream or sink should run on the
+  // same thread
 
-  stringstream buf;
+  static map<const void *, HMASTERPORT> firstPorts;
 
-  buf << "GO" << iGo << "_";
+  if (!pBindPorts)
+    return;
 
-  delimitNext = PrintFields(tout, pTable, fields, delimitNext, buf.str().c_str());
+  HMASTERPORT &hFirstPort = firstPorts[pOutput];
 
-  return delimitNext;
+  if (!hFirstPort)
+    hFirstPort = hMasterPort;
+  else
+    pBindPorts(hFirstPort, hMasterPort);
 }
 ///////////////////////////////////////////////////////////////
-static BOOL PrintEscOptions(
-    ostream &tout,
-    DWORD fields,
-    BOOL delimitNext = FALSE)
+static HFILTERINSTANCE CALLBACK CreateInstance(
+    HMASTERFILTERINSTANCE hMasterFilterInstance)
 {
-  PrintGoOptions(tout, ESC_OPTS_MAP_EO_2_GO1(fields) | GO_I2O(1), delimitNext);
-  PrintFields(tout, NULL, fields & ~ESC_OPTS_MAP_GO1_2_EO(-1), delimitNext);
+  _ASSERTE(hMasterFilterInstance != NULL);
 
-  return delimitNext;
-}
-///////////////////////////////////////////////////////////////
-static void PrintMaskedFields(ostream &tout, const FIELD2NAME *pTable, DWORD maskedFields)
-{
-    WORD mask = MASK2VAL(maskedFields);
+  HMASTERPORT hMasterPort = pFilterPort(hMasterFilterInstance);
 
-    tout << "SET[";
-    PrintFields(tout, pTable, maskedFields & mask);
-    tout << "] CLR[";
-    PrintFields(tout, pTable, ~maskedFields & mask);
-    tout << "]";
-}
-///////////////////////////////////////////////////////////////
-static void PrintBuf(ostream &tout, const BYTE *pData, DWORD size)
-{
-  tout << "[" << size << "]:";
+  _ASSERTE(hMasterPort != NULL);
 
-  ios_base::fmtflags b = tout.setf(ios_base::hex, ios_base::basefield);
-  char f = tout.fill('0');
+  Filter *pFilter = (Filter *)pGetFilter(hMasterFilterInstance);
 
-  while (size) {
-    tout << endl << "  ";
+  _ASSERTE(pFilter != NULL);
 
-    stringstream buf;
+  if (pFilter->pTraceSink)
+    BindPort(pFilter->pTraceSink, hMasterPort);
+  else
+    BindPort(pFilter->pTraceStream, hMasterPort);
 
-    int i = 0;
+  Recorder *pRecorder = NULL;
 
-    for ( ; i < 16 && size ; i++, size--) {
-      BYTE ch = *pData++;
+  if (pFilter->recorderSize) {
+    _ASSERTE(pFilter->pTraceStream != NULL);
 
-      tout << setw(2) << (unsigned)ch << " ";
-      buf << (char)((ch >= 0x20 && ch < 0x7F) ? ch : '.');
-    }
+    pRecorder = new Recorder(pFilter->recorderSize,
+                             pPortName(hMasterPort),
+                             pFilter->FilterName(),
+                             *pFilter->pTraceStream);
 
-    for ( ; i < 16 ; i++) {
-      tout << "   ";
-      buf << " ";
+    if (!pRecorder) {
+      cerr << "No enough memory." << endl;
+      exit(2);
     }
-
-    tout << " * " << buf.str() << " *";
   }
 
-  tout.fill(f);
-  tout.setf(b, ios_base::basefield);
-}
-///////////////////////////////////////////////////////////////
-static void PrintMsgType(ostream &tout, DWORD msgType)
-{
-  tout << "MSG_";
-  PrintCode(tout, codeNameTableHubMsg, msgType);
-}
-///////////////////////////////////////////////////////////////
-static void PrintVal(ostream &tout, DWORD msgType, DWORD val)
-{
-  switch (msgType & HUB_MSG_VAL_TYPES_MASK) {
-    case HUB_MSG_VAL_TYPE_BOOL:
-      tout << (val ? "true" : "false");
-      break;
-    case HUB_MSG_VAL_TYPE_MSG_TYPE:
-      PrintMsgType(tout, val);
-      break;
-    case HUB_MSG_VAL_TYPE_UINT:
-      tout << val;
-      break;
-    case HUB_MSG_VAL_TYPE_LC:
-      if (val & LC_MASK_BYTESIZE)
-        tout << (unsigned)LC2VAL_BYTESIZE(val);
-      else
-        tout << 'x';
-
-      tout << '-';
-
-      if (val & LC_MASK_PARITY)
-        PrintCode(tout, codeNameTableParity, LC2VAL_PARITY(val));
-      else
-        tout << 'x';
-
-      tout << '-';
-
-      if (val & LC_MASK_STOPBITS)
-        PrintCode(tout, codeNameTableStopBits, LC2VAL_STOPBITS(val));
-      else
-        tout << 'x';
-      break;
-    default:
-      tout << "0x" << hex << val << dec;
-  }
-}
-///////////////////////////////////////////////////////////////
-static void PrintMsgBody(ostream &tout, HUB_MSG *pMsg)
-{
-  switch (pMsg->type & HUB_MSG_UNION_TYPES_MASK) {
-    case HUB_MSG_UNION_TYPE_NONE:
-      break;
-    case HUB_MSG_UNION_TYPE_BUF:
-      PrintBuf(tout, pMsg->u.buf.pBuf, pMsg->u.buf.size);
-      break;
-    case HUB_MSG_UNION_TYPE_VAL:
-      PrintVal(tout, pMsg->type, pMsg->u.val);
-      break;
-    case HUB_MSG_UNION_TYPE_PVAL:
-      tout << hex << "&" << pMsg->u.pv.pVal << "[0x" << *pMsg->u.pv.pVal << dec << "] ";
-      PrintVal(tout, pMsg->type, pMsg->u.pv.val);
-      break;
-    case HUB_MSG_UNION_TYPE_HVAL:
-      tout << pMsg->u.hVal;
-      break;
-    case HUB_MSG_UNION_TYPE_HVAL2:
-      tout << pMsg->u.hv2.hVal0 << " " << pMsg->u.hv2.hVal1;
-      break;
-    default:
-      tout  << "???";
+  State *pState = new State(pPortName(hMasterPort), pRecorder);
+
+  if (!pState) {
+    cerr << "No enough memory." << endl;
+    exit(2);
   }
+
+  return (HFILTERINSTANCE)pState;
 }
 ///////////////////////////////////////////////////////////////
-static void PrintMsg(ostream &tout, HUB_MSG *pMsg)
+static void CALLBACK DeleteInstance(
+    HFILTERINSTANCE hFilterInstance)
 {
-  PrintMsgType(tout, pMsg->type);
-
-  tout  << " {";
-
-  switch (HUB_MSG_T2N(pMsg->type)) {
-    case HUB_MSG_T2N(HUB_MSG_TYPE_MODEM_STATUS):
-      PrintMaskedFields(tout, fieldNameTableModemStatus, pMsg->u.val);
-      break;
-    case HUB_MSG_T2N(HUB_MSG_TYPE_LINE_STATUS):
-    case HUB_MSG_T2N(HUB_MSG_TYPE_SET_LSR):
-      PrintMaskedFields(tout, fieldNameTableLineStatus, pMsg->u.val);
-      break;
-    case HUB_MSG_T2N(HUB_MSG_TYPE_SET_PIN_STATE):
-      PrintMaskedFields(tout, codeNameTableSetPinState, pMsg->u.val);
-      break;
-    case HUB_MSG_T2N(HUB_MSG_TYPE_SET_OUT_OPTS): {
-      tout << "[";
-      BOOL delimitNext = FALSE;
-      delimitNext = PrintFields(tout, codeNameTableSetPinState, SO_O2V_PIN_STATE(pMsg->u.val), delimitNext, "SET_");
-      PrintFields(tout, fieldNameTableSoOptions, pMsg->u.val & ~SO_V2O_PIN_STATE(-1), delimitNext);
-      tout << "]";
-      break;
-    }
-    case HUB_MSG_T2N(HUB_MSG_TYPE_GET_IN_OPTS): {
-      tout << hex << "&" << pMsg->u.pv.pVal << "[" << dec;
-      PrintGoOptions(tout, (*pMsg->u.pv.pVal & ~(GO_I2O(-1))) | (pMsg->u.pv.val & GO_I2O(-1)));
-      tout << "] [";
-      PrintGoOptions(tout, pMsg->u.pv.val);
-      tout << "]";
-      break;
-    }
-    case HUB_MSG_T2N(HUB_MSG_TYPE_FAIL_IN_OPTS): {
-      tout << "[";
-      PrintGoOptions(tout, pMsg->u.val);
-      tout << "]";
-      break;
-    }
-    case HUB_MSG_T2N(HUB_MSG_TYPE_GET_ESC_OPTS): {
-      tout << hex << "&" << pMsg->u.pv.pVal << "[" << dec;
-      tout << "CHAR_0x" << hex << (unsigned)ESC_OPTS_O2V_ESCCHAR(*pMsg->u.pv.pVal) << dec;
-      PrintEscOptions(tout, *pMsg->u.pv.pVal & ~ESC_OPTS_V2O_ESCCHAR(-1), TRUE);
-      tout << "]";
-      break;
-    }
-    case HUB_MSG_T2N(HUB_MSG_TYPE_FAIL_ESC_OPTS): {
-      tout << hex << "&" << pMsg->u.pv.pVal << "[" << dec;
-      PrintGoOptions(tout, (*pMsg->u.pv.pVal & ~(GO_I2O(-1))) | GO_I2O(1));
-      tout << "] [";
-      PrintEscOptions(tout, pMsg->u.pv.val & ~ESC_OPTS_V2O_ESCCHAR(-1));
-      tout << "]";
-      break;
-    }
-    default:
-      PrintMsgBody(tout, pMsg);
-  }
+  _ASSERTE(hFilterInstance != NULL);
 
-  tout  << "}" << endl;
+  delete (State *)hFilterInstance;
 }
 ///////////////////////////////////////////////////////////////
 static BOOL CALLBACK InMethod(
@@ -786,12 +545,32 @@ static BOOL CALLBACK InMethod(
   _ASSERTE(ppEchoMsg != NULL);
   _ASSERTE(*ppEchoMsg == NULL);
 
+  Recorder *pRecorder = ((State *)hFilterInstance)->pRecorder;
+
+  if (pRecorder) {
+    pRecorder->Record(FALSE, NULL, pInMsg);
+
+    if (pInMsg->type == HUB_MSG_TYPE_LOST)
+      pRecorder->Dump("lost bytes");
+
+    return TRUE;
+  }
+
+  if (((Filter *)hFilter)->pTraceSink) {
+    ((Filter *)hFilter)->pTraceSink->Msg(TRACE_BIN_REC_IN,
+                                         ((State *)hFilterInstance)->pPortName,
+                                         ((Filter *)hFilter)->FilterName(),
+                                         NULL,
+                                         pInMsg);
+    return TRUE;
+  }
+
   _ASSERTE(((Filter *)hFilter)->pTraceStream != NULL);
   ostream &tout = *((Filter *)hFilter)->pTraceStream;
 
   PrintTime(tout);
 
-  tout << (const char *)hFilterInstance << "-("
+  tout << ((State *)hFilterInstance)->pPortName << "-("
        << ((Filter *)hFilter)->FilterName() << ")->: ";
 
   PrintMsg(tout, pInMsg);
@@ -810,12 +589,29 @@ static BOOL CALLBACK OutMethod(
   _ASSERTE(hFromPort != NULL);
   _ASSERTE(pOutMsg != NULL);
 
+  Recorder *pRecorder = ((State *)hFilterInstance)->pRecorder;
+
+  if (pRecorder) {
+    pRecorder->Record(TRUE, pPortName(hFromPort), pOutMsg);
+
+    return TRUE;
+  }
+
+  if (((Filter *)hFilter)->pTraceSink) {
+    ((Filter *)hFilter)->pTraceSink->Msg(TRACE_BIN_REC_OUT,
+                                         ((State *)hFilterInstance)->pPortName,
+                                         ((Filter *)hFilter)->FilterName(),
+                                         pPortName(hFromPort),
+                                         pOutMsg);
+    return TRUE;
+  }
+
   _ASSERTE(((Filter *)hFilter)->pTraceStream != NULL);
   ostream &tout = *((Filter *)hFilter)->pTraceStream;
 
   PrintTime(tout);
 
-  tout << (const char *)hFilterInstance << "<-("
+  tout << ((State *)hFilterInstance)->pPortName << "<-("
        << ((Filter *)hFilter)->FilterName() << ")-"
        << pPortName(hFromPort) << ": ";
 
@@ -851,7 +647,8 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
 {
   if (!ROUTINE_IS_VALID(pHubRoutines, pPortName) ||
       !ROUTINE_IS_VALID(pHubRoutines, pFilterName) ||
-      !ROUTINE_IS_VALID(pHubRoutines, pFilterPort))
+      !ROUTINE_IS_VALID(pHubRoutines, pFilterPort) ||
+      !ROUTINE_IS_VALID(pHubRoutines, pGetFilter))
   {
     return NULL;
   }
@@ -859,6 +656,8 @@ const PLUGIN_ROUTINES_A *const * CALLBACK InitA(
   pPortName = pHubRoutines->pPortName;
   pFilterName = pHubRoutines->pFilterName;
   pFilterPort = pHubRoutines->pFilterPort;
+  pGetFilter = pHubRoutines->pGetFilter;
+  pBindPorts = ROUTINE_GET(pHubRoutines, pBindPorts);
 
   return plugins;
 }
@@ -38,6 +38,8 @@
 #include <sstream>
 #include <iomanip>
 #include <set>
+#include <map>
+#include <vector>
 
 using namespace std;
 
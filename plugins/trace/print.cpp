@@ -0,0 +1,493 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2008-2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+#include "../plugins_api.h"
+///////////////////////////////////////////////////////////////
+namespace FilterTrace {
+///////////////////////////////////////////////////////////////
+#include "print.h"
+///////////////////////////////////////////////////////////////
+void TraceClockInit(TRACE_CLOCK &clock)
+{
+  LARGE_INTEGER li;
+
+  ::QueryPerformanceFrequency(&li);
+  clock.frequency = li.QuadPart;
+  clock.counter = TraceClockCounter();
+  ::GetSystemTimeAsFileTime(&clock.fileTime);
+}
+
+LONGLONG TraceClockCounter()
+{
+  LARGE_INTEGER li;
+
+  ::QueryPerformanceCounter(&li);
+
+  return li.QuadPart;
+}
+///////////////////////////////////////////////////////////////
+void PrintTime(ostream &tout)
+{
+  SYSTEMTIME time;
+
+  ::GetLocalTime(&time);
+
+  PrintTime(tout, time);
+}
+
+void PrintTime(ostream &tout, const TRACE_CLOCK &clock, LONGLONG counter)
+{
+  LONGLONG delta = counter - clock.counter;
+  LONGLONG ticks = (delta / clock.frequency) * 10000000 +
+                   (delta % clock.frequency) * 10000000 / clock.frequency;
+
+  ULARGE_INTEGER fileTime;
+
+  fileTime.LowPart = clock.fileTime.dwLowDateTime;
+  fileTime.HighPart = clock.fileTime.dwHighDateTime;
+  fileTime.QuadPart += ticks;
+
+  FILETIME ft;
+  FILETIME ftLocal;
+  SYSTEMTIME time;
+
+  ft.dwLowDateTime = fileTime.LowPart;
+  ft.dwHighDateTime = fileTime.HighPart;
+
+  if (!::FileTimeToLocalFileTime(&ft, &ftLocal) || !::FileTimeToSystemTime(&ftLocal, &time))
+    memset(&time, 0, sizeof(time));
+
+  PrintTime(tout, time);
+}
+
+void PrintTime(ostream &tout, const SYSTEMTIME &time)
+{
+  char f = tout.fill('0');
+
+  tout << setw(4) << time.wYear << "/"
+       << setw(2) << time.wMonth << "/"
+       << setw(2) << time.wDay << " "
+       << setw(2) << time.wHour << ":"
+       << setw(2) << time.wMinute << ":"
+       << setw(2) << time.wSecond << "."
+       << setw(3) << time.wMilliseconds << " ";
+
+  tout.fill(f);
+}
+///////////////////////////////////////////////////////////////
+struct CODE2NAME {
+  DWORD code;
+  const char *name;
+};
+#define TOCODE2NAME(p, s) { (ULONG)p##s, #s }
+
+static void PrintCode(ostream &tout, const CODE2NAME *pTable, DWORD code)
+{
+  if (pTable) {
+    while (pTable->name) {
+      if (pTable->code == code) {
+        tout << pTable->name;
+        return;
+      }
+      pTable++;
+    }
+  }
+
+  tout << "0x" << hex << code << dec;
+}
+///////////////////////////////////////////////////////////////
+struct FIELD2NAME {
+  DWORD field;
+  DWORD mask;
+  const char *name;
+};
+#define TOFIELD2NAME2(p, s) { (ULONG)p##s, (ULONG)p##s, #s }
+
+static BOOL PrintFields(
+    ostream &tout,
+    const FIELD2NAME *pTable,
+    DWORD fields,
+    BOOL delimitNext = FALSE,
+    const char *pUnknownPrefix = "",
+    const char *pDelimiter = "|")
+{
+  if (pTable) {
+    while (pTable->name) {
+      DWORD field = (fields & pTable->mask);
+
+      if (field == pTable->field) {
+        fields &= ~pTable->mask;
+        if (delimitNext)
+          tout << pDelimiter;
+        else
+          delimitNext = TRUE;
+
+        tout << pTable->name;
+      }
+      pTable++;
+    }
+  }
+
+  if (fields) {
+    if (delimitNext)
+      tout << pDelimiter;
+    else
+      delimitNext = TRUE;
+
+    tout << pUnknownPrefix << "0x" << hex << fields << dec;
+  }
+
+  return delimitNext;
+}
+///////////////////////////////////////////////////////////////
+static const CODE2NAME codeNameTableHubMsg[] = {
+  TOCODE2NAME(HUB_MSG_TYPE_, EMPTY),
+  TOCODE2NAME(HUB_MSG_TYPE_, LINE_DATA),
+  TOCODE2NAME(HUB_MSG_TYPE_, CONNECT),
+  TOCODE2NAME(HUB_MSG_TYPE_, MODEM_STATUS),
+  TOCODE2NAME(HUB_MSG_TYPE_, LINE_STATUS),
+  TOCODE2NAME(HUB_MSG_TYPE_, SET_PIN_STATE),
+  TOCODE2NAME(HUB_MSG_TYPE_, GET_IN_OPTS),
+  TOCODE2NAME(HUB_MSG_TYPE_, SET_OUT_OPTS),
+  TOCODE2NAME(HUB_MSG_TYPE_, FAIL_IN_OPTS),
+  TOCODE2NAME(HUB_MSG_TYPE_, RBR_STATUS),
+  TOCODE2NAME(HUB_MSG_TYPE_, RLC_STATUS),
+  TOCODE2NAME(HUB_MSG_TYPE_, COUNT_REPEATS),
+  TOCODE2NAME(HUB_MSG_TYPE_, GET_ESC_OPTS),
+  TOCODE2NAME(HUB_MSG_TYPE_, FAIL_ESC_OPTS),
+  TOCODE2NAME(HUB_MSG_TYPE_, BREAK_STATUS),
+  TOCODE2NAME(HUB_MSG_TYPE_, SET_BR),
+  TOCODE2NAME(HUB_MSG_TYPE_, SET_LC),
+  TOCODE2NAME(HUB_MSG_TYPE_, SET_LSR),
+  TOCODE2NAME(HUB_MSG_TYPE_, LBR_STATUS),
+  TOCODE2NAME(HUB_MSG_TYPE_, LLC_STATUS),
+  TOCODE2NAME(HUB_MSG_TYPE_, LOOP_TEST),
+  TOCODE2NAME(HUB_MSG_TYPE_, ADD_XOFF_XON),
+  TOCODE2NAME(HUB_MSG_TYPE_, PURGE_TX_IN),
+  TOCODE2NAME(HUB_MSG_TYPE_, PURGE_TX),
+  TOCODE2NAME(HUB_MSG_TYPE_, TICK),
+  TOCODE2NAME(HUB_MSG_TYPE_, LOST),
+  TOCODE2NAME(HUB_MSG_TYPE_, CREDIT),
+  {0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const CODE2NAME codeNameTableParity[] = {
+  NOPARITY,    "N",
+  ODDPARITY,   "O",
+  EVENPARITY,  "E",
+  MARKPARITY,  "M",
+  SPACEPARITY, "S",
+  {0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const CODE2NAME codeNameTableStopBits
+[] = {
+  ONESTOPBIT,   "1",
+  ONE5STOPBITS, "1.5",
+  TWOSTOPBITS,  "2",
+  {0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const FIELD2NAME fieldNameTableModemStatus[] = {
+  TOFIELD2NAME2(MODEM_STATUS_, DCTS),
+  TOFIELD2NAME2(MODEM_STATUS_, DDSR),
+  TOFIELD2NAME2(MODEM_STATUS_, TERI),
+  TOFIELD2NAME2(MODEM_STATUS_, DDCD),
+  TOFIELD2NAME2(MODEM_STATUS_, CTS),
+  TOFIELD2NAME2(MODEM_STATUS_, DSR),
+  TOFIELD2NAME2(MODEM_STATUS_, RI),
+  TOFIELD2NAME2(MODEM_STATUS_, DCD),
+  {0, 0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const FIELD2NAME fieldNameTableLineStatus[] = {
+  TOFIELD2NAME2(LINE_STATUS_, DR),
+  TOFIELD2NAME2(LINE_STATUS_, OE),
+  TOFIELD2NAME2(LINE_STATUS_, PE),
+  TOFIELD2NAME2(LINE_STATUS_, FE),
+  TOFIELD2NAME2(LINE_STATUS_, BI),
+  TOFIELD2NAME2(LINE_STATUS_, THRE),
+  TOFIELD2NAME2(LINE_STATUS_, TEMT),
+  TOFIELD2NAME2(LINE_STATUS_, FIFOERR),
+  {0, 0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const FIELD2NAME fieldNameTableGo0Options[] = {
+  TOFIELD2NAME2(GO0_, LBR_STATUS),
+  TOFIELD2NAME2(GO0_, LLC_STATUS),
+  TOFIELD2NAME2(GO0_, ESCAPE_MODE),
+  {0, 0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const FIELD2NAME fieldNameTableGo1Options[] = {
+  TOFIELD2NAME2(GO1_, RBR_STATUS),
+  TOFIELD2NAME2(GO1_, RLC_STATUS),
+  TOFIELD2NAME2(GO1_, BREAK_STATUS),
+  {0, 0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const FIELD2NAME codeNameTableSetPinState[] = {
+  TOFIELD2NAME2(PIN_STATE_, RTS),
+  TOFIELD2NAME2(PIN_STATE_, DTR),
+  TOFIELD2NAME2(PIN_STATE_, OUT1),
+  TOFIELD2NAME2(PIN_STATE_, OUT2),
+  TOFIELD2NAME2(PIN_STATE_, CTS),
+  TOFIELD2NAME2(PIN_STATE_, DSR),
+  TOFIELD2NAME2(PIN_STATE_, RI),
+  TOFIELD2NAME2(PIN_STATE_, DCD),
+  TOFIELD2NAME2(PIN_STATE_, BREAK),
+  {0, 0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static const FIELD2NAME fieldNameTableSoOptions[] = {
+  TOFIELD2NAME2(SO_, SET_BR),
+  TOFIELD2NAME2(SO_, SET_LC),
+  {0, 0, NULL}
+};
+///////////////////////////////////////////////////////////////
+static BOOL PrintGoOptions(
+    ostream &tout,
+    DWORD fields,
+    BOOL delimitNext = FALSE)
+{
+  int iGo = GO_O2I(fields);
+
+  fields &= ~GO_I2O(-1);
+
+  const FIELD2NAME *pTable;
+
+  switch (iGo) {
+    case 0:
+      pTable = fieldNameTableGo0Options;
+      break;
+    case 1:
+      delimitNext = PrintFields(tout, fieldNameTableModemStatus, GO1_O2V_MODEM_STATUS(fields), delimitNext, "MST_");
+      delimitNext = PrintFields(tout, fieldNameTableLineStatus, GO1_O2V_LINE_STATUS(fields), delimitNext, "LSR_");
+      fields &= ~(GO1_V2O_MODEM_STATUS(-1) | GO1_V2O_LINE_STATUS(-1));
+      pTable = fieldNameTableGo1Options;
+      break;
+    default:
+      pTable = NULL;
+  }
+
+  stringstream buf;
+
+  buf << "GO" << iGo << "_";
+
+  delimitNext = PrintFields(tout, pTable, fields, delimitNext, buf.str().c_str());
+
+  return delimitNext;
+}
+///////////////////////////////////////////////////////////////
+static BOOL PrintEscOptions(
+    ostream &tout,
+    DWORD fields,
+    BOOL delimitNext = FALSE)
+{
+  PrintGoOptions(tout, ESC_OPTS_MAP_EO_2_GO1(fields) | GO_I2O(1), delimitNext);
+  PrintFields(tout, NULL, fields & ~ESC_OPTS_MAP_GO1_2_EO(-1), delimitNext);
+
+  return delimitNext;
+}
+///////////////////////////////////////////////////////////////
+static void PrintMaskedFields(ostream &tout, const FIELD2NAME *pTable, DWORD maskedFields)
+{
+    WORD mask = MASK2VAL(maskedFields);
+
+    tout << "SET[";
+    PrintFields(tout, pTable, maskedFields & mask);
+    tout << "] CLR[";
+    PrintFields(tout, pTable, ~maskedFields & mask);
+    tout << "]";
+}
+///////////////////////////////////////////////////////////////
+static void PrintBuf(ostream &tout, const BYTE *pData, DWORD size)
+{
+  tout << "[" << size << "]:";
+
+  ios_base::fmtflags b = tout.setf(ios_base::hex, ios_base::basefield);
+  char f = tout.fill('0');
+
+  while (size) {
+    tout << endl << "  ";
+
+    stringstream buf;
+
+    int i = 0;
+
+    for ( ; i < 16 && size ; i++, size--) {
+      BYTE ch = *pData++;
+
+      tout << setw(2) << (unsigned)ch << " ";
+      buf << (char)((ch >= 0x20 && ch < 0x7F) ? ch : '.');
+    }
+
+    for ( ; i < 16 ; i++) {
+      tout << "   ";
+      buf << " ";
+    }
+
+    tout << " * " << buf.str() << " *";
+  }
+
+  tout.fill(f);
+  tout.setf(b, ios_base::basefield);
+}
+///////////////////////////////////////////////////////////////
+static void PrintMsgType(ostream &tout, DWORD msgType)
+{
+  tout << "MSG_";
+  PrintCode(tout, codeNameTableHubMsg, msgType);
+}
+///////////////////////////////////////////////////////////////
+static void PrintVal(ostream &tout, DWORD msgType, DWORD val)
+{
+  switch (msgType & HUB_MSG_VAL_TYPES_MASK) {
+    case HUB_MSG_VAL_TYPE_BOOL:
+      tout << (val ? "true" : "false");
+      break;
+    case HUB_MSG_VAL_TYPE_MSG_TYPE:
+      PrintMsgType(tout, val);
+      break;
+    case HUB_MSG_VAL_TYPE_UINT:
+      tout << val;
+      break;
+    case HUB_MSG_VAL_TYPE_LC:
+      if (val & LC_MASK_BYTESIZE)
+        tout << (unsigned)LC2VAL_BYTESIZE(val);
+      else
+        tout << 'x';
+
+      tout << '-';
+
+      if (val & LC_MASK_PARITY)
+        PrintCode(tout, codeNameTableParity, LC2VAL_PARITY(val));
+      else
+        tout << 'x';
+
+      tout << '-';
+
+      if (val & LC_MASK_STOPBITS)
+        PrintCode(tout, codeNameTableStopBits, LC2VAL_STOPBITS(val));
+      else
+        tout << 'x';
+      break;
+    default:
+      tout << "0x" << hex << val << dec;
+  }
+}
+///////////////////////////////////////////////////////////////
+static void PrintMsgBody(ostream &tout, const HUB_MSG *pMsg, const void *pValAddr)
+{
+  switch (pMsg->type & HUB_MSG_UNION_TYPES_MASK) {
+    case HUB_MSG_UNION_TYPE_NONE:
+      break;
+    case HUB_MSG_UNION_TYPE_BUF:
+      PrintBuf(tout, pMsg->u.buf.pBuf, pMsg->u.buf.size);
+      break;
+    case HUB_MSG_UNION_TYPE_VAL:
+      PrintVal(tout, pMsg->type, pMsg->u.val);
+      break;
+    case HUB_MSG_UNION_TYPE_PVAL:
+      tout << hex << "&" << pValAddr << "[0x" << *pMsg->u.pv.pVal << dec << "] ";
+      PrintVal(tout, pMsg->type, pMsg->u.pv.val);
+      break;
+    case HUB_MSG_UNION_TYPE_HVAL:
+      tout << pMsg->u.hVal;
+      break;
+    case HUB_MSG_UNION_TYPE_HVAL2:
+      tout << pMsg->u.hv2.hVal0 << " " << pMsg->u.hv2.hVal1;
+      break;
+    default:
+      tout  << "???";
+  }
+}
+///////////////////////////////////////////////////////////////
+void PrintMsg(ostream &tout, const HUB_MSG *pMsg, const void *pValAddr)
+{
+  if (!pValAddr && (pMsg->type & HUB_MSG_UNION_TYPES_MASK) == HUB_MSG_UNION_TYPE_PVAL)
+    pValAddr = pMsg->u.pv.pVal;
+
+  PrintMsgType(tout, pMsg->type);
+
+  tout  << " {";
+
+  switch (HUB_MSG_T2N(pMsg->type)) {
+    case HUB_MSG_T2N(HUB_MSG_TYPE_MODEM_STATUS):
+      PrintMaskedFields(tout, fieldNameTableModemStatus, pMsg->u.val);
+      break;
+    case HUB_MSG_T2N(HUB_MSG_TYPE_LINE_STATUS):
+    case HUB_MSG_T2N(HUB_MSG_TYPE_SET_LSR):
+      PrintMaskedFields(tout, fieldNameTableLineStatus, pMsg->u.val);
+      break;
+    case HUB_MSG_T2N(HUB_MSG_TYPE_SET_PIN_STATE):
+      PrintMaskedFields(tout, codeNameTableSetPinState, pMsg->u.val);
+      break;
+    case HUB_MSG_T2N(HUB_MSG_TYPE_SET_OUT_OPTS): {
+      tout << "[";
+      BOOL delimitNext = FALSE;
+      delimitNext = PrintFields(tout, codeNameTableSetPinState, SO_O2V_PIN_STATE(pMsg->u.val), delimitNext, "SET_");
+      PrintFields(tout, fieldNameTableSoOptions, pMsg->u.val & ~SO_V2O_PIN_STATE(-1), delimitNext);
+      tout << "]";
+      break;
+    }
+    case HUB_MSG_T2N(HUB_MSG_TYPE_GET_IN_OPTS): {
+      tout << hex << "&" << pValAddr << "[" << dec;
+      PrintGoOptions(tout, (*pMsg->u.pv.pVal & ~(GO_I2O(-1))) | (pMsg->u.pv.val & GO_I2O(-1)));
+      tout << "] [";
+      PrintGoOptions(tout, pMsg->u.pv.val);
+      tout << "]";
+      break;
+    }
+    case HUB_MSG_T2N(HUB_MSG_TYPE_FAIL_IN_OPTS): {
+      tout << "[";
+      PrintGoOptions(tout, pMsg->u.val);
+      tout << "]";
+      break;
+    }
+    case HUB_MSG_T2N(HUB_MSG_TYPE_GET_ESC_OPTS): {
+      tout << hex << "&" << pValAddr << "[" << dec;
+      tout << "CHAR_0x" << hex << (unsigned)ESC_OPTS_O2V_ESCCHAR(*pMsg->u.pv.pVal) << dec;
+      PrintEscOptions(tout, *pMsg->u.pv.pVal & ~ESC_OPTS_V2O_ESCCHAR(-1), TRUE);
+      tout << "]";
+      break;
+    }
+    case HUB_MSG_T2N(HUB_MSG_TYPE_FAIL_ESC_OPTS): {
+      tout << hex << "&" << pValAddr << "[" << dec;
+      PrintGoOptions(tout, (*pMsg->u.pv.pVal & ~(GO_I2O(-1))) | GO_I2O(1));
+      tout << "] [";
+      PrintEscOptions(tout, pMsg->u.pv.val & ~ESC_OPTS_V2O_ESCCHAR(-1));
+      tout << "]";
+      break;
+    }
+    default:
+      PrintMsgBody(tout, pMsg, pValAddr);
+  }
+
+  tout  << "}" << endl;
+}
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
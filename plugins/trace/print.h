@@ -0,0 +1,47 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2008-2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#ifndef _PRINT_H
+#define _PRINT_H
+
+///////////////////////////////////////////////////////////////
+struct TRACE_CLOCK {
+  LONGLONG frequency;     // QueryPerformanceFrequency()
+  LONGLONG counter;       // QueryPerformanceCounter() at fileTime
+  FILETIME fileTime;      // GetSystemTimeAsFileTime()
+};
+///////////////////////////////////////////////////////////////
+void TraceClockInit(TRACE_CLOCK &clock);
+LONGLONG TraceClockCounter();
+///////////////////////////////////////////////////////////////
+void PrintTime(ostream &tout);
+void PrintTime(ostream &tout, const SYSTEMTIME &time);
+void PrintTime(ostream &tout, const TRACE_CLOCK &clock, LONGLONG counter);
+///////////////////////////////////////////////////////////////
+// pValAddr, if not NULL, is printed instead of pMsg->u.pv.pVal
+// (used to render the address recorded by a binary trace)
+void PrintMsg(ostream &tout, const HUB_MSG *pMsg, const void *pValAddr = NULL);
+///////////////////////////////////////////////////////////////
+
+#endif  // _PRINT_H
@@ -0,0 +1,271 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+#include "../plugins_api.h"
+///////////////////////////////////////////////////////////////
+namespace FilterTrace {
+///////////////////////////////////////////////////////////////
+#include "print.h"
+#include "recorder.h"
+///////////////////////////////////////////////////////////////
+Recorder *Recorder::pFirst = NULL;
+BOOL Recorder::dumpOnBreak = FALSE;
+///////////////////////////////////////////////////////////////
+Recorder::Recorder(DWORD _size, const char *_pPort, const char *_pFilter, ostream &_tout)
+  : size(_size),
+    head(0),
+    tail(0),
+    used(0),
+    countRecords(0),
+    countOverwritten(0),
+    pPort(_pPort),
+    pFilter(_pFilter),
+    tout(_tout),
+    hThread(NULL)
+{
+  _ASSERTE(size >= RECORDER_SIZE_MIN*1024);
+
+  pRing = new BYTE[size];
+
+  if (!pRing) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  TraceClockInit(clock);
+
+  EnableDumpOnBreak();
+
+  pNext = pFirst;
+  pFirst = this;
+}
+
+Recorder::~Recorder()
+{
+  for (Recorder **ppRecorder = &pFirst ; *ppRecorder ; ppRecorder = &(*ppRecorder)->pNext) {
+    if (*ppRecorder == this) {
+      *ppRecorder = pNext;
+      break;
+    }
+  }
+
+  if (hThread && hThread != INVALID_HANDLE_VALUE)
+    ::CloseHandle(hThread);
+
+  delete [] pRing;
+}
+///////////////////////////////////////////////////////////////
+void Recorder::Record(BOOL out, const char *pFromPort, const HUB_MSG *pMsg)
+{
+  REC rec;
+  DWORD sizeData = 0;
+
+  if (!hThread)
+    SetThread();
+
+  rec.out = out;
+  rec.counter = TraceClockCounter();
+  rec.pFromPort = pFromPort;
+  rec.valPtr = 0;
+  rec.msg = *pMsg;
+
+  switch (pMsg->type & HUB_MSG_UNION_TYPES_MASK) {
+    case HUB_MSG_UNION_TYPE_BUF:
+      sizeData = pMsg->u.buf.size;
+
+      if (sizeData > size - sizeof(rec)) {
+        sizeData = size - sizeof(rec);
+        rec.msg.u.buf.size = sizeData;
+      }
+      break;
+    case HUB_MSG_UNION_TYPE_PVAL:
+      rec.valPtr = *pMsg->u.pv.pVal;
+      break;
+  }
+
+  rec.size = sizeof(rec) + sizeData;
+
+  // overwrite the oldest records
+
+  while (size - used < rec.size) {
+    DWORD sizeOld;
+
+    Get(tail, &sizeOld, sizeof(sizeOld));
+
+    _ASSERTE(sizeOld <= used);
+
+    tail = (tail + sizeOld) % size;
+    used -= sizeOld;
+    countRecords--;
+    countOverwritten++;
+  }
+
+  Put(&rec, sizeof(rec));
+
+  if (sizeData)
+    Put(pMsg->u.buf.pBuf, sizeData);
+
+  countRecords++;
+}
+///////////////////////////////////////////////////////////////
+void Recorder::Dump(const char *pReason)
+{
+  if (!countRecords)
+    return;
+
+  PrintTime(tout);
+
+  tout << pPort << " flight recorder (" << pFilter << "): " << pReason
+       << ", " << countRecords << " records";
+
+  if (countOverwritten)
+    tout << " (" << countOverwritten << " older records were overwritten)";
+
+  tout << endl;
+
+  vector<BYTE> data;
+
+  for (DWORD pos = tail ; countRecords ; countRecords--) {
+    REC rec;
+    const void *pValAddr = NULL;
+
+    Get(pos, &rec, sizeof(rec));
+
+    switch (rec.msg.type & HUB_MSG_UNION_TYPES_MASK) {
+      case HUB_MSG_UNION_TYPE_BUF:
+        data.resize(rec.msg.u.buf.size + 1);
+
+        Get((pos + sizeof(rec)) % size, &data[0], rec.msg.u.buf.size);
+        rec.msg.u.buf.pBuf = &data[0];
+        break;
+      case HUB_MSG_UNION_TYPE_PVAL:
+        pValAddr = rec.msg.u.pv.pVal;
+        rec.msg.u.pv.pVal = &rec.valPtr;
+        break;
+    }
+
+    PrintTime(tout, clock, rec.counter);
+
+    if (rec.out) {
+      tout << pPort << "<-(" << pFilter << ")-" << rec.pFromPort << ": ";
+    } else {
+      tout << pPort << "-(" << pFilter << ")->: ";
+    }
+
+    PrintMsg(tout, &rec.msg, pValAddr);
+
+    pos = (pos + rec.size) % size;
+  }
+
+  head = tail = used = 0;
+  countOverwritten = 0;
+}
+///////////////////////////////////////////////////////////////
+void Recorder::Put(const void *pData, DWORD len)
+{
+  _ASSERTE(len <= size - used);
+
+  DWORD lenFirst = size - head;
+
+  if (lenFirst >= len) {
+    memcpy(pRing + head, pData, len);
+  } else {
+    memcpy(pRing + head, pData, lenFirst);
+    memcpy(pRing, (const BYTE *)pData + lenFirst, len - lenFirst);
+  }
+
+  head = (head + len) % size;
+  used += len;
+}
+
+void Recorder::Get(DWORD pos, void *pData, DWORD len) const
+{
+  DWORD lenFirst = size - pos;
+
+  if (lenFirst >= len) {
+    memcpy(pData, pRing + pos, len);
+  } else {
+    memcpy(pData, pRing + pos, lenFirst);
+    memcpy((BYTE *)pData + lenFirst, pRing, len - lenFirst);
+  }
+}
+///////////////////////////////////////////////////////////////
+void Recorder::SetThread()
+{
+  // the hub can run the ports on several threads, so the dump
+  // is queued to the thread that records the messages
+
+  if (!::DuplicateHandle(::GetCurrentProcess(), ::GetCurrentThread(),
+                         ::GetCurrentProcess(), &hThread,
+                         0, FALSE, DUPLICATE_SAME_ACCESS))
+  {
+    DWORD err = GetLastError();
+    cerr << "WARNING: DuplicateHandle() - error=" << err << endl;
+    hThread = INVALID_HANDLE_VALUE;
+  }
+}
+
+void Recorder::EnableDumpOnBreak()
+{
+  if (dumpOnBreak)
+    return;
+
+  dumpOnBreak = TRUE;
+
+  if (!::SetConsoleCtrlHandler(CtrlHandler, TRUE)) {
+    DWORD err = GetLastError();
+    cerr << "WARNING: SetConsoleCtrlHandler() - error=" << err << endl;
+  }
+}
+
+VOID CALLBACK Recorder::DumpAPC(ULONG_PTR param)
+{
+  ((Recorder *)param)->Dump("Ctrl+Break");
+}
+
+BOOL WINAPI Recorder::CtrlHandler(DWORD ctrlType)
+{
+  if (ctrlType != CTRL_BREAK_EVENT)
+    return FALSE;
+
+  for (Recorder *pRecorder = pFirst ; pRecorder ; pRecorder = pRecorder->pNext) {
+    HANDLE hThread = pRecorder->hThread;
+
+    // nothing recorded yet
+
+    if (!hThread || hThread == INVALID_HANDLE_VALUE)
+      continue;
+
+    if (!::QueueUserAPC(DumpAPC, hThread, (ULONG_PTR)pRecorder)) {
+      DWORD err = GetLastError();
+      cerr << "WARNING: QueueUserAPC() - error=" << err << endl;
+    }
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,86 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+///////////////////////////////////////////////////////////////
+#define RECORDER_SIZE_MIN   4       // KB
+///////////////////////////////////////////////////////////////
+// Flight recorder: keeps the last messages of a port in memory,
+// the oldest records are overwritten by the new ones.
+//
+// It's used by the thread of its port only (the dump on Ctrl+Break
+// is queued to that thread by APC), so it needs no locks.
+///////////////////////////////////////////////////////////////
+class Recorder
+{
+  public:
+    Recorder(DWORD _size, const char *_pPort, const char *_pFilter, ostream &_tout);
+    ~Recorder();
+
+    void Record(BOOL out, const char *pFromPort, const HUB_MSG *pMsg);
+    void Dump(const char *pReason);
+
+  private:
+    struct REC {
+      DWORD size;             // including the data
+      BOOL out;
+      LONGLONG counter;
+      const char *pFromPort;
+      DWORD valPtr;           // *msg.u.pv.pVal for HUB_MSG_UNION_TYPE_PVAL
+      HUB_MSG msg;            // msg.u.buf.size bytes of data follow
+    };
+
+    void Put(const void *pData, DWORD len);
+    void Get(DWORD pos, void *pData, DWORD len) const;
+
+    void SetThread();
+    static void EnableDumpOnBreak();
+    static VOID CALLBACK DumpAPC(ULONG_PTR param);
+    static BOOL WINAPI CtrlHandler(DWORD ctrlType);
+
+    BYTE *pRing;
+    DWORD size;
+    DWORD head;
+    DWORD tail;
+    DWORD used;
+    DWORD countRecords;
+    DWORD countOverwritten;
+
+    const char *pPort;
+    const char *pFilter;
+    ostream &tout;
+
+    TRACE_CLOCK clock;
+
+    HANDLE hThread;
+
+    Recorder *pNext;
+    static Recorder *pFirst;
+    static BOOL dumpOnBreak;
+};
+///////////////////////////////////////////////////////////////
+
+#endif  // _RECORDER_H
@@ -0,0 +1,202 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+#include "../plugins_api.h"
+///////////////////////////////////////////////////////////////
+namespace FilterTrace {
+///////////////////////////////////////////////////////////////
+#include "print.h"
+#include "tracebin.h"
+///////////////////////////////////////////////////////////////
+typedef vector<string> Names;
+///////////////////////////////////////////////////////////////
+static const char *Name(const Names &names, WORD id)
+{
+  return id < names.size() ? names[id].c_str() : "?";
+}
+///////////////////////////////////////////////////////////////
+static BOOL PrintRecordMsg(
+    ostream &tout,
+    const Names &names,
+    WORD type,
+    const BYTE *pPayload,
+    DWORD sizePayload)
+{
+  TRACE_BIN_MSG msg;
+
+  if (sizePayload < sizeof(msg))
+    return FALSE;
+
+  memcpy(&msg, pPayload, sizeof(msg));
+  pPayload += sizeof(msg);
+  sizePayload -= sizeof(msg);
+
+  if (type == TRACE_BIN_REC_IN) {
+    tout << Name(names, msg.idPort) << "-("
+         << Name(names, msg.idFilter) << ")->: ";
+  } else {
+    tout << Name(names, msg.idPort) << "<-("
+         << Name(names, msg.idFilter) << ")-"
+         << Name(names, msg.idFromPort) << ": ";
+  }
+
+  HUB_MSG hubMsg;
+  const void *pValAddr = NULL;
+  DWORD valPtr;
+  ULONGLONG vals[2];
+
+  memset(&hubMsg, 0, sizeof(hubMsg));
+  hubMsg.type = msg.type;
+
+  switch (msg.type & HUB_MSG_UNION_TYPES_MASK) {
+    case HUB_MSG_UNION_TYPE_BUF:
+      hubMsg.u.buf.pBuf = (BYTE *)pPayload;
+      hubMsg.u.buf.size = sizePayload;
+      break;
+    case HUB_MSG_UNION_TYPE_VAL:
+      if (sizePayload < sizeof(DWORD))
+        return FALSE;
+
+      memcpy(&hubMsg.u.val, pPayload, sizeof(DWORD));
+      break;
+    case HUB_MSG_UNION_TYPE_PVAL:
+      if (sizePayload < sizeof(ULONGLONG) + 2*sizeof(DWORD))
+        return FALSE;
+
+      memcpy(&vals[0], pPayload, sizeof(ULONGLONG));
+      memcpy(&valPtr, pPayload + sizeof(ULONGLONG), sizeof(DWORD));
+      memcpy(&hubMsg.u.pv.val, pPayload + sizeof(ULONGLONG) + sizeof(DWORD), sizeof(DWORD));
+      hubMsg.u.pv.pVal = &valPtr;
+      pValAddr = (const void *)(ULONG_PTR)vals[0];
+      break;
+    case HUB_MSG_UNION_TYPE_HVAL:
+      if (sizePayload < sizeof(ULONGLONG))
+        return FALSE;
+
+      memcpy(&vals[0], pPayload, sizeof(ULONGLONG));
+      hubMsg.u.hVal = (HANDLE)(ULONG_PTR)vals[0];
+      break;
+    case HUB_MSG_UNION_TYPE_HVAL2:
+      if (sizePayload < 2*sizeof(ULONGLONG))
+        return FALSE;
+
+      memcpy(vals, pPayload, 2*sizeof(ULONGLONG));
+      hubMsg.u.hv2.hVal0 = (HANDLE)(ULONG_PTR)vals[0];
+      hubMsg.u.hv2.hVal1 = (HANDLE)(ULONG_PTR)vals[1];
+      break;
+  }
+
+  PrintMsg(tout, &hubMsg, pValAddr);
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+int RenderTraceBin(const char *pPath, ostream &tout)
+{
+  ifstream in(pPath, ios::in | ios::binary);
+
+  if (!in.is_open()) {
+    cerr << "Can't open " << pPath << endl;
+    return 2;
+  }
+
+  TRACE_BIN_HEADER header;
+
+  if (!in.read((char *)&header, sizeof(header)) ||
+      memcmp(header.signature, TRACE_BIN_SIGNATURE, sizeof(header.signature)) != 0 ||
+      header.clock.frequency <= 0)
+  {
+    cerr << pPath << " is not a binary trace file" << endl;
+    return 2;
+  }
+
+  if (header.version != TRACE_BIN_VERSION) {
+    cerr << pPath << " has unsupported version " << header.version << endl;
+    return 2;
+  }
+
+  Names names;
+  vector<BYTE> payload;
+
+  for (;;) {
+    TRACE_BIN_RECORD rec;
+
+    if (!in.read((char *)&rec, sizeof(rec)))
+      break;
+
+    if (rec.size < sizeof(rec)) {
+      cerr << pPath << " has a broken record" << endl;
+      return 2;
+    }
+
+    DWORD sizePayload = rec.size - sizeof(rec);
+
+    payload.resize(sizePayload + 1);
+
+    if (sizePayload && !in.read((char *)&payload[0], sizePayload)) {
+      cerr << pPath << " has a truncated record" << endl;
+      return 2;
+    }
+
+    payload[sizePayload] = 0;
+
+    switch (rec.type) {
+      case TRACE_BIN_REC_NAME:
+        if (names.size() <= rec.id)
+          names.resize(rec.id + 1);
+
+        names[rec.id] = (const char *)&payload[0];
+        break;
+      case TRACE_BIN_REC_TEXT:
+        tout << (const char *)&payload[0];
+        break;
+      case TRACE_BIN_REC_IN:
+      case TRACE_BIN_REC_OUT: {
+        PrintTime(tout, header.clock, rec.counter);
+
+        if (!PrintRecordMsg(tout, names, rec.type, &payload[0], sizePayload))
+          tout << "???" << endl;
+
+        break;
+      }
+      case TRACE_BIN_REC_LOST: {
+        DWORD countLost = 0;
+
+        if (sizePayload >= sizeof(DWORD))
+          memcpy(&countLost, &payload[0], sizeof(DWORD));
+
+        PrintTime(tout, header.clock, rec.counter);
+
+        tout << "LOST " << countLost << " records" << endl;
+        break;
+      }
+    }
+  }
+
+  return 0;
+}
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,363 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+#include "../plugins_api.h"
+///////////////////////////////////////////////////////////////
+namespace FilterTrace {
+///////////////////////////////////////////////////////////////
+#include "print.h"
+#include "tracebin.h"
+///////////////////////////////////////////////////////////////
+#define TRACE_RING_SIZE       ((DWORD)1 << 22)
+#define TRACE_RING_MASK       (TRACE_RING_SIZE - 1)
+#define TRACE_FLUSH_PERIOD    100     // ms
+#define TRACE_FLUSH_TIMEOUT   1000    // ms
+///////////////////////////////////////////////////////////////
+TraceSink *TraceSink::pFirst = NULL;
+///////////////////////////////////////////////////////////////
+TraceSink *TraceSink::Open(const char *pPath)
+{
+  HANDLE hFile = ::CreateFile(pPath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  if (hFile == INVALID_HANDLE_VALUE) {
+    DWORD err = GetLastError();
+    cerr << "Can't open " << pPath << " - error=" << err << endl;
+    exit(2);
+  }
+
+  TRACE_BIN_HEADER header;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.signature, TRACE_BIN_SIGNATURE, sizeof(header.signature));
+  header.version = TRACE_BIN_VERSION;
+
+  TraceClockInit(header.clock);
+
+  DWORD done;
+
+  if (!::WriteFile(hFile, &header, sizeof(header), &done, NULL) || done != sizeof(header)) {
+    DWORD err = GetLastError();
+    cerr << "Can't write " << pPath << " - error=" << err << endl;
+    exit(2);
+  }
+
+  TraceSink *pSink = new TraceSink(hFile);
+
+  if (!pSink) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  if (!pFirst) {
+    if (!::SetConsoleCtrlHandler(CtrlHandler, TRUE)) {
+      DWORD err = GetLastError();
+      cerr << "WARNING: SetConsoleCtrlHandler() - error=" << err << endl;
+    }
+  }
+
+  pSink->pNext = pFirst;
+  pFirst = pSink;
+
+  return pSink;
+}
+///////////////////////////////////////////////////////////////
+TraceSink::TraceSink(HANDLE _hFile)
+  : hFile(_hFile),
+    head(0),
+    tail(0),
+    headPut(0),
+    countLost(0),
+    pNext(NULL)
+{
+  pRing = new BYTE[TRACE_RING_SIZE];
+
+  if (!pRing) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  hWakeup = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+
+  if (!hWakeup) {
+    DWORD err = GetLastError();
+    cerr << "CreateEvent() - error=" << err << endl;
+    exit(2);
+  }
+
+  DWORD id;
+
+  hThread = ::CreateThread(NULL, 0, WriterThread, this, 0, &id);
+
+  if (!hThread) {
+    DWORD err = GetLastError();
+    cerr << "CreateThread() - error=" << err << endl;
+    exit(2);
+  }
+}
+///////////////////////////////////////////////////////////////
+void TraceSink::Text(const char *pText)
+{
+  DWORD len = (DWORD)strlen(pText);
+
+  if (Reserve(sizeof(TRACE_BIN_RECORD) + len)) {
+    PutRecord(TRACE_BIN_REC_TEXT, 0, len);
+    Put(pText, len);
+  } else {
+    countLost++;
+  }
+
+  Commit();
+}
+///////////////////////////////////////////////////////////////
+void TraceSink::Msg(
+    WORD type,
+    const char *pPort,
+    const char *pFilter,
+    const char *pFromPort,
+    const HUB_MSG *pMsg)
+{
+  if (countLost) {
+    if (!Reserve(sizeof(TRACE_BIN_RECORD) + sizeof(DWORD))) {
+      countLost++;
+      return;
+    }
+
+    PutRecord(TRACE_BIN_REC_LOST, 0, sizeof(DWORD));
+    Put(&countLost, sizeof(DWORD));
+    countLost = 0;
+  }
+
+  TRACE_BIN_MSG msg;
+
+  msg.idFromPort = 0;
+  msg.reserved = 0;
+  msg.type = pMsg->type;
+
+  if (!NameId(pPort, &msg.idPort) ||
+      !NameId(pFilter, &msg.idFilter) ||
+      (pFromPort && !NameId(pFromPort, &msg.idFromPort)))
+  {
+    countLost++;
+    Commit();
+    return;
+  }
+
+  const void *pData;
+  DWORD sizeData;
+  BYTE data[2*sizeof(ULONGLONG)];
+
+  switch (pMsg->type & HUB_MSG_UNION_TYPES_MASK) {
+    case HUB_MSG_UNION_TYPE_BUF:
+      pData = pMsg->u.buf.pBuf;
+      sizeData = pMsg->u.buf.size;
+      break;
+    case HUB_MSG_UNION_TYPE_VAL:
+      memcpy(data, &pMsg->u.val, sizeof(DWORD));
+      pData = data;
+      sizeData = sizeof(DWORD);
+      break;
+    case HUB_MSG_UNION_TYPE_PVAL: {
+      ULONGLONG addr = (ULONG_PTR)pMsg->u.pv.pVal;
+
+      memcpy(data, &addr, sizeof(ULONGLONG));
+      memcpy(data + sizeof(ULONGLONG), pMsg->u.pv.pVal, sizeof(DWORD));
+      memcpy(data + sizeof(ULONGLONG) + sizeof(DWORD), &pMsg->u.pv.val, sizeof(DWORD));
+      pData = data;
+      sizeData = sizeof(ULONGLONG) + 2*sizeof(DWORD);
+      break;
+    }
+    case HUB_MSG_UNION_TYPE_HVAL: {
+      ULONGLONG hVal = (ULONG_PTR)pMsg->u.hVal;
+
+      memcpy(data, &hVal, sizeof(ULONGLONG));
+      pData = data;
+      sizeData = sizeof(ULONGLONG);
+      break;
+    }
+    case HUB_MSG_UNION_TYPE_HVAL2: {
+      ULONGLONG hVal0 = (ULONG_PTR)pMsg->u.hv2.hVal0;
+      ULONGLONG hVal1 = (ULONG_PTR)pMsg->u.hv2.hVal1;
+
+      memcpy(data, &hVal0, sizeof(ULONGLONG));
+      memcpy(data + sizeof(ULONGLONG), &hVal1, sizeof(ULONGLONG));
+      pData = data;
+      sizeData = 2*sizeof(ULONGLONG);
+      break;
+    }
+    default:
+      pData = NULL;
+      sizeData = 0;
+  }
+
+  if (Reserve(sizeof(TRACE_BIN_RECORD) + sizeof(msg) + sizeData)) {
+    PutRecord(type, 0, sizeof(msg) + sizeData);
+    Put(&msg, sizeof(msg));
+
+    if (sizeData)
+      Put(pData, sizeData);
+  } else {
+    countLost++;
+  }
+
+  Commit();
+}
+///////////////////////////////////////////////////////////////
+BOOL TraceSink::NameId(const char *pName, WORD *pId)
+{
+  _ASSERTE(pName != NULL);
+
+  Names::const_iterator iName = names.find(pName);
+
+  if (iName != names.end()) {
+    *pId = iName->second;
+    return TRUE;
+  }
+
+  DWORD len = (DWORD)strlen(pName);
+
+  if (!Reserve(sizeof(TRACE_BIN_RECORD) + len))
+    return FALSE;
+
+  WORD id = (WORD)names.size();
+
+  PutRecord(TRACE_BIN_REC_NAME, id, len);
+  Put(pName, len);
+
+  names[pName] = id;
+  *pId = id;
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+BOOL TraceSink::Reserve(DWORD size)
+{
+  DWORD used = headPut - (DWORD)tail;
+
+  _ASSERTE(used <= TRACE_RING_SIZE);
+
+  return size <= TRACE_RING_SIZE - used;
+}
+
+void TraceSink::Put(const void *pData, DWORD size)
+{
+  DWORD pos = headPut & TRACE_RING_MASK;
+  DWORD sizeFirst = TRACE_RING_SIZE - pos;
+
+  if (sizeFirst >= size) {
+    memcpy(pRing + pos, pData, size);
+  } else {
+    memcpy(pRing + pos, pData, sizeFirst);
+    memcpy(pRing, (const BYTE *)pData + sizeFirst, size - sizeFirst);
+  }
+
+  headPut += size;
+}
+
+void TraceSink::PutRecord(WORD type, WORD id, DWORD sizePayload)
+{
+  TRACE_BIN_RECORD rec;
+
+  rec.size = sizeof(rec) + sizePayload;
+  rec.type = type;
+  rec.id = id;
+  rec.counter = TraceClockCounter();
+
+  Put(&rec, sizeof(rec));
+}
+
+void TraceSink::Commit()
+{
+  DWORD usedPrev = (DWORD)head - (DWORD)tail;
+
+  if (usedPrev == headPut - (DWORD)tail)
+    return;
+
+  ::InterlockedExchange(&head, (LONG)headPut);
+
+  // the writer thread polls the ring periodically,
+  // wake it up earlier only if the ring is getting full
+
+  if (usedPrev < TRACE_RING_SIZE/2 && headPut - (DWORD)tail >= TRACE_RING_SIZE/2)
+    ::SetEvent(hWakeup);
+}
+///////////////////////////////////////////////////////////////
+DWORD CALLBACK TraceSink::WriterThread(LPVOID pParam)
+{
+  TraceSink *pSink = (TraceSink *)pParam;
+
+  for (;;) {
+    ::WaitForSingleObject(pSink->hWakeup, TRACE_FLUSH_PERIOD);
+
+    pSink->Drain();
+  }
+}
+
+void TraceSink::Drain()
+{
+  DWORD posHead = (DWORD)head;
+  DWORD posTail = (DWORD)tail;
+
+  while (posTail != posHead) {
+    DWORD pos = posTail & TRACE_RING_MASK;
+    DWORD size = posHead - posTail;
+
+    if (size > TRACE_RING_SIZE - pos)
+      size = TRACE_RING_SIZE - pos;
+
+    DWORD done;
+
+    if (!::WriteFile(hFile, pRing + pos, size, &done, NULL)) {
+      DWORD err = GetLastError();
+      cerr << "Trace WriteFile() - error=" << err << endl;
+    }
+
+    posTail += size;
+    ::InterlockedExchange(&tail, (LONG)posTail);
+  }
+}
+///////////////////////////////////////////////////////////////
+void TraceSink::Flush()
+{
+  DWORD posHead = (DWORD)head;
+
+  ::SetEvent(hWakeup);
+
+  for (DWORD waited = 0 ; (LONG)(posHead - (DWORD)tail) > 0 && waited < TRACE_FLUSH_TIMEOUT ; waited += 10)
+    ::Sleep(10);
+}
+
+BOOL WINAPI TraceSink::CtrlHandler(DWORD /*ctrlType*/)
+{
+  // flush the rings before a possible process termination
+
+  for (TraceSink *pSink = pFirst ; pSink ; pSink = pSink->pNext)
+    pSink->Flush();
+
+  return FALSE;
+}
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
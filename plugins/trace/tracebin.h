@@ -0,0 +1,133 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#ifndef _TRACEBIN_H
+#define _TRACEBIN_H
+
+///////////////////////////////////////////////////////////////
+// Binary trace file layout (little endian):
+//
+//   TRACE_BIN_HEADER
+//   TRACE_BIN_RECORD [payload] ...
+//
+// The record size includes the record header and the payload.
+// The timestamps are QueryPerformanceCounter() values, the header
+// binds them to the wall clock.
+///////////////////////////////////////////////////////////////
+#define TRACE_BIN_SIGNATURE       "H4CTRACE"
+#define TRACE_BIN_VERSION         1
+///////////////////////////////////////////////////////////////
+struct TRACE_BIN_HEADER {
+  char signature[8];
+  DWORD version;
+  DWORD reserved;
+  TRACE_CLOCK clock;
+};
+///////////////////////////////////////////////////////////////
+struct TRACE_BIN_RECORD {
+  DWORD size;
+  WORD type;
+  WORD id;                // name ID for TRACE_BIN_REC_NAME
+  LONGLONG counter;
+};
+
+#define TRACE_BIN_REC_NAME        1     // payload: name chars
+#define TRACE_BIN_REC_TEXT        2     // payload: text chars
+#define TRACE_BIN_REC_IN          3     // payload: TRACE_BIN_MSG [union data]
+#define TRACE_BIN_REC_OUT         4     // payload: TRACE_BIN_MSG [union data]
+#define TRACE_BIN_REC_LOST        5     // payload: DWORD number of lost records
+///////////////////////////////////////////////////////////////
+struct TRACE_BIN_MSG {
+  WORD idPort;
+  WORD idFilter;
+  WORD idFromPort;        // TRACE_BIN_REC_OUT only
+  WORD reserved;
+  DWORD type;             // HUB_MSG_TYPE_*
+};
+
+// union data by HUB_MSG_UNION_TYPES_MASK of the type:
+//   BUF   - the data bytes
+//   VAL   - DWORD val
+//   PVAL  - ULONGLONG pVal, DWORD *pVal, DWORD val
+//   HVAL  - ULONGLONG hVal
+//   HVAL2 - ULONGLONG hVal0, ULONGLONG hVal1
+///////////////////////////////////////////////////////////////
+class TraceSink
+{
+  public:
+    static TraceSink *Open(const char *pPath);
+
+    // waits (up to a second) till the writer thread drains the ring
+    void Flush();
+
+    void Text(const char *pText);
+    void Msg(
+        WORD type,
+        const char *pPort,
+        const char *pFilter,
+        const char *pFromPort,
+        const HUB_MSG *pMsg);
+
+  private:
+    TraceSink(HANDLE _hFile);
+
+    BOOL NameId(const char *pName, WORD *pId);
+    BOOL Reserve(DWORD size);
+    void Put(const void *pData, DWORD size);
+    void PutRecord(WORD type, WORD id, DWORD sizePayload);
+    void Commit();
+
+    static DWORD CALLBACK WriterThread(LPVOID pParam);
+    static BOOL WINAPI CtrlHandler(DWORD ctrlType);
+    void Drain();
+
+    HANDLE hFile;
+    HANDLE hWakeup;
+    HANDLE hThread;
+
+    // single producer (the thread of the traced ports), single
+    // consumer (the writer thread), positions are free running byte
+    // counters
+
+    BYTE *pRing;
+    volatile LONG head;
+    volatile LONG tail;
+    DWORD headPut;
+
+    DWORD countLost;
+
+    typedef map<const char *, WORD> Names;
+
+    Names names;
+
+    TraceSink *pNext;
+    static TraceSink *pFirst;
+};
+///////////////////////////////////////////////////////////////
+// renders the binary trace file to the text format (render.cpp),
+// returns the exit code of tracefmt
+int RenderTraceBin(const char *pPath, ostream &tout);
+///////////////////////////////////////////////////////////////
+
+#endif  // _TRACEBIN_H
@@ -0,0 +1,50 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+#include "precomp.h"
+#include "../plugins_api.h"
+///////////////////////////////////////////////////////////////
+namespace FilterTrace {
+///////////////////////////////////////////////////////////////
+#include "print.h"
+#include "tracebin.h"
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+  if (argc != 2) {
+    cerr
+    << "Usage:" << endl
+    << "  " << argv[0] << " <path>" << endl
+    << endl
+    << "Renders to stdout the binary trace file <path> written by the trace filter" << endl
+    << "with --trace-format=binary option." << endl
+    ;
+    return 1;
+  }
+
+  return FilterTrace::RenderTraceBin(argv[1], cout);
+}
+///////////////////////////////////////////////////////////////
@@ -36,14 +36,25 @@
 #include "precomp.h"
 #include "plugins/plugins_api.h"
 
+#include "latency.h"
+#include "stats.h"
 #include "port.h"
 #include "comhub.h"
+#include "hubmsg.h"
 
 ///////////////////////////////////////////////////////////////
 Port::Port(ComHub &_hub, int _num)
   : hub(_hub),
+    pAsync(NULL),
+    credit(0),
+    creditShares(0),
     num(_num),
-    hPort(NULL)
+    hPort(NULL),
+    iActiveQueue(0),
+    routeQueued(0),
+    routeLost(0),
+    routeLostTotal(0),
+    dispatching(FALSE)
 {
   stringstream buf;
 
@@ -56,6 +67,20 @@ Port::Port(ComHub &_hub, int _num)
 #endif
 }
 
+Port::~Port()
+{
+  _ASSERTE(signature == PORT_SIGNATURE);
+
+  PurgeRoutes();
+
+  for (RouteQueueMap::const_iterator i = routeQueues.begin() ; i != routeQueues.end() ; i++)
+    delete i->second;
+
+#ifdef _DEBUG
+  signature = 0;
+#endif
+}
+
 BOOL Port::Init(
     const PORT_ROUTINES_A *pPortRoutines,
     HCONFIG hConfig,
@@ -134,15 +159,248 @@ BOOL Port::Write(HubMsg *pMsg)
 {
   _ASSERTE(pMsg != NULL);
 
+  writeStats.Add((HUB_MSG *)pMsg);
+
+  if (creditShares && pMsg->type == HUB_MSG_TYPE_LINE_DATA)
+    credit -= (LONG)pMsg->u.buf.size;
+
   if (!pWrite)
     return TRUE;
 
   return pWrite(hPort, (HUB_MSG *)pMsg);
 }
 
+void Port::WriteRouted(HubMsg *pMsg)
+{
+  Write(pMsg);
+
+  // the driver clears the output options it supports
+
+  switch (HUB_MSG_T2N(pMsg->type)) {
+    case HUB_MSG_T2N(HUB_MSG_TYPE_SET_OUT_OPTS):
+      if (pMsg->u.val) {
+        cerr << name << " WARNING: Requested output option(s) SO_0x"
+             << hex << pMsg->u.val << dec
+             << " not supported" << endl;
+      }
+      break;
+  }
+}
+
+///////////////////////////////////////////////////////////////
+#define ROUTE_QUANTUM 256   // bytes per round for weight 1
+///////////////////////////////////////////////////////////////
+Port::RouteQueue *Port::GetRouteQueue(Port *pFromPort)
+{
+  RouteQueueMap::iterator iPair = routeQueues.find(pFromPort);
+
+  if (iPair != routeQueues.end())
+    return iPair->second;
+
+  RouteQueue *pQueue = new RouteQueue(pFromPort);
+
+  if (!pQueue) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  routeQueues[pFromPort] = pQueue;
+
+  return pQueue;
+}
+
+void Port::SetRouteWeight(Port *pFromPort, DWORD weight)
+{
+  _ASSERTE(weight > 0);
+
+  GetRouteQueue(pFromPort)->weight = weight;
+}
+
+DWORD Port::RouteWeight(Port *pFromPort) const
+{
+  RouteQueueMap::const_iterator iPair = routeQueues.find(pFromPort);
+
+  return iPair != routeQueues.end() ? iPair->second->weight : 1;
+}
+
+void Port::Write(Port *pFromPort, HubMsg *pMsg)
+{
+  _ASSERTE(pMsg != NULL);
+
+  // w/o the credit the free space in the driver is unknown, so
+  // the data is queued by the driver in the order of arrival
+
+  if (!creditShares) {
+    WriteRouted(pMsg);
+    return;
+  }
+
+  RouteQueue *pQueue = GetRouteQueue(pFromPort);
+
+  if (pQueue->msgs.empty()) {
+    if (pMsg->type != HUB_MSG_TYPE_LINE_DATA || (activeQueues.empty() && credit > 0)) {
+      WriteRouted(pMsg);
+      return;
+    }
+  }
+
+  if (pMsg->type == HUB_MSG_TYPE_LINE_DATA) {
+    DWORD limit = hub.RouteLimit();
+
+    if (limit && pQueue->queued + pMsg->u.buf.size > limit) {
+      routeLost += pMsg->u.buf.size;
+      return;
+    }
+  }
+
+  HubMsg *pNewMsg = new HubMsg();
+
+  if (!pNewMsg) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  // take the message from the caller
+
+  *(HUB_MSG *)pNewMsg = *(HUB_MSG *)pMsg;
+  ::memset((HUB_MSG *)pMsg, 0, sizeof(HUB_MSG));
+
+  if (pNewMsg->type == HUB_MSG_TYPE_LINE_DATA) {
+    pQueue->queued += pNewMsg->u.buf.size;
+    routeQueued += pNewMsg->u.buf.size;
+  }
+
+  if (pQueue->msgs.empty())
+    activeQueues.push_back(pQueue);
+
+  pQueue->msgs.push_back(pNewMsg);
+
+  Dispatch();
+}
+
+void Port::Dispatch()
+{
+  // the driver can grant more credit while writing
+
+  if (dispatching)
+    return;
+
+  dispatching = TRUE;
+
+  // deficit round robin, each source gets ROUTE_QUANTUM*weight
+  // bytes per round while the credit is not exhausted
+
+  while (!activeQueues.empty()) {
+    if (iActiveQueue >= activeQueues.size())
+      iActiveQueue = 0;
+
+    RouteQueue *pQueue = activeQueues[iActiveQueue];
+
+    if (!pQueue->turn) {
+      pQueue->turn = TRUE;
+      pQueue->deficit += ROUTE_QUANTUM*pQueue->weight;
+    }
+
+    HubMsg *pMsg = pQueue->msgs.front();
+
+    if (pMsg->type == HUB_MSG_TYPE_LINE_DATA) {
+      if (credit <= 0)
+        break;
+
+      DWORD size = pMsg->u.buf.size;
+
+      if (size > pQueue->deficit) {
+        pQueue->turn = FALSE;
+        iActiveQueue++;
+        continue;
+      }
+
+      pQueue->deficit -= size;
+      pQueue->queued -= size;
+      routeQueued -= size;
+    }
+
+    pQueue->msgs.pop_front();
+
+    if (pQueue->msgs.empty()) {
+      pQueue->turn = FALSE;
+      pQueue->deficit = 0;
+      activeQueues.erase(activeQueues.begin() + iActiveQueue);
+    }
+
+    WriteRouted(pMsg);
+    delete pMsg;
+  }
+
+  dispatching = FALSE;
+}
+
+void Port::PurgeRoutes()
+{
+  // the messages waiting for the credit are lost
+
+  for (vector<RouteQueue *>::const_iterator i = activeQueues.begin() ; i != activeQueues.end() ; i++) {
+    RouteQueue *pQueue = *i;
+
+    while (!pQueue->msgs.empty()) {
+      delete pQueue->msgs.front();
+      pQueue->msgs.pop_front();
+    }
+
+    routeLost += pQueue->queued;
+    routeQueued -= pQueue->queued;
+    pQueue->queued = 0;
+    pQueue->deficit = 0;
+    pQueue->turn = FALSE;
+  }
+
+  _ASSERTE(routeQueued == 0);
+
+  activeQueues.clear();
+  iActiveQueue = 0;
+}
+
 void Port::LostReport()
 {
+  if (routeLost) {
+    routeLostTotal += routeLost;
+    cout << "Route lost " << name << ": " << routeLost << ", total " << routeLostTotal << endl;
+    routeLost = 0;
+  }
+
   if (pLostReport)
     pLostReport(hPort);
 }
+
+void Port::LatencyReport()
+{
+  readLatency.Report(name, "OnRead");
+  writeLatency.Report(name, "write queued");
+}
+
+void Port::StatAdd(const char *pName, DWORD type, const DWORD *pValue)
+{
+  _ASSERTE(pName != NULL);
+  _ASSERTE(pValue != NULL);
+
+  DriverStat stat;
+
+  stat.name = string("hub4com_port_") + pName;
+  stat.type = type;
+  stat.pValue = pValue;
+
+  driverStats.push_back(stat);
+}
+
+void Port::StatsReport(Stats &stats) const
+{
+  readStats.Report(stats, "hub4com_port_read", name);
+  writeStats.Report(stats, "hub4com_port_write", name);
+
+  stats.Add("hub4com_port_route_queued_bytes", STATS_TYPE_GAUGE, name, NULL, routeQueued);
+  stats.Add("hub4com_port_route_lost_bytes_total", STATS_TYPE_COUNTER, name, NULL, routeLostTotal + routeLost);
+
+  for (vector<DriverStat>::const_iterator i = driverStats.begin() ; i != driverStats.end() ; i++)
+    stats.Add(i->name, i->type, name, NULL, *i->pValue);
+}
 ///////////////////////////////////////////////////////////////
@@ -39,6 +39,8 @@
 ///////////////////////////////////////////////////////////////
 class ComHub;
 class HubMsg;
+class AsyncStage;
+class Stats;
 ///////////////////////////////////////////////////////////////
 #define PORT_SIGNATURE 'h4cP'
 ///////////////////////////////////////////////////////////////
@@ -46,13 +48,7 @@ class Port
 {
   public:
     Port(ComHub &_hub, int _num);
-
-#ifdef _DEBUG
-    ~Port() {
-      _ASSERTE(signature == PORT_SIGNATURE);
-      signature = 0;
-    }
-#endif
+    ~Port();
 
     BOOL Init(
         const PORT_ROUTINES_A *pPortRoutines,
@@ -61,14 +57,58 @@ class Port
     BOOL Start();
     BOOL FakeReadFilter(HubMsg *pMsg);
     BOOL Write(HubMsg *pMsg);
+    void Write(Port *pFromPort, HubMsg *pMsg);
+    void Dispatch();
+    void PurgeRoutes();
+    void SetRouteWeight(Port *pFromPort, DWORD weight);
+    DWORD RouteWeight(Port *pFromPort) const;
+    DWORD RouteQueued() const { return routeQueued; }
     const string &Name() const { return name; }
     int Num() const { return num; }
     void LostReport();
+    void LatencyReport();
+    void StatAdd(const char *pName, DWORD type, const DWORD *pValue);
+    void StatsReport(Stats &stats) const;
 
   public:
     ComHub &hub;
 
+    LatencyHist readLatency;      // ComHub::OnRead() fan-out
+    LatencyHist writeLatency;     // data queued in the driver
+
+    MsgStats readStats;           // ComHub::OnRead()
+    MsgStats writeStats;          // Port::Write()
+
+    AsyncStage *pAsync;           // stage of the async filter
+
+    LONG credit;                  // LINE_DATA bytes can be written
+    DWORD creditShares;           // ports sharing the credit (0 - no credit)
+
   private:
+    struct DriverStat {
+      string name;
+      DWORD type;
+      const DWORD *pValue;
+    };
+
+    // the queue of the messages routed from the port pFromPort
+
+    struct RouteQueue {
+      RouteQueue(Port *_pFromPort) : pFromPort(_pFromPort), weight(1), deficit(0), turn(FALSE), queued(0) {}
+
+      Port *pFromPort;
+      DWORD weight;
+      DWORD deficit;
+      BOOL turn;
+      DWORD queued;
+      deque<HubMsg *> msgs;
+    };
+
+    typedef map<Port *, RouteQueue *> RouteQueueMap;
+
+    RouteQueue *GetRouteQueue(Port *pFromPort);
+    void WriteRouted(HubMsg *pMsg);
+
     int num;
     string name;
     HPORT hPort;
@@ -78,6 +118,16 @@ class Port
     PORT_WRITE *pWrite;
     PORT_LOST_REPORT *pLostReport;
 
+    vector<DriverStat> driverStats;
+
+    RouteQueueMap routeQueues;
+    vector<RouteQueue *> activeQueues;
+    vector<RouteQueue *>::size_type iActiveQueue;
+    DWORD routeQueued;
+    DWORD routeLost;
+    DWORD routeLostTotal;
+    BOOL dispatching;
+
 #ifdef _DEBUG
     DWORD signature;
 
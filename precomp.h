@@ -43,9 +43,11 @@
 
 #include <windows.h>
 #include <crtdbg.h>
+#include <limits.h>
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <set>
 #include <map>
 #include <iostream>
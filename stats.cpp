@@ -0,0 +1,228 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "precomp.h"
+#include "plugins/plugins_api.h"
+
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////
+BOOL Stats::GetFormat(const char *pName, Format *pFormat)
+{
+  if (_stricmp(pName, "prometheus") == 0)
+    *pFormat = FORMAT_PROMETHEUS;
+  else
+  if (_stricmp(pName, "json") == 0)
+    *pFormat = FORMAT_JSON;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void Stats::Add(
+    const string &name,
+    DWORD type,
+    const string &port,
+    const char *pFilter,
+    ULONGLONG value)
+{
+  Metric &metric = metrics[name];
+
+  metric.type = type;
+
+  Sample sample;
+
+  sample.port = port;
+
+  if (pFilter)
+    sample.filter = pFilter;
+
+  sample.value = value;
+
+  metric.samples.push_back(sample);
+}
+///////////////////////////////////////////////////////////////
+void Stats::Save()
+{
+  string pathTmp = path + ".tmp";
+
+  if (Write(pathTmp.c_str())) {
+    if (!::MoveFileEx(pathTmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+      DWORD err = GetLastError();
+
+      cerr << "WARNING: MoveFileEx(" << pathTmp << ", " << path << ") - error=" << err << endl;
+    }
+  }
+
+  metrics.clear();
+}
+///////////////////////////////////////////////////////////////
+BOOL Stats::Write(const char *pPath) const
+{
+  ofstream out(pPath, ios::out | ios::trunc);
+
+  if (!out.is_open()) {
+    cerr << "WARNING: Can't open statistics file " << pPath << endl;
+    return FALSE;
+  }
+
+  if (format == FORMAT_JSON)
+    WriteJson(out);
+  else
+    WritePrometheus(out);
+
+  out.close();
+
+  if (out.fail()) {
+    cerr << "WARNING: Can't write statistics file " << pPath << endl;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static void PrintQuoted(ostream &out, const string &str)
+{
+  out << '"';
+
+  for (string::const_iterator i = str.begin() ; i != str.end() ; i++) {
+    switch (*i) {
+      case '\\':
+        out << "\\\\";
+        break;
+      case '"':
+        out << "\\\"";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        out << *i;
+    }
+  }
+
+  out << '"';
+}
+
+static void PrintJsonQuoted(ostream &out, const string &str)
+{
+  out << '"';
+
+  for (string::const_iterator i = str.begin() ; i != str.end() ; i++) {
+    switch (*i) {
+      case '\\':
+        out << "\\\\";
+        break;
+      case '"':
+        out << "\\\"";
+        break;
+      default:
+        if ((BYTE)*i < 0x20) {
+          static const char digits[] = "0123456789abcdef";
+
+          out << "\\u00" << digits[(BYTE)*i >> 4] << digits[*i & 0xF];
+        } else {
+          out << *i;
+        }
+    }
+  }
+
+  out << '"';
+}
+///////////////////////////////////////////////////////////////
+void Stats::WritePrometheus(ostream &out) const
+{
+  for (Metrics::const_iterator i = metrics.begin() ; i != metrics.end() ; i++) {
+    out << "# TYPE " << i->first << " "
+        << (i->second.type == STATS_TYPE_GAUGE ? "gauge" : "counter") << endl;
+
+    for (vector<Sample>::const_iterator j = i->second.samples.begin() ; j != i->second.samples.end() ; j++) {
+      out << i->first << "{port=";
+      PrintQuoted(out, j->port);
+
+      if (!j->filter.empty()) {
+        out << ",filter=";
+        PrintQuoted(out, j->filter);
+      }
+
+      out << "} " << j->value << endl;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+void Stats::WriteJson(ostream &out) const
+{
+  FILETIME ft;
+
+  ::GetSystemTimeAsFileTime(&ft);
+
+  ULONGLONG time = (((ULONGLONG)ft.dwHighDateTime << 32) | ft.dwLowDateTime);
+
+  // milliseconds since 1970-01-01
+
+  time = (time - 116444736000000000ULL)/10000;
+
+  out << "{" << endl
+      << "  \"timestamp_ms\": " << time << "," << endl
+      << "  \"metrics\": [";
+
+  const char *pSep = "";
+
+  for (Metrics::const_iterator i = metrics.begin() ; i != metrics.end() ; i++) {
+    for (vector<Sample>::const_iterator j = i->second.samples.begin() ; j != i->second.samples.end() ; j++) {
+      out << pSep << endl << "    {\"name\": ";
+      PrintJsonQuoted(out, i->first);
+      out << ", \"type\": \""
+          << (i->second.type == STATS_TYPE_GAUGE ? "gauge" : "counter")
+          << "\", \"labels\": {\"port\": ";
+      PrintJsonQuoted(out, j->port);
+
+      if (!j->filter.empty()) {
+        out << ", \"filter\": ";
+        PrintJsonQuoted(out, j->filter);
+      }
+
+      out << "}, \"value\": " << j->value << "}";
+
+      pSep = ",";
+    }
+  }
+
+  out << endl << "  ]" << endl << "}" << endl;
+}
+///////////////////////////////////////////////////////////////
+void MsgStats::Report(
+    Stats &stats,
+    const char *pPrefix,
+    const string &port,
+    const char *pFilter) const
+{
+  string prefix(pPrefix);
+
+  stats.Add(prefix + "_messages_total", STATS_TYPE_COUNTER, port, pFilter, msgs);
+  stats.Add(prefix + "_bytes_total", STATS_TYPE_COUNTER, port, pFilter, bytes);
+}
+///////////////////////////////////////////////////////////////
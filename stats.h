@@ -0,0 +1,108 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#ifndef _STATS_H
+#define _STATS_H
+
+///////////////////////////////////////////////////////////////
+// Statistics of ports and filters saved to a file in Prometheus
+// text exposition format or in JSON format.
+//
+// The samples are added and saved by the hub threads in turn, so no
+// any locking is needed and the I/O is not stopped for snapshot. The
+// file is replaced atomically, so a reader never gets a partially
+// written snapshot.
+///////////////////////////////////////////////////////////////
+#define STATS_TYPE_COUNTER  HUB_STAT_TYPE_COUNTER
+#define STATS_TYPE_GAUGE    HUB_STAT_TYPE_GAUGE
+///////////////////////////////////////////////////////////////
+class Stats
+{
+  public:
+    enum Format {
+      FORMAT_PROMETHEUS,
+      FORMAT_JSON
+    };
+
+    Stats(const char *pPath, Format _format) : path(pPath), format(_format) {}
+
+    static BOOL GetFormat(const char *pName, Format *pFormat);
+
+    void Add(
+        const string &name,
+        DWORD type,
+        const string &port,
+        const char *pFilter,
+        ULONGLONG value);
+    void Save();
+
+  private:
+    struct Sample {
+      string port;
+      string filter;
+      ULONGLONG value;
+    };
+
+    struct Metric {
+      DWORD type;
+      vector<Sample> samples;
+    };
+
+    typedef map<string, Metric> Metrics;
+
+    BOOL Write(const char *pPath) const;
+    void WritePrometheus(ostream &out) const;
+    void WriteJson(ostream &out) const;
+
+    string path;
+    Format format;
+    Metrics metrics;
+};
+///////////////////////////////////////////////////////////////
+class MsgStats
+{
+  public:
+    MsgStats() : msgs(0), bytes(0) {}
+
+    void Add(const HUB_MSG *pMsg) {
+      msgs++;
+
+      if (pMsg->type == HUB_MSG_TYPE_LINE_DATA)
+        bytes += pMsg->u.buf.size;
+    }
+
+    void Report(
+        Stats &stats,
+        const char *pPrefix,
+        const string &port,
+        const char *pFilter = NULL) const;
+
+  private:
+    ULONGLONG msgs;
+    ULONGLONG bytes;
+};
+///////////////////////////////////////////////////////////////
+
+#endif  // _STATS_H
@@ -0,0 +1,199 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+///////////////////////////////////////////////////////////////
+static DWORD countFailed;
+///////////////////////////////////////////////////////////////
+BOOL TestCheck(BOOL ok, const char *pExpr, const char *pFile, int line)
+{
+  if (!ok) {
+    cerr << pFile << "(" << line << "): FAILED: " << pExpr << endl;
+    countFailed++;
+  }
+
+  return ok;
+}
+
+BOOL TestCheckBytes(const BYTE *pData, const char *pHex, const char *pFile, int line)
+{
+  string expected(pHex);
+  stringstream got;
+
+  got << hex;
+
+  for (string::size_type i = 0 ; i < expected.size() / 2 ; i++)
+    got << (unsigned)(pData[i] >> 4) << (unsigned)(pData[i] & 0xF);
+
+  if (got.str() != expected) {
+    cerr << pFile << "(" << line << "): FAILED: " << endl
+         << "  expected " << expected << endl
+         << "  got      " << got.str() << endl;
+    countFailed++;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+#ifdef _WIN32
+
+LONGLONG BenchCounter()
+{
+  LARGE_INTEGER counter;
+
+  ::QueryPerformanceCounter(&counter);
+
+  return counter.QuadPart;
+}
+
+static LONGLONG BenchFrequency()
+{
+  LARGE_INTEGER frequency;
+
+  ::QueryPerformanceFrequency(&frequency);
+
+  return frequency.QuadPart;
+}
+
+#else  /* _WIN32 */
+
+LONGLONG BenchCounter()
+{
+  struct timespec ts;
+
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (LONGLONG)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+static LONGLONG BenchFrequency()
+{
+  return 1000000000;
+}
+
+#endif /* _WIN32 */
+
+double BenchSeconds(LONGLONG start)
+{
+  return double(BenchCounter() - start)/double(BenchFrequency());
+}
+///////////////////////////////////////////////////////////////
+#ifdef _WIN32
+string TestTempPath(const char *pName)
+{
+  char dir[MAX_PATH];
+
+  if (!::GetTempPath(sizeof(dir), dir))
+    dir[0] = 0;
+
+  return string(dir) + pName;
+}
+#endif /* _WIN32 */
+///////////////////////////////////////////////////////////////
+static const struct {
+  const char *pName;
+  BOOL (*pTest)();
+  void (*pBench)();
+} tests[] = {
+#ifdef _WIN32
+  { "async",        TestAsync,        BenchAsync },
+  { "bufpool",      TestBufPool,      BenchBufPool },
+#endif
+  { "cipher",       TestCipher,       BenchCipher },
+#ifdef _WIN32
+  { "escparse",     TestEscParse,     BenchEscParse },
+  { "fanout",       TestFanOut,       BenchFanOut },
+  { "filterx",      TestFilterX,      BenchFilterX },
+  { "filters",      TestFilters,      BenchFilters },
+  { "hubmsg",       TestHubMsg,       BenchHubMsg },
+  { "latencyhist",  TestLatencyHist,  BenchLatencyHist },
+  { "route",        TestRoute,        BenchRoute },
+  { "routetable",   TestRouteTable,   BenchRouteTable },
+  { "scaling",      TestScaling,      BenchScaling },
+  { "stats",        TestStats,        BenchStats },
+  { "tag",          TestTag,          BenchTag },
+  { "telnet",       TestTelnet,       BenchTelnet },
+  { "trace",        TestTrace,        BenchTrace },
+#endif
+};
+///////////////////////////////////////////////////////////////
+static void Usage(const char *pProgPath)
+{
+  cerr
+  << "Usage:" << endl
+  << "  " << pProgPath << " [--bench] [<test> ...]" << endl
+  << endl
+  << "Run the tests listed in <test> (all by default). With --bench also" << endl
+  << "run the benchmarks of the tests." << endl
+  << endl
+  << "Tests:" << endl;
+
+  for (int i = 0 ; i < int(sizeof(tests)/sizeof(tests[0])) ; i++)
+    cerr << "  " << tests[i].pName << endl;
+}
+///////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+  BOOL bench = FALSE;
+  set<string> names;
+
+  for (int i = 1 ; i < argc ; i++) {
+    if (_stricmp(argv[i], "--bench") == 0) {
+      bench = TRUE;
+    }
+    else
+    if (argv[i][0] == '-') {
+      Usage(argv[0]);
+      return 2;
+    }
+    else {
+      names.insert(argv[i]);
+    }
+  }
+
+  for (int i = 0 ; i < int(sizeof(tests)/sizeof(tests[0])) ; i++) {
+    if (!names.empty() && names.find(tests[i].pName) == names.end())
+      continue;
+
+    DWORD countFailedBefore = countFailed;
+
+    tests[i].pTest();
+
+    cout << tests[i].pName << ": " << (countFailed == countFailedBefore ? "OK" : "FAILED") << endl;
+
+    if (bench && tests[i].pBench)
+      tests[i].pBench();
+  }
+
+  if (countFailed) {
+    cout << countFailed << " check(s) failed" << endl;
+    return 1;
+  }
+
+  return 0;
+}
+///////////////////////////////////////////////////////////////
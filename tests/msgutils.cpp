@@ -0,0 +1,65 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+#include "../hubmsg.h"
+#include "../bufutils.h"
+
+///////////////////////////////////////////////////////////////
+HUB_MSG *TestNewData(const void *pData, DWORD size)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  if (!pMsg) {
+    cerr << "No enough memory." << endl;
+    exit(2);
+  }
+
+  pMsg->type = HUB_MSG_TYPE_LINE_DATA;
+  pMsg->u.buf.size = size;
+
+  BufAppend(&pMsg->u.buf.pBuf, 0, (const BYTE *)pData, size);
+
+  return pMsg;
+}
+///////////////////////////////////////////////////////////////
+string TestData(HUB_MSG *pMsg)
+{
+  string data;
+
+  for (HubMsg *pCurMsg = (HubMsg *)pMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+    if (pCurMsg->type == HUB_MSG_TYPE_LINE_DATA && pCurMsg->u.buf.size)
+      data.append((const char *)pCurMsg->u.buf.pBuf, pCurMsg->u.buf.size);
+  }
+
+  return data;
+}
+///////////////////////////////////////////////////////////////
+void TestDeleteMsg(HUB_MSG *pMsg)
+{
+  delete (HubMsg *)pMsg;
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,384 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+
+#include "tests.h"
+#include "../plugins/crypt/cipherdefs.h"
+
+#include "../latency.h"
+#include "../stats.h"
+#include "../port.h"
+#include "../comhub.h"
+#include "../filters.h"
+#include "../hubmsg.h"
+#include "../bufutils.h"
+#include "../export.h"
+
+///////////////////////////////////////////////////////////////
+namespace FilterCrypt {
+///////////////////////////////////////////////////////////////
+#include "../plugins/crypt/cipher.h"
+///////////////////////////////////////////////////////////////
+PLUGIN_INIT_A InitA;
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
+//
+// Each link is a pair of ports with the fake driver:
+//
+//   P<k> <--route--> E<k>
+//
+// The crypt filter (rc4-md5) of E<k> is async. The plain data read
+// by P<k> is encrypted by the OUT method of E<k> and the encrypted
+// data read by E<k> is decrypted by its IN method. The links are
+// reconnected by E<k> from time to time, so the ciphers are reset
+// in the middle of the data by the messages handled by the thread
+// of the port.
+//
+// The written data is compared with the data encrypted or decrypted
+// by the cipher of the test in the order of reading, so any
+// reordering of the messages changes the keystream of the data.
+//
+///////////////////////////////////////////////////////////////
+#define MAX_LINKS       16
+
+#define PORT_P(k)       ((k)*2)
+#define PORT_E(k)       ((k)*2 + 1)
+
+#define SECRET          "async"
+///////////////////////////////////////////////////////////////
+static vector<BYTE> written[MAX_LINKS*2];
+static vector<size_t> connects[MAX_LINKS*2];   // the written bytes before CONNECT
+///////////////////////////////////////////////////////////////
+static HPORT CALLBACK Create(
+    HCONFIG hConfig,
+    const char * /*pPath*/)
+{
+  // the port number + 1 is passed by hConfig
+
+  return (HPORT)hConfig;
+}
+
+static BOOL CALLBACK Write(
+    HPORT hPort,
+    HUB_MSG *pMsg)
+{
+  // called by the thread of the port only
+
+  int iPort = int((ULONG_PTR)hPort - 1);
+
+  if (pMsg->type == HUB_MSG_TYPE_CONNECT)
+    connects[iPort].push_back(written[iPort].size());
+
+  if (pMsg->type != HUB_MSG_TYPE_LINE_DATA)
+    return TRUE;
+
+  vector<BYTE> &data = written[iPort];
+
+  data.insert(data.end(), pMsg->u.buf.pBuf, pMsg->u.buf.pBuf + pMsg->u.buf.size);
+
+  return TRUE;
+}
+
+static const PORT_ROUTINES_A routines = {
+  sizeof(PORT_ROUTINES_A),
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Create,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Write,
+  NULL,
+};
+///////////////////////////////////////////////////////////////
+static BOOL NewLinks(ComHub &hub, Filters &filters, int numLinks, unsigned numWorkers)
+{
+  const PLUGIN_ROUTINES_A *const *pPlugins = FilterCrypt::InitA(&hubRoutines);
+
+  if (!TEST_CHECK(pPlugins != NULL && pPlugins[0] != NULL))
+    return FALSE;
+
+  if (!TEST_CHECK(filters.CreateFilter((const FILTER_ROUTINES_A *)pPlugins[0],
+                                       "crypt", "crypt", NULL, "--secret=" SECRET)))
+  {
+    return FALSE;
+  }
+
+  PortMap map;
+
+  for (int k = 0 ; k < numLinks ; k++) {
+    hub.Add();
+    hub.Add();
+
+    if (!TEST_CHECK(hub.InitPort(PORT_P(k), &routines, (HCONFIG)(ULONG_PTR)(PORT_P(k) + 1), "plain")) ||
+        !TEST_CHECK(hub.InitPort(PORT_E(k), &routines, (HCONFIG)(ULONG_PTR)(PORT_E(k) + 1), "encrypted")) ||
+        !TEST_CHECK(filters.AddFilter(hub.GetPort(PORT_E(k)), "crypt", TRUE, TRUE, NULL)))
+    {
+      return FALSE;
+    }
+
+    map.insert(pair<Port *const, Port *>(hub.GetPort(PORT_P(k)), hub.GetPort(PORT_E(k))));
+    map.insert(pair<Port *const, Port *>(hub.GetPort(PORT_E(k)), hub.GetPort(PORT_P(k))));
+  }
+
+  // w/o the workers the filter is called by the thread of the port
+
+  if (numWorkers) {
+    TestMute mute;
+
+    filters.SetAsync("crypt");
+
+    if (!TEST_CHECK(filters.StartAsync(numWorkers)))
+      return FALSE;
+  }
+
+  if (!TEST_CHECK(filters.CompileOutMethods()))
+    return FALSE;
+
+  hub.SetFilters(&filters);
+  hub.SetDataRoute(map);
+
+  for (int i = 0 ; i < numLinks*2 ; i++) {
+    written[i].clear();
+    connects[i].clear();
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static void Read(ComHub &hub, int iPort, DWORD type, const BYTE *pData, DWORD size)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = type;
+
+  if (type == HUB_MSG_TYPE_LINE_DATA) {
+    pMsg->u.buf.pBuf = BufAlloc(size);
+    pMsg->u.buf.size = size;
+
+    memcpy(pMsg->u.buf.pBuf, pData, size);
+  } else {
+    pMsg->u.val = size;
+  }
+
+  hub.OnRead(hub.GetPort(iPort), pMsg);
+
+  delete pMsg;
+}
+
+static FilterCrypt::Cipher *NewCipher()
+{
+  BYTE key[MD5_DIGEST_SIZE];
+
+  FilterCrypt::Md5((const BYTE *)SECRET, (DWORD)strlen(SECRET), key);
+
+  return new FilterCrypt::CipherRc4(key, MD5_DIGEST_SIZE);
+}
+///////////////////////////////////////////////////////////////
+struct Link {
+  Link() : pCipherOut(NULL), pCipherIn(NULL) {}
+  ~Link() { delete pCipherOut; delete pCipherIn; }
+
+  void Reset() {
+    delete pCipherOut;
+    pCipherOut = NewCipher();
+    delete pCipherIn;
+    pCipherIn = NewCipher();
+  }
+
+  FilterCrypt::Cipher *pCipherOut;    // expected encryption by E<k>
+  FilterCrypt::Cipher *pCipherIn;     // encryption by the peer of E<k>
+  vector<BYTE> encrypted;             // expected to be written to E<k>
+  vector<BYTE> decrypted;             // expected to be written to P<k>
+  vector<size_t> connects;            // expected CONNECT of P<k>
+};
+///////////////////////////////////////////////////////////////
+//
+// Reads count messages by each port of the links and waits for the
+// completion of the async jobs. For the checks (reconnect != 0) the
+// messages are of 1 ... size bytes, the expected data is collected
+// and the links are reconnected after each reconnect messages.
+//
+static BOOL Drive(ComHub &hub, vector<Link> &links, int count, DWORD size, int reconnect)
+{
+  int numLinks = (int)links.size();
+
+  vector<BYTE> data(size);
+  LONGLONG expected = 0;
+
+  for (int k = 0 ; k < numLinks ; k++) {
+    links[k].Reset();
+    links[k].connects.push_back(0);
+    Read(hub, PORT_E(k), HUB_MSG_TYPE_CONNECT, NULL, TRUE);
+  }
+
+  for (int i = 0 ; i < count ; i++) {
+    DWORD len = reconnect ? 1 + (i*37) % size : size;
+
+    for (int k = 0 ; k < numLinks ; k++) {
+      Link &link = links[k];
+
+      for (DWORD j = 0 ; j < len ; j++)
+        data[j] = BYTE(i + j + k);
+
+      Read(hub, PORT_P(k), HUB_MSG_TYPE_LINE_DATA, &data[0], len);
+
+      if (reconnect) {
+        link.encrypted.insert(link.encrypted.end(), data.begin(), data.begin() + len);
+        link.pCipherOut->Crypt(&link.encrypted[link.encrypted.size() - len], len);
+        link.decrypted.insert(link.decrypted.end(), data.begin(), data.begin() + len);
+      }
+
+      link.pCipherIn->Crypt(&data[0], len);
+
+      Read(hub, PORT_E(k), HUB_MSG_TYPE_LINE_DATA, &data[0], len);
+
+      expected += len*2;
+    }
+
+    if (reconnect && i % reconnect == reconnect - 1 && i + 1 < count) {
+      // let the offload threads complete the data, so the CONNECT
+      // comes while the completions are waiting for the APC
+
+      ::Sleep(10);
+
+      for (int k = 0 ; k < numLinks ; k++) {
+        Link &link = links[k];
+
+        link.Reset();
+        Read(hub, PORT_E(k), HUB_MSG_TYPE_CONNECT, NULL, FALSE);
+        Read(hub, PORT_E(k), HUB_MSG_TYPE_CONNECT, NULL, TRUE);
+
+        // the CONNECT routed to P<k> should not overtake the data
+
+        link.connects.push_back(link.decrypted.size());
+        link.connects.push_back(link.decrypted.size());
+      }
+    }
+
+    // the completed jobs are returned by APC
+
+    ::SleepEx(0, TRUE);
+  }
+
+  for (;;) {
+    LONGLONG done = 0;
+
+    for (int k = 0 ; k < numLinks ; k++)
+      done += written[PORT_P(k)].size() + written[PORT_E(k)].size();
+
+    if (done >= expected)
+      break;
+
+    if (::SleepEx(5000, TRUE) != WAIT_IO_COMPLETION) {
+      TEST_CHECK(done == expected);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static void TestLinks(int numLinks, unsigned numWorkers)
+{
+  ComHub hub;
+  Filters filters(hub);
+
+  if (!NewLinks(hub, filters, numLinks, numWorkers))
+    return;
+
+  vector<Link> links(numLinks);
+
+  if (!Drive(hub, links, 500, 300, 50))
+    return;
+
+  for (int k = 0 ; k < numLinks ; k++) {
+    if (!TEST_CHECK(written[PORT_E(k)] == links[k].encrypted) ||
+        !TEST_CHECK(written[PORT_P(k)] == links[k].decrypted) ||
+        !TEST_CHECK(connects[PORT_P(k)] == links[k].connects))
+    {
+      cout << "  link " << k << " of " << numWorkers << " workers" << endl;
+      break;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+BOOL TestAsync()
+{
+  TestLinks(4, 0);
+  TestLinks(4, 1);
+  TestLinks(4, 4);
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchAsync()
+{
+  static const int count = 2000;
+  static const DWORD size = 1024;
+
+  SYSTEM_INFO sysInfo;
+
+  ::GetSystemInfo(&sysInfo);
+
+  cout << "  " << MAX_LINKS << " encrypted links on "
+       << sysInfo.dwNumberOfProcessors << " processor(s):" << endl;
+
+  // the offload threads of the finished benchmarks are left to
+  // the process exit
+
+  for (unsigned numWorkers = 0 ; numWorkers <= 4 ; numWorkers = numWorkers ? numWorkers*2 : 1) {
+    ComHub hub;
+    Filters filters(hub);
+
+    if (!NewLinks(hub, filters, MAX_LINKS, numWorkers))
+      return;
+
+    vector<Link> links(MAX_LINKS);
+
+    LONGLONG start = BenchCounter();
+
+    if (!Drive(hub, links, count, size, 0))
+      return;
+
+    double seconds = BenchSeconds(start);
+    double bytes = double(count)*size*MAX_LINKS*2;
+
+    if (numWorkers)
+      cout << "  " << numWorkers << " offload thread(s): ";
+    else
+      cout << "  inline: ";
+
+    cout << DWORD(bytes/seconds/(1024*1024)) << " MB/s" << endl;
+  }
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,225 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "../precomp.h"
+
+#include "../bufutils.h"
+#include "tests.h"
+
+///////////////////////////////////////////////////////////////
+static DWORD CALLBACK FreeProc(LPVOID pParam)
+{
+  BufFree((BYTE *)pParam);
+
+  return 0;
+}
+///////////////////////////////////////////////////////////////
+static void TestAlloc()
+{
+  for (DWORD size = 1 ; size <= 4*BUF_POOL_MAX_BLOCK ; size = size*3 + 1) {
+    BYTE *pBuf = BufAlloc(size);
+
+    if (!TEST_CHECK(pBuf != NULL))
+      continue;
+
+    TEST_CHECK(BUF_SIZE(pBuf) >= size);
+    TEST_CHECK(BUF_REFS(pBuf) == 1);
+
+    memset(pBuf, 0xA5, BUF_SIZE(pBuf));
+
+    BufFree(pBuf);
+  }
+
+  TEST_CHECK(BufAlloc(0) == NULL);
+
+  // the freed block is reused by the next allocation of its class
+
+  BYTE *pBuf1 = BufAlloc(100);
+  BufFree(pBuf1);
+  BYTE *pBuf2 = BufAlloc(100);
+
+  TEST_CHECK(pBuf1 == pBuf2);
+
+  BufFree(pBuf2);
+}
+///////////////////////////////////////////////////////////////
+static void TestRemoteFree()
+{
+  // the block freed by other thread is returned to this pool
+
+  BYTE *pBuf1 = BufAlloc(1000);
+
+  if (!TEST_CHECK(pBuf1 != NULL))
+    return;
+
+  HANDLE hThread = ::CreateThread(NULL, 0, FreeProc, pBuf1, 0, NULL);
+
+  if (!TEST_CHECK(hThread != NULL)) {
+    BufFree(pBuf1);
+    return;
+  }
+
+  ::WaitForSingleObject(hThread, INFINITE);
+  ::CloseHandle(hThread);
+
+  BYTE *pBuf2 = BufAlloc(1000);
+
+  TEST_CHECK(pBuf1 == pBuf2);
+
+  BufFree(pBuf2);
+}
+///////////////////////////////////////////////////////////////
+static void TestShared()
+{
+  static const BYTE data[] = "0123456789";
+
+  BYTE *pBuf = NULL;
+
+  BufAppend(&pBuf, 0, data, 10);
+
+  if (!TEST_CHECK(pBuf != NULL))
+    return;
+
+  BYTE *pRef = BufRef(pBuf);
+
+  TEST_CHECK(BufIsShared(pBuf));
+
+  // the shared buffer is copied on write
+
+  BufAppend(&pBuf, 10, data, 5);
+
+  TEST_CHECK(pBuf != pRef);
+  TEST_CHECK(!BufIsShared(pRef));
+  TEST_CHECK(memcmp(pBuf, "012345678901234", 15) == 0);
+  TEST_CHECK(memcmp(pRef, "0123456789", 10) == 0);
+
+  BYTE *pRef2 = BufRef(pRef);
+
+  TEST_CHECK(BufMakeWritable(&pRef2, 10));
+  TEST_CHECK(pRef2 != pRef);
+  TEST_CHECK(memcmp(pRef2, "0123456789", 10) == 0);
+
+  BufFree(pRef2);
+  BufFree(pRef);
+  BufFree(pBuf);
+}
+///////////////////////////////////////////////////////////////
+static void TestAppend()
+{
+  DWORD total = 1024*1024;
+  BYTE *pBuf = NULL;
+  DWORD len = 0;
+  DWORD countMoves = 0;
+  BOOL ok = TRUE;
+
+  while (len < total) {
+    BYTE data[7];
+    DWORD lenData = len % sizeof(data) + 1;
+
+    for (DWORD i = 0 ; i < lenData ; i++)
+      data[i] = BYTE(len + i);
+
+    BYTE *pBufOld = pBuf;
+
+    BufAppend(&pBuf, len, data, lenData);
+
+    if (!TEST_CHECK(pBuf != NULL))
+      return;
+
+    if (pBuf != pBufOld)
+      countMoves++;
+
+    len += lenData;
+  }
+
+  for (DWORD i = 0 ; i < len && ok ; i++)
+    ok = TEST_CHECK(pBuf[i] == BYTE(i));
+
+  // the growth is geometric
+
+  TEST_CHECK(countMoves <= 32);
+
+  BufFree(pBuf);
+}
+///////////////////////////////////////////////////////////////
+BOOL TestBufPool()
+{
+  TestAlloc();
+  TestRemoteFree();
+  TestShared();
+  TestAppend();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchBufPool()
+{
+  DWORD count = 10*1000*1000;
+
+  for (DWORD size = 64 ; size <= 4096 ; size *= 8) {
+    LONGLONG start = BenchCounter();
+
+    for (DWORD i = 0 ; i < count ; i++)
+      BufFree(BufAlloc(size));
+
+    double secondsPool = BenchSeconds(start);
+
+    start = BenchCounter();
+
+    for (DWORD i = 0 ; i < count ; i++) {
+      BYTE *pBuf = new BYTE[size];
+
+      *(volatile BYTE *)pBuf = 0;
+
+      delete [] pBuf;
+    }
+
+    double secondsHeap = BenchSeconds(start);
+
+    cout << "  alloc/free " << size << " bytes: pool " << DWORD(count/secondsPool/1000) << " K/s"
+         << ", heap " << DWORD(count/secondsHeap/1000) << " K/s" << endl;
+  }
+
+  DWORD total = 64*1024*1024;
+  BYTE data[16];
+
+  memset(data, 0x5A, sizeof(data));
+
+  LONGLONG start = BenchCounter();
+
+  BYTE *pBuf = NULL;
+
+  for (DWORD len = 0 ; len < total ; len += sizeof(data))
+    BufAppend(&pBuf, len, data, sizeof(data));
+
+  double seconds = BenchSeconds(start);
+
+  BufFree(pBuf);
+
+  cout << "  append " << sizeof(data) << " bytes: " << DWORD(total/seconds/(1024*1024)) << " MB/s" << endl;
+
+  BufPool::Trim();
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,243 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+#include "../plugins/crypt/cipherdefs.h"
+
+///////////////////////////////////////////////////////////////
+namespace FilterCrypt {
+///////////////////////////////////////////////////////////////
+#include "../plugins/crypt/cipher.h"
+///////////////////////////////////////////////////////////////
+} // end namespace
+///////////////////////////////////////////////////////////////
+using namespace FilterCrypt;
+///////////////////////////////////////////////////////////////
+static void Unhex(const char *pHex, BYTE *pData)
+{
+  for (; pHex[0] && pHex[1] ; pHex += 2) {
+    char tmp[3] = { pHex[0], pHex[1], 0 };
+
+    *pData++ = (BYTE)strtoul(tmp, NULL, 16);
+  }
+}
+///////////////////////////////////////////////////////////////
+// RFC 1321
+///////////////////////////////////////////////////////////////
+static void TestMd5()
+{
+  static const struct {
+    const char *pMsg;
+    const char *pDigest;
+  } vectors[] = {
+    { "", "d41d8cd98f00b204e9800998ecf8427e" },
+    { "a", "0cc175b9c0f1b6a831c399e269772661" },
+    { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+    { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+    { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+    { "12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+      "57edf4a22be3c955ac49da2e2107b67a" },
+  };
+
+  for (int i = 0 ; i < int(sizeof(vectors)/sizeof(vectors[0])) ; i++) {
+    BYTE digest[MD5_DIGEST_SIZE];
+
+    Md5((const BYTE *)vectors[i].pMsg, (DWORD)strlen(vectors[i].pMsg), digest);
+    TEST_CHECK_BYTES(digest, vectors[i].pDigest);
+  }
+}
+///////////////////////////////////////////////////////////////
+// FIPS 180-2
+///////////////////////////////////////////////////////////////
+static void TestSha256()
+{
+  static const struct {
+    const char *pMsg;
+    const char *pDigest;
+  } vectors[] = {
+    { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+  };
+
+  for (int i = 0 ; i < int(sizeof(vectors)/sizeof(vectors[0])) ; i++) {
+    BYTE digest[SHA256_DIGEST_SIZE];
+
+    Sha256((const BYTE *)vectors[i].pMsg, (DWORD)strlen(vectors[i].pMsg), digest);
+    TEST_CHECK_BYTES(digest, vectors[i].pDigest);
+  }
+
+  // one million of 'a'
+
+  DWORD len = 1000000;
+  BYTE *pMsg = new BYTE[len];
+
+  memset(pMsg, 'a', len);
+
+  BYTE digest[SHA256_DIGEST_SIZE];
+
+  Sha256(pMsg, len, digest);
+  TEST_CHECK_BYTES(digest, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+  delete [] pMsg;
+}
+///////////////////////////////////////////////////////////////
+static void TestRc4()
+{
+  static const struct {
+    const char *pKey;
+    const char *pMsg;
+    const char *pCipher;
+  } vectors[] = {
+    { "Key", "Plaintext", "bbf316e8d940af0ad3" },
+    { "Wiki", "pedia", "1021bf0420" },
+    { "Secret", "Attack at dawn", "45a01f645fc35b383552544b9bf5" },
+  };
+
+  for (int i = 0 ; i < int(sizeof(vectors)/sizeof(vectors[0])) ; i++) {
+    BYTE buf[64];
+    DWORD len = (DWORD)strlen(vectors[i].pMsg);
+
+    memcpy(buf, vectors[i].pMsg, len);
+
+    CipherRc4 rc4((const BYTE *)vectors[i].pKey, (DWORD)strlen(vectors[i].pKey));
+
+    rc4.Crypt(buf, len);
+    TEST_CHECK_BYTES(buf, vectors[i].pCipher);
+  }
+}
+///////////////////////////////////////////////////////////////
+// RFC 8439 (the 96-bit nonce of the RFC is the high word of the
+// 64-bit block counter followed by the 64-bit nonce)
+///////////////////////////////////////////////////////////////
+static void TestChaCha20()
+{
+  BYTE key[CHACHA20_KEY_SIZE];
+  BYTE nonce[CHACHA20_NONCE_SIZE];
+
+  // A.1 test vector #1
+
+  memset(key, 0, sizeof(key));
+  memset(nonce, 0, sizeof(nonce));
+
+  BYTE block[CHACHA20_BLOCK_SIZE];
+
+  memset(block, 0, sizeof(block));
+
+  CipherChaCha20(key, nonce).Crypt(block, sizeof(block));
+  TEST_CHECK_BYTES(block,
+    "76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7"
+    "da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586");
+
+  // 2.4.2 with the counter 1
+
+  for (int i = 0 ; i < CHACHA20_KEY_SIZE ; i++)
+    key[i] = (BYTE)i;
+
+  Unhex("0000004a00000000", nonce);
+
+  static const char msg[] =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one "
+    "tip for the future, sunscreen would be it.";
+
+  static const char cipher[] =
+    "6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0b"
+    "f91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f530c359f0861d8"
+    "07ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736"
+    "5af90bbf74a35be6b40b8eedf2785e42874d";
+
+  DWORD len = sizeof(msg) - 1;
+  BYTE buf[sizeof(msg)];
+
+  memcpy(buf, msg, len);
+
+  CipherChaCha20(key, nonce, 1).Crypt(buf, len);
+  TEST_CHECK_BYTES(buf, cipher);
+
+  // the same by the pieces of different size and alignment
+
+  for (DWORD step = 1 ; step < 80 ; step += 7) {
+    memcpy(buf, msg, len);
+
+    CipherChaCha20 chacha20(key, nonce, 1);
+
+    for (DWORD done = 0 ; done < len ; done += step)
+      chacha20.Crypt(buf + done, (len - done < step) ? len - done : step);
+
+    TEST_CHECK_BYTES(buf, cipher);
+  }
+
+  // decrypting restores the message
+
+  CipherChaCha20(key, nonce, 1).Crypt(buf, len);
+  TEST_CHECK(memcmp(buf, msg, len) == 0);
+}
+///////////////////////////////////////////////////////////////
+BOOL TestCipher()
+{
+  TestMd5();
+  TestSha256();
+  TestRc4();
+  TestChaCha20();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static void BenchCrypt(const char *pName, Cipher &cipher)
+{
+  DWORD lenBuf = 4096;
+  DWORD total = 64*1024*1024;
+  BYTE *pBuf = new BYTE[lenBuf];
+
+  memset(pBuf, 0x5A, lenBuf);
+
+  LONGLONG start = BenchCounter();
+
+  for (DWORD done = 0 ; done < total ; done += lenBuf)
+    cipher.Crypt(pBuf, lenBuf);
+
+  double seconds = BenchSeconds(start);
+
+  cout << "  " << pName << ": " << DWORD(total/seconds/(1024*1024)) << " MB/s" << endl;
+
+  delete [] pBuf;
+}
+
+void BenchCipher()
+{
+  BYTE key[CHACHA20_KEY_SIZE];
+  BYTE nonce[CHACHA20_NONCE_SIZE];
+
+  memset(key, 0x11, sizeof(key));
+  memset(nonce, 0x22, sizeof(nonce));
+
+  CipherRc4 rc4(key, MD5_DIGEST_SIZE);
+  CipherChaCha20 chacha20(key, nonce);
+
+  BenchCrypt("rc4", rc4);
+  BenchCrypt("chacha20", chacha20);
+}
+///////////////////////////////////////////////////////////////
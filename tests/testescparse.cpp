@@ -0,0 +1,419 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+#include "../hubmsg.h"
+#include "../export.h"
+#include "../plugins/cncext.h"
+
+///////////////////////////////////////////////////////////////
+namespace FilterEscParse {
+PLUGIN_INIT_A InitA;
+}
+///////////////////////////////////////////////////////////////
+#define ESC 0xFF
+#define ALL_OPTIONS (GO1_V2O_MODEM_STATUS(-1)|GO1_V2O_LINE_STATUS(-1)|GO1_BREAK_STATUS|GO1_RBR_STATUS|GO1_RLC_STATUS)
+#define MST_MASK VAL2MASK(0xFF)
+#define MST_DELTAS (MODEM_STATUS_DCTS|MODEM_STATUS_DDSR|MODEM_STATUS_TERI|MODEM_STATUS_DDCD)
+///////////////////////////////////////////////////////////////
+//
+// The filter has no master port and filter, so it gets them from here
+//
+static const char *CALLBACK PortName(HMASTERPORT /*hMasterPort*/)
+{
+  return "TEST";
+}
+
+static const char *CALLBACK FilterName(HMASTERFILTER /*hMasterFilter*/)
+{
+  return "escparse";
+}
+
+static HMASTERPORT CALLBACK FilterPort(HMASTERFILTERINSTANCE /*hMasterFilterInstance*/)
+{
+  return (HMASTERPORT)1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// The instance of the escparse filter with all options accepted
+//
+class EscParse
+{
+  public:
+    EscParse();
+    ~EscParse();
+
+    // returns the messages of the data parsed in the chunks ending at the
+    // splits, the adjacent modem statuses are merged if merge is TRUE
+    string Parse(const string &data, const vector<string::size_type> &splits, BOOL merge = FALSE);
+
+    void Feed(const string &data);
+
+  private:
+    void In(HubMsg *pMsg);
+    void AddEvent(char type, DWORD val, BOOL merge);
+
+    const FILTER_ROUTINES_A *pRoutines;
+    HFILTER hFilter;
+    HFILTERINSTANCE hFilterInstance;
+
+    vector< pair<char, DWORD> > events;
+};
+
+EscParse::EscParse()
+  : pRoutines(NULL),
+    hFilter(NULL),
+    hFilterInstance(NULL)
+{
+  HUB_ROUTINES_A routines = hubRoutines;
+
+  routines.pPortName = PortName;
+  routines.pFilterName = FilterName;
+  routines.pFilterPort = FilterPort;
+
+  const PLUGIN_ROUTINES_A *const *pPlugins = FilterEscParse::InitA(&routines);
+
+  if (!TEST_CHECK(pPlugins != NULL))
+    return;
+
+  pRoutines = (const FILTER_ROUTINES_A *)pPlugins[0];
+
+  static const char *const argv[] = { "escparse" };
+
+  hFilter = pRoutines->pCreate((HMASTERFILTER)1, NULL, 1, argv);
+  hFilterInstance = pRoutines->pCreateInstance((HMASTERFILTERINSTANCE)1);
+
+  // the subsequent filters intercept all options
+
+  DWORD options = 0;
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = HUB_MSG_TYPE_GET_IN_OPTS;
+  pMsg->u.pv.pVal = &options;
+  pMsg->u.pv.val = ALL_OPTIONS | GO_I2O(1);
+
+  In(pMsg);
+
+  for (HubMsg *pCurMsg = pMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+    if (pCurMsg->type == HUB_MSG_TYPE_GET_IN_OPTS && pCurMsg->u.pv.pVal != &options)
+      *pCurMsg->u.pv.pVal |= pCurMsg->u.pv.val & ~GO_I2O(-1);
+  }
+
+  delete pMsg;
+
+  // so the escape mode is requested
+
+  pMsg = new HubMsg();
+
+  pMsg->type = HUB_MSG_TYPE_GET_IN_OPTS;
+  pMsg->u.pv.pVal = &options;
+  pMsg->u.pv.val = GO0_ESCAPE_MODE | GO_I2O(0);
+
+  In(pMsg);
+
+  delete pMsg;
+
+  TEST_CHECK(options == GO0_ESCAPE_MODE);
+}
+
+EscParse::~EscParse()
+{
+  if (hFilterInstance)
+    pRoutines->pDeleteInstance(hFilterInstance);
+
+  if (hFilter)
+    pRoutines->pDelete(hFilter);
+}
+
+void EscParse::In(HubMsg *pMsg)
+{
+  HUB_MSG *pEchoMsg = NULL;
+
+  TEST_CHECK(pRoutines->pInMethod(hFilter, hFilterInstance, pMsg, &pEchoMsg));
+  TEST_CHECK(pEchoMsg == NULL);
+}
+
+void EscParse::Feed(const string &data)
+{
+  HubMsg *pMsg = (HubMsg *)TestNewData(data.data(), (DWORD)data.size());
+
+  In(pMsg);
+
+  delete pMsg;
+}
+
+void EscParse::AddEvent(char type, DWORD val, BOOL merge)
+{
+  if (!events.empty() && events.back().first == type) {
+    if (type == 'D') {
+      // the data split by the chunks
+      events.back().second += val;
+      return;
+    }
+
+    if (type == 'M' && merge) {
+      // the modem statuses split by the chunks, the changes
+      // reported by the previous one are not lost
+      events.back().second = (events.back().second & MST_DELTAS) | val;
+      return;
+    }
+  }
+
+  events.push_back(pair<char, DWORD>(type, val));
+}
+
+string EscParse::Parse(const string &data, const vector<string::size_type> &splits, BOOL merge)
+{
+  events.clear();
+
+  string::size_type begin = 0;
+
+  for (vector<string::size_type>::size_type i = 0 ; i <= splits.size() ; i++) {
+    string::size_type end = (i < splits.size()) ? splits[i] : data.size();
+
+    if (end == begin)
+      continue;
+
+    HubMsg *pMsg = (HubMsg *)TestNewData(data.data() + begin, DWORD(end - begin));
+
+    In(pMsg);
+
+    for (HubMsg *pCurMsg = pMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+      switch (pCurMsg->type) {
+        case HUB_MSG_TYPE_EMPTY:
+          break;
+        case HUB_MSG_TYPE_LINE_DATA:
+          if (pCurMsg->u.buf.size)
+            AddEvent('D', pCurMsg->u.buf.size, merge);
+          break;
+        case HUB_MSG_TYPE_MODEM_STATUS:
+          AddEvent('M', pCurMsg->u.val, merge);
+          break;
+        case HUB_MSG_TYPE_LINE_STATUS:
+          AddEvent('L', pCurMsg->u.val, merge);
+          break;
+        case HUB_MSG_TYPE_BREAK_STATUS:
+          AddEvent('B', pCurMsg->u.val, merge);
+          break;
+        case HUB_MSG_TYPE_RBR_STATUS:
+          AddEvent('R', pCurMsg->u.val, merge);
+          break;
+        case HUB_MSG_TYPE_RLC_STATUS:
+          AddEvent('C', pCurMsg->u.val, merge);
+          break;
+        default:
+          AddEvent('?', pCurMsg->type, merge);
+      }
+    }
+
+    delete pMsg;
+
+    begin = end;
+  }
+
+  stringstream buf;
+
+  for (vector< pair<char, DWORD> >::const_iterator i = events.begin() ; i != events.end() ; i++)
+    buf << i->first << hex << i->second << " ";
+
+  return buf.str();
+}
+///////////////////////////////////////////////////////////////
+static string Bytes(const BYTE *pData, size_t size)
+{
+  return string((const char *)pData, size);
+}
+
+static vector<string::size_type> NoSplits()
+{
+  return vector<string::size_type>();
+}
+
+static vector<string::size_type> Split(string::size_type pos)
+{
+  return vector<string::size_type>(1, pos);
+}
+
+static vector<string::size_type> SplitEach(string::size_type size)
+{
+  vector<string::size_type> splits;
+
+  for (string::size_type pos = 1 ; pos < size ; pos++)
+    splits.push_back(pos);
+
+  return splits;
+}
+///////////////////////////////////////////////////////////////
+static void TestSplit()
+{
+  static const BYTE data[] = {
+    'a', 'b',
+    ESC, SERIAL_LSRMST_ESCAPE,
+    'c',
+    ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DCTS|MODEM_STATUS_CTS,
+    ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DDSR|MODEM_STATUS_CTS|MODEM_STATUS_DSR,
+    'd',
+    ESC, SERIAL_LSRMST_LSR_DATA, LINE_STATUS_PE, 'e',
+    ESC, SERIAL_LSRMST_LSR_DATA, LINE_STATUS_BI, 0,
+    ESC, SERIAL_LSRMST_LSR_NODATA, LINE_STATUS_OE,
+    ESC, C0CE_INSERT_RBR, 0x00, 0x96, 0x00, 0x00,
+    ESC, C0CE_INSERT_RLC, 8, EVENPARITY, TWOSTOPBITS,
+    'f', ESC,
+  };
+
+  string org = Bytes(data, sizeof(data));
+  string expected;
+
+  {
+    EscParse escparse;
+
+    expected = escparse.Parse(org, NoSplits());
+
+    TEST_CHECK(expected ==
+      "D4 "
+      "Mff0033 "
+      "D1 "
+      "B0 Lff0004 D1 "
+      "B1 Lff0010 "
+      "B0 Lff0002 "
+      "R9600 "
+      "C7020208 "
+      "D1 ");
+  }
+
+  // the escape sequences at the ends of the buffers
+
+  for (string::size_type pos = 0 ; pos <= org.size() ; pos++) {
+    EscParse escparse;
+
+    TEST_CHECK(escparse.Parse(org, Split(pos), TRUE) == expected);
+  }
+
+  {
+    EscParse escparse;
+
+    TEST_CHECK(escparse.Parse(org, SplitEach(org.size()), TRUE) == expected);
+  }
+}
+///////////////////////////////////////////////////////////////
+static void TestCoalesce()
+{
+  EscParse escparse;
+
+  // only the last modem status but the changes of all
+
+  {
+    static const BYTE data[] = {
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DCTS|MODEM_STATUS_CTS,
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_CTS|MODEM_STATUS_DSR,
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DDSR|MODEM_STATUS_TERI|MODEM_STATUS_DSR,
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DDCD|MODEM_STATUS_DCD,
+    };
+
+    TEST_CHECK(escparse.Parse(Bytes(data, sizeof(data)), NoSplits()) == "Mff008f ");
+  }
+
+  // no coalescing across the data
+
+  {
+    static const BYTE data[] = {
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DCTS|MODEM_STATUS_CTS,
+      'a',
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DDSR|MODEM_STATUS_CTS|MODEM_STATUS_DSR,
+      ESC, SERIAL_LSRMST_ESCAPE,
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DCTS|MODEM_STATUS_DSR,
+    };
+
+    TEST_CHECK(escparse.Parse(Bytes(data, sizeof(data)), NoSplits()) == "Mff0011 D1 Mff0032 D1 Mff0021 ");
+  }
+
+  // no coalescing across the line status
+
+  {
+    static const BYTE data[] = {
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DCTS|MODEM_STATUS_CTS,
+      ESC, SERIAL_LSRMST_LSR_NODATA, LINE_STATUS_OE,
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_DDSR|MODEM_STATUS_CTS|MODEM_STATUS_DSR,
+      ESC, SERIAL_LSRMST_LSR_DATA, LINE_STATUS_FE, 'b',
+      ESC, SERIAL_LSRMST_MST, MODEM_STATUS_CTS,
+    };
+
+    TEST_CHECK(escparse.Parse(Bytes(data, sizeof(data)), NoSplits()) ==
+      "Mff0011 B0 Lff0002 Mff0032 B0 Lff0008 D1 Mff0010 ");
+  }
+}
+///////////////////////////////////////////////////////////////
+BOOL TestEscParse()
+{
+  TestSplit();
+  TestCoalesce();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchEscParse()
+{
+  static const DWORD size = 1024*1024;
+  static const DWORD chunk = 4096;
+  static const int percents[] = { 0, 1, 10 };
+
+  for (int p = 0 ; p < int(sizeof(percents)/sizeof(percents[0])) ; p++) {
+    string data;
+
+    srand(1);
+
+    while (data.size() < size) {
+      if (rand() % 100 < percents[p]) {
+        data += (char)ESC;
+        data += (char)SERIAL_LSRMST_MST;
+        data += (char)(rand() & 0xFF);
+      } else {
+        data += (char)(rand() % ESC);
+      }
+    }
+
+    vector<string> chunks;
+
+    for (string::size_type pos = 0 ; pos < data.size() ; pos += chunk)
+      chunks.push_back(data.substr(pos, chunk));
+
+    EscParse escparse;
+    int count = 20;
+
+    LONGLONG start = BenchCounter();
+
+    for (int i = 0 ; i < count ; i++) {
+      for (vector<string>::const_iterator c = chunks.begin() ; c != chunks.end() ; c++)
+        escparse.Feed(*c);
+    }
+
+    double seconds = BenchSeconds(start);
+
+    cout << "  " << percents[p] << "% of escapes: "
+         << DWORD(double(data.size())*count/(1024*1024)/seconds) << " MB/s" << endl;
+  }
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,222 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+#include "../latency.h"
+#include "../stats.h"
+#include "../port.h"
+#include "../comhub.h"
+#include "../hubmsg.h"
+#include "../bufutils.h"
+
+///////////////////////////////////////////////////////////////
+//
+// The data read by the source port P(0) is routed to the sink ports
+// P(1) ... P(N) with the fake drivers. The driver of the sink writing
+// in place makes its data writable first, as the driver encrypting
+// or escaping the data would do. So the sinks writing in place copy
+// the data for each sink, as Clone() did before the data was shared.
+//
+///////////////////////////////////////////////////////////////
+static const BYTE *pReadBuf;
+static BOOL writeInPlace;
+static DWORD numWritten;
+static LONGLONG bytesWritten;
+static LONGLONG bytesCopied;
+static vector<string> written;
+static BOOL logWritten = TRUE;
+///////////////////////////////////////////////////////////////
+static HPORT CALLBACK Create(
+    HCONFIG /*hConfig*/,
+    const char * /*pPath*/)
+{
+  return (HPORT)1;
+}
+
+static BOOL CALLBACK Write(
+    HPORT /*hPort*/,
+    HUB_MSG *pMsg)
+{
+  if (pMsg->type != HUB_MSG_TYPE_LINE_DATA)
+    return TRUE;
+
+  DWORD size = pMsg->u.buf.size;
+
+  if (writeInPlace && !BufMakeWritable(&pMsg->u.buf.pBuf, size))
+    return FALSE;
+
+  if (pMsg->u.buf.pBuf != pReadBuf)
+    bytesCopied += size;
+
+  numWritten++;
+  bytesWritten += size;
+
+  if (logWritten)
+    written.push_back(string((const char *)pMsg->u.buf.pBuf, size));
+
+  // the data of the other sinks is not changed
+  if (writeInPlace)
+    pMsg->u.buf.pBuf[0] = (BYTE)~pMsg->u.buf.pBuf[0];
+
+  return TRUE;
+}
+
+static const PORT_ROUTINES_A routines = {
+  sizeof(PORT_ROUTINES_A),
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Create,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Write,
+  NULL,
+};
+///////////////////////////////////////////////////////////////
+static BOOL NewFanOut(ComHub &hub, DWORD numSinks)
+{
+  PortMap map;
+
+  for (DWORD i = 0 ; i <= numSinks ; i++) {
+    hub.Add();
+
+    if (!TEST_CHECK(hub.InitPort(i, &routines, NULL, i ? "sink" : "source")))
+      return FALSE;
+
+    if (i)
+      map.insert(pair<Port *const, Port *>(hub.GetPort(0), hub.GetPort(i)));
+  }
+
+  hub.SetDataRoute(map);
+
+  return TRUE;
+}
+
+static void Read(ComHub &hub, DWORD size, DWORD seq)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = HUB_MSG_TYPE_LINE_DATA;
+  pMsg->u.buf.pBuf = BufAlloc(size);
+  pMsg->u.buf.size = size;
+
+  for (DWORD i = 0 ; i < size ; i++)
+    pMsg->u.buf.pBuf[i] = BYTE(seq + i);
+
+  pReadBuf = pMsg->u.buf.pBuf;
+
+  hub.OnRead(hub.GetPort(0), pMsg);
+
+  delete pMsg;
+}
+
+static void ResetWritten()
+{
+  numWritten = 0;
+  bytesWritten = 0;
+  bytesCopied = 0;
+  written.clear();
+}
+///////////////////////////////////////////////////////////////
+static void TestFanOut(DWORD numSinks, BOOL inPlace)
+{
+  ComHub hub;
+
+  if (!NewFanOut(hub, numSinks))
+    return;
+
+  writeInPlace = inPlace;
+  ResetWritten();
+
+  Read(hub, 100, 7);
+
+  TEST_CHECK(numWritten == numSinks);
+  TEST_CHECK(bytesWritten == 100*numSinks);
+
+  for (vector<string>::size_type i = 0 ; i < written.size() ; i++) {
+    if (!TEST_CHECK(written[i].size() == 100 && BYTE(written[i][0]) == 7 && BYTE(written[i][99]) == 106))
+      break;
+  }
+
+  // the data is copied only by the sinks writing in place
+
+  TEST_CHECK(bytesCopied == (inPlace ? 100*numSinks : 0));
+
+  writeInPlace = FALSE;
+}
+///////////////////////////////////////////////////////////////
+BOOL TestFanOut()
+{
+  TestFanOut(1, FALSE);
+  TestFanOut(16, FALSE);
+  TestFanOut(1, TRUE);
+  TestFanOut(16, TRUE);
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchFanOut()
+{
+  static const DWORD size = 1024;
+  static const DWORD sinks[] = { 1, 4, 16, 64 };
+
+  for (int inPlace = 0 ; inPlace <= 1 ; inPlace++) {
+    for (int s = 0 ; s < int(sizeof(sinks)/sizeof(sinks[0])) ; s++) {
+      ComHub hub;
+
+      if (!NewFanOut(hub, sinks[s]))
+        return;
+
+      DWORD count = 256*1024/sinks[s];
+
+      writeInPlace = inPlace;
+      logWritten = FALSE;
+      ResetWritten();
+
+      LONGLONG start = BenchCounter();
+
+      for (DWORD seq = 0 ; seq < count ; seq++)
+        Read(hub, size, seq);
+
+      double seconds = BenchSeconds(start);
+
+      writeInPlace = FALSE;
+      logWritten = TRUE;
+
+      cout << "  1 to " << sinks[s] << (inPlace ? " written in place" : "")
+           << ": " << DWORD(count/seconds/1000) << " K reads/s"
+           << ", " << DWORD(bytesWritten/seconds/(1024*1024)) << " MB/s written"
+           << ", " << DWORD(bytesCopied/count) << " bytes copied per " << size << " bytes read" << endl;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,315 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+#include "../latency.h"
+#include "../stats.h"
+#include "../port.h"
+#include "../comhub.h"
+#include "../filters.h"
+#include "../hubmsg.h"
+
+///////////////////////////////////////////////////////////////
+//
+// The filters F(1) ... F(NUM_FILTERS) are added to each of the ports
+// P(0) ... P(NUM_PORTS - 1), some of them w/o the OUT method or with
+// the OUT method for some source ports only. The OUT methods compiled
+// by CompileOutMethods() are compared with the OUT methods found by
+// the walk through the filters of the destination port for each
+// message, as Filters::OutMethod() did before.
+//
+///////////////////////////////////////////////////////////////
+#define NUM_PORTS   8
+#define NUM_FILTERS 6
+///////////////////////////////////////////////////////////////
+typedef pair<HFILTER, HFILTERINSTANCE> Called;
+
+static vector<Called> called;
+static BOOL logCalled = TRUE;
+static ULONG_PTR numInstances;
+///////////////////////////////////////////////////////////////
+static HPORT CALLBACK Create(
+    HCONFIG /*hConfig*/,
+    const char * /*pPath*/)
+{
+  return (HPORT)1;
+}
+
+static const PORT_ROUTINES_A portRoutines = {
+  sizeof(PORT_ROUTINES_A),
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Create,
+};
+///////////////////////////////////////////////////////////////
+static HFILTER CALLBACK CreateFilter(
+    HMASTERFILTER /*hMasterFilter*/,
+    HCONFIG /*hConfig*/,
+    int /*argc*/,
+    const char *const argv[])
+{
+  // the name is F<n>
+
+  return (HFILTER)(ULONG_PTR)atoi(argv[0] + 1);
+}
+
+static HFILTERINSTANCE CALLBACK CreateInstance(
+    HMASTERFILTERINSTANCE /*hMasterFilterInstance*/)
+{
+  return (HFILTERINSTANCE)++numInstances;
+}
+
+static BOOL CALLBACK InMethod(
+    HFILTER /*hFilter*/,
+    HFILTERINSTANCE /*hFilterInstance*/,
+    HUB_MSG * /*pInMsg*/,
+    HUB_MSG ** /*ppEchoMsg*/)
+{
+  return TRUE;
+}
+
+static BOOL CALLBACK OutMethod(
+    HFILTER hFilter,
+    HFILTERINSTANCE hFilterInstance,
+    HMASTERPORT /*hFromPort*/,
+    HUB_MSG * /*pOutMsg*/)
+{
+  if (logCalled)
+    called.push_back(Called(hFilter, hFilterInstance));
+
+  return TRUE;
+}
+
+static const FILTER_ROUTINES_A filterRoutines = {
+  sizeof(FILTER_ROUTINES_A),
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  CreateFilter,
+  NULL,
+  CreateInstance,
+  NULL,
+  InMethod,
+  OutMethod,
+  NULL,
+};
+///////////////////////////////////////////////////////////////
+//
+// The filters of the port as they were added
+//
+struct RefInstance
+{
+  HFILTER hFilter;
+  HFILTERINSTANCE hFilterInstance;
+  BOOL addOutMethod;
+  set<Port *> srcPorts;
+};
+
+typedef map<Port *, vector<RefInstance> > RefPortFilters;
+///////////////////////////////////////////////////////////////
+static BOOL RefOutMethod(
+    const RefPortFilters &portFilters,
+    Port *pFromPort,
+    Port *pToPort,
+    HubMsg *pOutMsg)
+{
+  RefPortFilters::const_iterator iPair = portFilters.find(pToPort);
+
+  if (iPair == portFilters.end())
+    return TRUE;
+
+  for (vector<RefInstance>::const_reverse_iterator i = iPair->second.rbegin() ; i != iPair->second.rend() ; i++) {
+    if (i->addOutMethod && (i->srcPorts.empty() ||
+        i->srcPorts.find(pFromPort) != i->srcPorts.end()))
+    {
+      for (HubMsg *pCurMsg = pOutMsg ; pCurMsg ; pCurMsg = pCurMsg->Next()) {
+        if (!OutMethod(i->hFilter, i->hFilterInstance, (HMASTERPORT)pFromPort, pCurMsg))
+          return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static BOOL NewFilters(ComHub &hub, Filters &filters, RefPortFilters &portFilters)
+{
+  numInstances = 0;
+
+  for (int i = 0 ; i < NUM_PORTS ; i++) {
+    hub.Add();
+
+    if (!TEST_CHECK(hub.InitPort(i, &portRoutines, NULL, "port")))
+      return FALSE;
+  }
+
+  for (int f = 1 ; f <= NUM_FILTERS ; f++) {
+    stringstream group;
+    stringstream name;
+
+    group << "G" << f;
+    name << "F" << f;
+
+    if (!TEST_CHECK(filters.CreateFilter(&filterRoutines, group.str().c_str(), name.str().c_str(), NULL, NULL)))
+      return FALSE;
+  }
+
+  for (int i = 0 ; i < NUM_PORTS ; i++) {
+    Port *pPort = hub.GetPort(i);
+
+    for (int f = 1 ; f <= NUM_FILTERS ; f++) {
+      stringstream group;
+
+      group << "G" << f;
+
+      RefInstance instance;
+
+      instance.hFilter = (HFILTER)(ULONG_PTR)f;
+      instance.hFilterInstance = (HFILTERINSTANCE)(numInstances + 1);
+      instance.addOutMethod = ((i + f) % 5 != 0);
+
+      if ((i*f) % 3 == 0) {
+        instance.srcPorts.insert(hub.GetPort(f % NUM_PORTS));
+        instance.srcPorts.insert(hub.GetPort((i + f) % NUM_PORTS));
+      }
+
+      if (!TEST_CHECK(filters.AddFilter(pPort, group.str().c_str(), TRUE, instance.addOutMethod,
+                                        instance.srcPorts.empty() ? NULL : &instance.srcPorts)))
+      {
+        return FALSE;
+      }
+
+      portFilters[pPort].push_back(instance);
+    }
+  }
+
+  return TEST_CHECK(numInstances == NUM_PORTS*NUM_FILTERS) && TEST_CHECK(filters.CompileOutMethods());
+}
+///////////////////////////////////////////////////////////////
+BOOL TestFilters()
+{
+  ComHub hub;
+  Filters filters(hub);
+  RefPortFilters portFilters;
+
+  if (!NewFilters(hub, filters, portFilters))
+    return FALSE;
+
+  // the OUT methods of each (from, to) pair are called in the same order
+  // for each message
+
+  HubMsgChain chain;
+
+  chain.Append(new HubMsg());
+  chain.Append(new HubMsg());
+
+  HubMsg *pMsg = chain.Detach();
+  DWORD numCalled = 0;
+
+  for (int iFrom = 0 ; iFrom < NUM_PORTS ; iFrom++) {
+    for (int iTo = 0 ; iTo < NUM_PORTS ; iTo++) {
+      Port *pFromPort = hub.GetPort(iFrom);
+      Port *pToPort = hub.GetPort(iTo);
+
+      called.clear();
+      TEST_CHECK(RefOutMethod(portFilters, pFromPort, pToPort, pMsg));
+      vector<Called> expected = called;
+
+      called.clear();
+      TEST_CHECK(filters.OutMethod(pFromPort, pToPort, pMsg));
+
+      if (!TEST_CHECK(called == expected)) {
+        cerr << "  from " << iFrom << " to " << iTo << endl;
+        break;
+      }
+
+      numCalled += (DWORD)called.size();
+    }
+  }
+
+  // some pairs have not all OUT methods
+
+  TEST_CHECK(numCalled > 0 && numCalled < NUM_PORTS*NUM_PORTS*NUM_FILTERS*2);
+
+  delete pMsg;
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchFilters()
+{
+  ComHub hub;
+  Filters filters(hub);
+  RefPortFilters portFilters;
+
+  if (!NewFilters(hub, filters, portFilters))
+    return;
+
+  HubMsg *pMsg = new HubMsg();
+  DWORD count = 100*1000;
+
+  logCalled = FALSE;
+
+  LONGLONG start = BenchCounter();
+
+  for (DWORD n = 0 ; n < count ; n++) {
+    for (int iFrom = 0 ; iFrom < NUM_PORTS ; iFrom++) {
+      for (int iTo = 0 ; iTo < NUM_PORTS ; iTo++)
+        RefOutMethod(portFilters, hub.GetPort(iFrom), hub.GetPort(iTo), pMsg);
+    }
+  }
+
+  double secondsWalk = BenchSeconds(start);
+
+  start = BenchCounter();
+
+  for (DWORD n = 0 ; n < count ; n++) {
+    for (int iFrom = 0 ; iFrom < NUM_PORTS ; iFrom++) {
+      for (int iTo = 0 ; iTo < NUM_PORTS ; iTo++)
+        filters.OutMethod(hub.GetPort(iFrom), hub.GetPort(iTo), pMsg);
+    }
+  }
+
+  double secondsCompiled = BenchSeconds(start);
+
+  logCalled = TRUE;
+
+  delete pMsg;
+
+  count *= NUM_PORTS*NUM_PORTS;
+
+  cout << "  " << NUM_PORTS << " ports x " << NUM_FILTERS << " filters OUT:"
+       << " walk " << DWORD(count/secondsWalk/1000) << " K msg/s"
+       << ", compiled " << DWORD(count/secondsCompiled/1000) << " K msg/s" << endl;
+}
+///////////////////////////////////////////////////////////////
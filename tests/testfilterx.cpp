@@ -0,0 +1,160 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+
+#include "tests.h"
+
+///////////////////////////////////////////////////////////////
+namespace PortSerial {
+#include "../plugins/serial/filterx.h"
+}
+///////////////////////////////////////////////////////////////
+using namespace PortSerial;
+///////////////////////////////////////////////////////////////
+#define XON   0x11
+#define XOFF  0x13
+///////////////////////////////////////////////////////////////
+//
+// The data w/o the xOn and xOff chars removed char by char
+//
+static string Reference(const string &data)
+{
+  string res;
+
+  for (string::size_type i = 0 ; i < data.size() ; i++) {
+    if (data[i] != (char)XON && data[i] != (char)XOFF)
+      res += data[i];
+  }
+
+  return res;
+}
+///////////////////////////////////////////////////////////////
+static string Strip(const string &data)
+{
+  vector<BYTE> buf(data.begin(), data.end());
+  buf.push_back(0xEE);  // a guard after the data
+
+  DWORD len = DWORD(data.size());
+  DWORD off = FindX(&buf[0], len, XON, XOFF);
+
+  if (off == len)
+    return data;
+
+  TEST_CHECK(off < len && (buf[off] == XON || buf[off] == XOFF));
+  TEST_CHECK(Reference(data.substr(0, off)) == data.substr(0, off));
+
+  len = StripX(&buf[0], off, len, XON, XOFF);
+
+  TEST_CHECK(buf[data.size()] == 0xEE);
+
+  return string(buf.begin(), buf.begin() + len);
+}
+///////////////////////////////////////////////////////////////
+static string RandomData(string::size_type size, int percent)
+{
+  string data;
+
+  while (data.size() < size) {
+    if (rand() % 100 < percent)
+      data += (char)(rand() & 1 ? XON : XOFF);
+    else
+      data += (char)(rand() & 0xFF);
+  }
+
+  return data;
+}
+///////////////////////////////////////////////////////////////
+static void TestExamples()
+{
+  TEST_CHECK(Strip("") == "");
+  TEST_CHECK(Strip("abc") == "abc");
+  TEST_CHECK(Strip("\x11") == "");
+  TEST_CHECK(Strip("\x13\x11\x13") == "");
+  TEST_CHECK(Strip("\x11" "abc") == "abc");
+  TEST_CHECK(Strip("abc\x13") == "abc");
+  TEST_CHECK(Strip("a\x13" "b\x11" "c") == "abc");
+  TEST_CHECK(Strip("ab\x13\x13\x11" "cd\x11") == "abcd");
+}
+///////////////////////////////////////////////////////////////
+static void TestRandom()
+{
+  static const int percents[] = { 0, 1, 10, 50, 100 };
+
+  srand(1);
+
+  for (int p = 0 ; p < int(sizeof(percents)/sizeof(percents[0])) ; p++) {
+    for (int i = 0 ; i < 200 ; i++) {
+      string data = RandomData(rand() % 300, percents[p]);
+
+      if (!TEST_CHECK(Strip(data) == Reference(data)))
+        return;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+BOOL TestFilterX()
+{
+  TestExamples();
+  TestRandom();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchFilterX()
+{
+  static const DWORD size = 4096;
+  static const int percents[] = { 0, 1, 10 };
+
+  for (int p = 0 ; p < int(sizeof(percents)/sizeof(percents[0])) ; p++) {
+    srand(1);
+
+    string data = RandomData(size, percents[p]);
+
+    if (percents[p] == 0)
+      data = Reference(data);  // clean, only FindX() is called
+
+    vector<BYTE> buf(size);
+    int count = 20000;
+
+    LONGLONG start = BenchCounter();
+
+    for (int i = 0 ; i < count ; i++) {
+      memcpy(&buf[0], data.data(), data.size());
+
+      DWORD len = DWORD(data.size());
+      DWORD off = FindX(&buf[0], len, XON, XOFF);
+
+      if (off < len)
+        StripX(&buf[0], off, len, XON, XOFF);
+
+    }
+
+    double seconds = BenchSeconds(start);
+
+    cout << "  " << (percents[p] ? "dirty, " : "clean, ") << percents[p] << "% of xOn/xOff: "
+         << DWORD(double(data.size())*count/(1024*1024)/seconds) << " MB/s" << endl;
+  }
+}
+///////////////////////////////////////////////////////////////
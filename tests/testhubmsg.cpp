@@ -0,0 +1,243 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "../precomp.h"
+#include "../plugins/plugins_api.h"
+
+#include "../hubmsg.h"
+#include "../bufutils.h"
+#include "tests.h"
+
+///////////////////////////////////////////////////////////////
+static HubMsg *NewDataMsg(DWORD size, BYTE fill)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = HUB_MSG_TYPE_LINE_DATA;
+  pMsg->u.buf.pBuf = BufAlloc(size);
+  pMsg->u.buf.size = size;
+
+  if (pMsg->u.buf.pBuf)
+    memset(pMsg->u.buf.pBuf, fill, size);
+
+  return pMsg;
+}
+
+static HubMsg *NewValMsg(DWORD type, DWORD val)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = type;
+  pMsg->u.val = val;
+
+  return pMsg;
+}
+///////////////////////////////////////////////////////////////
+static void TestPool()
+{
+  // the deleted message is reused by the next allocation
+
+  HubMsg *pMsg1 = new HubMsg();
+  delete pMsg1;
+  HubMsg *pMsg2 = new HubMsg();
+
+  TEST_CHECK(pMsg1 == pMsg2);
+  TEST_CHECK(pMsg2->type == HUB_MSG_TYPE_EMPTY);
+  TEST_CHECK(pMsg2->Next() == NULL);
+
+  delete pMsg2;
+}
+///////////////////////////////////////////////////////////////
+static void TestClone()
+{
+  HubMsgChain chain;
+
+  chain.Append(NewDataMsg(10, 'a'));
+  chain.Append(NewValMsg(HUB_MSG_TYPE_CONNECT, TRUE));
+  chain.Append(NewDataMsg(1000, 'b'));
+  chain.Append(NewValMsg(HUB_MSG_TYPE_MODEM_STATUS, 0x30 | VAL2MASK(0xF0)));
+
+  HubMsg *pMsg = chain.Detach();
+  HubMsg *pClone = pMsg->Clone();
+
+  if (!TEST_CHECK(pClone != NULL)) {
+    delete pMsg;
+    return;
+  }
+
+  int count = 0;
+  HubMsg *pOrig = pMsg;
+
+  for (HubMsg *pCopy = pClone ; pCopy ; pCopy = pCopy->Next(), pOrig = pOrig->Next()) {
+    if (!TEST_CHECK(pOrig != NULL))
+      break;
+
+    count++;
+
+    TEST_CHECK(pCopy != pOrig);
+    TEST_CHECK(pCopy->type == pOrig->type);
+
+    if (pCopy->type == HUB_MSG_TYPE_LINE_DATA) {
+      // the data is shared till it is written
+
+      TEST_CHECK(pCopy->u.buf.pBuf == pOrig->u.buf.pBuf);
+      TEST_CHECK(pCopy->u.buf.size == pOrig->u.buf.size);
+      TEST_CHECK(BUF_REFS(pCopy->u.buf.pBuf) == 2);
+    } else {
+      TEST_CHECK(pCopy->u.val == pOrig->u.val);
+    }
+  }
+
+  TEST_CHECK(count == 4);
+
+  delete pMsg;
+
+  HubMsg *pData = pClone->Next()->Next();
+
+  TEST_CHECK(BUF_REFS(pClone->u.buf.pBuf) == 1);
+  TEST_CHECK(BUF_REFS(pData->u.buf.pBuf) == 1);
+  TEST_CHECK(pClone->u.buf.pBuf[9] == 'a');
+  TEST_CHECK(pData->u.buf.pBuf[999] == 'b');
+
+  delete pClone;
+}
+///////////////////////////////////////////////////////////////
+static void TestLongChain()
+{
+  // the chain is deleted w/o the recursion
+
+  HubMsg *pHead = NewValMsg(HUB_MSG_TYPE_CONNECT, TRUE);
+
+  for (DWORD i = 0 ; i < 1000000 ; i++)
+    NewValMsg(HUB_MSG_TYPE_CONNECT, i)->Insert(pHead);
+
+  HubMsg *pClone = pHead->Clone();
+
+  TEST_CHECK(pClone != NULL);
+
+  delete pHead;
+  delete pClone;
+}
+///////////////////////////////////////////////////////////////
+static void TestStress()
+{
+  // random alloc, clone and free of the chains sharing the buffers
+
+  HubMsg *slots[64];
+  DWORD seed = 1;
+
+  memset(slots, 0, sizeof(slots));
+
+  for (DWORD i = 0 ; i < 200000 ; i++) {
+    seed = seed*1103515245 + 12345;
+
+    HubMsg *&pSlot = slots[(seed >> 16) % 64];
+
+    switch ((seed >> 8) % 4) {
+    case 0:
+      delete pSlot;
+      pSlot = NewDataMsg((seed >> 4) % 3000 + 1, BYTE(i));
+      break;
+    case 1:
+      if (pSlot) {
+        HubMsgChain chain;
+
+        chain.Append(pSlot);
+        chain.Append(NewValMsg(HUB_MSG_TYPE_CONNECT, i));
+        pSlot = chain.Detach();
+      }
+      break;
+    case 2:
+      if (pSlot) {
+        HubMsg *&pOther = slots[(seed >> 20) % 64];
+
+        if (&pOther != &pSlot) {
+          delete pOther;
+          pOther = pSlot->Clone();
+        }
+      }
+      break;
+    default:
+      delete pSlot;
+      pSlot = NULL;
+    }
+  }
+
+  for (int i = 0 ; i < 64 ; i++) {
+    for (HubMsg *pMsg = slots[i] ; pMsg ; pMsg = pMsg->Next()) {
+      if (pMsg->type == HUB_MSG_TYPE_LINE_DATA)
+        TEST_CHECK(BUF_REFS(pMsg->u.buf.pBuf) > 0);
+    }
+
+    delete slots[i];
+  }
+}
+///////////////////////////////////////////////////////////////
+BOOL TestHubMsg()
+{
+  TestPool();
+  TestClone();
+  TestLongChain();
+  TestStress();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchHubMsg()
+{
+  DWORD count = 10*1000*1000;
+
+  LONGLONG start = BenchCounter();
+
+  for (DWORD i = 0 ; i < count ; i++)
+    delete new HubMsg();
+
+  double seconds = BenchSeconds(start);
+
+  cout << "  new/delete: " << DWORD(count/seconds/1000) << " K/s" << endl;
+
+  HubMsgChain chain;
+
+  for (int i = 0 ; i < 4 ; i++) {
+    chain.Append(NewDataMsg(256, 0x5A));
+    chain.Append(NewValMsg(HUB_MSG_TYPE_CONNECT, TRUE));
+  }
+
+  HubMsg *pMsg = chain.Detach();
+
+  count /= 8;
+
+  start = BenchCounter();
+
+  for (DWORD i = 0 ; i < count ; i++)
+    delete pMsg->Clone();
+
+  seconds = BenchSeconds(start);
+
+  cout << "  clone/delete of 8 messages: " << DWORD(count/seconds/1000) << " K/s" << endl;
+
+  delete pMsg;
+}
+///////////////////////////////////////////////////////////////
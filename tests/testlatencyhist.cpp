@@ -0,0 +1,151 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+
+#include "tests.h"
+
+#include "../latency.h"
+
+///////////////////////////////////////////////////////////////
+#ifdef USE_LATENCY_STATS
+///////////////////////////////////////////////////////////////
+#define TICKS_MAX   ((LONGLONG)(~(ULONGLONG)0 >> 1))   // 2^63 - 1
+///////////////////////////////////////////////////////////////
+//
+// The ticks are in the bucket and the reported value of the bucket
+// is less than 1/8 higher
+//
+static BOOL CheckTicks(LONGLONG ticks)
+{
+  int iBucket = LatencyHist::BucketIndex(ticks);
+
+  if (!TEST_CHECK(iBucket >= 0 && iBucket < LATENCY_BUCKETS))
+    return FALSE;
+
+  LONGLONG value = LatencyHist::BucketValue(iBucket);
+
+  if (!TEST_CHECK(value >= ticks) ||
+      !TEST_CHECK(value - ticks <= ticks/LATENCY_SUB_BUCKETS) ||
+      !TEST_CHECK(iBucket == 0 || LatencyHist::BucketValue(iBucket - 1) < ticks))
+  {
+    cout << "  ticks " << ticks << ", bucket " << iBucket << ", value " << value << endl;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static void TestBoundaries()
+{
+  // the linear buckets and the first two logarithmic ranges
+
+  for (LONGLONG ticks = 0 ; ticks <= 4*LATENCY_SUB_BUCKETS ; ticks++) {
+    if (!CheckTicks(ticks))
+      return;
+  }
+
+  TEST_CHECK(LatencyHist::BucketIndex(-1) == 0);
+  TEST_CHECK(LatencyHist::BucketIndex(7) == 7);
+  TEST_CHECK(LatencyHist::BucketIndex(8) == 8);
+  TEST_CHECK(LatencyHist::BucketValue(8) == 8);
+  TEST_CHECK(LatencyHist::BucketIndex(15) == 15);
+  TEST_CHECK(LatencyHist::BucketIndex(16) == 16);
+  TEST_CHECK(LatencyHist::BucketIndex(17) == 16);
+  TEST_CHECK(LatencyHist::BucketValue(16) == 17);
+
+  // around each power of two up to 2^63
+
+  for (int bit = 3 ; bit < 63 ; bit++) {
+    LONGLONG pow2 = (LONGLONG)1 << bit;
+
+    if (!CheckTicks(pow2 - 1) || !CheckTicks(pow2) || !CheckTicks(pow2 + 1))
+      return;
+
+    TEST_CHECK(LatencyHist::BucketIndex(pow2) == LatencyHist::BucketIndex(pow2 - 1) + 1);
+  }
+
+  CheckTicks(TICKS_MAX);
+
+  TEST_CHECK(LatencyHist::BucketIndex(TICKS_MAX) == LATENCY_BUCKETS - 1);
+  TEST_CHECK(LatencyHist::BucketValue(LATENCY_BUCKETS - 1) == TICKS_MAX);
+}
+///////////////////////////////////////////////////////////////
+static void TestBuckets()
+{
+  // the buckets cover all the values w/o gaps
+
+  for (int iBucket = 1 ; iBucket < LATENCY_BUCKETS ; iBucket++) {
+    LONGLONG lower = LatencyHist::BucketValue(iBucket - 1) + 1;
+
+    if (!TEST_CHECK(LatencyHist::BucketIndex(lower) == iBucket) ||
+        !TEST_CHECK(LatencyHist::BucketIndex(LatencyHist::BucketValue(iBucket)) == iBucket))
+    {
+      cout << "  bucket " << iBucket << endl;
+      return;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+BOOL TestLatencyHist()
+{
+  TestBoundaries();
+  TestBuckets();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchLatencyHist()
+{
+  static const int count = 10000000;
+
+  vector<DWORD> buckets(LATENCY_BUCKETS);
+  LONGLONG ticks = 1;
+
+  LONGLONG start = BenchCounter();
+
+  for (int i = 0 ; i < count ; i++) {
+    buckets[LatencyHist::BucketIndex(ticks)]++;
+    ticks = ticks*5 + 1;
+    ticks &= 0xFFFFFFF;
+  }
+
+  double seconds = BenchSeconds(start);
+
+  cout << "  BucketIndex(): " << DWORD(count/seconds/1000000) << " M/s" << endl;
+}
+///////////////////////////////////////////////////////////////
+#else   /* USE_LATENCY_STATS */
+///////////////////////////////////////////////////////////////
+BOOL TestLatencyHist()
+{
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchLatencyHist()
+{
+}
+///////////////////////////////////////////////////////////////
+#endif  /* USE_LATENCY_STATS */
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,444 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "../precomp.h"
+#include "../plugins/plugins_api.h"
+
+#include "../latency.h"
+#include "../stats.h"
+#include "../port.h"
+#include "../comhub.h"
+#include "../hubmsg.h"
+#include "../bufutils.h"
+#include "tests.h"
+
+///////////////////////////////////////////////////////////////
+//
+// The sink port P(0) with a fake driver gets the data routed from
+// the source ports P(1), P(2), ... and sends it when the credit is
+// granted. The data of each message is the number of the source
+// port and the sequence number of the message.
+//
+///////////////////////////////////////////////////////////////
+#define QUANTUM 256   // ROUTE_QUANTUM of port.cpp
+///////////////////////////////////////////////////////////////
+struct Written {
+  DWORD type;
+  DWORD src;
+  DWORD seq;
+  DWORD size;
+};
+
+static vector<Written> written;
+static BOOL logWritten = TRUE;
+static DWORD supportedOutOpts = 0;
+///////////////////////////////////////////////////////////////
+static HPORT CALLBACK Create(
+    HCONFIG /*hConfig*/,
+    const char * /*pPath*/)
+{
+  return (HPORT)1;
+}
+
+static BOOL CALLBACK Write(
+    HPORT /*hPort*/,
+    HUB_MSG *pMsg)
+{
+  if (pMsg->type == HUB_MSG_TYPE_SET_OUT_OPTS)
+    pMsg->u.val &= ~supportedOutOpts;
+
+  if (!logWritten)
+    return TRUE;
+
+  Written w;
+
+  w.type = pMsg->type;
+
+  if (pMsg->type == HUB_MSG_TYPE_LINE_DATA) {
+    w.src = pMsg->u.buf.pBuf[0];
+    w.seq = *(DWORD *)(pMsg->u.buf.pBuf + 1);
+    w.size = pMsg->u.buf.size;
+  } else {
+    w.src = pMsg->u.val;
+    w.seq = 0;
+    w.size = 0;
+  }
+
+  written.push_back(w);
+
+  return TRUE;
+}
+
+static const PORT_ROUTINES_A routines = {
+  sizeof(PORT_ROUTINES_A),
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Create,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Write,
+  NULL,
+};
+///////////////////////////////////////////////////////////////
+static void Send(Port *pSink, Port *pSrc, DWORD seq, DWORD size)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = HUB_MSG_TYPE_LINE_DATA;
+  pMsg->u.buf.pBuf = BufAlloc(size);
+  pMsg->u.buf.size = size;
+
+  memset(pMsg->u.buf.pBuf, 0, size);
+  pMsg->u.buf.pBuf[0] = (BYTE)pSrc->Num();
+  *(DWORD *)(pMsg->u.buf.pBuf + 1) = seq;
+
+  // the port takes the data if it's queued
+
+  pSink->Write(pSrc, pMsg);
+
+  delete pMsg;
+}
+
+static void SendConnect(Port *pSink, Port *pSrc)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = HUB_MSG_TYPE_CONNECT;
+  pMsg->u.val = pSrc->Num();
+
+  pSink->Write(pSrc, pMsg);
+
+  delete pMsg;
+}
+
+static void SendOutOpts(Port *pSink, Port *pSrc, DWORD opts)
+{
+  HubMsg *pMsg = new HubMsg();
+
+  pMsg->type = HUB_MSG_TYPE_SET_OUT_OPTS;
+  pMsg->u.val = opts;
+
+  pSink->Write(pSrc, pMsg);
+
+  delete pMsg;
+}
+
+static void Grant(Port *pSink, LONG credit)
+{
+  pSink->credit += credit;
+  pSink->Dispatch();
+}
+
+static DWORD Bytes(DWORD src, vector<Written>::size_type end)
+{
+  DWORD bytes = 0;
+
+  for (vector<Written>::size_type i = 0 ; i < end ; i++) {
+    if (written[i].type == HUB_MSG_TYPE_LINE_DATA && written[i].src == src)
+      bytes += written[i].size;
+  }
+
+  return bytes;
+}
+///////////////////////////////////////////////////////////////
+static Port *NewSink(ComHub &hub, DWORD numSrcs)
+{
+  for (DWORD i = 0 ; i <= numSrcs ; i++)
+    hub.Add();
+
+  if (!TEST_CHECK(hub.InitPort(0, &routines, NULL, "sink")))
+    return NULL;
+
+  Port *pSink = hub.GetPort(0);
+
+  pSink->credit = 0;
+  pSink->creditShares = 1;
+
+  written.clear();
+
+  return pSink;
+}
+///////////////////////////////////////////////////////////////
+static void TestPassThrough()
+{
+  ComHub hub;
+  Port *pSink = NewSink(hub, 1);
+
+  if (!pSink)
+    return;
+
+  // nothing is queued while there is the credit
+
+  pSink->credit = 1000;
+
+  Send(pSink, hub.GetPort(1), 0, 100);
+
+  TEST_CHECK(written.size() == 1);
+  TEST_CHECK(pSink->RouteQueued() == 0);
+  TEST_CHECK(pSink->credit == 900);
+}
+///////////////////////////////////////////////////////////////
+static void TestFairness()
+{
+  ComHub hub;
+  Port *pSink = NewSink(hub, 2);
+
+  if (!pSink)
+    return;
+
+  Port *pSrc1 = hub.GetPort(1);
+  Port *pSrc2 = hub.GetPort(2);
+
+  hub.SetRouteWeight(pSrc1, pSink, 1);
+  hub.SetRouteWeight(pSrc2, pSink, 3);
+
+  for (DWORD seq = 0 ; seq < 400 ; seq++) {
+    Send(pSink, pSrc1, seq, 64);
+    Send(pSink, pSrc2, seq, 64);
+  }
+
+  TEST_CHECK(written.empty());
+  TEST_CHECK(pSink->RouteQueued() == 2*400*64);
+
+  // while both sources are backlogged the credit is shared 1:3
+
+  while (Bytes(1, written.size()) + Bytes(2, written.size()) < 16000)
+    Grant(pSink, 128);
+
+  DWORD bytes1 = Bytes(1, written.size());
+  DWORD bytes2 = Bytes(2, written.size());
+
+  TEST_CHECK(bytes2 <= 3*bytes1 + 4*QUANTUM);
+  TEST_CHECK(3*bytes1 <= bytes2 + 4*QUANTUM);
+
+  Grant(pSink, 2*400*64);
+
+  TEST_CHECK(pSink->RouteQueued() == 0);
+  TEST_CHECK(Bytes(1, written.size()) == 400*64);
+  TEST_CHECK(Bytes(2, written.size()) == 400*64);
+
+  // the order of each source is kept
+
+  DWORD next[3] = { 0, 0, 0 };
+  BOOL ok = TRUE;
+
+  for (vector<Written>::size_type i = 0 ; i < written.size() && ok ; i++)
+    ok = TEST_CHECK(written[i].seq == next[written[i].src]++);
+}
+///////////////////////////////////////////////////////////////
+static void TestLatency()
+{
+  ComHub hub;
+  Port *pSink = NewSink(hub, 2);
+
+  if (!pSink)
+    return;
+
+  Port *pBulk = hub.GetPort(1);
+  Port *pLight = hub.GetPort(2);
+
+  for (DWORD seq = 0 ; seq < 1000 ; seq++)
+    Send(pSink, pBulk, seq, 64);
+
+  Grant(pSink, 1000);
+
+  // the message of the light source does not wait for the backlog
+  // of the bulk source, only for its quantum
+
+  Send(pSink, pLight, 0, 64);
+
+  vector<Written>::size_type start = written.size();
+
+  while (Bytes(2, written.size()) == 0)
+    Grant(pSink, 64);
+
+  vector<Written>::size_type end = written.size() - 1;
+
+  TEST_CHECK(Bytes(1, end) - Bytes(1, start) <= 2*QUANTUM);
+
+  // the non-data message waits for the data before it
+
+  SendConnect(pSink, pLight);
+
+  TEST_CHECK(written.back().type == HUB_MSG_TYPE_CONNECT);
+
+  pSink->credit = 0;
+
+  vector<Written>::size_type count = written.size();
+
+  Send(pSink, pLight, 1, 64);
+  SendConnect(pSink, pLight);
+
+  TEST_CHECK(written.size() == count);
+
+  while (Bytes(2, written.size()) < 2*64)
+    Grant(pSink, 64);
+
+  TEST_CHECK(written.back().type == HUB_MSG_TYPE_CONNECT);
+  TEST_CHECK(written.back().src == 2);
+}
+///////////////////////////////////////////////////////////////
+static void TestLimit()
+{
+  ComHub hub;
+  Port *pSink = NewSink(hub, 1);
+
+  if (!pSink)
+    return;
+
+  Port *pSrc = hub.GetPort(1);
+
+  // not limited by default
+
+  for (DWORD seq = 0 ; seq < 100 ; seq++)
+    Send(pSink, pSrc, seq, 64);
+
+  TEST_CHECK(pSink->RouteQueued() == 100*64);
+
+  pSink->PurgeRoutes();
+
+  TEST_CHECK(pSink->RouteQueued() == 0);
+
+  Grant(pSink, 100*64);
+
+  TEST_CHECK(written.empty());
+
+  // the data over the limit is discarded
+
+  pSink->credit = 0;
+  hub.SetRouteLimit(640);
+
+  for (DWORD seq = 0 ; seq < 100 ; seq++)
+    Send(pSink, pSrc, seq, 64);
+
+  TEST_CHECK(pSink->RouteQueued() == 640);
+
+  Grant(pSink, 100*64);
+
+  TEST_CHECK(written.size() == 10);
+}
+///////////////////////////////////////////////////////////////
+static void TestOutOpts()
+{
+  ComHub hub;
+  Port *pSink = NewSink(hub, 1);
+
+  if (!pSink)
+    return;
+
+  Port *pSrc = hub.GetPort(1);
+  ostringstream warnings;
+  streambuf *pCerrBuf = cerr.rdbuf(warnings.rdbuf());
+
+  supportedOutOpts = SO_SET_BR;
+
+  // the options not cleared by the driver are reported
+
+  SendOutOpts(pSink, pSrc, SO_SET_BR);
+
+  TEST_CHECK(warnings.str().empty());
+
+  SendOutOpts(pSink, pSrc, SO_SET_BR|SO_SET_LC);
+
+  TEST_CHECK(warnings.str().find("SO_0x2000000 not supported") != string::npos);
+
+  // the options queued after the data are reported when they are
+  // written, not when they are queued
+
+  warnings.str("");
+
+  Send(pSink, pSrc, 0, 64);
+  SendOutOpts(pSink, pSrc, SO_SET_BR|SO_SET_LC);
+
+  TEST_CHECK(pSink->RouteQueued() == 64);
+  TEST_CHECK(warnings.str().empty());
+
+  Grant(pSink, 64);
+
+  TEST_CHECK(written.back().type == HUB_MSG_TYPE_SET_OUT_OPTS);
+  TEST_CHECK(warnings.str().find("SO_0x2000000 not supported") != string::npos);
+
+  warnings.str("");
+
+  Send(pSink, pSrc, 1, 64);
+  SendOutOpts(pSink, pSrc, SO_SET_BR);
+  Grant(pSink, 64);
+
+  TEST_CHECK(warnings.str().empty());
+
+  supportedOutOpts = 0;
+  cerr.rdbuf(pCerrBuf);
+}
+///////////////////////////////////////////////////////////////
+BOOL TestRoute()
+{
+  TestPassThrough();
+  TestFairness();
+  TestLatency();
+  TestLimit();
+  TestOutOpts();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchRoute()
+{
+  ComHub hub;
+  DWORD numSrcs = 8;
+  Port *pSink = NewSink(hub, numSrcs);
+
+  if (!pSink)
+    return;
+
+  DWORD count = 2*1000*1000;
+
+  logWritten = FALSE;
+
+  LONGLONG start = BenchCounter();
+
+  for (DWORD seq = 0 ; seq < count/numSrcs ; seq++) {
+    for (DWORD i = 1 ; i <= numSrcs ; i++)
+      Send(pSink, hub.GetPort(i), seq, 64);
+
+    Grant(pSink, numSrcs*64);
+  }
+
+  double seconds = BenchSeconds(start);
+
+  logWritten = TRUE;
+
+  cout << "  " << numSrcs << " sources of 64 bytes: " << DWORD(count/seconds/1000) << " K msg/s"
+       << ", queued " << pSink->RouteQueued() << " bytes" << endl;
+
+  pSink->PurgeRoutes();
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,227 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+#include "../latency.h"
+#include "../stats.h"
+#include "../port.h"
+#include "../comhub.h"
+
+///////////////////////////////////////////////////////////////
+static HPORT CALLBACK Create(
+    HCONFIG /*hConfig*/,
+    const char * /*pPath*/)
+{
+  return (HPORT)1;
+}
+
+static const PORT_ROUTINES_A routines = {
+  sizeof(PORT_ROUTINES_A),
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Create,
+};
+///////////////////////////////////////////////////////////////
+static BOOL NewPorts(ComHub &hub, unsigned numPorts, Ports &ports)
+{
+  for (unsigned i = 0 ; i < numPorts ; i++) {
+    hub.Add();
+
+    if (!TEST_CHECK(hub.InitPort(i, &routines, NULL, "port")))
+      return FALSE;
+
+    ports.push_back(hub.GetPort(i));
+  }
+
+  return TRUE;
+}
+
+static void AddRoute(PortMap &map, Port *pFromPort, Port *pToPort)
+{
+  map.insert(pair<Port *const, Port *>(pFromPort, pToPort));
+}
+
+static PortMap RandomMap(const Ports &ports, unsigned numRoutes)
+{
+  PortMap map;
+
+  srand(1);
+
+  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+    // some ports have no routes
+    if (rand() % 8 == 0)
+      continue;
+
+    for (unsigned n = 0 ; n < numRoutes ; n++)
+      AddRoute(map, *i, ports[rand() % ports.size()]);
+  }
+
+  return map;
+}
+///////////////////////////////////////////////////////////////
+static void TestTable()
+{
+  ComHub hub;
+  Ports ports;
+
+  if (!NewPorts(hub, 64, ports))
+    return;
+
+  PortMap map = RandomMap(ports, 4);
+  RouteTable table;
+
+  BuildRouteTable(ports, map, table);
+
+  if (!TEST_CHECK(table.index.size() == ports.size() + 1))
+    return;
+
+  TEST_CHECK(table.ports.size() == map.size());
+
+  // the routes of each port in the same order as in the map
+
+  for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+    Ports::size_type num = (*i)->Num();
+    Ports routes;
+
+    for (PortMap::const_iterator iPair = map.find(*i) ; iPair != map.end() && iPair->first == *i ; iPair++)
+      routes.push_back(iPair->second);
+
+    if (!TEST_CHECK(Ports(table.ports.begin() + table.index[num], table.ports.begin() + table.index[num + 1]) == routes))
+      break;
+  }
+}
+///////////////////////////////////////////////////////////////
+static void TestReport()
+{
+  ComHub hub;
+  Ports ports;
+
+  if (!NewPorts(hub, 4, ports))
+    return;
+
+  PortMap map;
+
+  AddRoute(map, ports[0], ports[3]);
+  AddRoute(map, ports[0], ports[1]);
+  AddRoute(map, ports[0], ports[2]);
+
+  hub.SetDataRoute(map);
+
+  map.clear();
+
+  AddRoute(map, ports[1], ports[0]);
+
+  hub.SetFlowControlRoute(map);
+
+  stringstream report;
+  streambuf *pBuf = cout.rdbuf(report.rdbuf());
+
+  hub.RouteReport();
+
+  cout.rdbuf(pBuf);
+
+  TEST_CHECK(report.str() ==
+    "Route data " + ports[0]->Name() + " --> " + ports[3]->Name() + " " + ports[1]->Name() + " " + ports[2]->Name() + "\n"
+    "Route flow control " + ports[1]->Name() + " --> " + ports[0]->Name() + "\n");
+
+  hub.SetFlowControlRoute(PortMap());
+
+  report.str(string());
+  pBuf = cout.rdbuf(report.rdbuf());
+
+  hub.RouteReport();
+
+  cout.rdbuf(pBuf);
+
+  TEST_CHECK(report.str() ==
+    "Route data " + ports[0]->Name() + " --> " + ports[3]->Name() + " " + ports[1]->Name() + " " + ports[2]->Name() + "\n"
+    "No route for flow control\n");
+}
+///////////////////////////////////////////////////////////////
+BOOL TestRouteTable()
+{
+  TestTable();
+  TestReport();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchRouteTable()
+{
+  ComHub hub;
+  Ports ports;
+
+  if (!NewPorts(hub, 256, ports))
+    return;
+
+  PortMap map = RandomMap(ports, 4);
+  RouteTable table;
+
+  BuildRouteTable(ports, map, table);
+
+  DWORD count = 10*1000;
+  Ports::size_type sum = 0;
+
+  LONGLONG start = BenchCounter();
+
+  for (DWORD n = 0 ; n < count ; n++) {
+    for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+      for (PortMap::const_iterator iPair = map.find(*i) ; iPair != map.end() ; iPair++) {
+        if (iPair->first != *i)
+          break;
+
+        sum += iPair->second->Num();
+      }
+    }
+  }
+
+  double secondsMap = BenchSeconds(start);
+
+  start = BenchCounter();
+
+  for (DWORD n = 0 ; n < count ; n++) {
+    for (Ports::const_iterator i = ports.begin() ; i != ports.end() ; i++) {
+      Ports::size_type num = (*i)->Num();
+
+      for (Ports::size_type j = table.index[num] ; j < table.index[num + 1] ; j++)
+        sum -= table.ports[j]->Num();
+    }
+  }
+
+  double secondsTable = BenchSeconds(start);
+
+  TEST_CHECK(sum == 0);
+
+  count *= (DWORD)ports.size();
+
+  cout << "  " << ports.size() << " ports lookup: map " << DWORD(count/secondsMap/1000) << " K/s"
+       << ", table " << DWORD(count/secondsTable/1000) << " K/s" << endl;
+}
+///////////////////////////////////////////////////////////////
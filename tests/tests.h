@@ -0,0 +1,135 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#ifndef _TESTS_H_
+#define _TESTS_H_
+
+///////////////////////////////////////////////////////////////
+//
+// The checks of the portable parts of hub4com (buffers, messages,
+// ciphers, route scheduling) and the micro-benchmarks of them.
+//
+// The tests of the ciphers do not depend on Win32 and are built by
+// Makefile on other systems too.
+//
+///////////////////////////////////////////////////////////////
+#ifdef _WIN32
+
+#include "../precomp.h"
+#include "../plugins/plugins_api.h"
+
+#else  /* _WIN32 */
+
+#include "../plugins/crypt/cipherdefs.h"
+
+#include <stdlib.h>
+#include <strings.h>
+#include <time.h>
+
+#include <string>
+#include <set>
+#include <iostream>
+#include <sstream>
+
+typedef long long LONGLONG;
+
+#define _stricmp strcasecmp
+
+using namespace std;
+
+#endif /* _WIN32 */
+///////////////////////////////////////////////////////////////
+#define TEST_CHECK(cond) TestCheck((cond) != 0, #cond, __FILE__, __LINE__)
+///////////////////////////////////////////////////////////////
+BOOL TestCheck(BOOL ok, const char *pExpr, const char *pFile, int line);
+BOOL TestCheckBytes(const BYTE *pData, const char *pHex, const char *pFile, int line);
+
+#define TEST_CHECK_BYTES(pData, pHex) TestCheckBytes((pData), (pHex), __FILE__, __LINE__)
+///////////////////////////////////////////////////////////////
+LONGLONG BenchCounter();
+double BenchSeconds(LONGLONG start);
+///////////////////////////////////////////////////////////////
+//
+// Mutes cout (the plugins trace to it) while in the scope
+//
+class TestMute
+{
+  public:
+    TestMute() : pBuf(cout.rdbuf(NULL)) {}
+    ~TestMute() { cout.rdbuf(pBuf); cout.clear(); }
+
+  private:
+    streambuf *pBuf;
+};
+///////////////////////////////////////////////////////////////
+#ifdef _WIN32
+//
+// The messages of the hub for the tests of the plugins (msgutils.cpp)
+//
+HUB_MSG *TestNewData(const void *pData, DWORD size);
+string TestData(HUB_MSG *pMsg);
+void TestDeleteMsg(HUB_MSG *pMsg);
+
+//
+// The path of the file in the temporary directory (main.cpp)
+//
+string TestTempPath(const char *pName);
+#endif /* _WIN32 */
+///////////////////////////////////////////////////////////////
+BOOL TestAsync();
+void BenchAsync();
+BOOL TestBufPool();
+void BenchBufPool();
+BOOL TestCipher();
+void BenchCipher();
+BOOL TestEscParse();
+void BenchEscParse();
+BOOL TestFanOut();
+void BenchFanOut();
+BOOL TestFilterX();
+void BenchFilterX();
+BOOL TestFilters();
+void BenchFilters();
+BOOL TestHubMsg();
+void BenchHubMsg();
+BOOL TestLatencyHist();
+void BenchLatencyHist();
+BOOL TestRoute();
+void BenchRoute();
+BOOL TestRouteTable();
+void BenchRouteTable();
+BOOL TestScaling();
+void BenchScaling();
+BOOL TestStats();
+void BenchStats();
+BOOL TestTag();
+void BenchTag();
+BOOL TestTelnet();
+void BenchTelnet();
+BOOL TestTrace();
+void BenchTrace();
+///////////////////////////////////////////////////////////////
+
+#endif /* _TESTS_H_ */
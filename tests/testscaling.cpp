@@ -0,0 +1,292 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+
+#include "tests.h"
+
+#include "../latency.h"
+#include "../stats.h"
+#include "../port.h"
+#include "../comhub.h"
+#include "../hubmsg.h"
+#include "../bufutils.h"
+#include "../export.h"
+
+///////////////////////////////////////////////////////////////
+namespace PortConnector {
+PLUGIN_INIT_A InitA;
+}
+///////////////////////////////////////////////////////////////
+//
+// Each group of ports is an independent component of the hub:
+//
+//   S<g> --route--> A<g> ==connector==> B<g> --route--> D<g>
+//
+// The data read by the source port S<g> with the fake driver is
+// routed to the connector port A<g>, read by the connected port B<g>
+// and routed to the sink port D<g> with the fake driver. The groups
+// are driven by 1 ... N threads, each thread drives its own groups
+// as the hub threads do with --threads=N.
+//
+///////////////////////////////////////////////////////////////
+#define NUM_GROUPS      16
+#define PORTS_IN_GROUP  4
+
+#define PORT_S(g)       ((g)*PORTS_IN_GROUP)
+#define PORT_A(g)       ((g)*PORTS_IN_GROUP + 1)
+#define PORT_B(g)       ((g)*PORTS_IN_GROUP + 2)
+#define PORT_D(g)       ((g)*PORTS_IN_GROUP + 3)
+///////////////////////////////////////////////////////////////
+// the bytes written to the sink port D<g> (a cache line per group
+// since the groups are driven by the different threads)
+
+static struct {
+  LONGLONG bytes;
+  DWORD sum;
+  BYTE pad[64 - sizeof(LONGLONG) - sizeof(DWORD)];
+} sinks[NUM_GROUPS];
+///////////////////////////////////////////////////////////////
+static HPORT CALLBACK Create(
+    HCONFIG hConfig,
+    const char * /*pPath*/)
+{
+  // the group number + 1 is passed by hConfig
+
+  return (HPORT)hConfig;
+}
+
+static BOOL CALLBACK Write(
+    HPORT hPort,
+    HUB_MSG *pMsg)
+{
+  if (pMsg->type != HUB_MSG_TYPE_LINE_DATA)
+    return TRUE;
+
+  int g = int((ULONG_PTR)hPort - 1);
+
+  sinks[g].bytes += pMsg->u.buf.size;
+
+  for (DWORD i = 0 ; i < pMsg->u.buf.size ; i++)
+    sinks[g].sum += pMsg->u.buf.pBuf[i];
+
+  return TRUE;
+}
+
+static const PORT_ROUTINES_A routines = {
+  sizeof(PORT_ROUTINES_A),
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Create,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  Write,
+  NULL,
+};
+///////////////////////////////////////////////////////////////
+static BOOL NewGroups(ComHub &hub)
+{
+  const PLUGIN_ROUTINES_A *const *pPlugins = PortConnector::InitA(&hubRoutines);
+
+  if (!TEST_CHECK(pPlugins != NULL && pPlugins[0] != NULL))
+    return FALSE;
+
+  const PORT_ROUTINES_A *pConnector = (const PORT_ROUTINES_A *)pPlugins[0];
+  HCONFIG hConfig = pConnector->pConfigStart();
+
+  PortMap map;
+
+  for (int g = 0 ; g < NUM_GROUPS ; g++) {
+    stringstream a, b, connect;
+
+    a << "A" << g;
+    b << "B" << g;
+    connect << "--connect=" << a.str() << ":" << b.str();
+
+    if (!TEST_CHECK(pConnector->pConfig(hConfig, connect.str().c_str())))
+      return FALSE;
+
+    for (int i = 0 ; i < PORTS_IN_GROUP ; i++)
+      hub.Add();
+
+    if (!TEST_CHECK(hub.InitPort(PORT_S(g), &routines, (HCONFIG)(ULONG_PTR)(g + 1), "source")) ||
+        !TEST_CHECK(hub.InitPort(PORT_A(g), pConnector, hConfig, a.str().c_str())) ||
+        !TEST_CHECK(hub.InitPort(PORT_B(g), pConnector, hConfig, b.str().c_str())) ||
+        !TEST_CHECK(hub.InitPort(PORT_D(g), &routines, (HCONFIG)(ULONG_PTR)(g + 1), "sink")))
+    {
+      return FALSE;
+    }
+
+    map.insert(pair<Port *const, Port *>(hub.GetPort(PORT_S(g)), hub.GetPort(PORT_A(g))));
+    map.insert(pair<Port *const, Port *>(hub.GetPort(PORT_B(g)), hub.GetPort(PORT_D(g))));
+  }
+
+  {
+    TestMute mute;
+
+    pConnector->pConfigStop(hConfig);
+  }
+
+  hub.SetDataRoute(map);
+
+  memset(sinks, 0, sizeof(sinks));
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+struct Driver {
+  ComHub *pHub;
+  int first;      // the groups first, first + step, ...
+  int step;
+  int count;      // the messages read by each source port
+  DWORD size;
+};
+
+static DWORD CALLBACK DriverProc(LPVOID pParam)
+{
+  const Driver *pDriver = (const Driver *)pParam;
+
+  // the messages and buffers are allocated from the pools of the
+  // driving thread, as the hub threads do for their ports
+
+  for (int i = 0 ; i < pDriver->count ; i++) {
+    for (int g = pDriver->first ; g < NUM_GROUPS ; g += pDriver->step) {
+      HubMsg *pMsg = new HubMsg();
+
+      pMsg->type = HUB_MSG_TYPE_LINE_DATA;
+      pMsg->u.buf.pBuf = BufAlloc(pDriver->size);
+      pMsg->u.buf.size = pDriver->size;
+
+      memset(pMsg->u.buf.pBuf, g + 1, pDriver->size);
+
+      pDriver->pHub->OnRead(pDriver->pHub->GetPort(PORT_S(g)), pMsg);
+
+      delete pMsg;
+    }
+  }
+
+  return 0;
+}
+
+static double Drive(ComHub &hub, int numThreads, int count, DWORD size)
+{
+  vector<Driver> drivers(numThreads);
+  vector<HANDLE> threads;
+
+  LONGLONG start = BenchCounter();
+
+  for (int t = 0 ; t < numThreads ; t++) {
+    drivers[t].pHub = &hub;
+    drivers[t].first = t;
+    drivers[t].step = numThreads;
+    drivers[t].count = count;
+    drivers[t].size = size;
+
+    DWORD id;
+    HANDLE hThread = ::CreateThread(NULL, 0, DriverProc, &drivers[t], 0, &id);
+
+    if (!TEST_CHECK(hThread != NULL))
+      break;
+
+    threads.push_back(hThread);
+  }
+
+  // the pools of the finished threads are left to the process exit
+
+  for (vector<HANDLE>::const_iterator i = threads.begin() ; i != threads.end() ; i++) {
+    ::WaitForSingleObject(*i, INFINITE);
+    ::CloseHandle(*i);
+  }
+
+  return BenchSeconds(start);
+}
+///////////////////////////////////////////////////////////////
+static void TestGroups(int numThreads)
+{
+  ComHub hub;
+
+  if (!NewGroups(hub))
+    return;
+
+  Drive(hub, numThreads, 100, 50);
+
+  // each sink gets the data of its own source only
+
+  for (int g = 0 ; g < NUM_GROUPS ; g++) {
+    if (!TEST_CHECK(sinks[g].bytes == 100*50) ||
+        !TEST_CHECK(sinks[g].sum == DWORD(100*50*(g + 1))))
+    {
+      cout << "  group " << g << " of " << numThreads << " threads" << endl;
+      break;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+BOOL TestScaling()
+{
+  TestGroups(1);
+  TestGroups(4);
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchScaling()
+{
+  static const int count = 20000;
+  static const DWORD size = 256;
+
+  SYSTEM_INFO sysInfo;
+
+  ::GetSystemInfo(&sysInfo);
+
+  cout << "  " << NUM_GROUPS << " groups of connector ports on "
+       << sysInfo.dwNumberOfProcessors << " processor(s):" << endl;
+
+  double rate1 = 0;
+
+  for (int numThreads = 1 ; numThreads <= NUM_GROUPS ; numThreads *= 2) {
+    ComHub hub;
+
+    if (!NewGroups(hub))
+      return;
+
+    double seconds = Drive(hub, numThreads, count, size);
+    double rate = double(count)*NUM_GROUPS/seconds;
+
+    if (numThreads == 1)
+      rate1 = rate;
+
+    cout << "  " << numThreads << " thread(s): " << DWORD(rate/1000) << " K msg/s, "
+         << DWORD(rate*size/(1024*1024)) << " MB/s, x"
+         << DWORD(rate/rate1*10 + 0.5)/10 << "." << DWORD(rate/rate1*10 + 0.5)%10 << endl;
+  }
+}
+///////////////////////////////////////////////////////////////
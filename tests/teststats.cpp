@@ -0,0 +1,135 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+
+#include "tests.h"
+
+#include "../stats.h"
+
+///////////////////////////////////////////////////////////////
+static string ReadFile(const string &path)
+{
+  ifstream in(path.c_str(), ios::in | ios::binary);
+  ostringstream buf;
+
+  buf << in.rdbuf();
+
+  return buf.str();
+}
+///////////////////////////////////////////////////////////////
+static string Saved(Stats::Format format, const string &port, const char *pFilter)
+{
+  string path = TestTempPath("hub4com-teststats.txt");
+  Stats stats(path.c_str(), format);
+
+  stats.Add("test_total", STATS_TYPE_COUNTER, port, pFilter, 123);
+  stats.Save();
+
+  string saved = ReadFile(path);
+
+  ::DeleteFile(path.c_str());
+
+  return saved;
+}
+///////////////////////////////////////////////////////////////
+static void TestJson()
+{
+  string json = Saved(Stats::FORMAT_JSON, string("a\"b\\c\x01\t\n\r\x1F", 10), "f\x7F");
+
+  TEST_CHECK(json.find("\"port\": \"a\\\"b\\\\c\\u0001\\u0009\\u000a\\u000d\\u001f\"") != string::npos);
+  TEST_CHECK(json.find("\"filter\": \"f\x7F\"") != string::npos);
+  TEST_CHECK(json.find("\"value\": 123") != string::npos);
+
+  // no control chars inside of the strings
+
+  BOOL inString = FALSE;
+
+  for (string::size_type i = 0 ; i < json.size() ; i++) {
+    if (json[i] == '\\' && inString)
+      i++;
+    else
+    if (json[i] == '"')
+      inString = !inString;
+    else
+    if (inString && !TEST_CHECK((BYTE)json[i] >= 0x20))
+      break;
+  }
+}
+///////////////////////////////////////////////////////////////
+static void TestPrometheus()
+{
+  string text = Saved(Stats::FORMAT_PROMETHEUS, "a\"b\\c\t\n", NULL);
+
+  TEST_CHECK(text == "# TYPE test_total counter\n"
+                     "test_total{port=\"a\\\"b\\\\c\t\\n\"} 123\n");
+}
+///////////////////////////////////////////////////////////////
+BOOL TestStats()
+{
+  TestJson();
+  TestPrometheus();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchStats()
+{
+  static const int numPorts = 64;
+  static const int count = 100;
+
+  static const Stats::Format formats[] = { Stats::FORMAT_PROMETHEUS, Stats::FORMAT_JSON };
+  static const char *names[] = { "prometheus", "json" };
+
+  string path = TestTempPath("hub4com-benchstats.txt");
+
+  for (int f = 0 ; f < int(sizeof(formats)/sizeof(formats[0])) ; f++) {
+    Stats stats(path.c_str(), formats[f]);
+
+    LONGLONG start = BenchCounter();
+
+    for (int i = 0 ; i < count ; i++) {
+      for (int p = 0 ; p < numPorts ; p++) {
+        stringstream port;
+
+        port << "COM" << p;
+
+        MsgStats msgStats;
+
+        msgStats.Report(stats, "hub4com_read", port.str());
+        msgStats.Report(stats, "hub4com_write", port.str(), "trace");
+      }
+
+      stats.Save();
+    }
+
+    double seconds = BenchSeconds(start);
+
+    cout << "  " << numPorts << " ports " << names[f] << ": "
+         << DWORD(count/seconds) << " saves/s" << endl;
+  }
+
+  ::DeleteFile(path.c_str());
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,273 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+#include "../hubmsg.h"
+#include "../bufutils.h"
+#include "../export.h"
+
+///////////////////////////////////////////////////////////////
+namespace FilterTag {
+PLUGIN_INIT_A InitA;
+}
+///////////////////////////////////////////////////////////////
+//
+// The instance of the tag or tag-sync filter
+//
+class Tag
+{
+  public:
+    Tag(int iPlugin, const char *pArg1, const char *pArg2 = NULL);
+    ~Tag();
+
+    // returns the data filtered in the chunks of the chunk size
+    string In(const string &data, string::size_type chunk);
+    string Out(const string &data, string::size_type chunk);
+
+    void Out(HUB_MSG *pMsg);
+
+  private:
+    string Filter(BOOL out, const string &data, string::size_type chunk);
+
+    const FILTER_ROUTINES_A *pRoutines;
+    HFILTER hFilter;
+    HFILTERINSTANCE hFilterInstance;
+};
+
+Tag::Tag(int iPlugin, const char *pArg1, const char *pArg2)
+  : pRoutines(NULL),
+    hFilter(NULL),
+    hFilterInstance(NULL)
+{
+  const PLUGIN_ROUTINES_A *const *pPlugins = FilterTag::InitA(&hubRoutines);
+
+  if (!TEST_CHECK(pPlugins != NULL))
+    return;
+
+  pRoutines = (const FILTER_ROUTINES_A *)pPlugins[iPlugin];
+
+  const char *const argv[] = { "tag", pArg1, pArg2 };
+
+  hFilter = pRoutines->pCreate((HMASTERFILTER)1, NULL, pArg2 ? 3 : 2, argv);
+
+  if (TEST_CHECK(hFilter != NULL))
+    hFilterInstance = pRoutines->pCreateInstance((HMASTERFILTERINSTANCE)1);
+}
+
+Tag::~Tag()
+{
+  if (hFilterInstance)
+    pRoutines->pDeleteInstance(hFilterInstance);
+
+  if (hFilter)
+    pRoutines->pDelete(hFilter);
+}
+
+string Tag::In(const string &data, string::size_type chunk)
+{
+  return Filter(FALSE, data, chunk);
+}
+
+string Tag::Out(const string &data, string::size_type chunk)
+{
+  return Filter(TRUE, data, chunk);
+}
+
+void Tag::Out(HUB_MSG *pMsg)
+{
+  TEST_CHECK(pRoutines->pOutMethod(hFilter, hFilterInstance, (HMASTERPORT)1, pMsg));
+}
+
+string Tag::Filter(BOOL out, const string &data, string::size_type chunk)
+{
+  string res;
+
+  if (!hFilterInstance)
+    return res;
+
+  for (string::size_type pos = 0 ; pos < data.size() ; pos += chunk) {
+    string::size_type size = min(chunk, data.size() - pos);
+    HUB_MSG *pMsg = TestNewData(data.data() + pos, (DWORD)size);
+
+    if (out) {
+      Out(pMsg);
+    } else {
+      HUB_MSG *pEchoMsg = NULL;
+
+      TEST_CHECK(pRoutines->pInMethod(hFilter, hFilterInstance, pMsg, &pEchoMsg));
+      TEST_CHECK(pEchoMsg == NULL);
+    }
+
+    res += TestData(pMsg);
+
+    TestDeleteMsg(pMsg);
+  }
+
+  return res;
+}
+///////////////////////////////////////////////////////////////
+//
+// The values tagged by 48, 49 and 50 in turn
+//
+static string Tagged(DWORD size)
+{
+  string data;
+
+  for (DWORD i = 0 ; i < size ; i++) {
+    data += char('0' + i % 3);
+    data += char('a' + i % 26);
+  }
+
+  return data;
+}
+///////////////////////////////////////////////////////////////
+static void TestExamples()
+{
+  {
+    Tag tag(0, "--tag=48");
+
+    TEST_CHECK(tag.In("abc", 3) == "0a0b0c");
+    TEST_CHECK(tag.Out("0a1e0b1f0c1g0d1h", 16) == "abcd");
+  }
+
+  {
+    Tag tag(1, "--sync=120");
+
+    TEST_CHECK(tag.In("x0a1ex0b1f0c1gx0d1h", 19) == "0a1e0b1f0c1g0d1h");
+    TEST_CHECK(tag.Out("0a1e0b1f0c1g0d1h", 16) == "x0a1e0b1f0c1g0d1h");
+  }
+
+  {
+    Tag tag(1, "--sync=120", "--period=3");
+
+    TEST_CHECK(tag.Out("0a1e0b1f0c1g0d1h", 16) == "x0a1e0bx1f0c1gx0d1h");
+  }
+}
+///////////////////////////////////////////////////////////////
+static void TestChunks(
+    int iPlugin,
+    const char *pArg1,
+    const char *pArg2,
+    BOOL out,
+    const string &data)
+{
+  string expected;
+
+  {
+    Tag tag(iPlugin, pArg1, pArg2);
+
+    expected = out ? tag.Out(data, data.size()) : tag.In(data, data.size());
+  }
+
+  for (string::size_type chunk = 1 ; chunk <= data.size() ; chunk++) {
+    Tag tag(iPlugin, pArg1, pArg2);
+
+    if (!TEST_CHECK((out ? tag.Out(data, chunk) : tag.In(data, chunk)) == expected)) {
+      cerr << "  " << pArg1 << (out ? " OUT" : " IN") << " in chunks of " << chunk << endl;
+      break;
+    }
+  }
+}
+
+static void TestChunks(int iPlugin, const char *pArg, BOOL out, const string &data)
+{
+  TestChunks(iPlugin, pArg, NULL, out, data);
+}
+
+static void TestChunks()
+{
+  string data = Tagged(50);
+
+  TestChunks(0, "--tag=49", TRUE, data);
+  TestChunks(1, "--sync=120", TRUE, data);
+  TestChunks(1, "--sync=120", TRUE, data.substr(1));
+  TestChunks(1, "--sync=120", "--period=3", TRUE, data);
+
+  {
+    Tag tag(1, "--sync=120");
+
+    TestChunks(1, "--sync=120", FALSE, tag.Out(data, data.size()));
+  }
+}
+///////////////////////////////////////////////////////////////
+static void TestShared()
+{
+  // the shared data are not changed in place
+
+  Tag tag(0, "--tag=48");
+  HUB_MSG *pMsg = TestNewData("0a1b0c", 6);
+  HubMsg *pClone = ((HubMsg *)pMsg)->Clone();
+
+  if (TEST_CHECK(pClone != NULL)) {
+    tag.Out(pClone);
+
+    TEST_CHECK(TestData(pClone) == "ac");
+    TEST_CHECK(TestData(pMsg) == "0a1b0c");
+
+    TestDeleteMsg(pClone);
+  }
+
+  TestDeleteMsg(pMsg);
+}
+///////////////////////////////////////////////////////////////
+BOOL TestTag()
+{
+  TestExamples();
+  TestChunks();
+  TestShared();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static void BenchTag(int iPlugin, const char *pArg1, const char *pArg2)
+{
+  static const DWORD size = 1024*1024;
+
+  string data = Tagged(size/2);
+
+  cout << "  " << pArg1 << (pArg2 ? " " : "") << (pArg2 ? pArg2 : "") << " OUT:";
+
+  for (string::size_type chunk = 1 ; chunk <= 64*1024 ; chunk *= 16) {
+    Tag tag(iPlugin, pArg1, pArg2);
+
+    LONGLONG start = BenchCounter();
+
+    tag.Out(data, chunk);
+
+    double seconds = BenchSeconds(start);
+
+    cout << " " << DWORD(size/seconds/(1024*1024)) << " MB/s (" << chunk << ")";
+  }
+
+  cout << endl;
+}
+
+void BenchTag()
+{
+  BenchTag(0, "--tag=49", NULL);
+  BenchTag(1, "--sync=120", "--period=3");
+}
+///////////////////////////////////////////////////////////////
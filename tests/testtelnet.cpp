@@ -0,0 +1,523 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+#include "tests.h"
+
+#include "../export.h"
+
+///////////////////////////////////////////////////////////////
+namespace FilterTelnet {
+#include "../plugins/telnet/import.h"
+#include "../plugins/telnet/telnet.h"
+
+PLUGIN_INIT_A InitA;
+}
+
+using namespace FilterTelnet;
+///////////////////////////////////////////////////////////////
+enum {
+  SE   = TelnetProtocol::cdSE,
+  NOP  = TelnetProtocol::cdNOP,
+  SB   = TelnetProtocol::cdSB,
+  WILL = TelnetProtocol::cdWILL,
+  WONT = TelnetProtocol::cdWONT,
+  DO   = TelnetProtocol::cdDO,
+  DONT = TelnetProtocol::cdDONT,
+  IAC  = TelnetProtocol::cdIAC,
+  CR   = 13,
+};
+///////////////////////////////////////////////////////////////
+//
+// The byte at a time codec of the previous revision of telnet.cpp
+// (without the registered options)
+//
+static string RefEncode(const string &data, const string &padding)
+{
+  string encoded;
+
+  for (string::size_type i = 0 ; i < data.size() ; i++) {
+    BYTE ch = data[i];
+
+    if (ch == IAC)
+      encoded += ch;
+
+    encoded += ch;
+
+    if (ch == CR)
+      encoded += padding;
+  }
+
+  return encoded;
+}
+
+static void RefDecode(const string &data, string &decoded, string &echo)
+{
+  enum { stData, stCode, stOption, stSubParams, stSubCode } state = stData;
+  BYTE code = 0;
+
+  for (string::size_type i = 0 ; i < data.size() ; i++) {
+    BYTE ch = data[i];
+
+    switch (state) {
+      case stData:
+        if (ch == IAC)
+          state = stCode;
+        else
+          decoded += ch;
+        break;
+      case stCode:
+        switch (ch) {
+          case IAC:
+            decoded += ch;
+            state = stData;
+            break;
+          case SB:
+          case WILL:
+          case WONT:
+          case DO:
+          case DONT:
+            code = ch;
+            state = stOption;
+            break;
+          default:
+            state = stData;
+        }
+        break;
+      case stOption:
+        if (code == WILL || code == DO) {
+          echo += (char)IAC;
+          echo += (char)(code == WILL ? DONT : WONT);
+          echo += ch;
+        }
+        state = (code == SB) ? stSubParams : stData;
+        break;
+      case stSubParams:
+        if (ch == IAC)
+          state = stSubCode;
+        break;
+      case stSubCode:
+        state = (ch == IAC) ? stSubParams : stData;
+        break;
+    }
+  }
+}
+///////////////////////////////////////////////////////////////
+//
+// Feeds the data in the chunks ending at the splits
+//
+class TestCodec
+{
+  public:
+    TestCodec(const string &padding = string(), BOOL binary = FALSE) : telnet(NULL) {
+      telnet.SetAsciiCrPadding(BYTE_string((const BYTE *)padding.data(), padding.size()));
+
+      if (binary)
+        (new TelnetOption(telnet, 0 /*TRANSMIT-BINARY*/))->LocalWill();
+
+      telnet.Start();
+
+      // discard the negotiation of the started options
+      Echo();
+    }
+
+    string Encode(const string &data, const vector<string::size_type> &splits) {
+      return Feed(data, splits, &TelnetProtocol::Encode);
+    }
+
+    string Decode(const string &data, const vector<string::size_type> &splits) {
+      return Feed(data, splits, &TelnetProtocol::Decode);
+    }
+
+    string Echo() {
+      HUB_MSG *pEchoMsg = NULL;
+
+      telnet.FlushEncodedStream(&pEchoMsg);
+
+      if (!pEchoMsg)
+        return string();
+
+      string echo = TestData(pEchoMsg);
+
+      TestDeleteMsg(pEchoMsg);
+
+      return echo;
+    }
+
+  private:
+    string Feed(const string &data,
+                const vector<string::size_type> &splits,
+                HUB_MSG *(TelnetProtocol::*pCodec)(HUB_MSG *))
+    {
+      string res;
+      string::size_type begin = 0;
+
+      for (vector<string::size_type>::size_type i = 0 ; i <= splits.size() ; i++) {
+        string::size_type end = (i < splits.size()) ? splits[i] : data.size();
+        HUB_MSG *pMsg = TestNewData(data.data() + begin, DWORD(end - begin));
+
+        pMsg = (telnet.*pCodec)(pMsg);
+
+        if (!TEST_CHECK(pMsg != NULL))
+          break;
+
+        res += TestData(pMsg);
+        TestDeleteMsg(pMsg);
+
+        begin = end;
+      }
+
+      return res;
+    }
+
+    TestMute mute;
+    TelnetProtocol telnet;
+};
+///////////////////////////////////////////////////////////////
+static string Bytes(const BYTE *pData, size_t size)
+{
+  return string((const char *)pData, size);
+}
+
+static vector<string::size_type> NoSplits()
+{
+  return vector<string::size_type>();
+}
+
+static vector<string::size_type> Split(string::size_type pos)
+{
+  return vector<string::size_type>(1, pos);
+}
+
+static vector<string::size_type> SplitEach(string::size_type size)
+{
+  vector<string::size_type> splits;
+
+  for (string::size_type pos = 1 ; pos < size ; pos++)
+    splits.push_back(pos);
+
+  return splits;
+}
+///////////////////////////////////////////////////////////////
+static void TestEncode()
+{
+  static const BYTE data[] = { 'a', CR, 10, 'b', IAC, 'c', IAC, IAC, CR, CR, 'd', CR, IAC };
+  string org = Bytes(data, sizeof(data));
+  string padding("\0", 1);
+
+  {
+    static const BYTE expected[] = {
+      'a', CR, 0, 10, 'b', IAC, IAC, 'c', IAC, IAC, IAC, IAC, CR, 0, CR, 0, 'd', CR, 0, IAC, IAC
+    };
+
+    TEST_CHECK(RefEncode(org, padding) == Bytes(expected, sizeof(expected)));
+  }
+
+  // the IAC and CR at the ends of the chunks
+
+  for (string::size_type pos = 0 ; pos <= org.size() ; pos++) {
+    TestCodec codec(padding);
+
+    TEST_CHECK(codec.Encode(org, Split(pos)) == RefEncode(org, padding));
+  }
+
+  {
+    TestCodec codec(padding);
+
+    TEST_CHECK(codec.Encode(org, SplitEach(org.size())) == RefEncode(org, padding));
+  }
+
+  // no padding without the option or with TRANSMIT-BINARY
+
+  {
+    TestCodec codec;
+
+    TEST_CHECK(codec.Encode(org, NoSplits()) == RefEncode(org, string()));
+  }
+
+  {
+    TestCodec codec(padding, TRUE);
+
+    TEST_CHECK(codec.Encode(org, NoSplits()) == RefEncode(org, string()));
+  }
+
+  // the data without IAC and CR is passed as is
+
+  {
+    TestMute mute;
+    TelnetProtocol telnet(NULL);
+
+    telnet.SetAsciiCrPadding(BYTE_string((const BYTE *)padding.data(), padding.size()));
+    telnet.Start();
+
+    HUB_MSG *pMsg = TestNewData("abc\n", 4);
+    BYTE *pBuf = pMsg->u.buf.pBuf;
+
+    TEST_CHECK(telnet.Encode(pMsg) == pMsg);
+    TEST_CHECK(pMsg->u.buf.pBuf == pBuf);
+
+    TestDeleteMsg(pMsg);
+  }
+}
+///////////////////////////////////////////////////////////////
+static void TestDecodeOne(const string &data)
+{
+  string decoded;
+  string echo;
+
+  RefDecode(data, decoded, echo);
+
+  // the command at the ends of the chunks
+
+  for (string::size_type pos = 0 ; pos <= data.size() ; pos++) {
+    TestCodec codec;
+
+    TEST_CHECK(codec.Decode(data, Split(pos)) == decoded);
+    TEST_CHECK(codec.Echo() == echo);
+  }
+
+  TestCodec codec;
+
+  TEST_CHECK(codec.Decode(data, SplitEach(data.size())) == decoded);
+  TEST_CHECK(codec.Echo() == echo);
+}
+
+static void TestDecode()
+{
+  {
+    static const BYTE data[] = {
+      'a', IAC, IAC, 'b', IAC, NOP, 'c', IAC, WILL, 1, IAC, DO, 3, IAC, WONT, 5, IAC, DONT, 6, 'd'
+    };
+    static const BYTE decoded[] = { 'a', IAC, 'b', 'c', 'd' };
+    static const BYTE echo[] = { IAC, DONT, 1, IAC, WONT, 3 };
+
+    string refDecoded;
+    string refEcho;
+
+    RefDecode(Bytes(data, sizeof(data)), refDecoded, refEcho);
+
+    TEST_CHECK(refDecoded == Bytes(decoded, sizeof(decoded)));
+    TEST_CHECK(refEcho == Bytes(echo, sizeof(echo)));
+
+    TestDecodeOne(Bytes(data, sizeof(data)));
+  }
+
+  {
+    // the sub negotiation with IAC IAC in the parameters and the unknown codes
+
+    static const BYTE data[] = {
+      'a', IAC, SB, 44, 1, IAC, IAC, 2, IAC, SE, 'b', IAC, 200, 'c', IAC, SB, 44, IAC, 7, 'd', CR
+    };
+    static const BYTE decoded[] = { 'a', 'b', 'c', 'd', CR };
+
+    string refDecoded;
+    string refEcho;
+
+    RefDecode(Bytes(data, sizeof(data)), refDecoded, refEcho);
+
+    TEST_CHECK(refDecoded == Bytes(decoded, sizeof(decoded)));
+    TEST_CHECK(refEcho.empty());
+
+    TestDecodeOne(Bytes(data, sizeof(data)));
+  }
+
+  // the data without commands is passed as is
+
+  {
+    TestMute mute;
+    TelnetProtocol telnet(NULL);
+
+    telnet.Start();
+
+    HUB_MSG *pMsg = TestNewData("abc\r\n", 5);
+    BYTE *pBuf = pMsg->u.buf.pBuf;
+
+    TEST_CHECK(telnet.Decode(pMsg) == pMsg);
+    TEST_CHECK(pMsg->u.buf.pBuf == pBuf);
+
+    TestDeleteMsg(pMsg);
+  }
+}
+///////////////////////////////////////////////////////////////
+//
+// The random stream of the data and the commands
+//
+static string RandomCommands(DWORD size, DWORD percentCommands)
+{
+  string data;
+
+  while (data.size() < size) {
+    if (DWORD(rand() % 100) >= percentCommands) {
+      BYTE ch = BYTE(rand());
+
+      data += (char)(ch == IAC ? CR : ch);
+      continue;
+    }
+
+    data += (char)IAC;
+
+    switch (rand() % 6) {
+      case 0:
+        data += (char)IAC;
+        break;
+      case 1:
+        data += (char)NOP;
+        break;
+      case 2: {
+        static const BYTE codes[] = { WILL, WONT, DO, DONT };
+
+        data += (char)codes[rand() % 4];
+        data += (char)(rand() % IAC);
+        break;
+      }
+      case 3:
+        data += (char)SB;
+        data += (char)(rand() % IAC);
+
+        for (int i = rand() % 4 ; i ; i--) {
+          BYTE ch = BYTE(rand());
+
+          data += (char)ch;
+
+          if (ch == IAC)
+            data += (char)IAC;
+        }
+
+        data += (char)IAC;
+        data += (char)SE;
+        break;
+      default:
+        data += (char)(rand() % SE);
+    }
+  }
+
+  return data;
+}
+
+static void TestRandom()
+{
+  srand(1);
+
+  string padding("\0", 1);
+
+  for (int n = 0 ; n < 20 ; n++) {
+    string data = RandomCommands(200 + rand() % 200, 5 + n*5);
+    vector<string::size_type> splits;
+
+    for (string::size_type pos = rand() % 16 + 1 ; pos < data.size() ; pos += rand() % 16 + 1)
+      splits.push_back(pos);
+
+    string decoded;
+    string echo;
+
+    RefDecode(data, decoded, echo);
+
+    TestCodec codec(padding);
+
+    TEST_CHECK(codec.Decode(data, splits) == decoded);
+    TEST_CHECK(codec.Echo() == echo);
+    TEST_CHECK(codec.Encode(data, splits) == RefEncode(data, padding));
+  }
+}
+///////////////////////////////////////////////////////////////
+BOOL TestTelnet()
+{
+  if (!TEST_CHECK(InitA(&hubRoutines) != NULL))
+    return FALSE;
+
+  TestEncode();
+  TestDecode();
+  TestRandom();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+static void BenchCodec(const char *pName, const string &data)
+{
+  static const string::size_type chunk = 4096;
+  vector<string::size_type> splits;
+
+  for (string::size_type pos = chunk ; pos < data.size() ; pos += chunk)
+    splits.push_back(pos);
+
+  int count = 20;
+  double secondsEncode;
+  double secondsDecode;
+
+  {
+    TestCodec codec(string("\0", 1));
+
+    LONGLONG start = BenchCounter();
+
+    for (int i = 0 ; i < count ; i++)
+      codec.Encode(data, splits);
+
+    secondsEncode = BenchSeconds(start);
+
+    start = BenchCounter();
+
+    for (int i = 0 ; i < count ; i++)
+      codec.Decode(data, splits);
+
+    secondsDecode = BenchSeconds(start);
+  }
+
+  double mb = double(data.size())*count/(1024*1024);
+
+  cout << "  " << pName << ": encode " << DWORD(mb/secondsEncode) << " MB/s"
+       << ", decode " << DWORD(mb/secondsDecode) << " MB/s" << endl;
+}
+
+void BenchTelnet()
+{
+  static const DWORD size = 1024*1024;
+
+  srand(1);
+
+  string random;
+
+  while (random.size() < size) {
+    BYTE ch = BYTE(rand());
+
+    // no commands, but the IAC IAC escapes
+    random += (char)ch;
+
+    if (ch == IAC)
+      random += (char)ch;
+  }
+
+  string ascii;
+
+  while (ascii.size() < size) {
+    ascii += string(40 + rand() % 40, char('a' + rand() % 26));
+    ascii += "\r\n";
+  }
+
+  string commands = RandomCommands(size, 20);
+
+  BenchCodec("random", random);
+  BenchCodec("ascii", ascii);
+  BenchCodec("IAC-heavy", commands);
+}
+///////////////////////////////////////////////////////////////
@@ -0,0 +1,216 @@
+/*
+ * $Id$
+ *
+ * Copyright (c) 2026 Vyacheslav Frolov
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * $Log$
+ *
+ */
+
+
+
+#include "tests.h"
+
+#include <iomanip>
+
+///////////////////////////////////////////////////////////////
+namespace FilterTrace {
+#include "../plugins/trace/print.h"
+#include "../plugins/trace/tracebin.h"
+}
+///////////////////////////////////////////////////////////////
+using namespace FilterTrace;
+///////////////////////////////////////////////////////////////
+//
+// The text format of the trace filter (w/o --trace-format=binary)
+//
+static void PrintText(
+    ostream &tout,
+    WORD type,
+    const char *pPort,
+    const char *pFilter,
+    const char *pFromPort,
+    const HUB_MSG *pMsg)
+{
+  PrintTime(tout);
+
+  if (type == TRACE_BIN_REC_IN) {
+    tout << pPort << "-(" << pFilter << ")->: ";
+  } else {
+    tout << pPort << "<-(" << pFilter << ")-" << pFromPort << ": ";
+  }
+
+  PrintMsg(tout, pMsg);
+}
+///////////////////////////////////////////////////////////////
+//
+// Removes the times (they differ in the both formats) from the
+// beginning of the lines
+//
+static string NoTimes(const string &text)
+{
+  static const char pattern[] = "dddd/dd/dd dd:dd:dd.ddd ";
+  static const string::size_type size = sizeof(pattern) - 1;
+
+  string res;
+  string::size_type pos = 0;
+
+  while (pos < text.size()) {
+    string::size_type end = text.find('\n', pos);
+
+    end = (end == string::npos) ? text.size() : end + 1;
+
+    string line = text.substr(pos, end - pos);
+    BOOL isTime = (line.size() >= size);
+
+    for (string::size_type i = 0 ; isTime && i < size ; i++) {
+      if (pattern[i] == 'd' ? !isdigit((BYTE)line[i]) : line[i] != pattern[i])
+        isTime = FALSE;
+    }
+
+    res += isTime ? line.substr(size) : line;
+    pos = end;
+  }
+
+  return res;
+}
+///////////////////////////////////////////////////////////////
+static void TestRoundTrip()
+{
+  static const BYTE data[] = "data\r\n\x00\x01\xFF";
+
+  DWORD optsVal = GO_I2O(1) | GO1_V2O_MODEM_STATUS(MODEM_STATUS_CTS);
+  HUB_MSG msgs[7];
+
+  memset(msgs, 0, sizeof(msgs));
+
+  msgs[0].type = HUB_MSG_TYPE_LINE_DATA;
+  msgs[0].u.buf.pBuf = (BYTE *)data;
+  msgs[0].u.buf.size = sizeof(data) - 1;
+
+  msgs[1].type = HUB_MSG_TYPE_LINE_DATA;
+
+  msgs[2].type = HUB_MSG_TYPE_CONNECT;
+  msgs[2].u.val = TRUE;
+
+  msgs[3].type = HUB_MSG_TYPE_SET_OUT_OPTS;
+  msgs[3].u.val = SO_V2O_PIN_STATE(PIN_STATE_RTS) | SO_SET_BR;
+
+  msgs[4].type = HUB_MSG_TYPE_GET_IN_OPTS;
+  msgs[4].u.pv.pVal = &optsVal;
+  msgs[4].u.pv.val = GO_I2O(1) | GO1_V2O_MODEM_STATUS(MODEM_STATUS_DSR) | GO1_RBR_STATUS;
+
+  msgs[5].type = HUB_MSG_TYPE_LOOP_TEST;
+  msgs[5].u.hVal = (HANDLE)(ULONG_PTR)0x1234;
+
+  msgs[6].type = HUB_MSG_TYPE_TICK;
+  msgs[6].u.hv2.hVal0 = (HANDLE)(ULONG_PTR)0x5678;
+  msgs[6].u.hv2.hVal1 = (HANDLE)(ULONG_PTR)0x9ABC;
+
+  // the sink is never closed, so the file is left in the temporary
+  // directory and overwritten by the next run
+
+  string path = TestTempPath("hub4com-testtrace.bin");
+  TraceSink *pSink = TraceSink::Open(path.c_str());
+  ostringstream expected;
+
+  pSink->Text("START\n");
+  expected << "START\n";
+
+  for (int i = 0 ; i < int(sizeof(msgs)/sizeof(msgs[0])) ; i++) {
+    WORD type = (i & 1) ? TRACE_BIN_REC_OUT : TRACE_BIN_REC_IN;
+    const char *pPort = (i & 2) ? "COM1" : "COM2";
+    const char *pFromPort = (i & 1) ? ((i & 2) ? "COM2" : "COM1") : NULL;
+
+    pSink->Msg(type, pPort, "trace", pFromPort, &msgs[i]);
+    PrintText(expected, type, pPort, "trace", pFromPort, &msgs[i]);
+  }
+
+  pSink->Flush();
+
+  ostringstream rendered;
+
+  if (!TEST_CHECK(RenderTraceBin(path.c_str(), rendered) == 0))
+    return;
+
+  TEST_CHECK(NoTimes(rendered.str()) == NoTimes(expected.str()));
+  TEST_CHECK(NoTimes(rendered.str()) != rendered.str());
+}
+///////////////////////////////////////////////////////////////
+BOOL TestTrace()
+{
+  TestRoundTrip();
+
+  return TRUE;
+}
+///////////////////////////////////////////////////////////////
+void BenchTrace()
+{
+  static const DWORD batch = 50000;  // about 3 MB of records, fits the ring
+  static const int count = 20;
+
+  BYTE data[32];
+
+  memset(data, 'x', sizeof(data));
+
+  HUB_MSG msgs[2];
+
+  memset(msgs, 0, sizeof(msgs));
+
+  msgs[0].type = HUB_MSG_TYPE_LINE_DATA;
+  msgs[0].u.buf.pBuf = data;
+  msgs[0].u.buf.size = sizeof(data);
+
+  msgs[1].type = HUB_MSG_TYPE_SET_OUT_OPTS;
+  msgs[1].u.val = SO_V2O_PIN_STATE(PIN_STATE_RTS|PIN_STATE_DTR);
+
+  const char *names[2] = { "LINE_DATA of 32 bytes", "SET_OUT_OPTS" };
+
+  TraceSink *pSink = TraceSink::Open(TestTempPath("hub4com-benchtrace.bin").c_str());
+  ofstream text(TestTempPath("hub4com-benchtrace.txt").c_str());
+
+  for (int m = 0 ; m < int(sizeof(msgs)/sizeof(msgs[0])) ; m++) {
+    double seconds = 0;
+
+    // only the calls on the hub thread are timed, not the writer thread
+
+    for (int i = 0 ; i < count ; i++) {
+      LONGLONG start = BenchCounter();
+
+      for (DWORD j = 0 ; j < batch ; j++)
+        pSink->Msg(TRACE_BIN_REC_IN, "COM1", "trace", NULL, &msgs[m]);
+
+      seconds += BenchSeconds(start);
+
+      pSink->Flush();
+    }
+
+    double binary = batch*count/seconds/1000;
+
+    LONGLONG start = BenchCounter();
+
+    for (DWORD j = 0 ; j < batch ; j++)
+      PrintText(text, TRACE_BIN_REC_IN, "COM1", "trace", NULL, &msgs[m]);
+
+    double txt = batch/BenchSeconds(start)/1000;
+
+    cout << "  " << names[m] << ": binary " << DWORD(binary) << " K msg/s, text "
+         << DWORD(txt) << " K msg/s" << endl;
+  }
+}
+///////////////////////////////////////////////////////////////
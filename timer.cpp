@@ -35,6 +35,8 @@
 
 #include "timer.h"
 #include "comhub.h"
+#include "latency.h"
+#include "stats.h"
 #include "port.h"
 #include "hubmsg.h"
 ///////////////////////////////////////////////////////////////